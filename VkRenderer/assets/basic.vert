@@ -2,11 +2,7 @@
 
 #include "sceneData.glsl"
 
-layout(location = 0) in vec3 inPosition;
-layout(location = 1) in vec3 inNormal;
-layout(location = 2) in vec2 inTexCoord;
-layout(location = 3) in vec3 inTangent;
-layout(location = 4) in vec3 inBitangent;
+#include "vertexInput.glsl"
 
 layout(location = 0) out VertexData{
     vec3 fragPos;
@@ -17,19 +13,17 @@ layout(location = 0) out VertexData{
     vec4 fragPosLightSpace;
 } data;
 
-layout(push_constant) uniform push {
-	mat4 model;
-} transform;
-
 void main() {
-    mat3 normalMatrix = transpose(inverse(mat3(transform.model)));
+    MeshVertex v = loadVertex();
+    mat4 model = loadModelMatrix();
+    mat3 normalMatrix = transpose(inverse(mat3(model)));
 
-    data.fragPos = vec3(transform.model * vec4(inPosition, 1.0));
-    data.normal = normalize(normalMatrix * inNormal);
-    data.tangent = normalize(normalMatrix * inTangent);
-    data.bitangent = normalize(normalMatrix * inBitangent);
+    data.fragPos = vec3(model * vec4(v.position, 1.0));
+    data.normal = normalize(normalMatrix * v.normal);
+    data.tangent = normalize(normalMatrix * v.tangent);
+    data.bitangent = normalize(normalMatrix * v.bitangent);
     data.fragPosLightSpace = u_scene.lightSpace * vec4(data.fragPos, 1.0);
-    data.texCoord = inTexCoord;
+    data.texCoord = v.texCoord;
 
     gl_Position = u_scene.proj * u_scene.view * vec4(data.fragPos, 1.0);
 }
\ No newline at end of file
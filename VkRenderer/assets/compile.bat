@@ -12,7 +12,7 @@ if not exist "%OUTPUT_DIR%" (
 echo Starting shader compilation...
 echo -------------------------------
 
-for %%f in (*.vert *.frag) do (
+for %%f in (*.vert *.frag *.comp) do (
     set "name=%%~nf"
     set "ext=%%~xf"
     
@@ -22,10 +22,29 @@ for %%f in (*.vert *.frag) do (
     ) else if "%%~xf"==".frag" (
         set "stage=frag"
         set "suffix=Frag.spv"
+    ) else if "%%~xf"==".comp" (
+        set "stage=comp"
+        set "suffix=Comp.spv"
     )
     
     echo Compiling %%f to %OUTPUT_DIR%\!name!!suffix!
     "%GLSLC%" -fshader-stage=!stage! -I . "%%f" -o "%OUTPUT_DIR%\!name!!suffix!"
+
+    rem mesh shaders get variants reading PackedVertex, the indirect draw instance buffer and the instance transforms
+    if "%%~xf"==".vert" (
+        findstr /c:"vertexInput.glsl" "%%f" >nul && (
+            echo Compiling %%f to %OUTPUT_DIR%\!name!Packed!suffix!
+            "%GLSLC%" -fshader-stage=!stage! -I . -DPACKED_VERTEX "%%f" -o "%OUTPUT_DIR%\!name!Packed!suffix!"
+            echo Compiling %%f to %OUTPUT_DIR%\!name!Indirect!suffix!
+            "%GLSLC%" -fshader-stage=!stage! -I . -DINDIRECT_DRAW "%%f" -o "%OUTPUT_DIR%\!name!Indirect!suffix!"
+            echo Compiling %%f to %OUTPUT_DIR%\!name!PackedIndirect!suffix!
+            "%GLSLC%" -fshader-stage=!stage! -I . -DPACKED_VERTEX -DINDIRECT_DRAW "%%f" -o "%OUTPUT_DIR%\!name!PackedIndirect!suffix!"
+            echo Compiling %%f to %OUTPUT_DIR%\!name!Instanced!suffix!
+            "%GLSLC%" -fshader-stage=!stage! -I . -DINSTANCED_DRAW "%%f" -o "%OUTPUT_DIR%\!name!Instanced!suffix!"
+            echo Compiling %%f to %OUTPUT_DIR%\!name!PackedInstanced!suffix!
+            "%GLSLC%" -fshader-stage=!stage! -I . -DPACKED_VERTEX -DINSTANCED_DRAW "%%f" -o "%OUTPUT_DIR%\!name!PackedInstanced!suffix!"
+        )
+    )
 )
 
 echo -------------------------------
@@ -9,7 +9,7 @@ echo "Created folder: $OUTPUT_DIR"
 echo "Starting shader compilation..."
 echo "-------------------------------"
 
-for file in *.vert *.frag; do
+for file in *.vert *.frag *.comp; do
     [[ -e "$file" ]] || continue  # Skip if no files match
 
     name="${file%.*}"
@@ -21,12 +21,29 @@ for file in *.vert *.frag; do
     elif [[ "$ext" == "frag" ]]; then
         stage="frag"
         suffix="Frag.spv"
+    elif [[ "$ext" == "comp" ]]; then
+        stage="comp"
+        suffix="Comp.spv"
     else
         continue
     fi
 
     echo "Compiling $file to $OUTPUT_DIR/${name}${suffix}"
     "$GLSLC" -fshader-stage=$stage -I . "$file" -o "$OUTPUT_DIR/${name}${suffix}"
+
+    # mesh shaders get variants reading PackedVertex, the indirect draw instance buffer and the instance transforms
+    if [[ "$stage" == "vert" ]] && grep -q '#include "vertexInput.glsl"' "$file"; then
+        echo "Compiling $file to $OUTPUT_DIR/${name}Packed${suffix}"
+        "$GLSLC" -fshader-stage=$stage -I . -DPACKED_VERTEX "$file" -o "$OUTPUT_DIR/${name}Packed${suffix}"
+        echo "Compiling $file to $OUTPUT_DIR/${name}Indirect${suffix}"
+        "$GLSLC" -fshader-stage=$stage -I . -DINDIRECT_DRAW "$file" -o "$OUTPUT_DIR/${name}Indirect${suffix}"
+        echo "Compiling $file to $OUTPUT_DIR/${name}PackedIndirect${suffix}"
+        "$GLSLC" -fshader-stage=$stage -I . -DPACKED_VERTEX -DINDIRECT_DRAW "$file" -o "$OUTPUT_DIR/${name}PackedIndirect${suffix}"
+        echo "Compiling $file to $OUTPUT_DIR/${name}Instanced${suffix}"
+        "$GLSLC" -fshader-stage=$stage -I . -DINSTANCED_DRAW "$file" -o "$OUTPUT_DIR/${name}Instanced${suffix}"
+        echo "Compiling $file to $OUTPUT_DIR/${name}PackedInstanced${suffix}"
+        "$GLSLC" -fshader-stage=$stage -I . -DPACKED_VERTEX -DINSTANCED_DRAW "$file" -o "$OUTPUT_DIR/${name}PackedInstanced${suffix}"
+    fi
 done
 
 echo "-------------------------------"
@@ -0,0 +1,23 @@
+#version 450
+
+// one level of the hi-z pyramid : every texel keeps the farthest depth of the source texels it covers
+
+layout(set = 0, binding = 0) uniform sampler2D inputImage;
+
+layout(location = 0) in vec2 fragUV;
+layout(location = 0) out float outDepth;
+
+void main() {
+	ivec2 sourceSize = textureSize(inputImage, 0);
+	ivec2 first = ivec2(gl_FragCoord.xy) * 2;
+	// an odd source folds its last row / column into the last texel
+	ivec2 last = first + 1 + ivec2(equal(first + 2, sourceSize - 1));
+	last = min(last, sourceSize - 1);
+
+	float depth = 0.0;
+	for (int y = first.y; y <= last.y; y++) {
+		for (int x = first.x; x <= last.x; x++)
+			depth = max(depth, texelFetch(inputImage, ivec2(x, y), 0).r);
+	}
+	outDepth = depth;
+}
@@ -0,0 +1,12 @@
+// a mesh drawn by the indirect path, mirrors MeshInstance in indirectScene.hpp
+
+struct MeshInstance {
+	mat4 model;
+	vec4 positionOffset;	// packed positions only
+	vec4 positionScale;
+	vec4 boundsMin;			// world space box
+	vec4 boundsMax;
+	vec4 sphere;			// world space center, radius
+	uvec4 lods[5];			// first index, index count, float bits of the world space error
+	uvec4 draw;				// lod count, vertex offset, batch, first instance of the batch
+};
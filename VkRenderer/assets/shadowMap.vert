@@ -2,16 +2,9 @@
 
 #include "sceneData.glsl"
 
-layout(location = 0) in vec3 inPosition;
-layout(location = 1) in vec3 inNormal;
-layout(location = 2) in vec2 inTexCoord;
-layout(location = 3) in vec3 inTangent;
-layout(location = 4) in vec3 inBitangent;
-
-layout(push_constant) uniform push {
-    mat4 model;
-} transform;
+#define POSITION_ONLY
+#include "vertexInput.glsl"
 
 void main(){
-    gl_Position = u_scene.lightSpace * transform.model * vec4(inPosition, 1.0);
+    gl_Position = u_scene.lightSpace * loadModelMatrix() * vec4(loadPosition(), 1.0);
 }
\ No newline at end of file
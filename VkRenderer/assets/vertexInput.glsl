@@ -0,0 +1,111 @@
+// mesh vertex inputs, compiled a second time with -DPACKED_VERTEX for the PackedVertex layout (vertexPacking.hpp).
+// shaders defining POSITION_ONLY before the include only declare location 0 and are fed the geometry position stream.
+// the -DINDIRECT_DRAW variants read the transform of gl_InstanceIndex from the instance buffer (indirectScene.hpp),
+// the -DINSTANCED_DRAW ones keep the push constants and place them with the matrix of gl_InstanceIndex (instancedModel.hpp).
+// shaders take the model matrix from loadModelMatrix()
+
+#ifdef INDIRECT_DRAW
+
+#include "meshInstance.glsl"
+
+layout(std430, set = 0, binding = 8) readonly buffer Instances {
+	MeshInstance instances[];
+};
+
+#define transform instances[gl_InstanceIndex]
+
+#else
+
+layout(push_constant) uniform push {
+	mat4 model;
+	vec4 positionOffset;
+	vec4 positionScale;
+} transform;
+
+#endif
+
+#ifdef INSTANCED_DRAW
+
+layout(std430, set = 0, binding = 9) readonly buffer InstanceTransforms {
+	mat4 instanceTransforms[];
+};
+
+mat4 loadModelMatrix() {
+	return instanceTransforms[gl_InstanceIndex] * transform.model;
+}
+
+#else
+
+mat4 loadModelMatrix() {
+	return transform.model;
+}
+
+#endif
+
+struct MeshVertex {
+	vec3 position;
+	vec3 normal;
+	vec2 texCoord;
+	vec3 tangent;
+	vec3 bitangent;
+};
+
+#ifdef PACKED_VERTEX
+
+// the name suffixes give the reflection the storage format of each attribute
+layout(location = 0) in vec4 inPosition_unorm16;	// w : bitangent sign
+
+vec3 loadPosition() {
+	return transform.positionOffset.xyz + transform.positionScale.xyz * inPosition_unorm16.xyz;
+}
+
+#ifndef POSITION_ONLY
+layout(location = 1) in vec2 inNormal_snorm16;		// octahedral
+layout(location = 2) in vec2 inTexCoord_half;
+layout(location = 3) in vec2 inTangent_snorm16;		// octahedral
+
+vec3 octDecode(vec2 e) {
+	vec3 n = vec3(e.xy, 1.0 - abs(e.x) - abs(e.y));
+	float t = max(-n.z, 0.0);
+	n.x += n.x >= 0.0 ? -t : t;
+	n.y += n.y >= 0.0 ? -t : t;
+	return normalize(n);
+}
+
+MeshVertex loadVertex() {
+	MeshVertex v;
+	v.position = loadPosition();
+	v.normal = octDecode(inNormal_snorm16);
+	v.texCoord = inTexCoord_half;
+	v.tangent = octDecode(inTangent_snorm16);
+	v.bitangent = cross(v.normal, v.tangent) * (inPosition_unorm16.w > 0.5 ? 1.0 : -1.0);
+	return v;
+}
+#endif
+
+#else
+
+layout(location = 0) in vec3 inPosition;
+
+vec3 loadPosition() {
+	return inPosition;
+}
+
+#ifndef POSITION_ONLY
+layout(location = 1) in vec3 inNormal;
+layout(location = 2) in vec2 inTexCoord;
+layout(location = 3) in vec3 inTangent;
+layout(location = 4) in vec3 inBitangent;
+
+MeshVertex loadVertex() {
+	MeshVertex v;
+	v.position = inPosition;
+	v.normal = inNormal;
+	v.texCoord = inTexCoord;
+	v.tangent = inTangent;
+	v.bitangent = inBitangent;
+	return v;
+}
+#endif
+
+#endif
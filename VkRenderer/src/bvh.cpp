@@ -0,0 +1,320 @@
+#include "src/bvh.hpp"
+
+static constexpr uint32_t BIN_COUNT = 12;
+static constexpr uint32_t MAX_LEAF_ITEMS = 4;
+static constexpr float TRAVERSAL_COST = 1.0f;	// relative to testing one item
+static constexpr float REBUILD_COST_RATIO = 1.5f;
+static constexpr uint32_t INVALID_NODE = UINT32_MAX;
+
+static bool operator==(const Aabb& a, const Aabb& b) {
+	return a.min == b.min && a.max == b.max;
+}
+
+void Bvh::build(const Aabb* boxes, uint32_t count) {
+	m_boxes.assign(boxes, boxes + count);
+	m_items.resize(count);
+	for (uint32_t i = 0; i < count; i++)
+		m_items[i] = i;
+	m_itemLeaves.assign(count, INVALID_NODE);
+	m_nodes.clear();
+	m_parents.clear();
+	m_buildCost = 0.f;
+	if (count == 0)
+		return;
+
+	m_nodes.reserve(2 * count);
+	m_parents.reserve(2 * count);
+
+	std::vector<glm::vec3> centers(count);
+	Aabb rootBounds;
+	for (uint32_t i = 0; i < count; i++) {
+		centers[i] = boxes[i].getCenter();
+		rootBounds.grow(boxes[i]);
+	}
+	m_nodes.push_back({ rootBounds, 0, count });
+	m_parents.push_back(INVALID_NODE);
+
+	std::vector<uint32_t> stack = { 0 };
+	while (!stack.empty()) {
+		uint32_t node = stack.back();
+		stack.pop_back();
+		split(node, stack, centers);
+	}
+
+	for (uint32_t node = 0; node < m_nodes.size(); node++) {
+		for (uint32_t i = 0; i < m_nodes[node].count; i++)
+			m_itemLeaves[m_items[m_nodes[node].first + i]] = node;
+	}
+	m_buildCost = getSahCost();
+}
+
+// splits the node where the binned surface area heuristic is lowest, or leaves it a leaf when that is cheaper
+void Bvh::split(uint32_t node, std::vector<uint32_t>& stack, const std::vector<glm::vec3>& centers) {
+	uint32_t first = m_nodes[node].first;
+	uint32_t count = m_nodes[node].count;
+	if (count <= 1)
+		return;
+
+	Aabb centerBounds;
+	for (uint32_t i = first; i < first + count; i++)
+		centerBounds.grow({ centers[m_items[i]], centers[m_items[i]] });
+
+	glm::vec3 size = centerBounds.max - centerBounds.min;
+	int axis = size.x > size.y ? (size.x > size.z ? 0 : 2) : (size.y > size.z ? 1 : 2);
+	float extent = size[axis];
+	uint32_t middle = first + count / 2;
+
+	if (extent > 0.f) {
+		struct Bin {
+			Aabb bounds;
+			uint32_t count = 0;
+		} bins[BIN_COUNT];
+
+		float binScale = BIN_COUNT / extent;
+		auto getBin = [&](uint32_t item) {
+			return std::min(BIN_COUNT - 1, static_cast<uint32_t>((centers[item][axis] - centerBounds.min[axis]) * binScale));
+		};
+		for (uint32_t i = first; i < first + count; i++) {
+			Bin& bin = bins[getBin(m_items[i])];
+			bin.bounds.grow(m_boxes[m_items[i]]);
+			bin.count++;
+		}
+
+		// right to left sweep first, the left to right one then knows both sides of every plane
+		float rightAreas[BIN_COUNT];
+		uint32_t rightCounts[BIN_COUNT];
+		Aabb right;
+		uint32_t rightCount = 0;
+		for (uint32_t b = BIN_COUNT - 1; b > 0; b--) {
+			right.grow(bins[b].bounds);
+			rightCount += bins[b].count;
+			rightAreas[b] = right.getSurfaceArea();
+			rightCounts[b] = rightCount;
+		}
+
+		float nodeArea = m_nodes[node].bounds.getSurfaceArea();
+		float inverseArea = nodeArea > 0.f ? 1.f / nodeArea : 1.f;
+		float bestCost = std::numeric_limits<float>::max();
+		uint32_t bestPlane = 0;
+		Aabb left;
+		uint32_t leftCount = 0;
+		for (uint32_t b = 1; b < BIN_COUNT; b++) {
+			left.grow(bins[b - 1].bounds);
+			leftCount += bins[b - 1].count;
+			if (leftCount == 0 || rightCounts[b] == 0)
+				continue;
+			float cost = TRAVERSAL_COST + (left.getSurfaceArea() * leftCount + rightAreas[b] * rightCounts[b]) * inverseArea;
+			if (cost < bestCost) {
+				bestCost = cost;
+				bestPlane = b;
+			}
+		}
+
+		if (count <= MAX_LEAF_ITEMS && bestCost >= static_cast<float>(count))
+			return;
+
+		if (bestPlane > 0) {
+			uint32_t* items = m_items.data();
+			middle = static_cast<uint32_t>(std::partition(items + first, items + first + count,
+				[&](uint32_t item) { return getBin(item) < bestPlane; }) - items);
+		}
+		else {
+			std::nth_element(m_items.begin() + first, m_items.begin() + middle, m_items.begin() + first + count,
+				[&](uint32_t a, uint32_t b) { return centers[a][axis] < centers[b][axis]; });
+		}
+	}
+	else if (count <= MAX_LEAF_ITEMS) {
+		return;
+	}
+
+	// every center in one spot, any halves will do
+	if (middle == first || middle == first + count)
+		middle = first + count / 2;
+
+	uint32_t leftChild = static_cast<uint32_t>(m_nodes.size());
+	for (uint32_t child = 0; child < 2; child++) {
+		uint32_t childFirst = child == 0 ? first : middle;
+		uint32_t childCount = child == 0 ? middle - first : first + count - middle;
+		Aabb bounds;
+		for (uint32_t i = childFirst; i < childFirst + childCount; i++)
+			bounds.grow(m_boxes[m_items[i]]);
+		m_nodes.push_back({ bounds, childFirst, childCount });
+		m_parents.push_back(node);
+		stack.push_back(leftChild + child);
+	}
+	m_nodes[node].first = leftChild;
+	m_nodes[node].count = 0;
+}
+
+void Bvh::update(uint32_t item, const Aabb& box) {
+	DEBUG_ASSERT(item < m_boxes.size(), "bvh item %u out of range", item);
+	m_boxes[item] = box;
+
+	uint32_t node = m_itemLeaves[item];
+	Aabb bounds;
+	for (uint32_t i = 0; i < m_nodes[node].count; i++)
+		bounds.grow(m_boxes[m_items[m_nodes[node].first + i]]);
+
+	while (true) {
+		if (bounds == m_nodes[node].bounds)
+			return;
+		m_nodes[node].bounds = bounds;
+
+		node = m_parents[node];
+		if (node == INVALID_NODE)
+			return;
+		bounds = m_nodes[m_nodes[node].first].bounds;
+		bounds.grow(m_nodes[m_nodes[node].first + 1].bounds);
+	}
+}
+
+bool Bvh::needsRebuild() const {
+	return !m_nodes.empty() && getSahCost() > m_buildCost * REBUILD_COST_RATIO;
+}
+
+float Bvh::getSahCost() const {
+	if (m_nodes.empty())
+		return 0.f;
+
+	double cost = 0.0;
+	for (const Node& node : m_nodes)
+		cost += node.bounds.getSurfaceArea() * (node.count > 0 ? node.count : TRAVERSAL_COST);
+
+	float rootArea = m_nodes[0].bounds.getSurfaceArea();
+	return rootArea > 0.f ? static_cast<float>(cost / rootArea) : 0.f;
+}
+
+void Bvh::collect(uint32_t root, std::vector<uint32_t>& items) const {
+	std::vector<uint32_t> stack = { root };
+	while (!stack.empty()) {
+		const Node& node = m_nodes[stack.back()];
+		stack.pop_back();
+		if (node.count > 0) {
+			items.insert(items.end(), m_items.begin() + node.first, m_items.begin() + node.first + node.count);
+			continue;
+		}
+		stack.push_back(node.first);
+		stack.push_back(node.first + 1);
+	}
+}
+
+void Bvh::queryFrustum(const Frustum& frustum, std::vector<uint32_t>& items, uint32_t* nodesVisited) const {
+	if (m_nodes.empty())
+		return;
+
+	uint32_t visited = 0;
+	std::vector<uint32_t> stack = { 0 };
+	while (!stack.empty()) {
+		uint32_t index = stack.back();
+		stack.pop_back();
+		visited++;
+
+		const Node& node = m_nodes[index];
+		Frustum::Overlap overlap = frustum.classify(node.bounds);
+		if (overlap == Frustum::Overlap::OUTSIDE)
+			continue;
+		if (overlap == Frustum::Overlap::INSIDE) {
+			collect(index, items);
+			continue;
+		}
+
+		if (node.count > 0) {
+			for (uint32_t i = node.first; i < node.first + node.count; i++) {
+				if (frustum.classify(m_boxes[m_items[i]]) != Frustum::Overlap::OUTSIDE)
+					items.push_back(m_items[i]);
+			}
+			continue;
+		}
+		stack.push_back(node.first);
+		stack.push_back(node.first + 1);
+	}
+
+	if (nodesVisited)
+		*nodesVisited += visited;
+}
+
+void Bvh::queryOverlap(const Aabb& box, std::vector<uint32_t>& items) const {
+	if (m_nodes.empty())
+		return;
+
+	std::vector<uint32_t> stack = { 0 };
+	while (!stack.empty()) {
+		const Node& node = m_nodes[stack.back()];
+		stack.pop_back();
+		if (!node.bounds.overlaps(box))
+			continue;
+
+		if (node.count > 0) {
+			for (uint32_t i = node.first; i < node.first + node.count; i++) {
+				if (m_boxes[m_items[i]].overlaps(box))
+					items.push_back(m_items[i]);
+			}
+			continue;
+		}
+		stack.push_back(node.first);
+		stack.push_back(node.first + 1);
+	}
+}
+
+// slab test, distance along the ray to the box or infinity when it is missed
+static float intersectRay(const Aabb& box, const glm::vec3& origin, const glm::vec3& inverseDirection, float maxDistance) {
+	glm::vec3 t0 = (box.min - origin) * inverseDirection;
+	glm::vec3 t1 = (box.max - origin) * inverseDirection;
+	glm::vec3 entries = glm::min(t0, t1);
+	glm::vec3 exits = glm::max(t0, t1);
+	float enter = std::max(std::max(entries.x, entries.y), std::max(entries.z, 0.f));
+	float exit = std::min(std::min(exits.x, exits.y), std::min(exits.z, maxDistance));
+	return enter <= exit ? enter : std::numeric_limits<float>::infinity();
+}
+
+uint32_t Bvh::raycast(const glm::vec3& origin, const glm::vec3& direction, float maxDistance, float* distance) const {
+	if (m_nodes.empty())
+		return INVALID_ITEM;
+
+	glm::vec3 inverseDirection = 1.0f / direction;
+	uint32_t closestItem = INVALID_ITEM;
+	float closest = maxDistance;
+
+	struct Entry {
+		uint32_t node;
+		float distance;
+	};
+	std::vector<Entry> stack;
+	float rootDistance = intersectRay(m_nodes[0].bounds, origin, inverseDirection, closest);
+	if (rootDistance <= closest)
+		stack.push_back({ 0, rootDistance });
+
+	while (!stack.empty()) {
+		Entry entry = stack.back();
+		stack.pop_back();
+		// a closer hit was found since this node was pushed
+		if (entry.distance > closest)
+			continue;
+
+		const Node& node = m_nodes[entry.node];
+		if (node.count > 0) {
+			for (uint32_t i = node.first; i < node.first + node.count; i++) {
+				float t = intersectRay(m_boxes[m_items[i]], origin, inverseDirection, closest);
+				if (t <= closest) {
+					closest = t;
+					closestItem = m_items[i];
+				}
+			}
+			continue;
+		}
+
+		// nearest child on top of the stack
+		Entry left = { node.first, intersectRay(m_nodes[node.first].bounds, origin, inverseDirection, closest) };
+		Entry right = { node.first + 1, intersectRay(m_nodes[node.first + 1].bounds, origin, inverseDirection, closest) };
+		if (left.distance < right.distance)
+			std::swap(left, right);
+		if (left.distance <= closest)
+			stack.push_back(left);
+		if (right.distance <= closest)
+			stack.push_back(right);
+	}
+
+	if (distance && closestItem != INVALID_ITEM)
+		*distance = closest;
+	return closestItem;
+}
@@ -0,0 +1,44 @@
+#pragma once
+#include "src/vulkan/vkHeader.hpp"
+#include "src/culling.hpp"
+
+// bounding volume hierarchy over item boxes, an item is the index of its box in the array given to build.
+// built with binned SAH, moved items are refitted in place until the tree got too loose and needs a rebuild
+class Bvh {
+public:
+	static constexpr uint32_t INVALID_ITEM = UINT32_MAX;
+
+	void build(const Aabb* boxes, uint32_t count);
+	// new box of one item, the nodes above it are refitted, the topology is kept
+	void update(uint32_t item, const Aabb& box);
+	// refits degraded the SAH cost too far from the last build
+	bool needsRebuild() const;
+
+	// items whose box overlaps the frustum, subtrees fully inside are taken without testing them
+	void queryFrustum(const Frustum& frustum, std::vector<uint32_t>& items, uint32_t* nodesVisited = nullptr) const;
+	void queryOverlap(const Aabb& box, std::vector<uint32_t>& items) const;
+	// nearest item box hit within maxDistance, INVALID_ITEM when there is none
+	uint32_t raycast(const glm::vec3& origin, const glm::vec3& direction, float maxDistance, float* distance = nullptr) const;
+
+	// expected traversal cost relative to the root, lower is better
+	float getSahCost() const;
+	uint32_t getNodeCount() const { return static_cast<uint32_t>(m_nodes.size()); }
+	uint32_t getItemCount() const { return static_cast<uint32_t>(m_boxes.size()); }
+
+private:
+	struct Node {
+		Aabb bounds;
+		uint32_t first;	// leaf : first slot in m_items, inner : left child, the right one follows it
+		uint32_t count;	// items of a leaf, 0 for inner nodes
+	};
+
+	void split(uint32_t node, std::vector<uint32_t>& stack, const std::vector<glm::vec3>& centers);
+	void collect(uint32_t node, std::vector<uint32_t>& items) const;
+
+	std::vector<Node> m_nodes;
+	std::vector<uint32_t> m_parents;
+	std::vector<uint32_t> m_items;		// leaves own contiguous slices
+	std::vector<uint32_t> m_itemLeaves;	// leaf of every item
+	std::vector<Aabb> m_boxes;
+	float m_buildCost = 0.f;
+};
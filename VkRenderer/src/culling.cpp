@@ -0,0 +1,266 @@
+#include "src/culling.hpp"
+#include "src/depthPyramid.hpp"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+	#define CULLING_SSE 1
+	#include <emmintrin.h>
+#else
+	#define CULLING_SSE 0
+#endif
+
+void CullingStats::add(const CullingStats& other) {
+	meshCount += other.meshCount;
+	visibleMeshes += other.visibleMeshes;
+	bvhNodesVisited += other.bvhNodesVisited;
+	meshletCount += other.meshletCount;
+	visibleMeshlets += other.visibleMeshlets;
+	frustumCulled += other.frustumCulled;
+	backfaceCulled += other.backfaceCulled;
+	occludedMeshes += other.occludedMeshes;
+	occludedMeshlets += other.occludedMeshlets;
+	occluderCount += other.occluderCount;
+	occluderTriangles += other.occluderTriangles;
+	drawCount += other.drawCount;
+	descriptorSetBinds += other.descriptorSetBinds;
+	triangleCount += other.triangleCount;
+	for (uint32_t i = 0; i < MAX_MESH_LODS; i++)
+		lodMeshes[i] += other.lodMeshes[i];
+}
+
+float Aabb::getSurfaceArea() const {
+	glm::vec3 size = glm::max(max - min, glm::vec3(0.0f));
+	return 2.0f * (size.x * size.y + size.y * size.z + size.z * size.x);
+}
+
+bool Aabb::overlaps(const Aabb& other) const {
+	return min.x <= other.max.x && max.x >= other.min.x &&
+		min.y <= other.max.y && max.y >= other.min.y &&
+		min.z <= other.max.z && max.z >= other.min.z;
+}
+
+Frustum Frustum::fromMatrix(const glm::mat4& matrix) {
+	// gribb / hartmann, with clip space z in [0, w]
+	glm::vec4 row0(matrix[0][0], matrix[1][0], matrix[2][0], matrix[3][0]);
+	glm::vec4 row1(matrix[0][1], matrix[1][1], matrix[2][1], matrix[3][1]);
+	glm::vec4 row2(matrix[0][2], matrix[1][2], matrix[2][2], matrix[3][2]);
+	glm::vec4 row3(matrix[0][3], matrix[1][3], matrix[2][3], matrix[3][3]);
+
+	Frustum frustum;
+	frustum.planes[0] = row3 + row0;
+	frustum.planes[1] = row3 - row0;
+	frustum.planes[2] = row3 + row1;
+	frustum.planes[3] = row3 - row1;
+	frustum.planes[4] = row2;
+	frustum.planes[5] = row3 - row2;
+
+	for (glm::vec4& plane : frustum.planes)
+		plane /= glm::length(glm::vec3(plane));
+	return frustum;
+}
+
+bool Frustum::intersectsSphere(const glm::vec3& center, float radius) const {
+	for (const glm::vec4& plane : planes) {
+		if (glm::dot(glm::vec3(plane), center) + plane.w < -radius)
+			return false;
+	}
+	return true;
+}
+
+Frustum::Overlap Frustum::classify(const Aabb& box) const {
+	glm::vec3 center = box.getCenter();
+	glm::vec3 extent = (box.max - box.min) * 0.5f;
+	Overlap overlap = Overlap::INSIDE;
+	for (const glm::vec4& plane : planes) {
+		float distance = glm::dot(glm::vec3(plane), center) + plane.w;
+		float radius = glm::dot(glm::abs(glm::vec3(plane)), extent);
+		if (distance + radius < 0.f)
+			return Overlap::OUTSIDE;
+		if (distance - radius < 0.f)
+			overlap = Overlap::INTERSECTING;
+	}
+	return overlap;
+}
+
+CullView CullView::create(const glm::mat4& viewProjection, const glm::vec3& position, const glm::mat4& model, bool perspective, float lodScale) {
+	CullView view;
+	view.frustum = Frustum::fromMatrix(viewProjection * model);
+	view.position = glm::vec3(glm::inverse(model) * glm::vec4(position, 1.0f));
+	view.perspective = perspective;
+	view.lodScale = lodScale;
+	// perspective scale cancels out between error and distance, orthographic views see the model's scale
+	if (!perspective) {
+		float scale = std::max(glm::length(glm::vec3(model[0])), std::max(glm::length(glm::vec3(model[1])), glm::length(glm::vec3(model[2]))));
+		view.lodScale *= scale;
+	}
+	return view;
+}
+
+float CullView::getLodScale(const glm::mat4& projection, float viewportHeight) {
+	// [1][1] is 1 / tan(fov / 2) or 2 / height, flipped for vulkan's y
+	return std::abs(projection[1][1]) * viewportHeight * 0.5f;
+}
+
+void CullView::setOcclusion(const DepthPyramid& pyramid, const glm::mat4& model) {
+	occlusion = &pyramid;
+	occlusionMatrix = pyramid.getViewProjection() * model;
+}
+
+void BoundsBatch::clear() {
+	for (std::vector<float>* component : { &centerX, &centerY, &centerZ, &extentX, &extentY, &extentZ, &sphereX, &sphereY, &sphereZ, &radius })
+		component->clear();
+}
+
+void BoundsBatch::add(const Mesh& mesh, const glm::mat4& model) {
+	for (std::vector<float>* component : { &centerX, &centerY, &centerZ, &extentX, &extentY, &extentZ, &sphereX, &sphereY, &sphereZ, &radius })
+		component->push_back(0.f);
+	set(size() - 1, mesh, model);
+}
+
+void BoundsBatch::set(size_t i, const Mesh& mesh, const glm::mat4& model) {
+	glm::vec3 center = glm::vec3(model * glm::vec4((mesh.m_boundsMin + mesh.m_boundsMax) * 0.5f, 1.0f));
+	glm::vec3 halfSize = (mesh.m_boundsMax - mesh.m_boundsMin) * 0.5f;
+	// arvo : every world axis gathers the absolute contribution of each local one
+	glm::mat3 rotationScale = glm::mat3(model);
+	glm::vec3 extent(0.0f);
+	for (int axis = 0; axis < 3; axis++)
+		extent += glm::abs(rotationScale[axis]) * halfSize[axis];
+
+	glm::vec3 sphere = glm::vec3(model * glm::vec4(mesh.m_center, 1.0f));
+	float scale = std::max(glm::length(rotationScale[0]), std::max(glm::length(rotationScale[1]), glm::length(rotationScale[2])));
+
+	centerX[i] = center.x;
+	centerY[i] = center.y;
+	centerZ[i] = center.z;
+	extentX[i] = extent.x;
+	extentY[i] = extent.y;
+	extentZ[i] = extent.z;
+	sphereX[i] = sphere.x;
+	sphereY[i] = sphere.y;
+	sphereZ[i] = sphere.z;
+	radius[i] = mesh.m_radius * scale;
+}
+
+Aabb BoundsBatch::getBox(size_t i) const {
+	glm::vec3 center(centerX[i], centerY[i], centerZ[i]);
+	glm::vec3 extent(extentX[i], extentY[i], extentZ[i]);
+	return { center - extent, center + extent };
+}
+
+bool isBoundsVisible(const Frustum& frustum, const BoundsBatch& bounds, size_t i) {
+	for (const glm::vec4& plane : frustum.planes) {
+		float boxDistance = plane.x * bounds.centerX[i] + plane.y * bounds.centerY[i] + plane.z * bounds.centerZ[i] + plane.w;
+		float boxRadius = std::abs(plane.x) * bounds.extentX[i] + std::abs(plane.y) * bounds.extentY[i] + std::abs(plane.z) * bounds.extentZ[i];
+		float sphereDistance = plane.x * bounds.sphereX[i] + plane.y * bounds.sphereY[i] + plane.z * bounds.sphereZ[i] + plane.w;
+		if (boxDistance + boxRadius < 0.f || sphereDistance + bounds.radius[i] < 0.f)
+			return false;
+	}
+	return true;
+}
+
+void cullBounds(const Frustum& frustum, const BoundsBatch& bounds, std::vector<uint8_t>& visible, CullingStats& stats) {
+	size_t count = bounds.size();
+	visible.resize(count);
+	size_t i = 0;
+
+#if CULLING_SSE
+	__m128 planeX[6], planeY[6], planeZ[6], planeW[6], absX[6], absY[6], absZ[6];
+	__m128 signMask = _mm_set1_ps(-0.0f);
+	for (int p = 0; p < 6; p++) {
+		planeX[p] = _mm_set1_ps(frustum.planes[p].x);
+		planeY[p] = _mm_set1_ps(frustum.planes[p].y);
+		planeZ[p] = _mm_set1_ps(frustum.planes[p].z);
+		planeW[p] = _mm_set1_ps(frustum.planes[p].w);
+		absX[p] = _mm_andnot_ps(signMask, planeX[p]);
+		absY[p] = _mm_andnot_ps(signMask, planeY[p]);
+		absZ[p] = _mm_andnot_ps(signMask, planeZ[p]);
+	}
+
+	__m128 zero = _mm_setzero_ps();
+	for (; i + 4 <= count; i += 4) {
+		__m128 centerX = _mm_loadu_ps(&bounds.centerX[i]);
+		__m128 centerY = _mm_loadu_ps(&bounds.centerY[i]);
+		__m128 centerZ = _mm_loadu_ps(&bounds.centerZ[i]);
+		__m128 extentX = _mm_loadu_ps(&bounds.extentX[i]);
+		__m128 extentY = _mm_loadu_ps(&bounds.extentY[i]);
+		__m128 extentZ = _mm_loadu_ps(&bounds.extentZ[i]);
+		__m128 sphereX = _mm_loadu_ps(&bounds.sphereX[i]);
+		__m128 sphereY = _mm_loadu_ps(&bounds.sphereY[i]);
+		__m128 sphereZ = _mm_loadu_ps(&bounds.sphereZ[i]);
+		__m128 radius = _mm_loadu_ps(&bounds.radius[i]);
+
+		__m128 outside = zero;
+		for (int p = 0; p < 6; p++) {
+			// summed in the order of isBoundsVisible so both agree to the bit
+			__m128 boxDistance = _mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(planeX[p], centerX), _mm_mul_ps(planeY[p], centerY)),
+				_mm_mul_ps(planeZ[p], centerZ)), planeW[p]);
+			__m128 boxRadius = _mm_add_ps(_mm_add_ps(_mm_mul_ps(absX[p], extentX), _mm_mul_ps(absY[p], extentY)), _mm_mul_ps(absZ[p], extentZ));
+			__m128 sphereDistance = _mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(planeX[p], sphereX), _mm_mul_ps(planeY[p], sphereY)),
+				_mm_mul_ps(planeZ[p], sphereZ)), planeW[p]);
+
+			outside = _mm_or_ps(outside, _mm_cmplt_ps(_mm_add_ps(boxDistance, boxRadius), zero));
+			outside = _mm_or_ps(outside, _mm_cmplt_ps(_mm_add_ps(sphereDistance, radius), zero));
+		}
+
+		int mask = _mm_movemask_ps(outside);
+		for (int lane = 0; lane < 4; lane++)
+			visible[i + lane] = (mask >> lane) & 1 ? 0 : 1;
+	}
+#endif
+
+	for (; i < count; i++)
+		visible[i] = isBoundsVisible(frustum, bounds, i) ? 1 : 0;
+
+	stats.meshCount += static_cast<uint32_t>(count);
+	for (uint8_t v : visible)
+		stats.visibleMeshes += v;
+}
+
+void cullMeshlets(const Meshlet* meshlets, size_t meshletCount, const CullView& view, std::vector<IndexRange>& ranges, CullingStats& stats) {
+	size_t firstRange = ranges.size();
+	stats.meshletCount += static_cast<uint32_t>(meshletCount);
+
+	for (size_t i = 0; i < meshletCount; i++) {
+		const Meshlet& meshlet = meshlets[i];
+
+		if (!view.frustum.intersectsSphere(meshlet.center, meshlet.radius)) {
+			stats.frustumCulled++;
+			continue;
+		}
+
+		// every triangle faces away when the view is inside the backface cone of the whole sphere
+		if (view.perspective) {
+			glm::vec3 toCenter = meshlet.center - view.position;
+			if (glm::dot(toCenter, meshlet.coneAxis) >= meshlet.coneCutoff * glm::length(toCenter) + meshlet.radius) {
+				stats.backfaceCulled++;
+				continue;
+			}
+		}
+
+		if (view.occlusion != nullptr && !view.occlusion->isVisible(meshlet.center, meshlet.radius, view.occlusionMatrix)) {
+			stats.occludedMeshlets++;
+			continue;
+		}
+
+		stats.visibleMeshlets++;
+		if (ranges.size() > firstRange && ranges.back().firstIndex + ranges.back().indexCount == meshlet.firstIndex)
+			ranges.back().indexCount += meshlet.indexCount;
+		else
+			ranges.push_back({ meshlet.firstIndex, meshlet.indexCount });
+	}
+}
+
+uint32_t selectLod(const Mesh& mesh, const CullView& view, float maxPixelError) {
+	float pixelsPerUnit = view.lodScale;
+	if (view.perspective) {
+		// nearest point of the bounding sphere, inside it everything is at full detail
+		float distance = glm::length(view.position - mesh.m_center) - mesh.m_radius;
+		if (distance <= 0.f)
+			return 0;
+		pixelsPerUnit /= distance;
+	}
+
+	uint32_t lod = 0;
+	while (lod + 1 < mesh.m_lods.size() && mesh.m_lods[lod + 1].error * pixelsPerUnit <= maxPixelError)
+		lod++;
+	return lod;
+}
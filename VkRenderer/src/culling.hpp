@@ -0,0 +1,97 @@
+#pragma once
+#include "src/vulkan/vkHeader.hpp"
+#include "src/model.hpp"
+
+class DepthPyramid;
+
+struct Aabb {
+	glm::vec3 min = glm::vec3(std::numeric_limits<float>::max());
+	glm::vec3 max = glm::vec3(-std::numeric_limits<float>::max());
+
+	void grow(const Aabb& other) { min = glm::min(min, other.min); max = glm::max(max, other.max); }
+	glm::vec3 getCenter() const { return (min + max) * 0.5f; }
+	float getSurfaceArea() const;
+	bool overlaps(const Aabb& other) const;
+};
+
+struct Frustum {
+	glm::vec4 planes[6];	// normalized, xyz points inside
+
+	enum class Overlap { OUTSIDE, INTERSECTING, INSIDE };
+
+	// planes of a view projection (depth 0 to 1), in the space the matrix transforms from
+	static Frustum fromMatrix(const glm::mat4& matrix);
+
+	bool intersectsSphere(const glm::vec3& center, float radius) const;
+	Overlap classify(const Aabb& box) const;
+};
+
+// a camera or light view expressed in the space of the mesh being culled
+struct CullView {
+	Frustum frustum;
+	glm::vec3 position;
+	bool perspective = true;	// the cone test and lod distances assume rays from position
+	float lodScale = 0.f;		// pixels covered by a mesh space unit, at a distance of one unit for perspective views
+	const DepthPyramid* occlusion = nullptr;	// meshlets hidden behind it are culled
+	glm::mat4 occlusionMatrix;					// mesh space to the pyramid's clip space
+
+	// lodScale : see getLodScale, in world units
+	static CullView create(const glm::mat4& viewProjection, const glm::vec3& position, const glm::mat4& model, bool perspective, float lodScale);
+	// pixels per world unit of an orthographic projection, or per unit at distance one of a perspective one
+	static float getLodScale(const glm::mat4& projection, float viewportHeight);
+	// tests meshlets against the pyramid, model : the mesh's model matrix
+	void setOcclusion(const DepthPyramid& pyramid, const glm::mat4& model);
+};
+
+struct CullingStats {
+	uint32_t meshCount = 0;
+	uint32_t visibleMeshes = 0;
+	uint32_t bvhNodesVisited = 0;
+	uint32_t meshletCount = 0;
+	uint32_t visibleMeshlets = 0;
+	uint32_t frustumCulled = 0;
+	uint32_t backfaceCulled = 0;
+	uint32_t occludedMeshes = 0;
+	uint32_t occludedMeshlets = 0;
+	uint32_t occluderCount = 0;		// meshes rasterized by the cpu occlusion culling
+	uint32_t occluderTriangles = 0;
+	uint32_t drawCount = 0;
+	uint32_t descriptorSetBinds = 0;	// sets bound while recording the pass
+	uint32_t triangleCount = 0;
+	uint32_t lodMeshes[MAX_MESH_LODS] = {};	// meshes drawn at each level
+
+	// sums the counters of a part of the pass culled separately
+	void add(const CullingStats& other);
+};
+
+// world space bounds of the meshes drawn this frame, one array per component for the batch test
+struct BoundsBatch {
+	std::vector<float> centerX, centerY, centerZ;
+	std::vector<float> extentX, extentY, extentZ;	// aabb half size
+	std::vector<float> sphereX, sphereY, sphereZ, radius;
+
+	void clear();
+	// the mesh's bounds moved by model, the aabb encloses the transformed one
+	void add(const Mesh& mesh, const glm::mat4& model);
+	void set(size_t i, const Mesh& mesh, const glm::mat4& model);
+	Aabb getBox(size_t i) const;
+	size_t size() const { return centerX.size(); }
+};
+
+// the scalar test of bounds i, cullBounds gives the same answer
+bool isBoundsVisible(const Frustum& frustum, const BoundsBatch& bounds, size_t i);
+
+// visible[i] is 1 when both the aabb and the sphere of bounds i overlap the frustum, 4 bounds at a time with sse2
+void cullBounds(const Frustum& frustum, const BoundsBatch& bounds, std::vector<uint8_t>& visible, CullingStats& stats);
+
+// a run of contiguous indices of a mesh
+struct IndexRange {
+	uint32_t firstIndex;
+	uint32_t indexCount;
+};
+
+// appends the visible meshlets to ranges, neighbours in the index list are merged into one range
+void cullMeshlets(const Meshlet* meshlets, size_t meshletCount, const CullView& view, std::vector<IndexRange>& ranges, CullingStats& stats);
+
+// coarsest level whose error projects to at most maxPixelError pixels from the view
+uint32_t selectLod(const Mesh& mesh, const CullView& view, float maxPixelError);
@@ -0,0 +1,95 @@
+#include "src/depthPyramid.hpp"
+
+void DepthPyramid::build(const float* depth, uint32_t width, uint32_t height, const glm::mat4& viewProjection) {
+	DEBUG_ASSERT(width > 0 && height > 0, "empty depth pyramid");
+	m_viewProjection = viewProjection;
+
+	m_levelCount = 1;
+	for (uint32_t w = width, h = height; w > 1 || h > 1; w = std::max(w / 2, 1u), h = std::max(h / 2, 1u))
+		m_levelCount++;
+	if (m_levels.size() < m_levelCount)
+		m_levels.resize(m_levelCount);
+
+	m_levels[0].width = width;
+	m_levels[0].height = height;
+	m_levels[0].depth.assign(depth, depth + width * height);
+
+	for (uint32_t i = 1; i < m_levelCount; i++) {
+		const Level& source = m_levels[i - 1];
+		Level& level = m_levels[i];
+		level.width = std::max(source.width / 2, 1u);
+		level.height = std::max(source.height / 2, 1u);
+		level.depth.resize(level.width * level.height);
+
+		// same footprint as hiZ.frag, an odd source folds its last row / column into the last texel
+		for (uint32_t y = 0; y < level.height; y++) {
+			uint32_t y0 = std::min(y * 2, source.height - 1);
+			uint32_t y1 = y + 1 == level.height ? source.height - 1 : y * 2 + 1;
+			for (uint32_t x = 0; x < level.width; x++) {
+				uint32_t x0 = std::min(x * 2, source.width - 1);
+				uint32_t x1 = x + 1 == level.width ? source.width - 1 : x * 2 + 1;
+				float farthest = 0.f;
+				for (uint32_t sy = y0; sy <= y1; sy++) {
+					for (uint32_t sx = x0; sx <= x1; sx++)
+						farthest = std::max(farthest, source.depth[sy * source.width + sx]);
+				}
+				level.depth[y * level.width + x] = farthest;
+			}
+		}
+	}
+}
+
+bool DepthPyramid::isVisible(const Aabb& box, const glm::mat4& toClip) const {
+	if (m_levelCount == 0)
+		return true;
+
+	glm::vec2 rectMin(std::numeric_limits<float>::max());
+	glm::vec2 rectMax(-std::numeric_limits<float>::max());
+	float nearest = 1.f;
+	for (int i = 0; i < 8; i++) {
+		glm::vec3 corner((i & 1) ? box.max.x : box.min.x, (i & 2) ? box.max.y : box.min.y, (i & 4) ? box.max.z : box.min.z);
+		glm::vec4 clip = toClip * glm::vec4(corner, 1.0f);
+		if (clip.w <= 1e-5f)
+			return true;
+		glm::vec3 ndc = glm::vec3(clip) / clip.w;
+		rectMin = glm::min(rectMin, glm::vec2(ndc));
+		rectMax = glm::max(rectMax, glm::vec2(ndc));
+		nearest = std::min(nearest, ndc.z);
+	}
+
+	// texels of the finest level, nothing is known outside of the view the pyramid was rendered from
+	const Level& base = m_levels[0];
+	glm::vec2 size(static_cast<float>(base.width), static_cast<float>(base.height));
+	rectMin = (rectMin * 0.5f + 0.5f) * size;
+	rectMax = (rectMax * 0.5f + 0.5f) * size;
+	if (rectMin.x < 0.f || rectMin.y < 0.f || rectMax.x > size.x || rectMax.y > size.y)
+		return true;
+
+	uint32_t x0 = static_cast<uint32_t>(rectMin.x);
+	uint32_t y0 = static_cast<uint32_t>(rectMin.y);
+	uint32_t x1 = std::min(static_cast<uint32_t>(rectMax.x), base.width - 1);
+	uint32_t y1 = std::min(static_cast<uint32_t>(rectMax.y), base.height - 1);
+
+	// coarsest level needed for the rect to cover at most 2x2 texels
+	uint32_t level = 0;
+	while (level + 1 < m_levelCount && ((x1 >> level) - (x0 >> level) > 1 || (y1 >> level) - (y0 >> level) > 1))
+		level++;
+
+	const Level& coarse = m_levels[level];
+	uint32_t tx0 = std::min(x0 >> level, coarse.width - 1), tx1 = std::min(x1 >> level, coarse.width - 1);
+	uint32_t ty0 = std::min(y0 >> level, coarse.height - 1), ty1 = std::min(y1 >> level, coarse.height - 1);
+	for (uint32_t y = ty0; y <= ty1; y++) {
+		for (uint32_t x = tx0; x <= tx1; x++) {
+			if (nearest <= coarse.depth[y * coarse.width + x])
+				return true;
+		}
+	}
+	return false;
+}
+
+bool DepthPyramid::isVisible(const glm::vec3& center, float radius, const glm::mat4& toClip) const {
+	Aabb box;
+	box.min = center - glm::vec3(radius);
+	box.max = center + glm::vec3(radius);
+	return isVisible(box, toClip);
+}
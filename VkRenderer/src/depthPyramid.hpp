@@ -0,0 +1,32 @@
+#pragma once
+#include "src/vulkan/vkHeader.hpp"
+#include "src/culling.hpp"
+
+// farthest depth pyramid of an already rendered view, depth is 0 at the near plane and 1 at the far one.
+// a box whose nearest point is behind the farthest depth of every texel it covers is occluded
+class DepthPyramid {
+public:
+	// depth : width * height texels of the finest level, viewProjection : the matrix they were rendered with
+	void build(const float* depth, uint32_t width, uint32_t height, const glm::mat4& viewProjection);
+	void invalidate() { m_levelCount = 0; }
+	bool isValid() const { return m_levelCount != 0; }
+
+	// toClip takes the box to the pyramid's clip space, false only when the box is certainly hidden.
+	// boxes crossing the near plane or the edges of the view are visible
+	bool isVisible(const Aabb& box, const glm::mat4& toClip) const;
+	bool isVisible(const glm::vec3& center, float radius, const glm::mat4& toClip) const;
+
+	const glm::mat4& getViewProjection() const { return m_viewProjection; }
+	uint32_t getLevelCount() const { return m_levelCount; }
+
+private:
+	struct Level {
+		uint32_t width;
+		uint32_t height;
+		std::vector<float> depth;
+	};
+
+	std::vector<Level> m_levels;	// kept between builds to reuse their storage
+	uint32_t m_levelCount = 0;
+	glm::mat4 m_viewProjection = glm::mat4(1.0f);
+};
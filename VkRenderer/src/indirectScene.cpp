@@ -0,0 +1,189 @@
+#include "src/indirectScene.hpp"
+#include "src/model.hpp"
+#include "src/material.hpp"
+#include "src/vulkan/device.hpp"
+#include "src/vulkan/buffer.hpp"
+#include "src/vulkan/shader.hpp"
+#include "src/vulkan/pipeline.hpp"
+#include "src/vulkan/descriptorSet.hpp"
+#include "src/vulkan/geometryBuffer.hpp"
+#include "src/vulkan/commandBuffer.hpp"
+
+static const uint32_t cullGroupSize = 64;	// local_size_x of cull.comp
+
+IndirectScene::IndirectScene(GeometryBuffer& geometry, uint32_t viewCount)
+	: m_geometry(geometry), m_compact(Device::get()->supportsDrawIndirectCount()), m_views(viewCount) {
+	DEBUG_ASSERT(Device::get()->supportsMultiDrawIndirect(), "indirect scene without multiDrawIndirect");
+	m_cullShader = std::make_shared<Shader>("spv/cullComp.spv");
+	m_cullPipeline = std::make_shared<ComputePipeline>(m_cullShader);
+	for (View& view : m_views)
+		view.descriptorSet = std::make_shared<DescriptorSet>(m_cullShader, 0);
+}
+
+IndirectScene::~IndirectScene() {
+}
+
+void IndirectScene::build(const std::vector<std::shared_ptr<Model>>& models) {
+	m_instanceMeshes.clear();
+	for (size_t i = 0; i < models.size(); i++) {
+		for (auto& mesh : models[i]->m_meshes) {
+			if (mesh->m_material != nullptr)
+				m_instanceMeshes.push_back({ mesh.get(), static_cast<uint32_t>(i) });
+		}
+	}
+	std::stable_sort(m_instanceMeshes.begin(), m_instanceMeshes.end(), [](const InstanceMesh& a, const InstanceMesh& b) {
+		if (a.mesh->m_material != b.mesh->m_material)
+			return a.mesh->m_material < b.mesh->m_material;
+		return a.mesh->m_geometry->getIndexType() < b.mesh->m_geometry->getIndexType();
+	});
+
+	m_batches.clear();
+	for (uint32_t i = 0; i < m_instanceMeshes.size(); i++) {
+		const Mesh& mesh = *m_instanceMeshes[i].mesh;
+		if (m_batches.empty() || m_batches.back().material != mesh.m_material.get() || m_batches.back().indexType != mesh.m_geometry->getIndexType())
+			m_batches.push_back({ mesh.m_material.get(), mesh.m_geometry->getIndexType(), i, 0 });
+		m_batches.back().instanceCount++;
+	}
+
+	// empty buffers can't be created, a scene without meshes keeps a single unused entry
+	VkDeviceSize instanceCount = std::max<VkDeviceSize>(m_instanceMeshes.size(), 1);
+	VkDeviceSize batchCount = std::max<VkDeviceSize>(m_batches.size(), 1);
+	for (uint32_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
+		Frame& frame = m_frames[i];
+		frame.instances = std::make_unique<Buffer>();
+		frame.instances->createBuffer(instanceCount * sizeof(MeshInstance), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+			VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+		frame.version = 0;
+
+		for (View& view : m_views) {
+			view.commands[i] = std::make_unique<Buffer>();
+			view.commands[i]->createBuffer(instanceCount * sizeof(VkDrawIndexedIndirectCommand),
+				VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+			view.counts[i] = std::make_unique<Buffer>();
+			view.counts[i]->createBuffer(batchCount * sizeof(uint32_t),
+				VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+
+			view.descriptorSet->setStorageBuffer(*frame.instances, 0, i);
+			view.descriptorSet->setStorageBuffer(*view.commands[i], 1, i);
+			view.descriptorSet->setStorageBuffer(*view.counts[i], 2, i);
+		}
+	}
+
+	m_matrices.clear();
+	for (auto& model : models)
+		m_matrices.push_back(model->m_modelMatrix);
+	m_geometryGeneration = m_geometry.getGeneration();
+	m_version++;
+}
+
+void IndirectScene::update(const std::vector<std::shared_ptr<Model>>& models, uint32_t frameIndex) {
+	DEBUG_ASSERT(models.size() == m_matrices.size(), "models changed since the indirect scene was built");
+
+	bool changed = m_geometry.getGeneration() != m_geometryGeneration;
+	m_geometryGeneration = m_geometry.getGeneration();
+	for (size_t i = 0; i < models.size(); i++) {
+		changed |= models[i]->m_modelMatrix != m_matrices[i];
+		m_matrices[i] = models[i]->m_modelMatrix;
+	}
+	if (changed)
+		m_version++;
+
+	Frame& frame = m_frames[frameIndex];
+	if (frame.version != m_version) {
+		writeInstances(models, frame);
+		frame.version = m_version;
+	}
+}
+
+void IndirectScene::writeInstances(const std::vector<std::shared_ptr<Model>>& models, Frame& frame) {
+	m_bounds.clear();
+	for (const InstanceMesh& instanceMesh : m_instanceMeshes)
+		m_bounds.add(*instanceMesh.mesh, models[instanceMesh.model]->m_modelMatrix);
+
+	MeshInstance* instances = static_cast<MeshInstance*>(frame.instances->getMapped());
+	for (const Batch& batch : m_batches) {
+		for (uint32_t i = batch.firstInstance; i < batch.firstInstance + batch.instanceCount; i++) {
+			const Mesh& mesh = *m_instanceMeshes[i].mesh;
+			const glm::mat4& model = models[m_instanceMeshes[i].model]->m_modelMatrix;
+			glm::mat3 rotationScale = glm::mat3(model);
+			float scale = std::max(glm::length(rotationScale[0]), std::max(glm::length(rotationScale[1]), glm::length(rotationScale[2])));
+
+			MeshInstance instance{};
+			MeshConstants constants = mesh.getConstants(model);
+			instance.model = constants.model;
+			instance.positionOffset = constants.positionOffset;
+			instance.positionScale = constants.positionScale;
+			Aabb box = m_bounds.getBox(i);
+			instance.boundsMin = glm::vec4(box.min, 0.0f);
+			instance.boundsMax = glm::vec4(box.max, 0.0f);
+			instance.sphere = glm::vec4(m_bounds.sphereX[i], m_bounds.sphereY[i], m_bounds.sphereZ[i], m_bounds.radius[i]);
+
+			uint32_t lodCount = std::min(static_cast<uint32_t>(mesh.m_lods.size()), MAX_MESH_LODS);
+			for (uint32_t lod = 0; lod < lodCount; lod++) {
+				const MeshLod& level = mesh.m_lods[lod];
+				float error = level.error * scale;
+				uint32_t errorBits;
+				memcpy(&errorBits, &error, sizeof(errorBits));
+				instance.lods[lod] = glm::uvec4(mesh.m_geometry->getFirstIndex() + level.firstIndex, level.indexCount, errorBits, 0);
+			}
+			instance.draw = glm::uvec4(lodCount, static_cast<uint32_t>(mesh.m_geometry->getVertexOffset()), static_cast<uint32_t>(&batch - m_batches.data()), batch.firstInstance);
+			instances[i] = instance;
+		}
+	}
+}
+
+void IndirectScene::cull(CommandBuffer& commandBuffer, uint32_t frameIndex, uint32_t view, const CullView& cullView, float maxPixelError) {
+	View& target = m_views[view];
+	if (m_instanceMeshes.empty())
+		return;
+
+	if (m_compact) {
+		vkCmdFillBuffer(commandBuffer.getHandle(), target.counts[frameIndex]->getHandle(), 0, VK_WHOLE_SIZE, 0);
+		VkMemoryBarrier clearBarrier{};
+		clearBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+		clearBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+		clearBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+		vkCmdPipelineBarrier(commandBuffer.getHandle(), VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 1, &clearBarrier, 0, nullptr, 0, nullptr);
+	}
+
+	CullConstants constants{};
+	for (int i = 0; i < 6; i++)
+		constants.planes[i] = cullView.frustum.planes[i];
+	constants.position = glm::vec4(cullView.position, cullView.perspective ? 1.0f : 0.0f);
+	constants.lodScale = cullView.lodScale;
+	constants.maxPixelError = maxPixelError;
+	constants.instanceCount = getInstanceCount();
+	constants.compact = m_compact ? 1 : 0;
+
+	VkDescriptorSet descriptorSet = target.descriptorSet->getHandle(frameIndex);
+	commandBuffer.bindDescriptorSets(VK_PIPELINE_BIND_POINT_COMPUTE, m_cullShader->getPipelineLayout(), 0, 1, &descriptorSet);
+	commandBuffer.pushConstants(*m_cullShader, &constants);
+	m_cullPipeline->dispatch(commandBuffer, constants.instanceCount, cullGroupSize);
+
+	VkMemoryBarrier drawBarrier{};
+	drawBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+	drawBarrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+	drawBarrier.dstAccessMask = VK_ACCESS_INDIRECT_COMMAND_READ_BIT;
+	vkCmdPipelineBarrier(commandBuffer.getHandle(), VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT, 0, 1, &drawBarrier, 0, nullptr, 0, nullptr);
+}
+
+void IndirectScene::draw(CommandBuffer& commandBuffer, uint32_t frameIndex, uint32_t view, VkPipelineLayout materialLayout) {
+	View& target = m_views[view];
+	const uint32_t stride = sizeof(VkDrawIndexedIndirectCommand);
+
+	for (uint32_t i = 0; i < m_batches.size(); i++) {
+		const Batch& batch = m_batches[i];
+		if (materialLayout != VK_NULL_HANDLE) {
+			VkDescriptorSet materialSet = batch.material->m_descriptorSet->getHandle(frameIndex);
+			commandBuffer.bindDescriptorSets(VK_PIPELINE_BIND_POINT_GRAPHICS, materialLayout, 1, 1, &materialSet);
+		}
+		m_geometry.bindIndexBuffer(commandBuffer, batch.indexType);
+
+		VkDeviceSize offset = static_cast<VkDeviceSize>(batch.firstInstance) * stride;
+		if (m_compact)
+			commandBuffer.drawIndexedIndirectCount(target.commands[frameIndex]->getHandle(), offset,
+				target.counts[frameIndex]->getHandle(), i * sizeof(uint32_t), batch.instanceCount, stride);
+		else
+			commandBuffer.drawIndexedIndirect(target.commands[frameIndex]->getHandle(), offset, batch.instanceCount, stride);
+	}
+}
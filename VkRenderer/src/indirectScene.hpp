@@ -0,0 +1,101 @@
+#pragma once
+#include "src/vulkan/vkHeader.hpp"
+#include "src/culling.hpp"
+
+class Model;
+
+// a mesh drawn by the indirect path, see meshInstance.glsl
+struct MeshInstance {
+	glm::mat4 model;
+	glm::vec4 positionOffset;	// packed positions only
+	glm::vec4 positionScale;
+	glm::vec4 boundsMin;		// world space box
+	glm::vec4 boundsMax;
+	glm::vec4 sphere;			// world space center, radius
+	glm::uvec4 lods[MAX_MESH_LODS];	// first index, index count, float bits of the world space error
+	glm::uvec4 draw;			// lod count, vertex offset, batch, first instance of the batch
+};
+static_assert(sizeof(MeshInstance) == 240, "MeshInstance must match the std430 layout of meshInstance.glsl");
+
+// every mesh of the scene in a storage buffer, culled and lod selected by cull.comp into indexed indirect draws.
+// instances are grouped in batches sharing a material and an index type, a pass draws a batch per indirect call
+// so its recording cost depends on the material count only.
+// with VK_KHR_draw_indirect_count the visible draws of a batch are compacted and counted on the gpu,
+// otherwise every instance keeps its command and culled ones draw no instance
+class IndirectScene {
+public:
+	// viewCount : views culled separately every frame, each with its own draws
+	IndirectScene(GeometryBuffer& geometry, uint32_t viewCount);
+	~IndirectScene();
+
+	// gathers the meshes of the models and allocates the buffers, the gpu must be idle.
+	// descriptor sets reading getInstanceBuffer() must be written again after it
+	void build(const std::vector<std::shared_ptr<Model>>& models);
+	// rewrites this frame's instances when a model moved or the geometry was compacted since they were written,
+	// the frame's fence must have been waited
+	void update(const std::vector<std::shared_ptr<Model>>& models, uint32_t frameIndex);
+
+	// records the culling of a view, outside of a render pass. view is in world space (identity model)
+	// and maxPixelError < 0 draws every mesh at lod 0
+	void cull(CommandBuffer& commandBuffer, uint32_t frameIndex, uint32_t view, const CullView& cullView, float maxPixelError);
+	// records the draws of a view culled this frame, the geometry and set 0 must be bound.
+	// materialLayout : binds every batch's material as set 1, VK_NULL_HANDLE for passes without materials
+	void draw(CommandBuffer& commandBuffer, uint32_t frameIndex, uint32_t view, VkPipelineLayout materialLayout);
+
+	Buffer& getInstanceBuffer(uint32_t frameIndex) { return *m_frames[frameIndex].instances; }
+	uint32_t getInstanceCount() const { return static_cast<uint32_t>(m_instanceMeshes.size()); }
+	uint32_t getBatchCount() const { return static_cast<uint32_t>(m_batches.size()); }
+	bool isCompact() const { return m_compact; }
+
+private:
+	struct Batch {
+		Material* material;
+		VkIndexType indexType;
+		uint32_t firstInstance;
+		uint32_t instanceCount;
+	};
+
+	struct InstanceMesh {
+		const Mesh* mesh;
+		uint32_t model;	// index in the models given to build()
+	};
+
+	struct Frame {
+		std::unique_ptr<Buffer> instances;	// host visible, written by update()
+		uint32_t version = 0;				// of m_version the instances were written at
+	};
+
+	struct View {
+		std::unique_ptr<Buffer> commands[MAX_FRAMES_IN_FLIGHT];	// a VkDrawIndexedIndirectCommand per instance
+		std::unique_ptr<Buffer> counts[MAX_FRAMES_IN_FLIGHT];		// draws of every batch, compact only
+		std::shared_ptr<DescriptorSet> descriptorSet;
+	};
+
+	// push constants of cull.comp
+	struct CullConstants {
+		glm::vec4 planes[6];
+		glm::vec4 position;	// w : 1 for perspective views
+		float lodScale;
+		float maxPixelError;
+		uint32_t instanceCount;
+		uint32_t compact;
+	};
+
+	void writeInstances(const std::vector<std::shared_ptr<Model>>& models, Frame& frame);
+
+	GeometryBuffer& m_geometry;
+	bool m_compact;
+
+	std::shared_ptr<Shader> m_cullShader;
+	std::shared_ptr<ComputePipeline> m_cullPipeline;
+
+	std::vector<InstanceMesh> m_instanceMeshes;	// in batch order
+	std::vector<Batch> m_batches;
+	std::vector<glm::mat4> m_matrices;			// model matrices the instances were written with
+	BoundsBatch m_bounds;
+	uint32_t m_geometryGeneration = 0;
+	uint32_t m_version = 1;
+
+	Frame m_frames[MAX_FRAMES_IN_FLIGHT];
+	std::vector<View> m_views;
+};
@@ -0,0 +1,118 @@
+#include "src/instancedModel.hpp"
+#include "src/model.hpp"
+#include "src/material.hpp"
+#include "src/vulkan/buffer.hpp"
+#include "src/vulkan/shader.hpp"
+#include "src/vulkan/descriptorSet.hpp"
+#include "src/vulkan/geometryBuffer.hpp"
+#include "src/vulkan/commandBuffer.hpp"
+
+InstanceBuffer::InstanceBuffer(uint32_t capacity)
+	: m_capacity(capacity) {
+	for (auto& buffer : m_buffers) {
+		buffer = std::make_unique<Buffer>();
+		buffer->createBuffer(static_cast<VkDeviceSize>(capacity) * sizeof(glm::mat4), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+			VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+	}
+}
+
+InstanceBuffer::~InstanceBuffer() {
+}
+
+void InstanceBuffer::begin(uint32_t frameIndex) {
+	m_frameIndex = frameIndex;
+	m_count = 0;
+}
+
+uint32_t InstanceBuffer::push(const glm::mat4* transforms, uint32_t& count) {
+	DEBUG_ASSERT(m_count + count <= m_capacity, "instance buffer full, %u transforms dropped", m_count + count - m_capacity);
+	count = std::min(count, m_capacity - m_count);
+	uint32_t first = m_count;
+	glm::mat4* mapped = static_cast<glm::mat4*>(m_buffers[m_frameIndex]->getMapped());
+	memcpy(mapped + first, transforms, count * sizeof(glm::mat4));
+	m_count += count;
+	return first;
+}
+
+InstancedModel::InstancedModel(std::shared_ptr<Model> model)
+	: m_model(model) {
+	for (auto& mesh : m_model->m_meshes) {
+		if (mesh->m_material != nullptr)
+			m_meshes.push_back(mesh.get());
+	}
+}
+
+void InstancedModel::setTransforms(std::vector<glm::mat4> transforms) {
+	m_transforms = std::move(transforms);
+	m_bounds.clear();
+	for (const Mesh* mesh : m_meshes) {
+		for (const glm::mat4& transform : m_transforms)
+			m_bounds.add(*mesh, transform);
+	}
+}
+
+void InstancedModel::cull(const Frustum& frustum, const glm::vec3& position, bool perspective, float lodScale, float maxPixelError,
+	InstanceBuffer& instances, CullingStats& stats) {
+	m_draws.clear();
+	cullBounds(frustum, m_bounds, m_visible, stats);
+
+	size_t instanceCount = m_transforms.size();
+	for (size_t m = 0; m < m_meshes.size(); m++) {
+		const Mesh& mesh = *m_meshes[m];
+		for (auto& transforms : m_lodTransforms)
+			transforms.clear();
+
+		for (size_t i = 0; i < instanceCount; i++) {
+			size_t bounds = m * instanceCount + i;
+			if (!m_visible[bounds])
+				continue;
+
+			// selectLod in world space, the mesh's errors grow with the instance's scale
+			uint32_t lod = 0;
+			if (maxPixelError >= 0.f && mesh.m_radius > 0.f) {
+				float pixelsPerUnit = lodScale;
+				float distance = 1.f;
+				if (perspective) {
+					glm::vec3 center(m_bounds.sphereX[bounds], m_bounds.sphereY[bounds], m_bounds.sphereZ[bounds]);
+					distance = glm::length(position - center) - m_bounds.radius[bounds];
+				}
+				if (distance > 0.f) {
+					pixelsPerUnit *= (m_bounds.radius[bounds] / mesh.m_radius) / distance;
+					while (lod + 1 < mesh.m_lods.size() && mesh.m_lods[lod + 1].error * pixelsPerUnit <= maxPixelError)
+						lod++;
+				}
+			}
+			m_lodTransforms[lod].push_back(m_transforms[i]);
+		}
+
+		for (uint32_t lod = 0; lod < MAX_MESH_LODS; lod++) {
+			uint32_t count = static_cast<uint32_t>(m_lodTransforms[lod].size());
+			uint32_t first = instances.push(m_lodTransforms[lod].data(), count);
+			if (count == 0)
+				continue;
+			m_draws.push_back({ &mesh, lod, first, count });
+			stats.lodMeshes[lod] += count;
+		}
+	}
+}
+
+void InstancedModel::draw(CommandBuffer& commandBuffer, GeometryBuffer& geometry, uint32_t frameIndex, const Shader& shader, VkPipelineLayout materialLayout, CullingStats& stats) {
+	for (const Draw& draw : m_draws) {
+		const Mesh& mesh = *draw.mesh;
+		if (materialLayout != VK_NULL_HANDLE) {
+			VkDescriptorSet materialSet = mesh.m_material->m_descriptorSet->getHandle(frameIndex);
+			commandBuffer.bindDescriptorSets(VK_PIPELINE_BIND_POINT_GRAPHICS, materialLayout, 1, 1, &materialSet);
+			stats.descriptorSetBinds++;
+		}
+		// the instance matrices place the mesh, the push constants only carry its packing bounds
+		MeshConstants constants = mesh.getConstants(glm::mat4(1.0f));
+		commandBuffer.pushConstants(shader, &constants);
+
+		const MeshLod& lod = mesh.m_lods[draw.lod];
+		geometry.bindIndexBuffer(commandBuffer, mesh.m_geometry->getIndexType());
+		commandBuffer.drawIndexed(lod.indexCount, draw.instanceCount, mesh.m_geometry->getFirstIndex() + lod.firstIndex,
+			mesh.m_geometry->getVertexOffset(), draw.firstInstance);
+		stats.drawCount++;
+		stats.triangleCount += lod.indexCount / 3 * draw.instanceCount;
+	}
+}
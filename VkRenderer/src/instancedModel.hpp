@@ -0,0 +1,68 @@
+#pragma once
+#include "src/vulkan/vkHeader.hpp"
+#include "src/culling.hpp"
+
+class Model;
+
+// transforms of the instances drawn this frame, read at gl_InstanceIndex by the INSTANCED_DRAW vertex shaders.
+// a host visible storage buffer per frame in flight, filled from the start every frame
+class InstanceBuffer {
+public:
+	InstanceBuffer(uint32_t capacity);
+	~InstanceBuffer();
+
+	// the frame's fence must have been waited
+	void begin(uint32_t frameIndex);
+	// copies the transforms to this frame's buffer and returns the first instance to draw them with.
+	// count is lowered to what is left when the buffer is full
+	uint32_t push(const glm::mat4* transforms, uint32_t& count);
+
+	Buffer& getBuffer(uint32_t frameIndex) { return *m_buffers[frameIndex]; }
+	uint32_t getCount() const { return m_count; }
+	uint32_t getCapacity() const { return m_capacity; }
+
+private:
+	std::unique_ptr<Buffer> m_buffers[MAX_FRAMES_IN_FLIGHT];
+	uint32_t m_capacity;
+	uint32_t m_frameIndex = 0;
+	uint32_t m_count = 0;
+};
+
+// a model drawn at many transforms : the instances share its geometry, materials and descriptor sets and only add
+// a matrix each. a pass culls the instances on the cpu and draws every mesh once per lod with instanceCount > 1,
+// meshlets are not culled per instance
+class InstancedModel {
+public:
+	InstancedModel(std::shared_ptr<Model> model);
+
+	// world transforms of the instances, the model's own matrix is ignored
+	void setTransforms(std::vector<glm::mat4> transforms);
+
+	// frustum culls the instances of every mesh, picks their lods and pushes the visible transforms grouped by lod.
+	// position, perspective and lodScale as in CullView, in world space. maxPixelError < 0 draws every instance at lod 0
+	void cull(const Frustum& frustum, const glm::vec3& position, bool perspective, float lodScale, float maxPixelError,
+		InstanceBuffer& instances, CullingStats& stats);
+	// records the draws of the last cull with the geometry and set 0 bound, shader : the pipeline's, for the push constants.
+	// materialLayout : binds every mesh's material as set 1, VK_NULL_HANDLE for passes without materials
+	void draw(CommandBuffer& commandBuffer, GeometryBuffer& geometry, uint32_t frameIndex, const Shader& shader, VkPipelineLayout materialLayout, CullingStats& stats);
+
+	const Model& getModel() const { return *m_model; }
+	uint32_t getInstanceCount() const { return static_cast<uint32_t>(m_transforms.size()); }
+
+private:
+	// the instances of a mesh drawn at one lod
+	struct Draw {
+		const Mesh* mesh;
+		uint32_t lod;
+		uint32_t firstInstance;	// in the instance buffer
+		uint32_t instanceCount;
+	};
+
+	std::shared_ptr<Model> m_model;
+	std::vector<const Mesh*> m_meshes;		// the model's meshes with a material
+	std::vector<glm::mat4> m_transforms;
+	BoundsBatch m_bounds;					// mesh major, m_meshes.size() * instance count
+	std::vector<uint8_t> m_visible;
+	std::vector<glm::mat4> m_lodTransforms[MAX_MESH_LODS];
+	std::vector<Draw> m_draws;
+};
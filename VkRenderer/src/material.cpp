@@ -1,8 +1,11 @@
 #include "src/material.hpp"
 #include "src/vulkan/descriptorSet.hpp"
+#include <atomic>
 
 Material::Material()
 {
+	static std::atomic<uint32_t> nextId{ 0 };
+	m_id = nextId++;
 }
 
 void Material::createUniformBuffers()
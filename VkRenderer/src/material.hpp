@@ -14,6 +14,7 @@ public:
 
 	void createUniformBuffers();
 
+	uint32_t m_id;	// unique per material, orders draws in a render queue
 	MaterialProperties m_properties;
 
 	std::shared_ptr<Texture2D> m_albedo = nullptr;
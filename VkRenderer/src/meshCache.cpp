@@ -0,0 +1,386 @@
+#include "src/meshCache.hpp"
+
+#if defined(PLATFORM_WINDOWS)
+	#define WIN32_LEAN_AND_MEAN
+	#define NOMINMAX
+	#include <windows.h>
+#else
+	#include <fcntl.h>
+	#include <sys/mman.h>
+	#include <sys/stat.h>
+	#include <unistd.h>
+#endif
+
+static constexpr uint32_t MESH_CACHE_MAGIC = 0x4348534d; // "MSHC"
+static constexpr uint32_t MESH_CACHE_VERSION = 6;
+static constexpr uint64_t SECTION_ALIGNMENT = 16;
+
+// identifies a version of a source file, the hash is only checked when the timestamp changed
+struct SourceStamp {
+	uint64_t size = 0;
+	int64_t time = 0;
+	uint64_t hash = 0;
+};
+
+struct MeshCacheHeader {
+	uint32_t magic;
+	uint32_t version;
+	uint32_t vertexStride;
+	uint32_t shapeStride;
+	uint32_t vertexCount;
+	uint32_t indexCount;
+	uint32_t shapeCount;
+	uint32_t materialCount;
+	uint32_t options;
+	uint32_t meshletStride;
+	uint32_t meshletCount;
+	uint32_t lodStride;
+	uint32_t lodCount;
+	uint32_t libraryCount;
+	SourceStamp source;
+	uint64_t shapesOffset;
+	uint64_t verticesOffset;
+	uint64_t indicesOffset;
+	uint64_t meshletsOffset;
+	uint64_t lodsOffset;
+	uint64_t librariesOffset;	// a stamp per MeshData::materialLibraries entry, zero for the missing ones
+	uint64_t stringsOffset;
+	uint64_t stringsSize;
+};
+
+static uint64_t alignOffset(uint64_t offset) {
+	return (offset + SECTION_ALIGNMENT - 1) / SECTION_ALIGNMENT * SECTION_ALIGNMENT;
+}
+
+// fnv-1a
+static uint64_t hashFile(const std::filesystem::path& path) {
+	std::ifstream file(path, std::ios::binary);
+	std::vector<char> buffer(1 << 20);
+
+	uint64_t hash = 0xcbf29ce484222325ull;
+	while (file) {
+		file.read(buffer.data(), buffer.size());
+		std::streamsize count = file.gcount();
+		for (std::streamsize i = 0; i < count; i++) {
+			hash ^= static_cast<uint8_t>(buffer[i]);
+			hash *= 0x100000001b3ull;
+		}
+	}
+	return hash;
+}
+
+// a zero stamp when the file can't be read
+static bool getStamp(const std::filesystem::path& path, SourceStamp& stamp, bool withHash) {
+	stamp = SourceStamp{};
+	std::error_code error;
+	uint64_t size = std::filesystem::file_size(path, error);
+	if (error)
+		return false;
+	int64_t time = static_cast<int64_t>(std::filesystem::last_write_time(path, error).time_since_epoch().count());
+	if (error)
+		return false;
+	stamp = { size, time, withHash ? hashFile(path) : 0 };
+	return true;
+}
+
+static bool isStampValid(const std::filesystem::path& path, const SourceStamp& cached) {
+	SourceStamp current;
+	if (!getStamp(path, current, false))
+		return cached.size == 0 && cached.time == 0;
+	if (current.size != cached.size)
+		return false;
+	if (current.time == cached.time)
+		return true;
+	// touched or copied, the content decides
+	return hashFile(path) == cached.hash;
+}
+
+MeshCache::~MeshCache() {
+	close();
+}
+
+std::filesystem::path MeshCache::getCachePath(const std::filesystem::path& source) {
+	std::filesystem::path path = source;
+	return path += ".meshcache";
+}
+
+bool MeshCache::write(const std::filesystem::path& source, const MeshData& data, uint32_t options) {
+	MeshCacheHeader header{};
+	header.magic = MESH_CACHE_MAGIC;
+	header.version = MESH_CACHE_VERSION;
+	header.vertexStride = sizeof(Vertex);
+	header.shapeStride = sizeof(MeshShape);
+	header.meshletStride = sizeof(Meshlet);
+	header.lodStride = sizeof(MeshLod);
+	header.vertexCount = static_cast<uint32_t>(data.vertices.size());
+	header.indexCount = static_cast<uint32_t>(data.indices.size());
+	header.shapeCount = static_cast<uint32_t>(data.shapes.size());
+	header.materialCount = static_cast<uint32_t>(data.materials.size());
+	header.meshletCount = static_cast<uint32_t>(data.meshlets.size());
+	header.lodCount = static_cast<uint32_t>(data.lods.size());
+	header.libraryCount = static_cast<uint32_t>(data.materialLibraries.size());
+	header.options = options;
+
+	if (!getStamp(source, header.source, true))
+		return false;
+	std::vector<SourceStamp> libraries(data.materialLibraries.size());
+	for (size_t i = 0; i < libraries.size(); i++)
+		getStamp(source.parent_path() / data.materialLibraries[i], libraries[i], true);
+
+	std::vector<char> strings;
+	auto writeString = [&](const std::string& string) {
+		uint32_t length = static_cast<uint32_t>(string.size());
+		strings.insert(strings.end(), reinterpret_cast<const char*>(&length), reinterpret_cast<const char*>(&length) + sizeof(length));
+		strings.insert(strings.end(), string.begin(), string.end());
+	};
+	for (const MaterialDesc& material : data.materials) {
+		writeString(material.diffuse);
+		writeString(material.specular);
+		writeString(material.normal);
+		writeString(material.bump);
+	}
+	for (const std::string& library : data.materialLibraries)
+		writeString(library);
+
+	header.shapesOffset = alignOffset(sizeof(MeshCacheHeader));
+	header.verticesOffset = alignOffset(header.shapesOffset + data.shapes.size() * sizeof(MeshShape));
+	header.indicesOffset = alignOffset(header.verticesOffset + data.vertices.size() * sizeof(Vertex));
+	header.meshletsOffset = alignOffset(header.indicesOffset + data.indices.size() * sizeof(uint32_t));
+	header.lodsOffset = alignOffset(header.meshletsOffset + data.meshlets.size() * sizeof(Meshlet));
+	header.librariesOffset = alignOffset(header.lodsOffset + data.lods.size() * sizeof(MeshLod));
+	header.stringsOffset = alignOffset(header.librariesOffset + libraries.size() * sizeof(SourceStamp));
+	header.stringsSize = strings.size();
+
+	// written aside then renamed so that an interrupted write never leaves a valid looking cache
+	std::filesystem::path cachePath = getCachePath(source);
+	std::filesystem::path tempPath = cachePath;
+	tempPath += ".tmp";
+	{
+		std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+		if (!file)
+			return false;
+
+		auto writeSection = [&](uint64_t offset, const void* bytes, size_t size) {
+			static const char zeros[SECTION_ALIGNMENT] = {};
+			uint64_t position = static_cast<uint64_t>(file.tellp());
+			file.write(zeros, static_cast<std::streamsize>(offset - position));
+			file.write(static_cast<const char*>(bytes), static_cast<std::streamsize>(size));
+		};
+
+		file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+		writeSection(header.shapesOffset, data.shapes.data(), data.shapes.size() * sizeof(MeshShape));
+		writeSection(header.verticesOffset, data.vertices.data(), data.vertices.size() * sizeof(Vertex));
+		writeSection(header.indicesOffset, data.indices.data(), data.indices.size() * sizeof(uint32_t));
+		writeSection(header.meshletsOffset, data.meshlets.data(), data.meshlets.size() * sizeof(Meshlet));
+		writeSection(header.lodsOffset, data.lods.data(), data.lods.size() * sizeof(MeshLod));
+		writeSection(header.librariesOffset, libraries.data(), libraries.size() * sizeof(SourceStamp));
+		writeSection(header.stringsOffset, strings.data(), strings.size());
+
+		if (!file)
+			return false;
+	}
+
+	std::error_code error;
+	std::filesystem::rename(tempPath, cachePath, error);
+	if (error) {
+		std::filesystem::remove(tempPath, error);
+		return false;
+	}
+	return true;
+}
+
+bool MeshCache::map(const std::filesystem::path& path) {
+#if defined(PLATFORM_WINDOWS)
+	HANDLE file = CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+	if (file == INVALID_HANDLE_VALUE)
+		return false;
+	m_file = file;
+
+	LARGE_INTEGER size;
+	if (!GetFileSizeEx(file, &size) || size.QuadPart == 0)
+		return false;
+	m_size = static_cast<size_t>(size.QuadPart);
+
+	m_mapping = CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	if (m_mapping == nullptr)
+		return false;
+
+	m_data = static_cast<const uint8_t*>(MapViewOfFile(m_mapping, FILE_MAP_READ, 0, 0, 0));
+	return m_data != nullptr;
+#else
+	int file = ::open(path.c_str(), O_RDONLY);
+	if (file < 0)
+		return false;
+
+	struct stat info;
+	if (fstat(file, &info) != 0 || info.st_size == 0) {
+		::close(file);
+		return false;
+	}
+	m_size = static_cast<size_t>(info.st_size);
+
+	void* data = mmap(nullptr, m_size, PROT_READ, MAP_PRIVATE, file, 0);
+	::close(file);
+	if (data == MAP_FAILED)
+		return false;
+
+	// everything is read once right away
+	madvise(data, m_size, MADV_WILLNEED);
+	m_data = static_cast<const uint8_t*>(data);
+	return true;
+#endif
+}
+
+void MeshCache::close() {
+#if defined(PLATFORM_WINDOWS)
+	if (m_data)
+		UnmapViewOfFile(m_data);
+	if (m_mapping)
+		CloseHandle(m_mapping);
+	if (m_file)
+		CloseHandle(m_file);
+	m_mapping = nullptr;
+	m_file = nullptr;
+#else
+	if (m_data)
+		munmap(const_cast<uint8_t*>(m_data), m_size);
+#endif
+	m_data = nullptr;
+	m_size = 0;
+	m_materials.clear();
+}
+
+bool MeshCache::open(const std::filesystem::path& source, uint32_t options) {
+	close();
+
+	std::filesystem::path cachePath = getCachePath(source);
+	if (!std::filesystem::exists(cachePath) || !map(cachePath)) {
+		close();
+		return false;
+	}
+
+	auto fail = [&](const char* reason) {
+		printf("mesh cache %s %s, rebuilding\n", cachePath.string().c_str(), reason);
+		close();
+		return false;
+	};
+
+	if (m_size < sizeof(MeshCacheHeader))
+		return fail("is truncated");
+
+	const MeshCacheHeader& header = *reinterpret_cast<const MeshCacheHeader*>(m_data);
+	if (header.magic != MESH_CACHE_MAGIC || header.version != MESH_CACHE_VERSION ||
+		header.vertexStride != sizeof(Vertex) || header.shapeStride != sizeof(MeshShape) || header.meshletStride != sizeof(Meshlet) ||
+		header.lodStride != sizeof(MeshLod))
+		return fail("has an old format");
+
+	if (header.options != options)
+		return fail("was built with other options");
+
+	auto sectionFits = [&](uint64_t offset, uint64_t size) {
+		return offset % SECTION_ALIGNMENT == 0 && offset <= m_size && size <= m_size - offset;
+	};
+	if (!sectionFits(header.shapesOffset, uint64_t(header.shapeCount) * sizeof(MeshShape)) ||
+		!sectionFits(header.verticesOffset, uint64_t(header.vertexCount) * sizeof(Vertex)) ||
+		!sectionFits(header.indicesOffset, uint64_t(header.indexCount) * sizeof(uint32_t)) ||
+		!sectionFits(header.meshletsOffset, uint64_t(header.meshletCount) * sizeof(Meshlet)) ||
+		!sectionFits(header.lodsOffset, uint64_t(header.lodCount) * sizeof(MeshLod)) ||
+		!sectionFits(header.librariesOffset, uint64_t(header.libraryCount) * sizeof(SourceStamp)) ||
+		!sectionFits(header.stringsOffset, header.stringsSize))
+		return fail("is truncated");
+
+	if (!isStampValid(source, header.source))
+		return fail("is stale");
+
+	const MeshShape* shapes = getShapes();
+	const Meshlet* meshlets = getMeshlets();
+	const MeshLod* lods = getLods();
+	for (uint32_t i = 0; i < header.shapeCount; i++) {
+		const MeshShape& shape = shapes[i];
+		if (uint64_t(shape.vertexOffset) + shape.vertexCount > header.vertexCount ||
+			uint64_t(shape.indexOffset) + shape.indexCount > header.indexCount ||
+			uint64_t(shape.meshletOffset) + shape.meshletCount > header.meshletCount ||
+			uint64_t(shape.lodOffset) + shape.lodCount > header.lodCount || shape.lodCount == 0 ||
+			shape.materialId >= static_cast<int32_t>(header.materialCount))
+			return fail("is corrupt");
+
+		for (uint32_t j = 0; j < shape.meshletCount; j++) {
+			const Meshlet& meshlet = meshlets[shape.meshletOffset + j];
+			if (uint64_t(meshlet.firstIndex) + meshlet.indexCount > shape.indexCount)
+				return fail("is corrupt");
+		}
+
+		for (uint32_t j = 0; j < shape.lodCount; j++) {
+			const MeshLod& lod = lods[shape.lodOffset + j];
+			if (uint64_t(lod.firstIndex) + lod.indexCount > shape.indexCount ||
+				uint64_t(lod.meshletOffset) + lod.meshletCount > shape.meshletCount)
+				return fail("is corrupt");
+		}
+	}
+
+	const uint8_t* strings = m_data + header.stringsOffset;
+	uint64_t cursor = 0;
+	auto readString = [&](std::string& string) {
+		uint32_t length;
+		if (header.stringsSize - cursor < sizeof(length))
+			return false;
+		memcpy(&length, strings + cursor, sizeof(length));
+		cursor += sizeof(length);
+		if (header.stringsSize - cursor < length)
+			return false;
+		string.assign(reinterpret_cast<const char*>(strings + cursor), length);
+		cursor += length;
+		return true;
+	};
+
+	m_materials.resize(header.materialCount);
+	for (MaterialDesc& material : m_materials) {
+		if (!readString(material.diffuse) || !readString(material.specular) ||
+			!readString(material.normal) || !readString(material.bump))
+			return fail("is corrupt");
+	}
+
+	// the materials the source read, a library changes them without touching the source
+	const SourceStamp* libraries = reinterpret_cast<const SourceStamp*>(m_data + header.librariesOffset);
+	for (uint32_t i = 0; i < header.libraryCount; i++) {
+		std::string library;
+		if (!readString(library))
+			return fail("is corrupt");
+		if (!isStampValid(source.parent_path() / library, libraries[i]))
+			return fail("is stale");
+	}
+
+	return true;
+}
+
+const Vertex* MeshCache::getVertices() const {
+	return reinterpret_cast<const Vertex*>(m_data + reinterpret_cast<const MeshCacheHeader*>(m_data)->verticesOffset);
+}
+
+const uint32_t* MeshCache::getIndices() const {
+	return reinterpret_cast<const uint32_t*>(m_data + reinterpret_cast<const MeshCacheHeader*>(m_data)->indicesOffset);
+}
+
+const MeshShape* MeshCache::getShapes() const {
+	return reinterpret_cast<const MeshShape*>(m_data + reinterpret_cast<const MeshCacheHeader*>(m_data)->shapesOffset);
+}
+
+const Meshlet* MeshCache::getMeshlets() const {
+	return reinterpret_cast<const Meshlet*>(m_data + reinterpret_cast<const MeshCacheHeader*>(m_data)->meshletsOffset);
+}
+
+const MeshLod* MeshCache::getLods() const {
+	return reinterpret_cast<const MeshLod*>(m_data + reinterpret_cast<const MeshCacheHeader*>(m_data)->lodsOffset);
+}
+
+uint32_t MeshCache::getVertexCount() const {
+	return reinterpret_cast<const MeshCacheHeader*>(m_data)->vertexCount;
+}
+
+uint32_t MeshCache::getIndexCount() const {
+	return reinterpret_cast<const MeshCacheHeader*>(m_data)->indexCount;
+}
+
+uint32_t MeshCache::getShapeCount() const {
+	return reinterpret_cast<const MeshCacheHeader*>(m_data)->shapeCount;
+}
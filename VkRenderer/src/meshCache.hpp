@@ -0,0 +1,44 @@
+#pragma once
+#include "src/vulkan/vkHeader.hpp"
+#include "src/model.hpp"
+
+// binary snapshot of a processed model written next to its source file (<source>.meshcache).
+// the file is memory mapped and its vertex / index arrays are read in place
+class MeshCache {
+public:
+	MeshCache() = default;
+	~MeshCache();
+
+	MeshCache(const MeshCache&) = delete;
+	MeshCache& operator=(const MeshCache&) = delete;
+
+	static std::filesystem::path getCachePath(const std::filesystem::path& source);
+	// options : whatever changes how the data was built, a mismatch invalidates the cache
+	static bool write(const std::filesystem::path& source, const MeshData& data, uint32_t options);
+
+	// maps the cache of source, fails if it is missing, corrupt, stale or built with other options
+	bool open(const std::filesystem::path& source, uint32_t options);
+	void close();
+
+	const Vertex* getVertices() const;
+	const uint32_t* getIndices() const;
+	const MeshShape* getShapes() const;
+	const Meshlet* getMeshlets() const;
+	const MeshLod* getLods() const;
+	uint32_t getVertexCount() const;
+	uint32_t getIndexCount() const;
+	uint32_t getShapeCount() const;
+	const std::vector<MaterialDesc>& getMaterials() const { return m_materials; }
+
+private:
+	bool map(const std::filesystem::path& path);
+
+	const uint8_t* m_data = nullptr;
+	size_t m_size = 0;
+#if defined(PLATFORM_WINDOWS)
+	void* m_file = nullptr;
+	void* m_mapping = nullptr;
+#endif
+
+	std::vector<MaterialDesc> m_materials;
+};
@@ -0,0 +1,635 @@
+#include "src/meshOptimizer.hpp"
+
+namespace MeshOptimizer {
+
+	static constexpr uint32_t INVALID_INDEX = UINT32_MAX;
+
+	VertexCacheStats analyzeVertexCache(const uint32_t* indices, size_t indexCount, size_t vertexCount, uint32_t cacheSize) {
+		VertexCacheStats stats{};
+		if (indexCount == 0)
+			return stats;
+
+		// a vertex is cached while fewer than cacheSize misses happened since it was loaded
+		std::vector<uint32_t> loadTime(vertexCount, 0);
+		std::vector<bool> referenced(vertexCount, false);
+		uint32_t time = cacheSize + 1;
+		uint32_t misses = 0;
+		uint32_t uniqueVertices = 0;
+
+		for (size_t i = 0; i < indexCount; i++) {
+			uint32_t v = indices[i];
+			if (time - loadTime[v] > cacheSize) {
+				loadTime[v] = time++;
+				misses++;
+			}
+			if (!referenced[v]) {
+				referenced[v] = true;
+				uniqueVertices++;
+			}
+		}
+
+		stats.acmr = static_cast<float>(misses) / static_cast<float>(indexCount / 3);
+		stats.atvr = static_cast<float>(misses) / static_cast<float>(uniqueVertices);
+		return stats;
+	}
+
+	// scoring from Tom Forsyth's "Linear-Speed Vertex Cache Optimisation"
+	static constexpr uint32_t CACHE_SIZE = 32;
+	static constexpr uint32_t MAX_VALENCE = 32;
+	static constexpr float CACHE_DECAY_POWER = 1.5f;
+	static constexpr float LAST_TRIANGLE_SCORE = 0.75f;
+	static constexpr float VALENCE_BOOST_SCALE = 2.0f;
+	static constexpr float VALENCE_BOOST_POWER = 0.5f;
+
+	struct ScoreTable {
+		float cache[CACHE_SIZE];
+		float valence[MAX_VALENCE + 1];
+
+		ScoreTable() {
+			for (uint32_t i = 0; i < CACHE_SIZE; i++) {
+				// the last triangle's vertices are scored flat so it isn't simply repeated
+				cache[i] = i < 3 ? LAST_TRIANGLE_SCORE : std::pow(1.f - static_cast<float>(i - 3) / (CACHE_SIZE - 3), CACHE_DECAY_POWER);
+			}
+			valence[0] = 0.f;
+			for (uint32_t i = 1; i <= MAX_VALENCE; i++)
+				valence[i] = VALENCE_BOOST_SCALE * std::pow(static_cast<float>(i), -VALENCE_BOOST_POWER);
+		}
+
+		float score(int32_t cachePosition, uint32_t liveTriangles) const {
+			if (liveTriangles == 0)
+				return -1.f;
+			float s = cachePosition >= 0 ? cache[cachePosition] : 0.f;
+			return s + valence[std::min(liveTriangles, MAX_VALENCE)];
+		}
+	};
+
+	void optimizeVertexCache(uint32_t* indices, size_t indexCount, size_t vertexCount) {
+		static const ScoreTable table;
+
+		size_t triangleCount = indexCount / 3;
+		if (triangleCount == 0)
+			return;
+
+		// triangles around each vertex, the live ones are kept at the front of the vertex's range
+		std::vector<uint32_t> liveTriangles(vertexCount, 0);
+		for (size_t i = 0; i < indexCount; i++)
+			liveTriangles[indices[i]]++;
+
+		std::vector<uint32_t> firstTriangle(vertexCount + 1, 0);
+		for (size_t v = 0; v < vertexCount; v++)
+			firstTriangle[v + 1] = firstTriangle[v] + liveTriangles[v];
+
+		std::vector<uint32_t> vertexTriangles(indexCount);
+		{
+			std::vector<uint32_t> fill(firstTriangle.begin(), firstTriangle.end() - 1);
+			for (size_t i = 0; i < indexCount; i++)
+				vertexTriangles[fill[indices[i]]++] = static_cast<uint32_t>(i / 3);
+		}
+
+		std::vector<int32_t> cachePosition(vertexCount, -1);
+		std::vector<float> vertexScore(vertexCount);
+		for (size_t v = 0; v < vertexCount; v++)
+			vertexScore[v] = table.score(-1, liveTriangles[v]);
+
+		std::vector<float> triangleScore(triangleCount);
+		for (size_t t = 0; t < triangleCount; t++)
+			triangleScore[t] = vertexScore[indices[t * 3 + 0]] + vertexScore[indices[t * 3 + 1]] + vertexScore[indices[t * 3 + 2]];
+
+		std::vector<bool> emitted(triangleCount, false);
+		std::vector<uint32_t> output(indexCount);
+
+		uint32_t cache[CACHE_SIZE + 3];
+		uint32_t cacheCount = 0;
+		uint32_t newCache[CACHE_SIZE + 3];
+
+		uint32_t bestTriangle = 0;
+		for (uint32_t t = 1; t < triangleCount; t++) {
+			if (triangleScore[t] > triangleScore[bestTriangle])
+				bestTriangle = t;
+		}
+
+		size_t cursor = 0;
+		for (size_t outTriangle = 0; outTriangle < triangleCount; outTriangle++) {
+			if (bestTriangle == INVALID_INDEX) {
+				// dead end : continue with the next triangle in input order
+				while (emitted[cursor])
+					cursor++;
+				bestTriangle = static_cast<uint32_t>(cursor);
+			}
+
+			const uint32_t* triangle = &indices[bestTriangle * 3];
+			output[outTriangle * 3 + 0] = triangle[0];
+			output[outTriangle * 3 + 1] = triangle[1];
+			output[outTriangle * 3 + 2] = triangle[2];
+			emitted[bestTriangle] = true;
+
+			for (uint32_t k = 0; k < 3; k++) {
+				uint32_t v = triangle[k];
+				uint32_t* begin = &vertexTriangles[firstTriangle[v]];
+				uint32_t live = liveTriangles[v];
+				for (uint32_t j = 0; j < live; j++) {
+					if (begin[j] == bestTriangle) {
+						std::swap(begin[j], begin[live - 1]);
+						break;
+					}
+				}
+				liveTriangles[v]--;
+			}
+
+			// the emitted triangle's vertices move to the front of the lru cache
+			uint32_t newCount = 0;
+			for (uint32_t k = 0; k < 3; k++) {
+				if (std::find(newCache, newCache + newCount, triangle[k]) == newCache + newCount)
+					newCache[newCount++] = triangle[k];
+			}
+			for (uint32_t i = 0; i < cacheCount; i++) {
+				uint32_t v = cache[i];
+				if (v != triangle[0] && v != triangle[1] && v != triangle[2])
+					newCache[newCount++] = v;
+			}
+
+			// rescore everything in or just evicted from the cache, and the triangles around it
+			for (uint32_t i = 0; i < newCount; i++) {
+				uint32_t v = newCache[i];
+				cachePosition[v] = i < CACHE_SIZE ? static_cast<int32_t>(i) : -1;
+
+				float score = table.score(cachePosition[v], liveTriangles[v]);
+				float delta = score - vertexScore[v];
+				vertexScore[v] = score;
+
+				const uint32_t* triangles = &vertexTriangles[firstTriangle[v]];
+				for (uint32_t j = 0; j < liveTriangles[v]; j++)
+					triangleScore[triangles[j]] += delta;
+			}
+
+			// the next triangle is picked among the ones touching the cache
+			bestTriangle = INVALID_INDEX;
+			float bestScore = -1.f;
+			for (uint32_t i = 0; i < std::min(newCount, CACHE_SIZE); i++) {
+				uint32_t v = newCache[i];
+				const uint32_t* triangles = &vertexTriangles[firstTriangle[v]];
+				for (uint32_t j = 0; j < liveTriangles[v]; j++) {
+					if (triangleScore[triangles[j]] > bestScore) {
+						bestScore = triangleScore[triangles[j]];
+						bestTriangle = triangles[j];
+					}
+				}
+			}
+
+			cacheCount = std::min(newCount, CACHE_SIZE);
+			std::copy(newCache, newCache + cacheCount, cache);
+		}
+
+		std::copy(output.begin(), output.end(), indices);
+	}
+
+	void optimizeOverdraw(uint32_t* indices, size_t indexCount, const Vertex* vertices, size_t vertexCount) {
+		size_t triangleCount = indexCount / 3;
+		if (triangleCount == 0)
+			return;
+
+		// hard boundaries : triangles that don't hit the cache at all
+		const uint32_t cacheSize = 16;
+		std::vector<uint32_t> loadTime(vertexCount, 0);
+		uint32_t time = cacheSize + 1;
+
+		std::vector<uint32_t> clusters;
+		for (size_t t = 0; t < triangleCount; t++) {
+			uint32_t misses = 0;
+			for (uint32_t k = 0; k < 3; k++) {
+				uint32_t v = indices[t * 3 + k];
+				if (time - loadTime[v] > cacheSize) {
+					loadTime[v] = time++;
+					misses++;
+				}
+			}
+			if (t == 0 || misses == 3)
+				clusters.push_back(static_cast<uint32_t>(t));
+		}
+		if (clusters.size() < 2)
+			return;
+
+		struct Cluster {
+			uint32_t begin;
+			uint32_t end;
+			glm::vec3 centroid;
+			glm::vec3 normal;
+			float sortKey;
+		};
+		std::vector<Cluster> clusterData(clusters.size());
+
+		glm::vec3 meshCentroid(0.0f);
+		float meshArea = 0.f;
+
+		for (size_t c = 0; c < clusters.size(); c++) {
+			Cluster& cluster = clusterData[c];
+			cluster.begin = clusters[c];
+			cluster.end = c + 1 < clusters.size() ? clusters[c + 1] : static_cast<uint32_t>(triangleCount);
+
+			glm::vec3 centroid(0.0f), normal(0.0f);
+			float area = 0.f;
+			for (uint32_t t = cluster.begin; t < cluster.end; t++) {
+				const glm::vec3& p0 = vertices[indices[t * 3 + 0]].pos;
+				const glm::vec3& p1 = vertices[indices[t * 3 + 1]].pos;
+				const glm::vec3& p2 = vertices[indices[t * 3 + 2]].pos;
+
+				glm::vec3 cross = glm::cross(p1 - p0, p2 - p0);
+				float triangleArea = glm::length(cross);
+
+				centroid += (p0 + p1 + p2) * (triangleArea / 3.f);
+				normal += cross;
+				area += triangleArea;
+			}
+
+			cluster.centroid = area > 0.f ? centroid / area : vertices[indices[cluster.begin * 3]].pos;
+			float normalLength = glm::length(normal);
+			cluster.normal = normalLength > 0.f ? normal / normalLength : glm::vec3(0.0f);
+
+			meshCentroid += centroid;
+			meshArea += area;
+		}
+		if (meshArea > 0.f)
+			meshCentroid /= meshArea;
+
+		// clusters on the outside facing away from the center occlude the rest
+		for (Cluster& cluster : clusterData)
+			cluster.sortKey = glm::dot(cluster.centroid - meshCentroid, cluster.normal);
+
+		std::stable_sort(clusterData.begin(), clusterData.end(), [](const Cluster& a, const Cluster& b) {
+			return a.sortKey > b.sortKey;
+		});
+
+		std::vector<uint32_t> output;
+		output.reserve(indexCount);
+		for (const Cluster& cluster : clusterData)
+			output.insert(output.end(), indices + cluster.begin * 3, indices + cluster.end * 3);
+
+		std::copy(output.begin(), output.end(), indices);
+	}
+
+	uint32_t optimizeVertexFetch(Vertex* vertices, uint32_t* indices, size_t indexCount, size_t vertexCount) {
+		std::vector<uint32_t> remap(vertexCount, INVALID_INDEX);
+		std::vector<Vertex> reordered;
+		reordered.reserve(vertexCount);
+
+		for (size_t i = 0; i < indexCount; i++) {
+			uint32_t& target = remap[indices[i]];
+			if (target == INVALID_INDEX) {
+				target = static_cast<uint32_t>(reordered.size());
+				reordered.push_back(vertices[indices[i]]);
+			}
+			indices[i] = target;
+		}
+
+		std::copy(reordered.begin(), reordered.end(), vertices);
+		return static_cast<uint32_t>(reordered.size());
+	}
+
+	static void computeMeshletBounds(const uint32_t* indices, const Vertex* vertices, Meshlet& meshlet) {
+		const uint32_t* triangles = indices + meshlet.firstIndex;
+		uint32_t triangleCount = meshlet.indexCount / 3;
+
+		glm::vec3 min(std::numeric_limits<float>::max());
+		glm::vec3 max(-std::numeric_limits<float>::max());
+		for (uint32_t i = 0; i < meshlet.indexCount; i++) {
+			min = glm::min(min, vertices[triangles[i]].pos);
+			max = glm::max(max, vertices[triangles[i]].pos);
+		}
+
+		meshlet.center = (min + max) * 0.5f;
+		meshlet.radius = 0.f;
+		for (uint32_t i = 0; i < meshlet.indexCount; i++)
+			meshlet.radius = std::max(meshlet.radius, glm::length(vertices[triangles[i]].pos - meshlet.center));
+
+		glm::vec3 normals[MESHLET_MAX_TRIANGLES];
+		uint32_t normalCount = 0;
+		glm::vec3 axis(0.0f);
+		for (uint32_t t = 0; t < triangleCount; t++) {
+			const glm::vec3& p0 = vertices[triangles[t * 3 + 0]].pos;
+			const glm::vec3& p1 = vertices[triangles[t * 3 + 1]].pos;
+			const glm::vec3& p2 = vertices[triangles[t * 3 + 2]].pos;
+
+			glm::vec3 normal = glm::cross(p1 - p0, p2 - p0);
+			float length = glm::length(normal);
+			if (length <= 0.f)
+				continue;
+			normals[normalCount++] = normal / length;
+			axis += normal / length;
+		}
+
+		meshlet.coneAxis = glm::vec3(0.0f);
+		meshlet.coneCutoff = 1.f;
+
+		float axisLength = glm::length(axis);
+		if (axisLength <= 0.f)
+			return;
+		axis /= axisLength;
+
+		float minDot = 1.f;
+		for (uint32_t i = 0; i < normalCount; i++)
+			minDot = std::min(minDot, glm::dot(normals[i], axis));
+
+		// the normals spread over close to a hemisphere, there is always a view seeing a front face
+		if (minDot <= 0.1f)
+			return;
+
+		// the backface cone is the normal cone widened by 90 degrees, its cosine is the sine of the normal cone
+		meshlet.coneAxis = axis;
+		meshlet.coneCutoff = std::sqrt(1.f - minDot * minDot);
+	}
+
+	void buildMeshlets(const uint32_t* indices, size_t indexCount, const Vertex* vertices, size_t vertexCount, std::vector<Meshlet>& meshlets) {
+		meshlets.reserve(meshlets.size() + indexCount / 3 / MESHLET_MAX_TRIANGLES + 1);
+
+		// vertices already in the current meshlet are stamped with its id
+		std::vector<uint32_t> stamp(vertexCount, INVALID_INDEX);
+		uint32_t meshletId = 0;
+		uint32_t meshletVertices = 0;
+		Meshlet meshlet{};
+
+		auto countNewVertices = [&](const uint32_t* triangle) {
+			uint32_t count = 0;
+			for (uint32_t k = 0; k < 3; k++) {
+				bool repeated = (k > 0 && triangle[k] == triangle[0]) || (k > 1 && triangle[k] == triangle[1]);
+				if (stamp[triangle[k]] != meshletId && !repeated)
+					count++;
+			}
+			return count;
+		};
+
+		auto finishMeshlet = [&]() {
+			computeMeshletBounds(indices, vertices, meshlet);
+			meshlets.push_back(meshlet);
+			meshletId++;
+			meshletVertices = 0;
+			meshlet = Meshlet{};
+		};
+
+		for (size_t i = 0; i + 2 < indexCount; i += 3) {
+			const uint32_t* triangle = &indices[i];
+			uint32_t newVertices = countNewVertices(triangle);
+
+			if (meshlet.indexCount > 0 &&
+				(meshletVertices + newVertices > MESHLET_MAX_VERTICES || meshlet.indexCount / 3 >= MESHLET_MAX_TRIANGLES)) {
+				finishMeshlet();
+				newVertices = countNewVertices(triangle);
+			}
+
+			if (meshlet.indexCount == 0)
+				meshlet.firstIndex = static_cast<uint32_t>(i);
+
+			for (uint32_t k = 0; k < 3; k++)
+				stamp[triangle[k]] = meshletId;
+			meshletVertices += newVertices;
+			meshlet.indexCount += 3;
+		}
+
+		if (meshlet.indexCount > 0)
+			finishMeshlet();
+	}
+
+	// sum of squared distances to a set of planes, weighted by triangle area
+	struct Quadric {
+		double a00 = 0.0, a11 = 0.0, a22 = 0.0, a01 = 0.0, a02 = 0.0, a12 = 0.0;
+		double b0 = 0.0, b1 = 0.0, b2 = 0.0;
+		double c = 0.0;
+		double weight = 0.0;
+
+		void addPlane(const glm::vec3& normal, float distance, float planeWeight) {
+			double x = normal.x, y = normal.y, z = normal.z, d = distance, w = planeWeight;
+			a00 += w * x * x; a11 += w * y * y; a22 += w * z * z;
+			a01 += w * x * y; a02 += w * x * z; a12 += w * y * z;
+			b0 += w * x * d; b1 += w * y * d; b2 += w * z * d;
+			c += w * d * d;
+			weight += w;
+		}
+
+		void add(const Quadric& other) {
+			a00 += other.a00; a11 += other.a11; a22 += other.a22;
+			a01 += other.a01; a02 += other.a02; a12 += other.a12;
+			b0 += other.b0; b1 += other.b1; b2 += other.b2;
+			c += other.c;
+			weight += other.weight;
+		}
+
+		// mean squared distance of p to the planes
+		float evaluate(const glm::vec3& p) const {
+			if (weight <= 0.0)
+				return 0.f;
+			double x = p.x, y = p.y, z = p.z;
+			double error = a00 * x * x + a11 * y * y + a22 * z * z
+				+ 2.0 * (a01 * x * y + a02 * x * z + a12 * y * z)
+				+ 2.0 * (b0 * x + b1 * y + b2 * z) + c;
+			return static_cast<float>(std::max(error, 0.0) / weight);
+		}
+	};
+
+	struct Collapse {
+		uint32_t from;
+		uint32_t to;
+		float error;
+	};
+
+	// rebuilds the vertex to triangle lists of the current index list
+	static void buildTriangleAdjacency(const uint32_t* indices, size_t indexCount, size_t vertexCount,
+		std::vector<uint32_t>& offsets, std::vector<uint32_t>& triangles) {
+		offsets.assign(vertexCount + 1, 0);
+		for (size_t i = 0; i < indexCount; i++)
+			offsets[indices[i] + 1]++;
+		for (size_t v = 0; v < vertexCount; v++)
+			offsets[v + 1] += offsets[v];
+
+		triangles.resize(indexCount);
+		std::vector<uint32_t> cursor(offsets.begin(), offsets.end() - 1);
+		for (size_t i = 0; i < indexCount; i++)
+			triangles[cursor[indices[i]]++] = static_cast<uint32_t>(i / 3);
+	}
+
+	// a collapse must not turn any remaining triangle of from over
+	static bool flipsTriangle(const uint32_t* indices, const Vertex* vertices, const uint32_t* triangles, uint32_t triangleCount,
+		uint32_t from, uint32_t to) {
+		for (uint32_t i = 0; i < triangleCount; i++) {
+			const uint32_t* triangle = &indices[triangles[i] * 3];
+			if (triangle[0] == to || triangle[1] == to || triangle[2] == to)
+				continue;
+
+			glm::vec3 before[3], after[3];
+			for (uint32_t k = 0; k < 3; k++) {
+				before[k] = vertices[triangle[k]].pos;
+				after[k] = triangle[k] == from ? vertices[to].pos : before[k];
+			}
+			glm::vec3 normalBefore = glm::cross(before[1] - before[0], before[2] - before[0]);
+			glm::vec3 normalAfter = glm::cross(after[1] - after[0], after[2] - after[0]);
+			// also refuses slivers that would turn by more than ~75 degrees
+			if (glm::dot(normalBefore, normalAfter) <= 0.25f * glm::length(normalBefore) * glm::length(normalAfter))
+				return true;
+		}
+		return false;
+	}
+
+	size_t simplify(uint32_t* destination, const uint32_t* indices, size_t indexCount, const Vertex* vertices, size_t vertexCount,
+		size_t targetIndexCount, float maxError, float* resultError) {
+		std::copy(indices, indices + indexCount, destination);
+		float maxErrorSquared = maxError * maxError;
+		float errorSquared = 0.f;
+
+		std::vector<uint32_t> offsets, triangles;
+		buildTriangleAdjacency(destination, indexCount, vertexCount, offsets, triangles);
+
+		// an edge used by one triangle is open, the welder splits vertices along uv and normal seams so they end up here too.
+		// edges used by more than two triangles are non manifold, both cases stay where they are
+		std::vector<bool> locked(vertexCount, false);
+		for (size_t i = 0; i < indexCount; i += 3) {
+			for (uint32_t k = 0; k < 3; k++) {
+				uint32_t a = destination[i + k];
+				uint32_t b = destination[i + (k + 1) % 3];
+				uint32_t sharing = 0;
+				for (uint32_t j = offsets[a]; j < offsets[a + 1]; j++) {
+					const uint32_t* triangle = &destination[triangles[j] * 3];
+					if (triangle[0] == b || triangle[1] == b || triangle[2] == b)
+						sharing++;
+				}
+				if (sharing != 2) {
+					locked[a] = true;
+					locked[b] = true;
+				}
+			}
+		}
+
+		std::vector<Quadric> quadrics(vertexCount);
+		for (size_t i = 0; i < indexCount; i += 3) {
+			const glm::vec3& p0 = vertices[destination[i + 0]].pos;
+			const glm::vec3& p1 = vertices[destination[i + 1]].pos;
+			const glm::vec3& p2 = vertices[destination[i + 2]].pos;
+			glm::vec3 normal = glm::cross(p1 - p0, p2 - p0);
+			float area = glm::length(normal);
+			if (area <= 0.f)
+				continue;
+			normal /= area;
+
+			Quadric quadric;
+			quadric.addPlane(normal, -glm::dot(normal, p0), area);
+			for (uint32_t k = 0; k < 3; k++)
+				quadrics[destination[i + k]].add(quadric);
+		}
+
+		std::vector<uint32_t> remap(vertexCount);
+		std::vector<bool> touched(vertexCount);
+		std::vector<Collapse> collapses;
+
+		while (indexCount > targetIndexCount) {
+			collapses.clear();
+			for (size_t i = 0; i < indexCount; i += 3) {
+				for (uint32_t k = 0; k < 3; k++) {
+					uint32_t a = destination[i + k];
+					uint32_t b = destination[i + (k + 1) % 3];
+					if (!locked[a])
+						collapses.push_back({ a, b, quadrics[a].evaluate(vertices[b].pos) });
+					if (!locked[b])
+						collapses.push_back({ b, a, quadrics[b].evaluate(vertices[a].pos) });
+				}
+			}
+			if (collapses.empty())
+				break;
+
+			std::sort(collapses.begin(), collapses.end(), [](const Collapse& a, const Collapse& b) { return a.error < b.error; });
+
+			// only the cheapest quarter per pass, the costs around a collapse are stale until the next one
+			float passLimit = std::min(collapses[collapses.size() / 4].error, maxErrorSquared);
+			size_t trianglesToRemove = (indexCount - targetIndexCount) / 3;
+			size_t removed = 0;
+
+			for (uint32_t v = 0; v < vertexCount; v++)
+				remap[v] = v;
+			std::fill(touched.begin(), touched.end(), false);
+
+			for (const Collapse& collapse : collapses) {
+				if (collapse.error > passLimit || removed >= trianglesToRemove)
+					break;
+				if (touched[collapse.from] || touched[collapse.to])
+					continue;
+
+				const uint32_t* fromTriangles = &triangles[offsets[collapse.from]];
+				uint32_t fromTriangleCount = offsets[collapse.from + 1] - offsets[collapse.from];
+				if (flipsTriangle(destination, vertices, fromTriangles, fromTriangleCount, collapse.from, collapse.to))
+					continue;
+
+				// the whole neighbourhood is frozen for this pass so the checks above stay valid
+				for (uint32_t i = 0; i < fromTriangleCount; i++) {
+					const uint32_t* triangle = &destination[fromTriangles[i] * 3];
+					for (uint32_t k = 0; k < 3; k++)
+						touched[triangle[k]] = true;
+					if (triangle[0] == collapse.to || triangle[1] == collapse.to || triangle[2] == collapse.to)
+						removed++;
+				}
+
+				remap[collapse.from] = collapse.to;
+				quadrics[collapse.to].add(quadrics[collapse.from]);
+				errorSquared = std::max(errorSquared, collapse.error);
+			}
+
+			if (removed == 0)
+				break;
+
+			size_t writeIndex = 0;
+			for (size_t i = 0; i < indexCount; i += 3) {
+				uint32_t a = remap[destination[i + 0]];
+				uint32_t b = remap[destination[i + 1]];
+				uint32_t c = remap[destination[i + 2]];
+				if (a == b || b == c || c == a)
+					continue;
+				destination[writeIndex++] = a;
+				destination[writeIndex++] = b;
+				destination[writeIndex++] = c;
+			}
+			indexCount = writeIndex;
+			buildTriangleAdjacency(destination, indexCount, vertexCount, offsets, triangles);
+		}
+
+		if (resultError)
+			*resultError = std::sqrt(errorSquared);
+		return indexCount;
+	}
+
+	void buildLods(std::vector<uint32_t>& indices, const Vertex* vertices, size_t vertexCount, std::vector<MeshLod>& lods) {
+		lods.clear();
+		lods.push_back({ 0, static_cast<uint32_t>(indices.size()), 0, 0, 0.f });
+		if (indices.size() < LOD_MIN_TRIANGLES * 3 || vertexCount == 0)
+			return;
+
+		glm::vec3 min = vertices[0].pos;
+		glm::vec3 max = vertices[0].pos;
+		for (size_t i = 1; i < vertexCount; i++) {
+			min = glm::min(min, vertices[i].pos);
+			max = glm::max(max, vertices[i].pos);
+		}
+		float maxError = LOD_MAX_ERROR * glm::length(max - min);
+
+		std::vector<uint32_t> lodIndices;
+		while (lods.size() < MAX_MESH_LODS) {
+			const MeshLod& previous = lods.back();
+			if (previous.indexCount < LOD_MIN_TRIANGLES * 3)
+				break;
+
+			// each level starts from the previous one, its error adds up
+			size_t target = previous.indexCount / 6 * 3;
+			lodIndices.resize(previous.indexCount);
+			float error = 0.f;
+			size_t lodIndexCount = simplify(lodIndices.data(), indices.data() + previous.firstIndex, previous.indexCount,
+				vertices, vertexCount, target, maxError - previous.error, &error);
+
+			// not worth the memory when the mesh is already close to its locked borders or the error budget
+			if (lodIndexCount == 0 || lodIndexCount > previous.indexCount * 3 / 4)
+				break;
+
+			optimizeVertexCache(lodIndices.data(), lodIndexCount, vertexCount);
+
+			MeshLod lod{};
+			lod.firstIndex = static_cast<uint32_t>(indices.size());
+			lod.indexCount = static_cast<uint32_t>(lodIndexCount);
+			lod.error = previous.error + error;
+			indices.insert(indices.end(), lodIndices.begin(), lodIndices.begin() + lodIndexCount);
+			lods.push_back(lod);
+		}
+	}
+}
@@ -0,0 +1,44 @@
+#pragma once
+#include "src/vulkan/vkHeader.hpp"
+#include "src/model.hpp"
+
+namespace MeshOptimizer {
+
+	struct VertexCacheStats {
+		float acmr = 0.f;	// transformed vertices per triangle, 0.5 is the best a regular grid can do
+		float atvr = 0.f;	// transformed vertices per referenced vertex, 1 is optimal
+	};
+
+	// fifo post-transform cache simulation
+	VertexCacheStats analyzeVertexCache(const uint32_t* indices, size_t indexCount, size_t vertexCount, uint32_t cacheSize = 16);
+
+	// reorders triangles for post-transform cache reuse (Forsyth, linear speed vertex cache optimisation)
+	void optimizeVertexCache(uint32_t* indices, size_t indexCount, size_t vertexCount);
+
+	// splits the cache optimized order where the cache restarts anyway and draws the outward facing clusters first.
+	// clusters are cut where a triangle misses the cache entirely, so the acmr barely changes
+	void optimizeOverdraw(uint32_t* indices, size_t indexCount, const Vertex* vertices, size_t vertexCount);
+
+	// moves vertices into first use order and drops unreferenced ones, returns the new vertex count
+	uint32_t optimizeVertexFetch(Vertex* vertices, uint32_t* indices, size_t indexCount, size_t vertexCount);
+
+	static constexpr uint32_t MESHLET_MAX_VERTICES = 64;
+	static constexpr uint32_t MESHLET_MAX_TRIANGLES = 124;
+
+	// cuts the index list into meshlets in its current order, so the cache and overdraw ordering is kept,
+	// and appends them with their bounding spheres and normal cones. firstIndex is relative to indices
+	void buildMeshlets(const uint32_t* indices, size_t indexCount, const Vertex* vertices, size_t vertexCount, std::vector<Meshlet>& meshlets);
+
+	// quadric error edge collapse (Garland / Heckbert). vertices are merged into a neighbour and never moved, the ones on
+	// open or non manifold edges stay, which also keeps the uv / normal seams the welder split. stops at targetIndexCount
+	// or when the next collapse would move the surface by more than maxError, returns the new index count
+	size_t simplify(uint32_t* destination, const uint32_t* indices, size_t indexCount, const Vertex* vertices, size_t vertexCount,
+		size_t targetIndexCount, float maxError, float* resultError = nullptr);
+
+	static constexpr uint32_t LOD_MIN_TRIANGLES = 64;	// shapes below this are not simplified further
+	static constexpr float LOD_MAX_ERROR = 0.05f;		// of the shape's bounding box diagonal, for the coarsest level
+
+	// appends up to MAX_MESH_LODS - 1 cache optimized levels of about half the triangles of the previous one to indices,
+	// lods receives every level including the source one. meshlet ranges are left to the caller
+	void buildLods(std::vector<uint32_t>& indices, const Vertex* vertices, size_t vertexCount, std::vector<MeshLod>& lods);
+}
@@ -3,26 +3,92 @@
 #include "src/vulkan/descriptorSet.hpp"
 #include "src/vulkan/shader.hpp"
 #include "src/vulkan/device.hpp"
+#include "src/vulkan/geometryBuffer.hpp"
 #include "src/model.hpp"
+#include "src/meshCache.hpp"
+#include "src/threadPool.hpp"
+#include "src/vertexWelder.hpp"
+#include "src/meshOptimizer.hpp"
+#include "src/vertexPacking.hpp"
 #include "src/material.hpp"
 
 #define TINYOBJLOADER_IMPLEMENTATION
 #include <tiny_obj_loader.h>
+#include <stb_image.h>
 
-namespace std {
-	template<> struct hash<Vertex> {
-		size_t operator()(Vertex const& vertex) const {
-			return ((hash<glm::vec3>()(vertex.pos) ^
-				(hash<glm::vec3>()(vertex.normal) << 1)) >> 1) ^
-				(hash<glm::vec2>()(vertex.texCoord) << 1);
+uint32_t getVertexStride(VertexFormat format) {
+	return format == VertexFormat::PACKED ? sizeof(PackedVertex) : sizeof(Vertex);
+}
+
+uint32_t getPositionStride(VertexFormat format) {
+	static_assert(offsetof(Vertex, pos) == 0 && offsetof(PackedVertex, position) == 0, "the position stream copies the start of each vertex");
+	return format == VertexFormat::PACKED ? sizeof(PackedVertex::position) : sizeof(glm::vec3);
+}
+
+VertexFormat getVertexFormat(const GeometryBuffer& geometry) {
+	if (geometry.getVertexStride() == sizeof(PackedVertex))
+		return VertexFormat::PACKED;
+
+	DEBUG_ASSERT(geometry.getVertexStride() == sizeof(Vertex), "geometry buffer stride doesn't match any vertex layout");
+	return VertexFormat::FLOAT32;
+}
+
+std::string getVertexShaderPath(const char* name, VertexFormat format, VertexTransform transform) {
+	const char* variant = transform == VertexTransform::INDIRECT ? "Indirect" : transform == VertexTransform::INSTANCED ? "Instanced" : "";
+	return std::string("spv/") + name + (format == VertexFormat::PACKED ? "Packed" : "") + variant + "Vert.spv";
+}
+
+Mesh::Mesh(GeometryBuffer& geometry, const Vertex* vertices, uint32_t vertexCount, const uint32_t* indices, uint32_t indexCount,
+	const Meshlet* meshlets, uint32_t meshletCount, const MeshLod* lods, uint32_t lodCount,
+	std::shared_ptr<Material> material, VertexPacking::QualityStats* packingStats)
+	: m_material(material), m_meshlets(meshlets, meshlets + meshletCount), m_lods(lods, lods + lodCount) {
+	if (m_lods.empty())
+		m_lods.push_back({ 0, indexCount, 0, meshletCount, 0.f });
+
+	if (vertexCount > 0) {
+		glm::vec3 min = vertices[0].pos;
+		glm::vec3 max = vertices[0].pos;
+		for (uint32_t i = 1; i < vertexCount; i++) {
+			min = glm::min(min, vertices[i].pos);
+			max = glm::max(max, vertices[i].pos);
 		}
-	};
+		m_boundsMin = min;
+		m_boundsMax = max;
+		m_center = (min + max) * 0.5f;
+		for (uint32_t i = 0; i < vertexCount; i++)
+			m_radius = std::max(m_radius, glm::length(vertices[i].pos - m_center));
+	}
+
+	const MeshLod& coarsest = m_lods.back();
+	std::vector<uint32_t> remap(vertexCount, UINT32_MAX);
+	m_occluderIndices.reserve(coarsest.indexCount);
+	for (uint32_t i = 0; i < coarsest.indexCount; i++) {
+		uint32_t vertex = indices[coarsest.firstIndex + i];
+		if (remap[vertex] == UINT32_MAX) {
+			remap[vertex] = static_cast<uint32_t>(m_occluderPositions.size());
+			m_occluderPositions.push_back(vertices[vertex].pos);
+		}
+		m_occluderIndices.push_back(remap[vertex]);
+	}
+
+	if (getVertexFormat(geometry) == VertexFormat::FLOAT32) {
+		m_geometry = geometry.allocate(vertices, vertexCount, indices, indexCount);
+		return;
+	}
+
+	VertexPacking::Bounds bounds = VertexPacking::computeBounds(vertices, vertexCount);
+	std::vector<PackedVertex> packed(vertexCount);
+	VertexPacking::pack(vertices, vertexCount, bounds, packed.data());
+	if (packingStats)
+		VertexPacking::measure(vertices, packed.data(), vertexCount, bounds, *packingStats);
+
+	m_positionOffset = bounds.offset;
+	m_positionScale = bounds.scale;
+	m_geometry = geometry.allocate(packed.data(), vertexCount, indices, indexCount);
 }
 
-Mesh::Mesh(std::vector<Vertex>& vertices, std::vector<uint32_t>& indices, std::shared_ptr<Material> material)
-	: m_material(material), m_count(indices.size()) {
-	m_vertexBuffer = std::make_shared<VertexBuffer>(sizeof(vertices[0]) * vertices.size(), vertices.data());
-	m_indexBuffer = std::make_shared<IndexBuffer>(sizeof(indices[0]) * indices.size(), indices.data());
+MeshConstants Mesh::getConstants(const glm::mat4& model) const {
+	return { model, glm::vec4(m_positionOffset, 0.0f), glm::vec4(m_positionScale, 0.0f) };
 }
 
 void computeTangentBitangent(
@@ -35,100 +101,337 @@ void computeTangentBitangent(
 	glm::vec2 deltaUV1 = uv2 - uv1;
 	glm::vec2 deltaUV2 = uv3 - uv1;
 
-	float f = 1.0f / (deltaUV1.x * deltaUV2.y - deltaUV2.x * deltaUV1.y);
+	float det = deltaUV1.x * deltaUV2.y - deltaUV2.x * deltaUV1.y;
+	// degenerate uvs, contributes nothing to the welded vertices
+	if (std::abs(det) < 1e-12f) {
+		tangent = glm::vec3(0.0f);
+		bitangent = glm::vec3(0.0f);
+		return;
+	}
+	float f = 1.0f / det;
 
 	tangent = f * (deltaUV2.y * edge1 - deltaUV1.y * edge2);
 	bitangent = f * (-deltaUV2.x * edge1 + deltaUV1.x * edge2);
 }
 
-Model::Model(std::filesystem::path filePath) {
+static uint32_t getCacheOptions(const ModelDesc& desc) {
+	return (desc.optimize ? 1u : 0u) | (desc.generateLods ? 2u : 0u);
+}
 
-	tinyobj::ObjReaderConfig reader_config;
+Model::Model(std::filesystem::path filePath, GeometryBuffer& geometry, const ModelDesc& desc) {
+	auto start = std::chrono::high_resolution_clock::now();
 
-	tinyobj::ObjReader reader;
+	std::filesystem::path sourcePath = ASSETS_PATH / filePath;
+	std::filesystem::path directory = filePath.parent_path();
 
-	if (!reader.ParseFromFile(ASSETS_PATH+filePath.string(), reader_config)) {
-		if (!reader.Error().empty()) {
-			std::cerr << "TinyObjReader: " << reader.Error();
-		}
-		exit(1);
+	VertexPacking::QualityStats packingStats;
+	VertexPacking::QualityStats* reportPacking = desc.reportPacking ? &packingStats : nullptr;
+
+	MeshCache cache;
+	if (cache.open(sourcePath, getCacheOptions(desc))) {
+		// uploads read straight from the mapped file
+		createMeshes(geometry, directory, cache.getVertices(), cache.getIndices(), cache.getShapes(), cache.getShapeCount(), cache.getMeshlets(), cache.getLods(), cache.getMaterials(), reportPacking);
+		cache.close();
+		packingStats.print(filePath.string().c_str());
+
+		float time = std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+		printf("loaded %s from cache in %.1f ms\n", filePath.string().c_str(), time);
+		return;
 	}
 
-	if (!reader.Warning().empty()) {
-		std::cout << "TinyObjReader: " << reader.Warning();
+	MeshData data = loadObj(sourcePath, desc);
+	float parseTime = std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+
+	if (!MeshCache::write(sourcePath, data, getCacheOptions(desc)))
+		DEBUG_WARNING("failed to write mesh cache %s", MeshCache::getCachePath(sourcePath).string().c_str());
+
+	createMeshes(geometry, directory, data.vertices.data(), data.indices.data(), data.shapes.data(), static_cast<uint32_t>(data.shapes.size()), data.meshlets.data(), data.lods.data(), data.materials, reportPacking);
+	packingStats.print(filePath.string().c_str());
+
+	float time = std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+	printf("loaded %s in %.1f ms (%.1f ms parsing)\n", filePath.string().c_str(), time, parseTime);
+}
+
+static Vertex getVertex(const tinyobj::attrib_t& attrib, const tinyobj::index_t& index) {
+	Vertex vertex{};
+
+	vertex.pos = {
+		attrib.vertices[3 * index.vertex_index + 0],
+		attrib.vertices[3 * index.vertex_index + 1],
+		attrib.vertices[3 * index.vertex_index + 2]
+	};
+
+	vertex.normal = {
+		attrib.normals[3 * index.normal_index + 0],
+		attrib.normals[3 * index.normal_index + 1],
+		attrib.normals[3 * index.normal_index + 2]
+	};
+
+	vertex.texCoord = {
+		attrib.texcoords[2 * index.texcoord_index + 0],
+		1.0f - attrib.texcoords[2 * index.texcoord_index + 1]
+	};
+
+	return vertex;
+}
+
+// builds one shape's deduplicated vertices and shape local indices
+static void processShape(const tinyobj::attrib_t& attrib, const tinyobj::shape_t& shape, std::vector<Vertex>& vertices, std::vector<uint32_t>& indices) {
+	size_t triangleCount = shape.mesh.indices.size() / 3;
+	indices.reserve(shape.mesh.indices.size());
+
+	// closed meshes have about half as many vertices as triangles, seams add some back
+	VertexWelder welder(vertices, triangleCount);
+
+	for (size_t i = 0; i < shape.mesh.indices.size(); i += 3) {
+		std::array<Vertex, 3> triangleVertices;
+		for (size_t j = 0; j < 3; ++j)
+			triangleVertices[j] = getVertex(attrib, shape.mesh.indices[i + j]);
+
+		glm::vec3 tangent, bitangent;
+		computeTangentBitangent(
+			triangleVertices[0].pos, triangleVertices[1].pos, triangleVertices[2].pos,
+			triangleVertices[0].texCoord, triangleVertices[1].texCoord, triangleVertices[2].texCoord,
+			tangent, bitangent
+		);
+
+		for (size_t j = 0; j < 3; ++j) {
+			auto& vertex = triangleVertices[j];
+			vertex.tangent = tangent;
+			vertex.bitangent = bitangent;
+			indices.emplace_back(welder.weld(vertex));
+		}
 	}
+}
 
-	auto& attrib = reader.GetAttrib();
-	auto& shapes = reader.GetShapes();
-	auto& materials = reader.GetMaterials();
+// tinyobj's material file reader, keeping the name of every mtllib the obj asks for, found or not
+class MaterialLibraryReader : public tinyobj::MaterialReader {
+public:
+	MaterialLibraryReader(const std::string& directory, std::vector<std::string>& libraries)
+		: m_reader(directory), m_libraries(libraries) {}
 
-	std::unordered_map<Vertex, uint32_t> uniqueVertices{};
-	std::unordered_map<std::string, std::shared_ptr<Texture2D>> textureCache;
-	m_meshes.reserve(shapes.size());
+	bool operator()(const std::string& matId, std::vector<tinyobj::material_t>* materials, std::map<std::string, int>* matMap,
+		std::string* warn, std::string* err) override {
+		m_libraries.push_back(matId);
+		return m_reader(matId, materials, matMap, warn, err);
+	}
 
-	auto shader = std::make_shared<Shader>("spv/basicVert.spv", "spv/pbrFrag.spv");
+private:
+	tinyobj::MaterialFileReader m_reader;
+	std::vector<std::string>& m_libraries;
+};
+
+MeshData Model::loadObj(const std::filesystem::path& path, const ModelDesc& desc) {
+	auto start = std::chrono::high_resolution_clock::now();
+
+	MeshData data;
+	tinyobj::attrib_t attrib;
+	std::vector<tinyobj::shape_t> shapes;
+	std::vector<tinyobj::material_t> materials;
+	std::string warning, error;
+
+	std::ifstream file(path);
+	MaterialLibraryReader materialReader((path.parent_path() / "").string(), data.materialLibraries);
+	if (!file || !tinyobj::LoadObj(&attrib, &shapes, &materials, &warning, &error, &file, &materialReader)) {
+		if (!error.empty()) {
+			std::cerr << "TinyObjReader: " << error;
+		}
+		exit(1);
+	}
 
-	uint8_t pixels[4] = { 255, 255, 255, 255 };
-	std::shared_ptr<Texture2D> defaultTexture = std::make_shared<Texture2D>(pixels,1,1);
+	if (!warning.empty()) {
+		std::cout << "TinyObjReader: " << warning;
+	}
 
-	for (const auto& shape : shapes) {
+	auto parsed = std::chrono::high_resolution_clock::now();
 
+	data.materials.reserve(materials.size());
+	for (const auto& mp : materials) {
+		data.materials.push_back({ mp.diffuse_texname, mp.specular_texname, mp.normal_texname, mp.bump_texname });
+	}
+
+	// shapes are independent, each task fills its own arrays
+	struct ShapeResult {
 		std::vector<Vertex> vertices;
 		std::vector<uint32_t> indices;
-		indices.reserve(shape.mesh.indices.size());
+		std::vector<Meshlet> meshlets;
+		std::vector<MeshLod> lods;
+		MeshOptimizer::VertexCacheStats before;
+		MeshOptimizer::VertexCacheStats after;
+	};
+	std::vector<ShapeResult> results(shapes.size());
+
+	// biggest shapes first so a large one doesn't start last and leave the other threads idle
+	std::vector<uint32_t> order(shapes.size());
+	for (uint32_t i = 0; i < order.size(); i++)
+		order[i] = i;
+	std::stable_sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) {
+		return shapes[a].mesh.indices.size() > shapes[b].mesh.indices.size();
+	});
+
+	ThreadPool& threadPool = ThreadPool::get();
+	threadPool.parallelFor(static_cast<uint32_t>(shapes.size()), [&](uint32_t i) {
+		ShapeResult& result = results[order[i]];
+		processShape(attrib, shapes[order[i]], result.vertices, result.indices);
+
+		if (desc.optimize) {
+			result.before = MeshOptimizer::analyzeVertexCache(result.indices.data(), result.indices.size(), result.vertices.size());
+
+			MeshOptimizer::optimizeVertexCache(result.indices.data(), result.indices.size(), result.vertices.size());
+			MeshOptimizer::optimizeOverdraw(result.indices.data(), result.indices.size(), result.vertices.data(), result.vertices.size());
+			uint32_t vertexCount = MeshOptimizer::optimizeVertexFetch(result.vertices.data(), result.indices.data(), result.indices.size(), result.vertices.size());
+			result.vertices.resize(vertexCount);
+
+			result.after = MeshOptimizer::analyzeVertexCache(result.indices.data(), result.indices.size(), result.vertices.size());
+		}
+
+		if (desc.generateLods)
+			MeshOptimizer::buildLods(result.indices, result.vertices.data(), result.vertices.size(), result.lods);
+		else
+			result.lods = { { 0, static_cast<uint32_t>(result.indices.size()), 0, 0, 0.f } };
+
+		for (MeshLod& lod : result.lods) {
+			lod.meshletOffset = static_cast<uint32_t>(result.meshlets.size());
+			MeshOptimizer::buildMeshlets(result.indices.data() + lod.firstIndex, lod.indexCount, result.vertices.data(), result.vertices.size(), result.meshlets);
+			lod.meshletCount = static_cast<uint32_t>(result.meshlets.size()) - lod.meshletOffset;
+			for (uint32_t j = lod.meshletOffset; j < result.meshlets.size(); j++)
+				result.meshlets[j].firstIndex += lod.firstIndex;
+		}
+	});
+
+	if (desc.optimize) {
+		// weighted by triangle / vertex count
+		double acmrBefore = 0.0, acmrAfter = 0.0, atvrBefore = 0.0, atvrAfter = 0.0;
+		size_t triangles = 0, vertices = 0;
+		for (size_t i = 0; i < shapes.size(); i++) {
+			const ShapeResult& result = results[i];
+			size_t shapeTriangles = result.lods[0].indexCount / 3;
+			if (desc.reportOptimization) {
+				std::string lodTriangles;
+				for (size_t j = 1; j < result.lods.size(); j++)
+					lodTriangles += " " + std::to_string(result.lods[j].indexCount / 3);
+				printf("  %-32s %6zu tris  acmr %.3f -> %.3f  atvr %.3f -> %.3f  lods%s\n", shapes[i].name.c_str(), shapeTriangles,
+					result.before.acmr, result.after.acmr, result.before.atvr, result.after.atvr, lodTriangles.c_str());
+			}
+			acmrBefore += result.before.acmr * shapeTriangles;
+			acmrAfter += result.after.acmr * shapeTriangles;
+			atvrBefore += result.before.atvr * result.vertices.size();
+			atvrAfter += result.after.atvr * result.vertices.size();
+			triangles += shapeTriangles;
+			vertices += result.vertices.size();
+		}
+		if (triangles > 0 && vertices > 0) {
+			printf("%s: acmr %.3f -> %.3f, atvr %.3f -> %.3f\n", path.filename().string().c_str(),
+				acmrBefore / triangles, acmrAfter / triangles, atvrBefore / vertices, atvrAfter / vertices);
+		}
+	}
 
-		for (size_t i = 0; i < shape.mesh.indices.size(); i += 3) {
-			std::array<Vertex, 3> triangleVertices;
+	auto processed = std::chrono::high_resolution_clock::now();
 
-			for (size_t j = 0; j < 3; ++j) {
-				const auto& index = shape.mesh.indices[i + j];
-				Vertex vertex{};
+	// merged in file order, same layout as a serial build
+	size_t vertexCount = 0, indexCount = 0, meshletCount = 0, lodCount = 0;
+	for (const ShapeResult& result : results) {
+		vertexCount += result.vertices.size();
+		indexCount += result.indices.size();
+		meshletCount += result.meshlets.size();
+		lodCount += result.lods.size();
+	}
+	data.vertices.reserve(vertexCount);
+	data.indices.reserve(indexCount);
+	data.meshlets.reserve(meshletCount);
+	data.lods.reserve(lodCount);
+	data.shapes.reserve(shapes.size());
+
+	for (size_t i = 0; i < shapes.size(); i++) {
+		MeshShape meshShape{};
+		meshShape.vertexOffset = static_cast<uint32_t>(data.vertices.size());
+		meshShape.vertexCount = static_cast<uint32_t>(results[i].vertices.size());
+		meshShape.indexOffset = static_cast<uint32_t>(data.indices.size());
+		meshShape.indexCount = static_cast<uint32_t>(results[i].indices.size());
+		meshShape.meshletOffset = static_cast<uint32_t>(data.meshlets.size());
+		meshShape.meshletCount = static_cast<uint32_t>(results[i].meshlets.size());
+		meshShape.lodOffset = static_cast<uint32_t>(data.lods.size());
+		meshShape.lodCount = static_cast<uint32_t>(results[i].lods.size());
+		meshShape.materialId = shapes[i].mesh.material_ids.empty() ? -1 : shapes[i].mesh.material_ids[0];
+		data.shapes.push_back(meshShape);
+
+		data.vertices.insert(data.vertices.end(), results[i].vertices.begin(), results[i].vertices.end());
+		data.indices.insert(data.indices.end(), results[i].indices.begin(), results[i].indices.end());
+		data.meshlets.insert(data.meshlets.end(), results[i].meshlets.begin(), results[i].meshlets.end());
+		data.lods.insert(data.lods.end(), results[i].lods.begin(), results[i].lods.end());
+		results[i] = ShapeResult{};
+	}
 
-				vertex.pos = {
-					attrib.vertices[3 * index.vertex_index + 0],
-					attrib.vertices[3 * index.vertex_index + 1],
-					attrib.vertices[3 * index.vertex_index + 2]
-				};
+	auto merged = std::chrono::high_resolution_clock::now();
+	printf("%s: parsed in %.1f ms, %zu shapes processed in %.1f ms on %u threads, merged in %.1f ms (%zu vertices, %zu indices, %zu meshlets, %zu lods)\n",
+		path.filename().string().c_str(),
+		std::chrono::duration<float, std::milli>(parsed - start).count(),
+		shapes.size(), std::chrono::duration<float, std::milli>(processed - parsed).count(), threadPool.getThreadCount(),
+		std::chrono::duration<float, std::milli>(merged - processed).count(),
+		data.vertices.size(), data.indices.size(), data.meshlets.size(), data.lods.size());
 
-				vertex.normal = {
-					attrib.normals[3 * index.normal_index + 0],
-					attrib.normals[3 * index.normal_index + 1],
-					attrib.normals[3 * index.normal_index + 2]
-				};
+	return data;
+}
 
-				vertex.texCoord = {
-					attrib.texcoords[2 * index.texcoord_index + 0],
-					1.0f - attrib.texcoords[2 * index.texcoord_index + 1]
-				};
+void Model::createMeshes(GeometryBuffer& geometry, const std::filesystem::path& directory,
+	const Vertex* vertices, const uint32_t* indices, const MeshShape* shapes, uint32_t shapeCount, const Meshlet* meshlets, const MeshLod* lods,
+	const std::vector<MaterialDesc>& materials, VertexPacking::QualityStats* packingStats) {
 
-				triangleVertices[j] = vertex;
-			}
+	std::unordered_map<std::string, std::shared_ptr<Texture2D>> textureCache;
+	m_meshes.reserve(shapeCount);
 
-			glm::vec3 tangent, bitangent;
-			computeTangentBitangent(
-				triangleVertices[0].pos, triangleVertices[1].pos, triangleVertices[2].pos,
-				triangleVertices[0].texCoord, triangleVertices[1].texCoord, triangleVertices[2].texCoord,
-				tangent, bitangent
-			);
+	auto shader = std::make_shared<Shader>(getVertexShaderPath("basic", getVertexFormat(geometry)).c_str(), "spv/pbrFrag.spv");
 
-			for (size_t j = 0; j < 3; ++j) {
-				auto& vertex = triangleVertices[j];
-				vertex.tangent += tangent;
-				vertex.bitangent += bitangent;
+	uint8_t pixels[4] = { 255, 255, 255, 255 };
+	std::shared_ptr<Texture2D> defaultTexture = std::make_shared<Texture2D>(pixels,1,1);
 
-				if (uniqueVertices.count(vertex) == 0) {
-					uniqueVertices[vertex] = static_cast<uint32_t>(vertices.size());
-					vertices.push_back(vertex);
-				}
+	std::vector<std::string> textureNames;
+	for (uint32_t i = 0; i < shapeCount; i++) {
+		if (shapes[i].materialId <= 0)
+			continue;
+		const MaterialDesc& desc = materials[shapes[i].materialId];
+		for (const std::string* name : { &desc.diffuse, &desc.specular, &desc.normal, &desc.bump }) {
+			if (!name->empty() && textureCache.emplace(*name, nullptr).second)
+				textureNames.push_back(*name);
+		}
+	}
 
-				indices.emplace_back(uniqueVertices[vertex]);
-			}
+	// the images are decoded on the thread pool a batch at a time, bounding the memory they take, and created on this thread
+	struct DecodedImage {
+		stbi_uc* pixels;
+		int width;
+		int height;
+	};
+	ThreadPool& threadPool = ThreadPool::get();
+	uint32_t batchSize = threadPool.getThreadCount() * 2;
+	std::vector<DecodedImage> images(batchSize);
+	for (uint32_t first = 0; first < textureNames.size(); first += batchSize) {
+		uint32_t count = std::min(batchSize, static_cast<uint32_t>(textureNames.size()) - first);
+		threadPool.parallelFor(count, [&](uint32_t i) {
+			int channels;
+			std::string path = (ASSETS_PATH / directory / textureNames[first + i]).string();
+			images[i].pixels = stbi_load(path.c_str(), &images[i].width, &images[i].height, &channels, STBI_rgb_alpha);
+		});
+
+		for (uint32_t i = 0; i < count; i++) {
+			const std::string& name = textureNames[first + i];
+			DEBUG_ASSERT(images[i].pixels, "failed to load texture image \"%s\"", (ASSETS_PATH / directory / name).string().c_str());
+			textureCache[name] = std::make_shared<Texture2D>(images[i].pixels, static_cast<uint32_t>(images[i].width), static_cast<uint32_t>(images[i].height));
+			stbi_image_free(images[i].pixels);
+			printf("loaded %s\n", name.c_str());
 		}
+	}
+
+	auto loadTexture = [&](const std::string& name) {
+		return textureCache[name];
+	};
 
+	for (uint32_t i = 0; i < shapeCount; i++) {
+		const MeshShape& shape = shapes[i];
 
 		std::shared_ptr<Material> material = nullptr;
 
-		if (shape.mesh.material_ids[0] > 0) {
+		if (shape.materialId > 0) {
 			material = std::make_shared<Material>();
 			material->m_shader = shader;
 			material->m_descriptorSet = std::make_shared<DescriptorSet>(shader, 1);
@@ -137,81 +440,25 @@ Model::Model(std::filesystem::path filePath) {
 			material->m_normal = defaultTexture;
 			material->m_specular = defaultTexture;
 
+			const MaterialDesc& desc = materials[shape.materialId];
 
-			const tinyobj::material_t* mp = &materials[shape.mesh.material_ids[0]];
-
-			if (!mp->diffuse_texname.empty()) {
-				// todo : texture loader helper function
+			if (!desc.diffuse.empty()) {
 				material->m_properties.brightness = 1;
-				auto texPath = ASSETS_PATH / filePath.parent_path() / mp->diffuse_texname;
-
-				std::string texPathStr = texPath.string();
-				auto it = textureCache.find(texPathStr);
-				if (it != textureCache.end()) {
-					material->m_albedo = it->second;
-				}
-				else {
-					auto tex = std::make_shared<Texture2D>(texPath);
-					material->m_albedo = tex;
-					textureCache[texPathStr] = tex;
-
-					
-					printf("loaded %s\n", mp->diffuse_texname.c_str());
-				}
+				material->m_albedo = loadTexture(desc.diffuse);
 			}
 
-			if (!mp->specular_texname.empty()) {
+			if (!desc.specular.empty()) {
 				material->m_properties.reflectance = 1.f;
-				auto texPath = ASSETS_PATH / filePath.parent_path() / mp->specular_texname;
-
-				std::string texPathStr = texPath.string();
-				auto it = textureCache.find(texPathStr);
-				if (it != textureCache.end()) {
-					material->m_specular = it->second;
-				}
-				else {
-					auto tex = std::make_shared<Texture2D>(texPath);
-					material->m_specular = tex;
-					textureCache[texPathStr] = tex;
-
-					printf("loaded %s\n", mp->diffuse_texname.c_str());
-				}
-
+				material->m_specular = loadTexture(desc.specular);
 			}
 
-			if (!mp->normal_texname.empty()) {
-				auto texPath = ASSETS_PATH / filePath.parent_path() / mp->normal_texname;
-
-				std::string texPathStr = texPath.string();
-				auto it = textureCache.find(texPathStr);
-				if (it != textureCache.end()) {
-					material->m_normal = it->second;
-				}
-				else {
-					auto tex = std::make_shared<Texture2D>(texPath);
-					material->m_normal = tex;
-					textureCache[texPathStr] = tex;
-
-					printf("loaded %s\n", mp->diffuse_texname.c_str());
-				}
+			if (!desc.normal.empty()) {
+				material->m_normal = loadTexture(desc.normal);
 			}
 
-			if (!mp->bump_texname.empty()) {
+			if (!desc.bump.empty()) {
 				material->m_properties.roughness = 1.f;
-				auto texPath = ASSETS_PATH / filePath.parent_path() / mp->bump_texname;
-
-				std::string texPathStr = texPath.string();
-				auto it = textureCache.find(texPathStr);
-				if (it != textureCache.end()) {
-					material->m_normal = it->second;
-				}
-				else {
-					auto tex = std::make_shared<Texture2D>(texPath);
-					material->m_normal = tex;
-					textureCache[texPathStr] = tex;
-
-					printf("loaded %s\n", mp->diffuse_texname.c_str());
-				}
+				material->m_normal = loadTexture(desc.bump);
 			}
 
 			material->createUniformBuffers();
@@ -220,14 +467,17 @@ Model::Model(std::filesystem::path filePath) {
 			material->m_descriptorSet->setTexture(material->m_normal, 3);
 		}
 
+		std::shared_ptr<Mesh> mesh = std::make_shared<Mesh>(geometry,
+			vertices + shape.vertexOffset, shape.vertexCount,
+			indices + shape.indexOffset, shape.indexCount,
+			meshlets + shape.meshletOffset, shape.meshletCount,
+			lods + shape.lodOffset, shape.lodCount, material, packingStats);
 
-		std::shared_ptr<Mesh> mesh = std::make_shared<Mesh>(vertices, indices, material);
-		
 		m_meshes.emplace_back(mesh);
 	}
 }
 
-void Model::createCube() {
+void Model::createCube(GeometryBuffer& geometry) {
 	std::vector<Vertex> vertices = {
 		// FRONT (+Z)
 		{{-0.5f, -0.5f,  0.5f}, { 0.0f,  0.0f,  1.0f}, {0.0f, 0.0f}},
@@ -293,7 +543,7 @@ void Model::createCube() {
 	material->m_albedo = defaultTexture;
 	material->m_normal = defaultTexture;
 	material->m_specular = defaultTexture;
-	material->m_shader = std::make_shared<Shader>("spv/basicVert.spv", "spv/pbrFrag.spv");
+	material->m_shader = std::make_shared<Shader>(getVertexShaderPath("basic", getVertexFormat(geometry)).c_str(), "spv/pbrFrag.spv");
 	material->m_properties.brightness = 10.f;
 
 	material->m_descriptorSet = std::make_shared<DescriptorSet>(material->m_shader, 1);
@@ -302,7 +552,9 @@ void Model::createCube() {
 	material->m_descriptorSet->setTexture(material->m_specular, 2);
 	material->m_descriptorSet->setTexture(material->m_normal, 3);
 
-	std::shared_ptr<Mesh> mesh = std::make_shared<Mesh>(vertices, indices, material);
+	std::shared_ptr<Mesh> mesh = std::make_shared<Mesh>(geometry,
+		vertices.data(), static_cast<uint32_t>(vertices.size()),
+		indices.data(), static_cast<uint32_t>(indices.size()), nullptr, 0, nullptr, 0, material);
 
 	m_meshes.emplace_back(mesh);
 }
\ No newline at end of file
@@ -2,6 +2,8 @@
 
 #include "src/vulkan/vkHeader.hpp"
 
+namespace VertexPacking { struct QualityStats; }
+
 struct Vertex {
 	glm::vec3 pos;
 	glm::vec3 normal;
@@ -14,21 +16,136 @@ struct Vertex {
 	}
 };
 
+// vertex layout of a geometry buffer, every mesh allocated from it is stored the same way
+enum class VertexFormat {
+	FLOAT32,	// Vertex
+	PACKED		// PackedVertex, quantized when the mesh is created
+};
+
+uint32_t getVertexStride(VertexFormat format);
+// leading position bytes of a vertex, the geometry buffer's position stream
+uint32_t getPositionStride(VertexFormat format);
+VertexFormat getVertexFormat(const GeometryBuffer& geometry);
+// where the mesh vertex shaders read the model matrix from, see vertexInput.glsl
+enum class VertexTransform {
+	PUSH_CONSTANT,	// MeshConstants
+	INDIRECT,		// INDIRECT_DRAW : the MeshInstance of gl_InstanceIndex
+	INSTANCED		// INSTANCED_DRAW : MeshConstants placed by the instance matrix of gl_InstanceIndex
+};
+
+// spv/<name>Vert.spv, or the PACKED_VERTEX variant spv/<name>PackedVert.spv.
+// the INDIRECT_DRAW and INSTANCED_DRAW variants are spv/<name>[Packed]IndirectVert.spv and spv/<name>[Packed]InstancedVert.spv
+std::string getVertexShaderPath(const char* name, VertexFormat format, VertexTransform transform = VertexTransform::PUSH_CONSTANT);
+
+// push constants of the mesh vertex shaders, see vertexInput.glsl
+struct MeshConstants {
+	glm::mat4 model;
+	glm::vec4 positionOffset;	// packed positions only
+	glm::vec4 positionScale;
+};
+
+// a cluster of at most 64 vertices / 124 triangles, its triangles are contiguous in the mesh's indices
+struct Meshlet {
+	uint32_t firstIndex;	// relative to the mesh's first index
+	uint32_t indexCount;
+	glm::vec3 center;		// bounding sphere in mesh space
+	float radius;
+	glm::vec3 coneAxis;		// average facing of the triangles
+	float coneCutoff;		// sine of the normal cone's half angle, 1 when the cluster can't be backface culled
+};
+
+static constexpr uint32_t MAX_MESH_LODS = 5;
+
+// a level of detail of a mesh, every level indexes the same vertices
+struct MeshLod {
+	uint32_t firstIndex;	// relative to the mesh's first index
+	uint32_t indexCount;
+	uint32_t meshletOffset;	// relative to the mesh's first meshlet
+	uint32_t meshletCount;
+	float error;			// distance the surface moved from level 0, in mesh space
+};
+
+// a shape's slice of the model's vertex / index / meshlet / lod arrays, indices are local to the shape.
+// the index slice holds every lod one after the other
+struct MeshShape {
+	uint32_t vertexOffset;
+	uint32_t vertexCount;
+	uint32_t indexOffset;
+	uint32_t indexCount;
+	uint32_t meshletOffset;
+	uint32_t meshletCount;
+	uint32_t lodOffset;
+	uint32_t lodCount;
+	int32_t materialId;
+};
+
+// texture paths relative to the model's directory
+struct MaterialDesc {
+	std::string diffuse;
+	std::string specular;
+	std::string normal;
+	std::string bump;
+};
+
+// processed model data, either built from the source file or read back from the mesh cache
+struct MeshData {
+	std::vector<Vertex> vertices;
+	std::vector<uint32_t> indices;
+	std::vector<MeshShape> shapes;
+	std::vector<Meshlet> meshlets;
+	std::vector<MeshLod> lods;
+	std::vector<MaterialDesc> materials;
+	std::vector<std::string> materialLibraries;	// the mtllib files of the source, relative to its directory
+};
+
+// options applied while building a model from its source file, part of the mesh cache key
+struct ModelDesc {
+	bool optimize = true;			// vertex cache, overdraw and vertex fetch ordering
+	bool generateLods = true;		// simplified copies of every shape, drawn by distance
+	bool reportOptimization = true;	// acmr / atvr of every mesh before and after, printed when the cache is rebuilt
+	bool reportPacking = true;		// decode error against fp32, printed when loading into a packed geometry buffer
+};
+
 class Mesh {
 public:
-	Mesh(std::vector<Vertex>& vertices, std::vector<uint32_t>& indices, std::shared_ptr<Material> material);
-	uint32_t m_count;
-	std::shared_ptr<VertexBuffer> m_vertexBuffer;
-	std::shared_ptr<IndexBuffer> m_indexBuffer;
+	// lods : a single level covering every index when empty
+	// packingStats : accumulates the quantization error when the geometry buffer is packed
+	Mesh(GeometryBuffer& geometry, const Vertex* vertices, uint32_t vertexCount, const uint32_t* indices, uint32_t indexCount,
+		const Meshlet* meshlets, uint32_t meshletCount, const MeshLod* lods, uint32_t lodCount,
+		std::shared_ptr<Material> material, VertexPacking::QualityStats* packingStats = nullptr);
+
+	MeshConstants getConstants(const glm::mat4& model) const;
+
+	std::shared_ptr<GeometryRange> m_geometry;
 	std::shared_ptr<Material> m_material;
+	std::vector<Meshlet> m_meshlets;	// empty : drawn whole
+	std::vector<MeshLod> m_lods;		// at least one
+	// bounding box and sphere in mesh space
+	glm::vec3 m_boundsMin = glm::vec3(0.0f);
+	glm::vec3 m_boundsMax = glm::vec3(0.0f);
+	glm::vec3 m_center = glm::vec3(0.0f);
+	float m_radius = 0.f;
+	// coarsest lod over its own compact vertices, drawn by the cpu occlusion rasterizer
+	std::vector<glm::vec3> m_occluderPositions;
+	std::vector<uint32_t> m_occluderIndices;
+	// bounds the packed positions are quantized in
+	glm::vec3 m_positionOffset = glm::vec3(0.0f);
+	glm::vec3 m_positionScale = glm::vec3(1.0f);
 };
 
 class Model {
 public:
 	Model() = default;
-	Model(std::filesystem::path filePath);
-	void createCube();
+	Model(std::filesystem::path filePath, GeometryBuffer& geometry, const ModelDesc& desc = ModelDesc());
+	void createCube(GeometryBuffer& geometry);
+
+	static MeshData loadObj(const std::filesystem::path& path, const ModelDesc& desc);
 
 	std::vector<std::shared_ptr<Mesh>> m_meshes;
 	glm::mat4 m_modelMatrix = glm::mat4(1.0f);
+
+private:
+	void createMeshes(GeometryBuffer& geometry, const std::filesystem::path& directory,
+		const Vertex* vertices, const uint32_t* indices, const MeshShape* shapes, uint32_t shapeCount, const Meshlet* meshlets, const MeshLod* lods,
+		const std::vector<MaterialDesc>& materials, VertexPacking::QualityStats* packingStats);
 };
\ No newline at end of file
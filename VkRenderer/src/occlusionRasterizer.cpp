@@ -0,0 +1,170 @@
+#include "src/occlusionRasterizer.hpp"
+#include "src/depthPyramid.hpp"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+	#define RASTERIZER_SSE 1
+	#include <emmintrin.h>
+#else
+	#define RASTERIZER_SSE 0
+#endif
+
+OcclusionRasterizer::OcclusionRasterizer(uint32_t width, uint32_t height)
+	: m_width((std::max(width, 1u) + 3) & ~3u), m_height(std::max(height, 1u)) {
+	m_depth.assign(m_width * m_height, 1.0f);
+}
+
+const char* OcclusionRasterizer::getInstructionSet() {
+	return RASTERIZER_SSE ? "sse2" : "scalar";
+}
+
+void OcclusionRasterizer::begin(const glm::mat4& viewProjection) {
+	m_viewProjection = viewProjection;
+	std::fill(m_depth.begin(), m_depth.end(), 1.0f);
+	m_triangleCount = 0;
+}
+
+void OcclusionRasterizer::drawTriangles(const glm::vec3* positions, uint32_t vertexCount, const uint32_t* indices, uint32_t indexCount, const glm::mat4& model) {
+	glm::mat4 toClip = m_viewProjection * model;
+	m_clip.resize(vertexCount);
+	for (uint32_t i = 0; i < vertexCount; i++)
+		m_clip[i] = toClip * glm::vec4(positions[i], 1.0f);
+
+	for (uint32_t i = 0; i + 2 < indexCount; i += 3) {
+		const glm::vec4& a = m_clip[indices[i]];
+		const glm::vec4& b = m_clip[indices[i + 1]];
+		const glm::vec4& c = m_clip[indices[i + 2]];
+
+		// every vertex outside the same clip plane
+		if ((a.x > a.w && b.x > b.w && c.x > c.w) || (a.x < -a.w && b.x < -b.w && c.x < -c.w) ||
+			(a.y > a.w && b.y > b.w && c.y > c.w) || (a.y < -a.w && b.y < -b.w && c.y < -c.w) ||
+			(a.z > a.w && b.z > b.w && c.z > c.w) || (a.z < 0.f && b.z < 0.f && c.z < 0.f))
+			continue;
+
+		drawClipped(a, b, c);
+	}
+}
+
+void OcclusionRasterizer::buildPyramid(DepthPyramid& pyramid) const {
+	pyramid.build(m_depth.data(), m_width, m_height, m_viewProjection);
+}
+
+void OcclusionRasterizer::drawClipped(const glm::vec4& a, const glm::vec4& b, const glm::vec4& c) {
+	// against the near plane (z >= 0), a triangle becomes at most a quad
+	const glm::vec4 input[3] = { a, b, c };
+	glm::vec4 polygon[4];
+	uint32_t count = 0;
+	for (uint32_t i = 0; i < 3; i++) {
+		const glm::vec4& current = input[i];
+		const glm::vec4& next = input[(i + 1) % 3];
+		if (current.z >= 0.f)
+			polygon[count++] = current;
+		if ((current.z >= 0.f) != (next.z >= 0.f))
+			polygon[count++] = current + (next - current) * (current.z / (current.z - next.z));
+	}
+
+	glm::vec3 screen[4];
+	for (uint32_t i = 0; i < count; i++) {
+		if (polygon[i].w <= 1e-6f)
+			return;
+		float invW = 1.0f / polygon[i].w;
+		screen[i] = glm::vec3(
+			(polygon[i].x * invW * 0.5f + 0.5f) * m_width,
+			(polygon[i].y * invW * 0.5f + 0.5f) * m_height,
+			polygon[i].z * invW);
+	}
+
+	for (uint32_t i = 1; i + 1 < count; i++)
+		rasterize(screen[0], screen[i], screen[i + 1]);
+}
+
+void OcclusionRasterizer::rasterize(const glm::vec3& a, const glm::vec3& b, const glm::vec3& c) {
+	float area = (b.x - a.x) * (c.y - a.y) - (b.y - a.y) * (c.x - a.x);
+	if (std::abs(area) < 1e-8f)
+		return;
+	// both faces are drawn, clockwise ones are flipped
+	const glm::vec3 v[3] = { a, area > 0.f ? b : c, area > 0.f ? c : b };
+	area = std::abs(area);
+
+	TriangleSetup setup;
+	setup.minX = std::max(static_cast<int>(std::floor(std::min(v[0].x, std::min(v[1].x, v[2].x)))), 0);
+	setup.minY = std::max(static_cast<int>(std::floor(std::min(v[0].y, std::min(v[1].y, v[2].y)))), 0);
+	setup.maxX = std::min(static_cast<int>(std::ceil(std::max(v[0].x, std::max(v[1].x, v[2].x)))), static_cast<int>(m_width) - 1);
+	setup.maxY = std::min(static_cast<int>(std::ceil(std::max(v[0].y, std::max(v[1].y, v[2].y)))), static_cast<int>(m_height) - 1);
+	if (setup.minX > setup.maxX || setup.minY > setup.maxY)
+		return;
+	m_triangleCount++;
+
+	for (int i = 0; i < 3; i++) {
+		const glm::vec3& p0 = v[(i + 1) % 3];
+		const glm::vec3& p1 = v[(i + 2) % 3];
+		setup.edgeA[i] = p0.y - p1.y;
+		setup.edgeB[i] = p1.x - p0.x;
+		setup.edgeC[i] = -(setup.edgeA[i] * p0.x + setup.edgeB[i] * p0.y);
+	}
+	// depth plane from the barycentric weights, pushed to the farthest value reached inside a pixel
+	setup.depthA = (setup.edgeA[0] * v[0].z + setup.edgeA[1] * v[1].z + setup.edgeA[2] * v[2].z) / area;
+	setup.depthB = (setup.edgeB[0] * v[0].z + setup.edgeB[1] * v[1].z + setup.edgeB[2] * v[2].z) / area;
+	setup.depthC = (setup.edgeC[0] * v[0].z + setup.edgeC[1] * v[1].z + setup.edgeC[2] * v[2].z) / area;
+	setup.depthC += 0.5f * (std::abs(setup.depthA) + std::abs(setup.depthB));
+
+#if RASTERIZER_SSE
+	if (!m_scalar) {
+		rasterizeSse(setup);
+		return;
+	}
+#endif
+	rasterizeScalar(setup);
+}
+
+// the same pixels and the same order of operations as the sse loop : whole groups of 4, A * x + (B * y + C)
+void OcclusionRasterizer::rasterizeScalar(const TriangleSetup& setup) {
+	for (int y = setup.minY; y <= setup.maxY; y++) {
+		float* row = m_depth.data() + y * m_width;
+		float py = y + 0.5f;
+		float row0 = setup.edgeB[0] * py + setup.edgeC[0];
+		float row1 = setup.edgeB[1] * py + setup.edgeC[1];
+		float row2 = setup.edgeB[2] * py + setup.edgeC[2];
+		float rowDepth = setup.depthB * py + setup.depthC;
+
+		for (int x = setup.minX & ~3; x <= (setup.maxX | 3); x++) {
+			float px = x + 0.5f;
+			if (setup.edgeA[0] * px + row0 < 0.f || setup.edgeA[1] * px + row1 < 0.f || setup.edgeA[2] * px + row2 < 0.f)
+				continue;
+			float depth = setup.depthA * px + rowDepth;
+			row[x] = row[x] < depth ? row[x] : depth;
+		}
+	}
+}
+
+#if RASTERIZER_SSE
+void OcclusionRasterizer::rasterizeSse(const TriangleSetup& setup) {
+	const __m128 laneCenters = _mm_setr_ps(0.5f, 1.5f, 2.5f, 3.5f);
+	const __m128 zero = _mm_setzero_ps();
+	const __m128 a0 = _mm_set1_ps(setup.edgeA[0]), a1 = _mm_set1_ps(setup.edgeA[1]), a2 = _mm_set1_ps(setup.edgeA[2]);
+	const __m128 depthX = _mm_set1_ps(setup.depthA);
+
+	for (int y = setup.minY; y <= setup.maxY; y++) {
+		float* row = m_depth.data() + y * m_width;
+		float py = y + 0.5f;
+		__m128 row0 = _mm_set1_ps(setup.edgeB[0] * py + setup.edgeC[0]);
+		__m128 row1 = _mm_set1_ps(setup.edgeB[1] * py + setup.edgeC[1]);
+		__m128 row2 = _mm_set1_ps(setup.edgeB[2] * py + setup.edgeC[2]);
+		__m128 rowDepth = _mm_set1_ps(setup.depthB * py + setup.depthC);
+
+		// the width is a multiple of 4, aligned groups never leave the row
+		for (int x = setup.minX & ~3; x <= setup.maxX; x += 4) {
+			__m128 px = _mm_add_ps(_mm_set1_ps(static_cast<float>(x)), laneCenters);
+			__m128 inside = _mm_and_ps(
+				_mm_and_ps(_mm_cmpge_ps(_mm_add_ps(_mm_mul_ps(a0, px), row0), zero), _mm_cmpge_ps(_mm_add_ps(_mm_mul_ps(a1, px), row1), zero)),
+				_mm_cmpge_ps(_mm_add_ps(_mm_mul_ps(a2, px), row2), zero));
+			if (_mm_movemask_ps(inside) == 0)
+				continue;
+
+			__m128 depth = _mm_add_ps(_mm_mul_ps(depthX, px), rowDepth);
+			__m128 stored = _mm_loadu_ps(row + x);
+			__m128 nearest = _mm_min_ps(stored, depth);
+			_mm_storeu_ps(row + x, _mm_or_ps(_mm_and_ps(inside, nearest), _mm_andnot_ps(inside, stored)));
+		}
+	}
+}
+#endif
@@ -0,0 +1,49 @@
+#pragma once
+#include "src/vulkan/vkHeader.hpp"
+
+class DepthPyramid;
+
+// low resolution cpu depth buffer of a few occluders, with the depth convention of the gpu (0 near, 1 far).
+// every covered pixel keeps the farthest depth its nearest triangle reaches inside it, 4 pixels at a time with sse2
+class OcclusionRasterizer {
+public:
+	// width is rounded up to a multiple of 4
+	OcclusionRasterizer(uint32_t width = 256, uint32_t height = 144);
+
+	// clears the depth to the far plane, viewProjection : depth 0 to 1, the view the occluders are seen from
+	void begin(const glm::mat4& viewProjection);
+	// both faces of every triangle are drawn, triangles crossing the near plane are clipped
+	void drawTriangles(const glm::vec3* positions, uint32_t vertexCount, const uint32_t* indices, uint32_t indexCount, const glm::mat4& model);
+	// the depth as a pyramid, tested with the same view projection
+	void buildPyramid(DepthPyramid& pyramid) const;
+
+	const float* getDepth() const { return m_depth.data(); }
+	uint32_t getWidth() const { return m_width; }
+	uint32_t getHeight() const { return m_height; }
+	uint32_t getTriangleCount() const { return m_triangleCount; }	// drawn since begin, after clipping
+	static const char* getInstructionSet();	// "sse2" or "scalar"
+	// draws with the scalar loop even when sse2 is available, both give the same depth to the bit
+	void setScalar(bool scalar) { m_scalar = scalar; }
+
+private:
+	// pixel bounds, edge equations and depth plane of a counter clockwise triangle
+	struct TriangleSetup {
+		int minX, minY, maxX, maxY;
+		float edgeA[3], edgeB[3], edgeC[3];	// edge i is opposite vertex i : A * x + B * y + C, positive inside
+		float depthA, depthB, depthC;		// depth at the back of the pixel : A * x + B * y + C
+	};
+
+	// screen space x / y in pixels, z in depth
+	void rasterize(const glm::vec3& a, const glm::vec3& b, const glm::vec3& c);
+	void rasterizeScalar(const TriangleSetup& setup);
+	void rasterizeSse(const TriangleSetup& setup);	// only defined with sse2
+	void drawClipped(const glm::vec4& a, const glm::vec4& b, const glm::vec4& c);
+
+	uint32_t m_width;
+	uint32_t m_height;
+	std::vector<float> m_depth;
+	std::vector<glm::vec4> m_clip;	// transformed vertices of the current draw
+	glm::mat4 m_viewProjection = glm::mat4(1.0f);
+	uint32_t m_triangleCount = 0;
+	bool m_scalar = false;
+};
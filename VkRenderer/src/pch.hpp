@@ -6,6 +6,7 @@
 #include <iostream>
 #include <stdexcept>
 #include <vector>
+#include <deque>
 #include <optional>
 #include <set>
 #include <cstdint>
@@ -16,9 +17,12 @@
 #include <chrono>
 #include <filesystem>
 #include <cstring>
+#include <memory>
+#include <mutex>
 
 #define GLM_FORCE_DEPTH_ZERO_TO_ONE
 #define GLM_ENABLE_EXPERIMENTAL
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/packing.hpp>
 #include <glm/gtx/hash.hpp>
\ No newline at end of file
@@ -0,0 +1,313 @@
+#include "src/renderGraph.hpp"
+#include "src/vulkan/renderPass.hpp"
+#include "src/vulkan/commandBuffer.hpp"
+#include "src/vulkan/texture.hpp"
+#include "src/vulkan/device.hpp"
+
+namespace {
+	struct AccessInfo {
+		VkImageLayout layout;		// before and after the access, UNDEFINED when the previous content is discarded
+		VkImageLayout finalLayout;
+		VkPipelineStageFlags stages;
+		VkAccessFlags access;
+		bool write;
+	};
+
+	AccessInfo getAccessInfo(ImageAccess access, const Texture& texture) {
+		bool depth = texture.getType() == TextureType::DEPTH;
+		VkPipelineStageFlags attachmentStages = depth ? VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT : VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+		VkAccessFlags attachmentWrite = depth ? VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT : VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+		VkAccessFlags attachmentRead = depth ? VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT : VK_ACCESS_COLOR_ATTACHMENT_READ_BIT;
+		VkImageLayout attachmentLayout = RenderPass::getFinalLayout(texture.getType());
+
+		switch (access) {
+		case ImageAccess::ATTACHMENT:
+			return { VK_IMAGE_LAYOUT_UNDEFINED, attachmentLayout, attachmentStages, attachmentWrite, true };
+		case ImageAccess::ATTACHMENT_LOAD:
+			return { attachmentLayout, attachmentLayout, attachmentStages, attachmentWrite | attachmentRead, true };
+		case ImageAccess::SAMPLED:
+			return { VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT, false };
+		case ImageAccess::TRANSFER_SRC:
+			return { VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_READ_BIT, false };
+		}
+		return {};
+	}
+}
+
+RenderGraph::~RenderGraph() {
+	// the transient images go before the memory bound to them, their owner must have released them already
+	for (const Image& image : m_images)
+		DEBUG_ASSERT(!image.texture->isTransient() || image.texture.use_count() == 1, "a transient image outlives its render graph");
+	m_images.clear();
+	Device::get()->getAllocator().free(m_transientMemory);
+}
+
+void RenderGraph::clear() {
+	m_passes.clear();
+	m_outputs.clear();
+	m_order.clear();
+	m_passStats.clear();
+}
+
+void RenderGraph::setImage(const std::string& name, const FrameResource<Texture>& textures) {
+	auto it = m_resourceIndices.find(name);
+	if (it == m_resourceIndices.end()) {
+		m_resourceIndices[name] = static_cast<uint32_t>(m_resources.size());
+		Resource resource;
+		for (uint32_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
+			// a copy shared with the previous frame is the same image
+			if (i > 0 && textures[i] == textures[i - 1]) {
+				resource.images[i] = resource.images[i - 1];
+				continue;
+			}
+			resource.images[i] = static_cast<uint32_t>(m_images.size());
+			m_images.push_back({ textures[i] });
+		}
+		m_resources.push_back(resource);
+		return;
+	}
+
+	for (uint32_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
+		Image& image = m_images[m_resources[it->second].images[i]];
+		if (image.texture != textures[i]) {
+			DEBUG_ASSERT(!image.texture->isTransient(), "render graph image \"%s\" is transient, its memory is placed once", name.c_str());
+			image = { textures[i] };
+		}
+	}
+}
+
+void RenderGraph::addPass(const std::string& name, const std::vector<Access>& accesses, Record record, bool sideEffect) {
+	Pass pass{ name, {}, std::move(record), sideEffect };
+	for (const Access& access : accesses)
+		pass.accesses.push_back({ getResource(access.image), access.access });
+	m_passes.push_back(std::move(pass));
+}
+
+void RenderGraph::addOutput(const std::string& image) {
+	m_outputs.push_back(getResource(image));
+}
+
+void RenderGraph::compile() {
+	// backwards from the outputs : a pass is kept when a later kept pass or the outputs read what it writes
+	std::vector<uint8_t> needed(m_resources.size(), 0);
+	for (uint32_t output : m_outputs)
+		needed[output] = 1;
+
+	std::vector<uint8_t> kept(m_passes.size(), 0);
+	for (size_t i = m_passes.size(); i-- > 0;) {
+		const Pass& pass = m_passes[i];
+		bool keep = pass.sideEffect;
+		for (const PassAccess& access : pass.accesses)
+			keep |= access.access != ImageAccess::SAMPLED && access.access != ImageAccess::TRANSFER_SRC && needed[access.resource];
+		if (!keep)
+			continue;
+
+		kept[i] = 1;
+		// a cleared attachment hides what was written before, the other accesses read it
+		for (const PassAccess& access : pass.accesses)
+			needed[access.resource] = access.access != ImageAccess::ATTACHMENT;
+	}
+
+	m_order.clear();
+	m_passStats.clear();
+	for (uint32_t i = 0; i < m_passes.size(); i++) {
+		if (kept[i])
+			m_order.push_back(i);
+		m_passStats.push_back({ m_passes[i].name, !kept[i], 0, 0.0f });
+	}
+}
+
+void RenderGraph::allocateTransients(bool aliasing) {
+	DEBUG_ASSERT(m_transientMemory.memory == VK_NULL_HANDLE, "the transient images are already placed");
+
+	// the first and last kept pass accessing each resource
+	std::vector<uint32_t> first(m_resources.size(), UINT32_MAX);
+	std::vector<uint32_t> last(m_resources.size(), 0);
+	for (uint32_t i = 0; i < m_order.size(); i++) {
+		for (const PassAccess& access : m_passes[m_order[i]].accesses) {
+			first[access.resource] = std::min(first[access.resource], i);
+			last[access.resource] = i;
+		}
+	}
+
+	// the resource of each image and the frames in flight using it
+	std::vector<uint32_t> resourceOf(m_images.size());
+	std::vector<uint32_t> frameMask(m_images.size(), 0);
+	for (uint32_t i = 0; i < m_resources.size(); i++) {
+		for (uint32_t frame = 0; frame < MAX_FRAMES_IN_FLIGHT; frame++) {
+			resourceOf[m_resources[i].images[frame]] = i;
+			frameMask[m_resources[i].images[frame]] |= 1u << frame;
+		}
+	}
+
+	std::vector<uint32_t> transients;
+	std::vector<VkDeviceSize> alignments(m_images.size(), 1);
+	VkMemoryRequirements heapRequirements{ 0, 1, ~0u };
+	for (uint32_t i = 0; i < m_images.size(); i++) {
+		Image& image = m_images[i];
+		if (!image.texture->isTransient())
+			continue;
+		DEBUG_ASSERT(first[resourceOf[i]] != UINT32_MAX, "transient render graph image %u is never accessed", i);
+
+		VkMemoryRequirements requirements = image.texture->getMemoryRequirements();
+		image.size = requirements.size;
+		image.resident = false;
+		alignments[i] = requirements.alignment;
+		heapRequirements.alignment = std::max(heapRequirements.alignment, requirements.alignment);
+		heapRequirements.memoryTypeBits &= requirements.memoryTypeBits;
+		m_memoryStats.separateBytes += requirements.size;
+		transients.push_back(i);
+	}
+	m_memoryStats.transientCount = static_cast<uint32_t>(transients.size());
+	if (transients.empty())
+		return;
+	DEBUG_ASSERT(heapRequirements.memoryTypeBits != 0, "the transient images have no memory type in common");
+
+	// the copies of different frames never share memory, the frames in flight would wait on each other again
+	auto alive = [&](uint32_t a, uint32_t b) {
+		uint32_t ra = resourceOf[a], rb = resourceOf[b];
+		return !aliasing || (frameMask[a] & frameMask[b]) == 0 || (first[ra] <= last[rb] && first[rb] <= last[ra]);
+	};
+	auto overlap = [&](const Image& a, const Image& b) {
+		return a.offset < b.offset + b.size && b.offset < a.offset + a.size;
+	};
+
+	// biggest first, each moved past the placed images alive at the same time until it overlaps none of them
+	std::sort(transients.begin(), transients.end(), [&](uint32_t a, uint32_t b) { return m_images[a].size > m_images[b].size; });
+	std::vector<uint32_t> placed;
+	for (uint32_t i : transients) {
+		Image& image = m_images[i];
+		for (bool moved = true; moved;) {
+			moved = false;
+			for (uint32_t other : placed) {
+				const Image& placedImage = m_images[other];
+				if (alive(i, other) && overlap(image, placedImage)) {
+					VkDeviceSize end = placedImage.offset + placedImage.size;
+					image.offset = (end + alignments[i] - 1) / alignments[i] * alignments[i];
+					moved = true;
+				}
+			}
+		}
+		placed.push_back(i);
+		heapRequirements.size = std::max(heapRequirements.size, image.offset + image.size);
+	}
+
+	for (uint32_t a : transients) {
+		for (uint32_t b : transients) {
+			if (a != b && overlap(m_images[a], m_images[b]))
+				m_images[a].aliases.push_back(b);
+		}
+	}
+
+	AllocationInfo allocInfo{};
+	allocInfo.properties = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
+	allocInfo.linear = false;
+	allocInfo.renderTarget = true;
+	m_transientMemory = Device::get()->getAllocator().allocate(heapRequirements, allocInfo);
+	for (uint32_t i : transients)
+		m_images[i].texture->bindMemory(m_transientMemory.memory, m_transientMemory.offset + m_images[i].offset);
+
+	m_memoryStats.aliasedBytes = heapRequirements.size;
+}
+
+void RenderGraph::printStats() const {
+	printf("render graph: %u transient targets in %.1f MB instead of %.1f MB, %.1f MB saved\n", m_memoryStats.transientCount,
+		m_memoryStats.aliasedBytes / (1024.f * 1024.f), m_memoryStats.separateBytes / (1024.f * 1024.f),
+		(m_memoryStats.separateBytes - m_memoryStats.aliasedBytes) / (1024.f * 1024.f));
+}
+
+void RenderGraph::execute(CommandBuffer& commandBuffer, uint32_t frameIndex) {
+	m_barrierCount = 0;
+	m_batchCount = 0;
+	for (uint32_t passIndex : m_order) {
+		Pass& pass = m_passes[passIndex];
+		m_barriers.clear();
+		VkPipelineStageFlags srcStages = 0;
+		VkPipelineStageFlags dstStages = 0;
+		for (const PassAccess& passAccess : pass.accesses)
+			access(m_images[m_resources[passAccess.resource].images[frameIndex]], passAccess.access, m_barriers, srcStages, dstStages);
+
+		if (!m_barriers.empty()) {
+			vkCmdPipelineBarrier(commandBuffer.getHandle(), srcStages, dstStages, 0, 0, nullptr, 0, nullptr,
+				static_cast<uint32_t>(m_barriers.size()), m_barriers.data());
+			m_barrierCount += static_cast<uint32_t>(m_barriers.size());
+			m_batchCount++;
+		}
+
+		auto start = std::chrono::high_resolution_clock::now();
+		pass.record();
+		PassStats& stats = m_passStats[passIndex];
+		stats.milliseconds = std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+		stats.barrierCount = static_cast<uint32_t>(m_barriers.size());
+	}
+}
+
+uint32_t RenderGraph::getResource(const std::string& name) const {
+	auto it = m_resourceIndices.find(name);
+	DEBUG_ASSERT(it != m_resourceIndices.end(), "render graph image \"%s\" was never set", name.c_str());
+	return it->second;
+}
+
+void RenderGraph::access(Image& image, ImageAccess access, std::vector<VkImageMemoryBarrier>& barriers, VkPipelineStageFlags& srcStages, VkPipelineStageFlags& dstStages) {
+	AccessInfo info = getAccessInfo(access, *image.texture);
+
+	// the first access of a transient image since its memory was used by an alias : it waits on what the aliases have
+	// pending and their content is lost
+	if (!image.resident) {
+		DEBUG_ASSERT(access == ImageAccess::ATTACHMENT, "a transient image is first cleared in the frame");
+		for (uint32_t alias : image.aliases) {
+			Image& other = m_images[alias];
+			image.writeStages |= other.writeStages;
+			image.writeAccess |= other.writeAccess;
+			image.readStages |= other.readStages;
+			other.layout = VK_IMAGE_LAYOUT_UNDEFINED;
+			other.writeStages = 0;
+			other.writeAccess = 0;
+			other.readStages = 0;
+			other.visibleStages = 0;
+			other.resident = false;
+		}
+		image.layout = VK_IMAGE_LAYOUT_UNDEFINED;
+		image.resident = true;
+	}
+
+	// a cleared attachment is moved out of whatever layout it is in by its render pass
+	bool transition = info.layout != VK_IMAGE_LAYOUT_UNDEFINED && info.layout != image.layout;
+	bool hazard = info.write
+		? image.writeStages != 0 || image.readStages != 0
+		: image.writeStages != 0 && (info.stages & ~image.visibleStages) != 0;
+
+	if (transition || hazard) {
+		VkImageMemoryBarrier barrier{};
+		barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+		barrier.srcAccessMask = image.writeAccess;
+		barrier.dstAccessMask = info.access;
+		barrier.oldLayout = image.layout;
+		// an image whose content was lost, to an alias, goes straight to the layout the access leaves it in
+		barrier.newLayout = transition ? info.layout : image.layout != VK_IMAGE_LAYOUT_UNDEFINED ? image.layout : info.finalLayout;
+		barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		barrier.image = image.texture->getImage();
+		VkImageAspectFlags aspect = image.texture->getType() == TextureType::DEPTH ? VK_IMAGE_ASPECT_DEPTH_BIT : VK_IMAGE_ASPECT_COLOR_BIT;
+		barrier.subresourceRange = { aspect, 0, VK_REMAINING_MIP_LEVELS, 0, VK_REMAINING_ARRAY_LAYERS };
+		barriers.push_back(barrier);
+
+		VkPipelineStageFlags waitStages = image.writeStages | image.readStages;
+		srcStages |= waitStages != 0 ? waitStages : VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
+		dstStages |= info.stages;
+	}
+
+	if (info.write || transition) {
+		// a layout transition is a write the barrier already made visible to the reader
+		image.writeStages = info.stages;
+		image.writeAccess = info.write ? info.access : 0;
+		image.readStages = 0;
+		image.visibleStages = info.write ? 0 : info.stages;
+	}
+	if (!info.write) {
+		image.readStages |= info.stages;
+		if (hazard)
+			image.visibleStages |= info.stages;
+	}
+	image.layout = info.finalLayout;
+}
@@ -0,0 +1,126 @@
+#pragma once
+#include "src/vulkan/vkHeader.hpp"
+#include "src/vulkan/memoryAllocator.hpp"
+#include "src/vulkan/frameResource.hpp"
+#include <functional>
+#include <unordered_map>
+
+// how a pass uses an image of the graph
+enum class ImageAccess {
+	ATTACHMENT,			// written by a render pass that clears it, left in RenderPass::getFinalLayout()
+	ATTACHMENT_LOAD,	// loaded and written by a render pass, in RenderPass::getFinalLayout() before and after
+	SAMPLED,			// read by fragment shaders
+	TRANSFER_SRC,		// copied from
+};
+
+// the passes of a frame and the named images they read and write. compile() keeps the passes the outputs depend on,
+// in the order they were added, and execute() records them with the image barriers their accesses need, one
+// vkCmdPipelineBarrier per pass at most. the images' layouts and pending accesses are tracked across frames,
+// a pass only waits on what actually touched its images last.
+// transient images (Texture::isTransient()) live from their first to their last pass of the frame, allocateTransients()
+// places those that are never alive at the same time in the same memory.
+// an image name may have a copy per frame in flight, execute() accesses those of the frame it records
+class RenderGraph {
+public:
+	// records the pass into the command buffer being executed
+	using Record = std::function<void()>;
+
+	struct Access {
+		std::string image;
+		ImageAccess access;
+	};
+
+	struct PassStats {
+		std::string name;
+		bool culled;
+		uint32_t barrierCount;
+		float milliseconds;		// cpu time recording the pass
+	};
+
+	struct MemoryStats {
+		uint32_t transientCount = 0;	// copies of every frame in flight
+		VkDeviceSize separateBytes = 0;	// allocating every transient image on its own
+		VkDeviceSize aliasedBytes = 0;	// the memory they share
+	};
+
+	RenderGraph() = default;
+	~RenderGraph();
+
+	RenderGraph(const RenderGraph&) = delete;
+	RenderGraph& operator=(const RenderGraph&) = delete;
+
+	// removes the passes and outputs, the images and their state are kept
+	void clear();
+	// adds or replaces the textures behind a name, a new texture starts without any pending access. a name keeps the
+	// frames sharing a copy it was added with
+	void setImage(const std::string& name, const FrameResource<Texture>& textures);
+	// sideEffect : the pass is never culled, for results leaving the graph another way such as readbacks
+	void addPass(const std::string& name, const std::vector<Access>& accesses, Record record, bool sideEffect = false);
+	// an image used after the graph, presented or read by the next frames
+	void addOutput(const std::string& image);
+
+	// culls the passes none of the outputs depend on
+	void compile();
+	// binds the transient images to memory from their lifetimes in the compiled graph, once. the graphs compiled later
+	// must keep a subset of its passes, in the same order, so their lifetimes stay within the ones they were placed with.
+	// aliasing false gives every image its own bytes of the transient memory, to compare against
+	void allocateTransients(bool aliasing = true);
+	void execute(CommandBuffer& commandBuffer, uint32_t frameIndex);
+
+	const std::vector<PassStats>& getPassStats() const { return m_passStats; }
+	uint32_t getBarrierCount() const { return m_barrierCount; }
+	uint32_t getBatchCount() const { return m_batchCount; }
+	const MemoryStats& getMemoryStats() const { return m_memoryStats; }
+	// the transient memory placed by allocateTransients(), on the console
+	void printStats() const;
+
+private:
+	struct Image {
+		std::shared_ptr<Texture> texture;
+		VkImageLayout layout = VK_IMAGE_LAYOUT_UNDEFINED;
+		VkPipelineStageFlags writeStages = 0;	// of the last write, 0 once nothing is pending
+		VkAccessFlags writeAccess = 0;
+		VkPipelineStageFlags readStages = 0;	// reading since the last write
+		VkPipelineStageFlags visibleStages = 0;	// the last write is visible to
+
+		// transient images
+		VkDeviceSize offset = 0;				// in m_transientMemory
+		VkDeviceSize size = 0;
+		bool resident = true;					// false until its first access since an alias took its memory over
+		std::vector<uint32_t> aliases;			// the images sharing some of its bytes
+	};
+
+	// a name of the graph, the image each frame in flight accesses through it
+	struct Resource {
+		uint32_t images[MAX_FRAMES_IN_FLIGHT];
+	};
+
+	struct PassAccess {
+		uint32_t resource;
+		ImageAccess access;
+	};
+
+	struct Pass {
+		std::string name;
+		std::vector<PassAccess> accesses;
+		Record record;
+		bool sideEffect;
+	};
+
+	uint32_t getResource(const std::string& name) const;
+	// adds the barrier an access needs to the pass's batch and moves the image to its state after the access
+	void access(Image& image, ImageAccess access, std::vector<VkImageMemoryBarrier>& barriers, VkPipelineStageFlags& srcStages, VkPipelineStageFlags& dstStages);
+
+	std::vector<Image> m_images;
+	std::vector<Resource> m_resources;
+	std::unordered_map<std::string, uint32_t> m_resourceIndices;
+	std::vector<Pass> m_passes;
+	std::vector<uint32_t> m_outputs;		// resources
+	std::vector<uint32_t> m_order;		// the passes kept by compile()
+	std::vector<PassStats> m_passStats;
+	std::vector<VkImageMemoryBarrier> m_barriers;
+	uint32_t m_barrierCount = 0;		// last execute()
+	uint32_t m_batchCount = 0;
+	Allocation m_transientMemory;
+	MemoryStats m_memoryStats;
+};
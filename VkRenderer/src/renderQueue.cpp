@@ -0,0 +1,46 @@
+#include "src/renderQueue.hpp"
+
+uint64_t RenderQueue::makeKey(uint32_t pipeline, uint32_t material, uint32_t geometry, float depth) {
+	const uint32_t depthMax = (1u << 24) - 1;
+	uint32_t depthBucket = static_cast<uint32_t>(std::clamp(depth, 0.0f, 1.0f) * depthMax);
+	return (static_cast<uint64_t>(pipeline & 0xff) << 56) |
+		(static_cast<uint64_t>(material & 0xffff) << 40) |
+		(static_cast<uint64_t>(geometry & 0xffff) << 24) |
+		depthBucket;
+}
+
+void RenderQueue::sort() {
+	size_t count = m_items.size();
+	if (count < 2)
+		return;
+	m_scratch.resize(count);
+
+	// every histogram in one read of the keys
+	uint32_t histograms[8][256] = {};
+	for (const Item& item : m_items) {
+		for (int pass = 0; pass < 8; pass++)
+			histograms[pass][(item.key >> (pass * 8)) & 0xff]++;
+	}
+
+	Item* source = m_items.data();
+	Item* destination = m_scratch.data();
+	for (int pass = 0; pass < 8; pass++) {
+		uint32_t* histogram = histograms[pass];
+		uint32_t shift = pass * 8;
+		if (histogram[(source[0].key >> shift) & 0xff] == count)
+			continue;
+
+		uint32_t offsets[256];
+		uint32_t offset = 0;
+		for (int digit = 0; digit < 256; digit++) {
+			offsets[digit] = offset;
+			offset += histogram[digit];
+		}
+		for (size_t i = 0; i < count; i++)
+			destination[offsets[(source[i].key >> shift) & 0xff]++] = source[i];
+		std::swap(source, destination);
+	}
+
+	if (source != m_items.data())
+		m_items.swap(m_scratch);
+}
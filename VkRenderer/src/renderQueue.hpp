@@ -0,0 +1,31 @@
+#pragma once
+#include "src/vulkan/vkHeader.hpp"
+
+// draws of a pass ordered by a 64 bit key, most significant first :
+// pipeline (8 bits) | material (16 bits) | geometry (16 bits) | depth (24 bits).
+// draws sharing the state of the upper fields end up next to each other so recording only binds what changes,
+// the depth bucket orders them front to back inside a batch
+class RenderQueue {
+public:
+	struct Item {
+		uint64_t key;
+		uint32_t draw;	// the caller's index of the draw
+	};
+
+	// depth : 0 at the view, 1 at the far end, clamped
+	static uint64_t makeKey(uint32_t pipeline, uint32_t material, uint32_t geometry, float depth);
+	static uint32_t getMaterial(uint64_t key) { return static_cast<uint32_t>(key >> 40) & 0xffff; }
+	static uint32_t getGeometry(uint64_t key) { return static_cast<uint32_t>(key >> 24) & 0xffff; }
+
+	void clear() { m_items.clear(); }
+	void push(uint64_t key, uint32_t draw) { m_items.push_back({ key, draw }); }
+	// stable lsd radix sort, 8 bits per pass, passes where every key has the same byte are skipped
+	void sort();
+
+	const std::vector<Item>& getItems() const { return m_items; }
+	size_t size() const { return m_items.size(); }
+
+private:
+	std::vector<Item> m_items;
+	std::vector<Item> m_scratch;
+};
@@ -0,0 +1,1278 @@
+#include "src/sceneRenderer.hpp"
+#include "src/model.hpp"
+#include "src/material.hpp"
+#include "src/indirectScene.hpp"
+#include "src/instancedModel.hpp"
+#include "src/threadPool.hpp"
+#include "src/vulkan/device.hpp"
+#include "src/vulkan/swapchain.hpp"
+#include "src/vulkan/pipeline.hpp"
+#include "src/vulkan/framebuffer.hpp"
+#include "src/vulkan/commandBuffer.hpp"
+#include "src/vulkan/descriptorSet.hpp"
+#include "src/vulkan/texture.hpp"
+#include "src/vulkan/syncObjects.hpp"
+#include "src/vulkan/shader.hpp"
+#include "src/vulkan/buffer.hpp"
+#include "src/vulkan/geometryBuffer.hpp"
+#include "src/vulkan/parallelRecorder.hpp"
+#include <imgui.h>
+
+SceneRenderer::SceneRenderer(Scene& scene, const std::shared_ptr<Swapchain>& swapchain, const Settings& settings)
+	: m_scene(scene), m_swapchain(swapchain), m_settings(settings) {
+	PipelineDesc pipelineDesc{};
+	VertexFormat vertexFormat = getVertexFormat(*m_scene.geometry);
+
+	// init scene data
+	m_sceneUBO.reserve(MAX_FRAMES_IN_FLIGHT);
+	for (int i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
+		m_sceneUBO.emplace_back((uint32_t)sizeof(SceneDataUBO));
+	}
+	createRenderTargets();
+
+	// depth pre-pass
+	pipelineDesc.shader = std::make_shared<Shader>(getVertexShaderPath("depthPrePass", vertexFormat).c_str(), "spv/depthPrePassFrag.spv");
+	pipelineDesc.sampleCount = VK_SAMPLE_COUNT_1_BIT;
+	pipelineDesc.clear = true;
+	pipelineDesc.attachmentInfos = { { m_depthPrePass.texture } };
+	pipelineDesc.swapchain = nullptr;
+
+	m_depthPrePass.pipeline = std::make_shared<Pipeline>(pipelineDesc);
+
+	m_depthPrePass.descriptorSet = std::make_shared<DescriptorSet>(pipelineDesc.shader, 0);
+	m_depthPrePass.descriptorSet->setUniform(m_sceneUBO, 0);
+
+	// ssao
+	pipelineDesc.shader = std::make_shared<Shader>("spv/screenVert.spv", "spv/ssaoFrag.spv");
+	pipelineDesc.sampleCount = VK_SAMPLE_COUNT_1_BIT;
+	pipelineDesc.clear = true;
+	pipelineDesc.attachmentInfos = { { m_ssaoPass.texture } };
+	pipelineDesc.swapchain = nullptr;
+	m_ssaoPass.pipeline = std::make_shared<Pipeline>(pipelineDesc);
+
+	m_ssaoPass.descriptorSet = std::make_shared<DescriptorSet>(pipelineDesc.shader, 0);
+	m_ssaoPass.descriptorSet->setUniform(m_sceneUBO, 0);
+	m_ssaoPass.descriptorSet->setTexture(m_depthPrePass.texture, 1);
+
+	// hi-z, the farthest depth halved per level, the last one is read back for occlusion culling
+	pipelineDesc.shader = std::make_shared<Shader>("spv/screenVert.spv", "spv/hiZFrag.spv");
+	pipelineDesc.sampleCount = VK_SAMPLE_COUNT_1_BIT;
+	pipelineDesc.clear = true;
+	pipelineDesc.attachmentInfos = { { m_hiZData.levels[0] } };
+	pipelineDesc.swapchain = nullptr;
+	pipelineDesc.createFramebuffers = false;
+	pipelineDesc.blendMode = BlendMode::NONE;	// float32 targets are not blendable everywhere
+	m_hiZData.pipeline = std::make_shared<Pipeline>(pipelineDesc);
+	pipelineDesc.createFramebuffers = true;
+	pipelineDesc.blendMode = BlendMode::DEFAULT;
+
+	for (uint32_t i = 0; i < hiZLevelCount; i++) {
+		for (int j = 0; j < MAX_FRAMES_IN_FLIGHT; j++) {
+			m_hiZData.framebuffers[j][i] = std::make_shared<Framebuffer>(
+				std::vector<std::shared_ptr<Texture>>{ m_hiZData.levels[i] },
+				m_hiZData.pipeline->getRenderPass()
+			);
+		}
+		m_hiZData.descriptorSets[i] = std::make_shared<DescriptorSet>(pipelineDesc.shader, 0);
+		if (i == 0)
+			m_hiZData.descriptorSets[i]->setTexture(m_depthPrePass.texture, 0);
+		else
+			m_hiZData.descriptorSets[i]->setTexture(m_hiZData.levels[i - 1], 0);
+	}
+
+	const auto& readbackLevel = m_hiZData.levels[hiZLevelCount - 1];
+	for (int i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
+		m_hiZData.readback[i] = std::make_shared<Buffer>();
+		m_hiZData.readback[i]->createBuffer(readbackLevel->getWidth() * readbackLevel->getHeight() * sizeof(float),
+			VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+			VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+	}
+
+	// shadow
+	float orthoSize = 30.0f;
+	float nearPlane = 1.0f;
+	float farPlane = 35.0f;
+
+	m_shadowData.lightProjection = glm::ortho(
+		-orthoSize, orthoSize,
+		-orthoSize, orthoSize,
+		nearPlane, farPlane
+	);
+
+	glm::vec3 lightDir = glm::normalize(glm::vec3(0.5f, -1.0f, 0.2f));
+	glm::vec3 lightPos = -lightDir * 25.0f;
+	m_shadowData.lightPos = lightPos;
+
+	m_shadowData.lightView = glm::lookAt(
+		lightPos,
+		glm::vec3(0.0f),
+		glm::vec3(0.0f, 1.0f, 0.0f)
+	);
+	m_shadowData.lightSpace = m_shadowData.lightProjection * m_shadowData.lightView;
+
+	pipelineDesc.shader = std::make_shared<Shader>(getVertexShaderPath("shadowMap", vertexFormat).c_str(), "spv/shadowMapFrag.spv");
+	pipelineDesc.sampleCount = VK_SAMPLE_COUNT_1_BIT;
+	pipelineDesc.clear = true;
+	pipelineDesc.attachmentInfos = { { m_shadowData.texture } };
+	pipelineDesc.swapchain = nullptr;
+
+	m_shadowData.pipeline = std::make_shared<Pipeline>(pipelineDesc);
+
+	m_shadowData.descriptorSet = std::make_shared<DescriptorSet>(pipelineDesc.shader, 0);
+	m_shadowData.descriptorSet->setUniform(m_sceneUBO, 0);
+	// forward scene
+	m_forwardData.shader = std::make_shared<Shader>(getVertexShaderPath("basic", vertexFormat).c_str(), "spv/pbrFrag.spv");
+
+	m_recorder = std::make_shared<ParallelRecorder>();
+
+	pipelineDesc.shader = m_forwardData.shader; // todo : asset manager
+	pipelineDesc.sampleCount = VK_SAMPLE_COUNT_8_BIT;
+	pipelineDesc.clear = true;
+	pipelineDesc.attachmentInfos = {
+		{ m_forwardData.colorTexture},
+		{ m_forwardData.depthTexture},
+		{ m_forwardData.resolveTexture, true} };
+
+	m_forwardData.pipeline = std::make_shared<Pipeline>(pipelineDesc);
+
+	m_forwardData.descriptorSet = std::make_shared<DescriptorSet>(pipelineDesc.shader, 0);
+	m_forwardData.descriptorSet->setUniform(m_sceneUBO, 0);
+	m_forwardData.descriptorSet->setTexture(m_shadowData.texture, 1);
+	m_forwardData.descriptorSet->setTexture(m_ssaoPass.texture, 2);
+
+	// cube map
+	const char* faces[6] = {
+		"skybox/right.jpg",
+		"skybox/left.jpg",
+		"skybox/top.jpg",
+		"skybox/bottom.jpg",
+		"skybox/front.jpg",
+		"skybox/back.jpg"
+	};
+	m_skyBoxData.cubeMap = std::make_shared<CubeMap>(faces);
+	pipelineDesc.shader = std::make_shared<Shader>("spv/cubeMapVert.spv", "spv/cubeMapFrag.spv");
+	pipelineDesc.sampleCount = VK_SAMPLE_COUNT_8_BIT;
+	pipelineDesc.clear = false;
+	pipelineDesc.attachmentInfos = {
+		{ m_forwardData.colorTexture},
+		{ m_forwardData.depthTexture},
+		{ m_forwardData.resolveTexture, true} };
+
+	m_skyBoxData.pipeline = std::make_shared<Pipeline>(pipelineDesc);
+	m_skyBoxData.descriptorSet = std::make_shared<DescriptorSet>(pipelineDesc.shader, 0);
+	m_skyBoxData.descriptorSet->setUniform(m_sceneUBO, 0);
+	m_skyBoxData.descriptorSet->setTexture(m_skyBoxData.cubeMap, 1);
+
+	// bloom
+	pipelineDesc.shader = std::make_shared<Shader>("spv/screenVert.spv", "spv/bloomFrag.spv");
+	pipelineDesc.sampleCount = VK_SAMPLE_COUNT_1_BIT;
+	pipelineDesc.clear = true; // ?
+	pipelineDesc.attachmentInfos = { { m_bloomData.mipChain[0] } };
+	pipelineDesc.swapchain = nullptr;
+	pipelineDesc.createFramebuffers = false;
+	pipelineDesc.blendMode = BlendMode::DEFAULT;
+	m_bloomData.pipeline = std::make_shared<Pipeline>(pipelineDesc);
+
+	for (int i = 0; i < mipChainLength; i++) {
+		for (int j = 0; j < MAX_FRAMES_IN_FLIGHT; j++) {
+			m_bloomData.framebuffers[j][i] = std::make_shared<Framebuffer>(
+				std::vector<std::shared_ptr<Texture>>{ m_bloomData.mipChain[i][j] },
+				m_bloomData.pipeline->getRenderPass()
+			);
+		}
+	}
+
+	for (int i = 0; i<mipChainLength+1; i++) {	// +1 counting resolve
+		m_bloomData.descriptorSets[i] = std::make_shared<DescriptorSet>(pipelineDesc.shader, 0);
+		if (i == 0) {
+			m_bloomData.descriptorSets[i]->setTexture(m_forwardData.resolveTexture, 0);
+		} else {
+			m_bloomData.descriptorSets[i]->setTexture(m_bloomData.mipChain[i-1], 0);
+		}
+
+	}
+	// tone mapping
+	pipelineDesc.shader = std::make_shared<Shader>("spv/screenVert.spv", "spv/toneMappingFrag.spv");
+	pipelineDesc.sampleCount = VK_SAMPLE_COUNT_1_BIT;
+	pipelineDesc.clear = true;
+	pipelineDesc.attachmentInfos = { { m_toneMappingData.texture } };
+	pipelineDesc.swapchain = nullptr;
+	pipelineDesc.createFramebuffers = true;
+	pipelineDesc.blendMode = BlendMode::DEFAULT;
+	m_toneMappingData.pipeline = std::make_shared<Pipeline>(pipelineDesc);
+	
+	m_toneMappingData.descriptorSet = std::make_shared<DescriptorSet>(pipelineDesc.shader, 0);
+	m_toneMappingData.descriptorSet->setTexture(m_forwardData.resolveTexture, 0);
+	m_toneMappingData.descriptorSet->setTexture(m_bloomData.mipChain[0], 1);
+
+	// post process
+	pipelineDesc.shader = std::make_shared<Shader>("spv/screenVert.spv", "spv/postProcessFrag.spv");
+	pipelineDesc.sampleCount = VK_SAMPLE_COUNT_1_BIT;
+	pipelineDesc.clear = true;
+	pipelineDesc.attachmentInfos = { { m_swapchain->m_swapchainTextures[0] } };
+	pipelineDesc.swapchain = m_swapchain;
+	pipelineDesc.createFramebuffers = true;
+
+	m_postProcessData.pipeline = std::make_shared<Pipeline>(pipelineDesc);
+	m_postProcessData.descriptorSet = std::make_shared<DescriptorSet>(pipelineDesc.shader, 0);
+	m_postProcessData.descriptorSet->setTexture(m_toneMappingData.texture, 0);
+
+	// bound in place of the outputs of disabled passes : unshadowed, unoccluded, no bloom
+	uint8_t white[4] = { 255, 255, 255, 255 };
+	uint8_t black[4] = { 0, 0, 0, 255 };
+	m_whiteTexture = std::make_shared<Texture2D>(white, 1, 1);
+	m_blackTexture = std::make_shared<Texture2D>(black, 1, 1);
+
+	// gpu driven path : the depth, shadow and forward pipelines again with the INDIRECT_DRAW vertex shaders,
+	// used inside the render passes of the pipelines above
+	if (Device::get()->supportsMultiDrawIndirect()) {
+		m_indirectData.scene = std::make_shared<IndirectScene>(*m_scene.geometry, IndirectData::viewCount);
+		m_indirectData.scene->build(m_scene.models);
+
+		pipelineDesc.swapchain = nullptr;
+		pipelineDesc.createFramebuffers = false;
+		pipelineDesc.blendMode = BlendMode::DEFAULT;
+		pipelineDesc.clear = true;
+
+		pipelineDesc.shader = std::make_shared<Shader>(getVertexShaderPath("depthPrePass", vertexFormat, VertexTransform::INDIRECT).c_str(), "spv/depthPrePassFrag.spv");
+		pipelineDesc.sampleCount = VK_SAMPLE_COUNT_1_BIT;
+		pipelineDesc.attachmentInfos = { { m_depthPrePass.texture } };
+		m_indirectData.depthPipeline = std::make_shared<Pipeline>(pipelineDesc);
+		m_indirectData.depthDescriptorSet = std::make_shared<DescriptorSet>(pipelineDesc.shader, 0);
+		m_indirectData.depthDescriptorSet->setUniform(m_sceneUBO, 0);
+
+		pipelineDesc.shader = std::make_shared<Shader>(getVertexShaderPath("shadowMap", vertexFormat, VertexTransform::INDIRECT).c_str(), "spv/shadowMapFrag.spv");
+		pipelineDesc.sampleCount = VK_SAMPLE_COUNT_1_BIT;
+		pipelineDesc.attachmentInfos = { { m_shadowData.texture } };
+		m_indirectData.shadowPipeline = std::make_shared<Pipeline>(pipelineDesc);
+		m_indirectData.shadowDescriptorSet = std::make_shared<DescriptorSet>(pipelineDesc.shader, 0);
+		m_indirectData.shadowDescriptorSet->setUniform(m_sceneUBO, 0);
+
+		pipelineDesc.shader = std::make_shared<Shader>(getVertexShaderPath("basic", vertexFormat, VertexTransform::INDIRECT).c_str(), "spv/pbrFrag.spv");
+		pipelineDesc.sampleCount = VK_SAMPLE_COUNT_8_BIT;
+		pipelineDesc.attachmentInfos = {
+			{ m_forwardData.colorTexture},
+			{ m_forwardData.depthTexture},
+			{ m_forwardData.resolveTexture, true} };
+		m_indirectData.forwardPipeline = std::make_shared<Pipeline>(pipelineDesc);
+		m_indirectData.forwardDescriptorSet = std::make_shared<DescriptorSet>(pipelineDesc.shader, 0);
+		m_indirectData.forwardDescriptorSet->setUniform(m_sceneUBO, 0);
+		m_indirectData.forwardDescriptorSet->setTexture(m_shadowData.texture, 1);
+		m_indirectData.forwardDescriptorSet->setTexture(m_ssaoPass.texture, 2);
+
+		for (uint32_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
+			Buffer& instances = m_indirectData.scene->getInstanceBuffer(i);
+			m_indirectData.depthDescriptorSet->setStorageBuffer(instances, 8, i);
+			m_indirectData.shadowDescriptorSet->setStorageBuffer(instances, 8, i);
+			m_indirectData.forwardDescriptorSet->setStorageBuffer(instances, 8, i);
+		}
+	} else {
+		m_settings.gpuDriven = false;
+	}
+
+	// instanced models : the same pipelines with the INSTANCED_DRAW vertex shaders, reading the frame's transforms
+	if (!m_scene.instancedModels.empty()) {
+		m_instancedData.buffer = std::make_shared<InstanceBuffer>(InstancedData::capacity);
+
+		pipelineDesc.swapchain = nullptr;
+		pipelineDesc.createFramebuffers = false;
+		pipelineDesc.blendMode = BlendMode::DEFAULT;
+		pipelineDesc.clear = true;
+
+		pipelineDesc.shader = std::make_shared<Shader>(getVertexShaderPath("depthPrePass", vertexFormat, VertexTransform::INSTANCED).c_str(), "spv/depthPrePassFrag.spv");
+		pipelineDesc.sampleCount = VK_SAMPLE_COUNT_1_BIT;
+		pipelineDesc.attachmentInfos = { { m_depthPrePass.texture } };
+		m_instancedData.depthPipeline = std::make_shared<Pipeline>(pipelineDesc);
+		m_instancedData.depthDescriptorSet = std::make_shared<DescriptorSet>(pipelineDesc.shader, 0);
+		m_instancedData.depthDescriptorSet->setUniform(m_sceneUBO, 0);
+
+		pipelineDesc.shader = std::make_shared<Shader>(getVertexShaderPath("shadowMap", vertexFormat, VertexTransform::INSTANCED).c_str(), "spv/shadowMapFrag.spv");
+		pipelineDesc.sampleCount = VK_SAMPLE_COUNT_1_BIT;
+		pipelineDesc.attachmentInfos = { { m_shadowData.texture } };
+		m_instancedData.shadowPipeline = std::make_shared<Pipeline>(pipelineDesc);
+		m_instancedData.shadowDescriptorSet = std::make_shared<DescriptorSet>(pipelineDesc.shader, 0);
+		m_instancedData.shadowDescriptorSet->setUniform(m_sceneUBO, 0);
+
+		pipelineDesc.shader = std::make_shared<Shader>(getVertexShaderPath("basic", vertexFormat, VertexTransform::INSTANCED).c_str(), "spv/pbrFrag.spv");
+		pipelineDesc.sampleCount = VK_SAMPLE_COUNT_8_BIT;
+		pipelineDesc.attachmentInfos = {
+			{ m_forwardData.colorTexture},
+			{ m_forwardData.depthTexture},
+			{ m_forwardData.resolveTexture, true} };
+		m_instancedData.forwardPipeline = std::make_shared<Pipeline>(pipelineDesc);
+		m_instancedData.forwardDescriptorSet = std::make_shared<DescriptorSet>(pipelineDesc.shader, 0);
+		m_instancedData.forwardDescriptorSet->setUniform(m_sceneUBO, 0);
+		m_instancedData.forwardDescriptorSet->setTexture(m_shadowData.texture, 1);
+		m_instancedData.forwardDescriptorSet->setTexture(m_ssaoPass.texture, 2);
+
+		for (uint32_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
+			Buffer& transforms = m_instancedData.buffer->getBuffer(i);
+			m_instancedData.depthDescriptorSet->setStorageBuffer(transforms, 9, i);
+			m_instancedData.shadowDescriptorSet->setStorageBuffer(transforms, 9, i);
+			m_instancedData.forwardDescriptorSet->setStorageBuffer(transforms, 9, i);
+		}
+	}
+
+}
+
+SceneRenderer::~SceneRenderer() {
+}
+
+void SceneRenderer::setCamera(const glm::vec3& position, const glm::vec3& front, const glm::vec3& up) {
+	m_sceneData.view = glm::lookAt(position, position + front, up);
+	m_sceneData.proj = glm::perspective(glm::radians(90.0f), 1280.0f / 720.0f, 0.1f, m_forwardData.farPlane);
+	m_sceneData.proj[1][1] *= -1;
+	m_sceneData.camPos = glm::vec4(position, 1);
+	m_sceneData.lightSpace = m_shadowData.lightSpace;
+	m_sceneData.lights[0].position = glm::vec4(m_shadowData.lightPos, 1.0f);
+	m_sceneData.lights[0].color = glm::vec4(1.0f, 1.0f, 1.0f, 0.0f)*1000.f;
+	m_sceneData.lights[1].position = glm::vec4(0,5,0, 1.0f);
+	m_sceneData.lights[1].color = glm::vec4(1.f,0.5f,0.85f,0.f)*500.f;
+}
+
+void SceneRenderer::update() {
+	m_sceneUBO[m_swapchain->getCurrentFrameIndex()].setData(&m_sceneData, sizeof(m_sceneData));
+	updateBounds();
+}
+
+void SceneRenderer::beginFrame() {
+	for (auto& mip : m_bloomData.mipChain) {
+		//mip->clear({0,1,0,1});
+		//mip->transitionImageLayout(VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+	}
+
+	readHiZ();
+	m_recorder->beginFrame(m_swapchain->getCurrentFrameIndex());
+	if (m_instancedData.buffer)
+		m_instancedData.buffer->begin(m_swapchain->getCurrentFrameIndex());
+}
+
+void SceneRenderer::render(const std::shared_ptr<CommandBuffer>& commandBuffer) {
+	m_commandBuffer = commandBuffer;
+	if (getRenderGraphKey() != m_renderGraphKey)
+		buildRenderGraph();
+
+	// cpu time spent recording from the culling to the end of the forward pass
+	m_recordStart = std::chrono::high_resolution_clock::now();
+	if (m_settings.gpuDriven)
+		cullIndirect();
+	m_renderGraph.setImage("swapchain", m_swapchain->m_swapchainTextures[m_swapchain->getCurrentImageIndex()]);
+	m_renderGraph.execute(*m_commandBuffer, m_swapchain->getCurrentFrameIndex());
+}
+
+void SceneRenderer::gui() {
+	ImGui::Checkbox("SSAO", &m_settings.enableSSAO);
+	ImGui::Checkbox("Bloom", &m_settings.enableBloom);
+	ImGui::Checkbox("Shadow", &m_settings.enableShadow);
+	ImGui::Checkbox("SkyBox", &m_settings.enableSkyBox);
+	ImGui::Checkbox("BVH culling", &m_settings.bvhCulling);
+	ImGui::Text("bvh: %u meshes, %u nodes, sah cost %.1f", m_bvh.getItemCount(), m_bvh.getNodeCount(), m_bvh.getSahCost());
+	ImGui::Checkbox("Cluster culling", &m_settings.clusterCulling);
+	ImGui::Checkbox("Occlusion culling", &m_settings.occlusionCulling);
+	ImGui::Checkbox("Software occlusion", &m_settings.softwareOcclusion);
+	ImGui::Text("software occlusion: forward %.2f ms, shadow %.2f ms", m_forwardData.occlusion.milliseconds, m_shadowData.occlusion.milliseconds);
+	if (m_indirectData.scene) {
+		ImGui::Checkbox("GPU driven", &m_settings.gpuDriven);
+		ImGui::Text("indirect: %u instances in %u batches, %s", m_indirectData.scene->getInstanceCount(), m_indirectData.scene->getBatchCount(),
+			m_indirectData.scene->isCompact() ? "draw counts from the gpu" : "culled draws keep no instance");
+	}
+	if (m_instancedData.buffer) {
+		uint32_t instanceCount = 0;
+		for (auto& model : m_scene.instancedModels)
+			instanceCount += model->getInstanceCount();
+		ImGui::Text("instanced: %zu models, %u instances, %u / %u transforms written", m_scene.instancedModels.size(), instanceCount,
+			m_instancedData.buffer->getCount(), m_instancedData.buffer->getCapacity());
+	}
+	ImGui::Text("geometry recording: %.3f ms", m_geometryRecordTime);
+	ImGui::Text("render graph: %u image barriers in %u batches", m_renderGraph.getBarrierCount(), m_renderGraph.getBatchCount());
+	const RenderGraph::MemoryStats& graphMemory = m_renderGraph.getMemoryStats();
+	ImGui::Text("transient targets: %u in %.1f MB instead of %.1f MB, %.1f MB saved", graphMemory.transientCount,
+		graphMemory.aliasedBytes / (1024.f * 1024.f), graphMemory.separateBytes / (1024.f * 1024.f),
+		(graphMemory.separateBytes - graphMemory.aliasedBytes) / (1024.f * 1024.f));
+	for (const RenderGraph::PassStats& pass : m_renderGraph.getPassStats()) {
+		if (pass.culled)
+			ImGui::Text("  %s: culled", pass.name.c_str());
+		else
+			ImGui::Text("  %s: %.3f ms, %u barriers", pass.name.c_str(), pass.milliseconds, pass.barrierCount);
+	}
+	ImGui::Checkbox("Parallel recording", &m_settings.parallelRecording);
+	ImGui::SameLine();
+	ImGui::Text("%u threads", m_recorder->getThreadCount());
+	ImGui::Checkbox("Draw sorting", &m_settings.drawSorting);
+	ImGui::Text("forward queue: %zu draws sorted in %.3f ms", m_renderQueue.size(), m_forwardData.sortMilliseconds);
+	ImGui::Checkbox("LOD selection", &m_settings.lodSelection);
+	ImGui::SliderFloat("LOD pixel error", &m_settings.lodPixelError, 0.25f, 16.0f);
+	ImGui::SliderFloat("Shadow LOD bias", &m_settings.shadowLodBias, 1.0f, 16.0f);
+	auto cullingText = [](const char* pass, const CullingStats& stats) {
+		ImGui::Text("%s: %u / %u meshes (%u bvh nodes), %u / %u meshlets (%u frustum, %u backface culled), %u draws, %u triangles", pass,
+			stats.visibleMeshes, stats.meshCount, stats.bvhNodesVisited, stats.visibleMeshlets, stats.meshletCount, stats.frustumCulled, stats.backfaceCulled, stats.drawCount, stats.triangleCount);
+		ImGui::Text("  %u descriptor set binds requested", stats.descriptorSetBinds);
+		ImGui::Text("  occluded: %u meshes, %u meshlets, %u occluders (%u triangles)", stats.occludedMeshes, stats.occludedMeshlets, stats.occluderCount, stats.occluderTriangles);
+		static_assert(MAX_MESH_LODS == 5, "one value per lod below");
+		ImGui::Text("  meshes per lod: %u %u %u %u %u",
+			stats.lodMeshes[0], stats.lodMeshes[1], stats.lodMeshes[2], stats.lodMeshes[3], stats.lodMeshes[4]);
+	};
+	cullingText("depth", m_depthPrePass.cullingStats);
+	cullingText("shadow", m_shadowData.cullingStats);
+	cullingText("forward", m_forwardData.cullingStats);
+}
+
+void SceneRenderer::printStats() const {
+	auto printCulling = [](const char* pass, const CullingStats& stats) {
+		static_assert(MAX_MESH_LODS == 5, "one value per lod below");
+		printf("  %s: %u draws, %u triangles, meshes per lod %u %u %u %u %u\n", pass, stats.drawCount, stats.triangleCount,
+			stats.lodMeshes[0], stats.lodMeshes[1], stats.lodMeshes[2], stats.lodMeshes[3], stats.lodMeshes[4]);
+		printf("    %u / %u meshes visible (%u bvh nodes), %u / %u meshlets (%u frustum, %u backface culled)\n",
+			stats.visibleMeshes, stats.meshCount, stats.bvhNodesVisited, stats.visibleMeshlets, stats.meshletCount, stats.frustumCulled, stats.backfaceCulled);
+		printf("    %u descriptor set binds\n", stats.descriptorSetBinds);
+		printf("    occluded: %u meshes, %u meshlets, %u occluders (%u triangles)\n",
+			stats.occludedMeshes, stats.occludedMeshlets, stats.occluderCount, stats.occluderTriangles);
+	};
+	printCulling("depth", m_depthPrePass.cullingStats);
+	printCulling("shadow", m_shadowData.cullingStats);
+	printCulling("forward", m_forwardData.cullingStats);
+	if (m_settings.drawSorting)
+		printf("  forward queue: %zu draws sorted in %.3f ms\n", m_renderQueue.size(), m_forwardData.sortMilliseconds);
+	else
+		printf("  forward queue: off, draws recorded in scene order\n");
+	printf("  occlusion culling: hi-z %s, software forward %.2f ms, shadow %.2f ms\n",
+		!m_settings.occlusionCulling ? "off" : m_forwardData.hiZOcclusion ? "used" : "skipped, the view or the scene moved",
+		m_forwardData.occlusion.milliseconds, m_shadowData.occlusion.milliseconds);
+}
+
+void SceneRenderer::createRenderTargets() {
+	// depth pre-pass
+	m_depthPrePass.texture = FrameResource<Texture2D>::create(m_settings.perFrameRenderTargets, [] {
+		auto texture = std::make_shared<DepthTexture>(1280, 720, VK_SAMPLE_COUNT_1_BIT, true);
+		texture->createSampler();
+		return texture;
+	});
+
+	// ssao
+	m_ssaoPass.texture = FrameResource<Texture2D>::create(m_settings.perFrameRenderTargets, [] {
+		auto texture = std::make_shared<Texture2D>(TextureType::COLOR, 1280, 720, VK_FORMAT_B10G11R11_UFLOAT_PACK32, VK_SAMPLE_COUNT_1_BIT);
+		texture->createImage(VK_IMAGE_TILING_OPTIMAL,
+			VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT,
+			VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, true);
+		texture->createImageView(VK_IMAGE_ASPECT_COLOR_BIT);
+		texture->createSampler();
+		return texture;
+	});
+
+	// hi-z
+	uint32_t hiZWidth = 1280, hiZHeight = 720;
+	for (uint32_t i = 0; i < hiZLevelCount; i++) {
+		hiZWidth = std::max(hiZWidth / 2, 1u);
+		hiZHeight = std::max(hiZHeight / 2, 1u);
+		m_hiZData.levels[i] = std::make_shared<Texture2D>(TextureType::COLOR, hiZWidth, hiZHeight, VK_FORMAT_R32_SFLOAT, VK_SAMPLE_COUNT_1_BIT);
+		m_hiZData.levels[i]->createImage(VK_IMAGE_TILING_OPTIMAL,
+			VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT,
+			VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+		m_hiZData.levels[i]->createImageView(VK_IMAGE_ASPECT_COLOR_BIT);
+		m_hiZData.levels[i]->createSampler(VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE);
+	}
+
+	// shadow
+	m_shadowData.texture = std::make_shared<DepthTexture>(m_shadowData.resolution, m_shadowData.resolution);
+	m_shadowData.texture->createSampler();
+
+	// forward scene, 8x msaa resolved
+	m_forwardData.depthTexture = FrameResource<Texture2D>::create(m_settings.perFrameRenderTargets, [] {
+		return std::make_shared<DepthTexture>(1280, 720, VK_SAMPLE_COUNT_8_BIT, true);
+	});
+
+	m_forwardData.colorTexture = FrameResource<Texture2D>::create(m_settings.perFrameRenderTargets, [] {
+		auto texture = std::make_shared<Texture2D>(TextureType::COLOR, 1280, 720, VK_FORMAT_B10G11R11_UFLOAT_PACK32, VK_SAMPLE_COUNT_8_BIT);
+		texture->createImage(VK_IMAGE_TILING_OPTIMAL,
+			VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT,
+			VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, true);
+		texture->createImageView(VK_IMAGE_ASPECT_COLOR_BIT);
+		return texture;
+	});
+
+	m_forwardData.resolveTexture = FrameResource<Texture2D>::create(m_settings.perFrameRenderTargets, [] {
+		auto texture = std::make_shared<Texture2D>(TextureType::COLOR, 1280, 720, VK_FORMAT_B10G11R11_UFLOAT_PACK32, VK_SAMPLE_COUNT_1_BIT);
+		texture->createImage(VK_IMAGE_TILING_OPTIMAL,
+			VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT,
+			VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, true);
+		texture->createImageView(VK_IMAGE_ASPECT_COLOR_BIT);
+		texture->createSampler();
+		return texture;
+	});
+
+	// bloom
+	float mutl = 1;
+	for (int i = 0; i < mipChainLength; i++) {
+		m_bloomData.mipChain[i] = FrameResource<Texture2D>::create(m_settings.perFrameRenderTargets, [mutl] {
+			auto texture = std::make_shared<Texture2D>(TextureType::COLOR, 1280 * mutl, 720 * mutl, VK_FORMAT_B10G11R11_UFLOAT_PACK32, VK_SAMPLE_COUNT_1_BIT);
+			texture->createImage(VK_IMAGE_TILING_OPTIMAL,
+				VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT,
+				VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, true);
+			texture->createImageView(VK_IMAGE_ASPECT_COLOR_BIT);
+			texture->createSampler(VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE);
+			return texture;
+		});
+		mutl *= 0.5f;
+	}
+
+	// tone mapping
+	m_toneMappingData.texture = FrameResource<Texture2D>::create(m_settings.perFrameRenderTargets, [] {
+		auto texture = std::make_shared<Texture2D>(TextureType::COLOR, 1280, 720, VK_FORMAT_B8G8R8A8_UNORM, VK_SAMPLE_COUNT_1_BIT);
+		texture->createImage(VK_IMAGE_TILING_OPTIMAL,
+			VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT,
+			VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, true);
+		texture->createImageView(VK_IMAGE_ASPECT_COLOR_BIT);
+		texture->createSampler();
+		return texture;
+	});
+
+	// the lifetimes are those of the graph with every pass, the graphs of fewer passes keep within them
+	declareRenderGraph(GRAPH_ALL);
+	m_renderGraph.compile();
+	m_renderGraph.allocateTransients(m_settings.renderTargetAliasing);
+	m_renderGraph.printStats();
+}
+
+void SceneRenderer::updateBounds() {
+	size_t meshCount = 0;
+	for (auto& model : m_scene.models) {
+		for (auto mesh : model->m_meshes)
+			meshCount += mesh->m_material != nullptr;
+	}
+
+	if (meshCount != m_meshBounds.size() || m_boundsMatrices.size() != m_scene.models.size()) {
+		m_meshBounds.clear();
+		m_boundsMatrices.clear();
+		m_boundsMeshes.clear();
+		m_boundsModels.clear();
+		for (size_t i = 0; i < m_scene.models.size(); i++) {
+			const Model& model = *m_scene.models[i];
+			m_boundsMatrices.push_back(model.m_modelMatrix);
+			for (auto mesh : model.m_meshes) {
+				if (mesh->m_material == nullptr)
+					continue;
+				m_meshBounds.add(*mesh, model.m_modelMatrix);
+				m_boundsMeshes.push_back(mesh.get());
+				m_boundsModels.push_back(static_cast<uint32_t>(i));
+			}
+		}
+		rebuildBvh();
+		m_boundsVersion++;
+		return;
+	}
+
+	size_t meshIndex = 0;
+	bool moved = false;
+	for (size_t i = 0; i < m_scene.models.size(); i++) {
+		const Model& model = *m_scene.models[i];
+		bool changed = model.m_modelMatrix != m_boundsMatrices[i];
+		m_boundsMatrices[i] = model.m_modelMatrix;
+		for (auto mesh : model.m_meshes) {
+			if (mesh->m_material == nullptr)
+				continue;
+			if (changed) {
+				m_meshBounds.set(meshIndex, *mesh, model.m_modelMatrix);
+				m_bvh.update(static_cast<uint32_t>(meshIndex), m_meshBounds.getBox(meshIndex));
+			}
+			meshIndex++;
+		}
+		moved |= changed;
+	}
+
+	if (moved)
+		m_boundsVersion++;
+	if (moved && m_bvh.needsRebuild())
+		rebuildBvh();
+}
+
+void SceneRenderer::rebuildBvh() {
+	std::vector<Aabb> boxes(m_meshBounds.size());
+	for (size_t i = 0; i < boxes.size(); i++)
+		boxes[i] = m_meshBounds.getBox(i);
+	m_bvh.build(boxes.data(), static_cast<uint32_t>(boxes.size()));
+}
+
+void SceneRenderer::cullScene(const Frustum& frustum, CullingStats& stats) {
+	if (!m_settings.bvhCulling) {
+		cullBounds(frustum, m_meshBounds, m_visibleMeshes, stats);
+		return;
+	}
+
+	m_visibleItems.clear();
+	m_bvh.queryFrustum(frustum, m_visibleItems, &stats.bvhNodesVisited);
+	m_visibleMeshes.assign(m_meshBounds.size(), 0);
+	for (uint32_t item : m_visibleItems)
+		m_visibleMeshes[item] = 1;
+	stats.meshCount += static_cast<uint32_t>(m_meshBounds.size());
+	stats.visibleMeshes += static_cast<uint32_t>(m_visibleItems.size());
+}
+
+void SceneRenderer::pick(const glm::vec3& origin, const glm::vec3& direction) {
+	float distance = 0.f;
+	uint32_t item = m_bvh.raycast(origin, direction, 1000.0f, &distance);
+	if (item == Bvh::INVALID_ITEM) {
+		printf("picked nothing\n");
+		return;
+	}
+
+	// bvh items are m_meshBounds entries
+	const Mesh& mesh = *m_boundsMeshes[item];
+	printf("picked a mesh of model %u, %u triangles, %.2f units away\n", m_boundsModels[item], mesh.m_lods[0].indexCount / 3, distance);
+}
+
+bool SceneRenderer::cullMesh(const Mesh& mesh, const CullView& view, float maxPixelError, std::vector<IndexRange>& ranges, CullingStats& stats) {
+	uint32_t level = m_settings.lodSelection ? selectLod(mesh, view, maxPixelError) : 0;
+	const MeshLod& lod = mesh.m_lods[level];
+	stats.lodMeshes[level]++;
+
+	ranges.clear();
+	if (lod.meshletCount == 0 || !m_settings.clusterCulling) {
+		ranges.push_back({ lod.firstIndex, lod.indexCount });
+		return true;
+	}
+
+	cullMeshlets(mesh.m_meshlets.data() + lod.meshletOffset, lod.meshletCount, view, ranges, stats);
+	return !ranges.empty();
+}
+
+void SceneRenderer::gatherPassMeshes(const glm::mat4& viewProjection, const glm::vec3& position, bool perspective, float lodScale, const DepthPyramid* occlusion) {
+	m_passMeshes.clear();
+	for (uint32_t i = 0; i < m_visibleMeshes.size(); i++) {
+		if (m_visibleMeshes[i])
+			m_passMeshes.push_back(i);
+	}
+
+	m_modelViews.resize(m_scene.models.size());
+	for (size_t i = 0; i < m_scene.models.size(); i++) {
+		m_modelViews[i] = CullView::create(viewProjection, position, m_scene.models[i]->m_modelMatrix, perspective, lodScale);
+		if (occlusion)
+			m_modelViews[i].setOcclusion(*occlusion, m_scene.models[i]->m_modelMatrix);
+	}
+}
+
+uint32_t SceneRenderer::getChunkCount(size_t itemCount) const {
+	if (!m_settings.parallelRecording)
+		return 1;
+	const size_t minChunkSize = 64;
+	size_t chunkCount = std::min<size_t>(ThreadPool::get().getThreadCount() * 2, (itemCount + minChunkSize - 1) / minChunkSize);
+	return static_cast<uint32_t>(std::max<size_t>(chunkCount, 1));
+}
+
+size_t SceneRenderer::getChunkBegin(size_t itemCount, uint32_t chunk, uint32_t chunkCount) {
+	return itemCount * chunk / chunkCount;
+}
+
+void SceneRenderer::beginChunks(uint32_t chunkCount) {
+	if (m_recordChunks.size() < chunkCount)
+		m_recordChunks.resize(chunkCount);
+	for (uint32_t i = 0; i < chunkCount; i++) {
+		RecordChunk& chunk = m_recordChunks[i];
+		chunk.visibleRanges.clear();
+		chunk.queuedDraws.clear();
+		chunk.queuedRanges.clear();
+		chunk.queuedItems.clear();
+		chunk.stats = CullingStats{};
+	}
+}
+
+void SceneRenderer::addChunkStats(uint32_t chunkCount, CullingStats& stats) {
+	for (uint32_t i = 0; i < chunkCount; i++)
+		stats.add(m_recordChunks[i].stats);
+}
+
+void SceneRenderer::recordChunks(uint32_t chunkCount, const std::function<void(CommandBuffer&, uint32_t)>& record) {
+	if (m_settings.parallelRecording) {
+		m_recorder->record(*m_commandBuffer, chunkCount, record);
+		return;
+	}
+	for (uint32_t i = 0; i < chunkCount; i++)
+		record(*m_commandBuffer, i);
+}
+
+void SceneRenderer::cullIndirect() {
+	uint32_t frameIndex = m_swapchain->getCurrentFrameIndex();
+	IndirectScene& scene = *m_indirectData.scene;
+	scene.update(m_scene.models, frameIndex);
+
+	glm::mat4 viewProjection = m_sceneData.proj * m_sceneData.view;
+	float pixelError = m_settings.lodSelection ? m_settings.lodPixelError : -1.0f;
+	CullView camera = CullView::create(viewProjection, glm::vec3(m_sceneData.camPos), glm::mat4(1.0f), true, CullView::getLodScale(m_sceneData.proj, 720.0f));
+	scene.cull(*m_commandBuffer, frameIndex, IndirectData::cameraView, camera, pixelError);
+
+	if (m_settings.enableShadow) {
+		float shadowLodScale = CullView::getLodScale(m_shadowData.lightProjection, static_cast<float>(m_shadowData.resolution));
+		CullView light = CullView::create(m_shadowData.lightSpace, m_shadowData.lightPos, glm::mat4(1.0f), false, shadowLodScale);
+		scene.cull(*m_commandBuffer, frameIndex, IndirectData::shadowView, light, pixelError * m_settings.shadowLodBias);
+	}
+}
+
+void SceneRenderer::drawIndirect(const std::shared_ptr<Pipeline>& pipeline, const DescriptorSet& descriptorSet, uint32_t view, bool materials, uint32_t width, uint32_t height, CullingStats& stats) {
+	uint32_t frameIndex = m_swapchain->getCurrentFrameIndex();
+	m_commandBuffer->bindPipeline(pipeline);
+	m_commandBuffer->updateViewport(width, height);
+	m_scene.geometry->bind(*m_commandBuffer, *pipeline);
+
+	VkPipelineLayout layout = pipeline->getShader()->getPipelineLayout();
+	VkDescriptorSet sceneDescriptorSet = descriptorSet.getHandle(frameIndex);
+	m_commandBuffer->bindDescriptorSets(VK_PIPELINE_BIND_POINT_GRAPHICS, layout, 0, 1, &sceneDescriptorSet);
+	m_indirectData.scene->draw(*m_commandBuffer, frameIndex, view, materials ? layout : VK_NULL_HANDLE);
+
+	stats = CullingStats{};
+	stats.meshCount = m_indirectData.scene->getInstanceCount();
+	stats.drawCount = m_indirectData.scene->getBatchCount();
+}
+
+void SceneRenderer::drawInstanced(CommandBuffer& commands, const std::shared_ptr<Pipeline>& pipeline, const std::shared_ptr<DescriptorSet>& descriptorSet, const glm::mat4& viewProjection,
+	const glm::vec3& position, bool perspective, float lodScale, float maxPixelError, bool materials, uint32_t width, uint32_t height, CullingStats& stats) {
+	if (m_scene.instancedModels.empty())
+		return;
+	uint32_t frameIndex = m_swapchain->getCurrentFrameIndex();
+	commands.bindPipeline(pipeline);
+	commands.updateViewport(width, height);
+	m_scene.geometry->bind(commands, *pipeline);
+
+	VkPipelineLayout layout = pipeline->getShader()->getPipelineLayout();
+	VkDescriptorSet sceneDescriptorSet = descriptorSet->getHandle(frameIndex);
+	commands.bindDescriptorSets(VK_PIPELINE_BIND_POINT_GRAPHICS, layout, 0, 1, &sceneDescriptorSet);
+	stats.descriptorSetBinds++;
+
+	Frustum frustum = Frustum::fromMatrix(viewProjection);
+	float pixelError = m_settings.lodSelection ? maxPixelError : -1.0f;
+	for (auto& model : m_scene.instancedModels) {
+		model->cull(frustum, position, perspective, lodScale, pixelError, *m_instancedData.buffer, stats);
+		model->draw(commands, *m_scene.geometry, frameIndex, *pipeline->getShader(), materials ? layout : VK_NULL_HANDLE, stats);
+	}
+}
+
+void SceneRenderer::drawRanges(CommandBuffer& commands, const Mesh& mesh, const IndexRange* ranges, size_t rangeCount, CullingStats& stats) {
+	for (size_t i = 0; i < rangeCount; i++) {
+		m_scene.geometry->draw(commands, *mesh.m_geometry, ranges[i].firstIndex, ranges[i].indexCount);
+		stats.triangleCount += ranges[i].indexCount / 3;
+	}
+	stats.drawCount += static_cast<uint32_t>(rangeCount);
+}
+
+void SceneRenderer::drawPassMeshes(CommandBuffer& commands, RecordChunk& chunk, size_t begin, size_t end, float maxPixelError) {
+	for (size_t i = begin; i < end; i++) {
+		uint32_t bounds = m_passMeshes[i];
+		const Mesh& mesh = *m_boundsMeshes[bounds];
+		uint32_t model = m_boundsModels[bounds];
+		if (!cullMesh(mesh, m_modelViews[model], maxPixelError, chunk.visibleRanges, chunk.stats))
+			continue;
+
+		MeshConstants constants = mesh.getConstants(m_scene.models[model]->m_modelMatrix);
+		commands.pushConstants(*m_forwardData.shader, &constants);
+		drawRanges(commands, mesh, chunk.visibleRanges.data(), chunk.visibleRanges.size(), chunk.stats);
+	}
+}
+
+void SceneRenderer::queueForward(RecordChunk& chunk, const Mesh& mesh, const glm::mat4& model, float depth) {
+	uint32_t draw = static_cast<uint32_t>(chunk.queuedDraws.size());
+	chunk.queuedDraws.push_back({ &mesh, &model, static_cast<uint32_t>(chunk.queuedRanges.size()), static_cast<uint32_t>(chunk.visibleRanges.size()) });
+	chunk.queuedRanges.insert(chunk.queuedRanges.end(), chunk.visibleRanges.begin(), chunk.visibleRanges.end());
+	uint32_t geometry = mesh.m_geometry->getIndexType() == VK_INDEX_TYPE_UINT16 ? 0 : 1;
+	chunk.queuedItems.push_back({ RenderQueue::makeKey(0, mesh.m_material->m_id, geometry, depth), draw });
+}
+
+void SceneRenderer::sortForwardQueue(uint32_t chunkCount) {
+	auto start = std::chrono::high_resolution_clock::now();
+	m_renderQueue.clear();
+	m_queuedDraws.clear();
+	m_queuedRanges.clear();
+	for (uint32_t i = 0; i < chunkCount; i++) {
+		const RecordChunk& chunk = m_recordChunks[i];
+		uint32_t firstDraw = static_cast<uint32_t>(m_queuedDraws.size());
+		uint32_t firstRange = static_cast<uint32_t>(m_queuedRanges.size());
+		for (QueuedDraw draw : chunk.queuedDraws) {
+			draw.firstRange += firstRange;
+			m_queuedDraws.push_back(draw);
+		}
+		m_queuedRanges.insert(m_queuedRanges.end(), chunk.queuedRanges.begin(), chunk.queuedRanges.end());
+		for (const RenderQueue::Item& item : chunk.queuedItems)
+			m_renderQueue.push(item.key, firstDraw + item.draw);
+	}
+	m_renderQueue.sort();
+	m_forwardData.sortMilliseconds = std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+}
+
+void SceneRenderer::drawForwardQueue(CommandBuffer& commands, size_t begin, size_t end, CullingStats& stats) {
+	uint32_t frameIndex = m_swapchain->getCurrentFrameIndex();
+	const Material* boundMaterial = nullptr;
+	for (size_t i = begin; i < end; i++) {
+		const QueuedDraw& draw = m_queuedDraws[m_renderQueue.getItems()[i].draw];
+		const Material& material = *draw.mesh->m_material;
+		VkPipelineLayout layout = material.m_shader->getPipelineLayout();
+		if (boundMaterial == nullptr) {
+			VkDescriptorSet sceneDescriptorSet = m_forwardData.descriptorSet->getHandle(frameIndex);
+			commands.bindDescriptorSets(VK_PIPELINE_BIND_POINT_GRAPHICS, layout, 0, 1, &sceneDescriptorSet);
+			stats.descriptorSetBinds++;
+		}
+		if (&material != boundMaterial) {
+			VkDescriptorSet materialDescriptorSet = material.m_descriptorSet->getHandle(frameIndex);
+			commands.bindDescriptorSets(VK_PIPELINE_BIND_POINT_GRAPHICS, layout, 1, 1, &materialDescriptorSet);
+			stats.descriptorSetBinds++;
+			boundMaterial = &material;
+		}
+
+		MeshConstants constants = draw.mesh->getConstants(*draw.model);
+		commands.pushConstants(*m_forwardData.shader, &constants);
+		drawRanges(commands, *draw.mesh, m_queuedRanges.data() + draw.firstRange, draw.rangeCount, stats);
+	}
+}
+
+void SceneRenderer::depthPrePass() {
+	bool gpuDriven = m_settings.gpuDriven;
+	m_commandBuffer->beginRenderpass(m_depthPrePass.pipeline->getRenderPass(), m_depthPrePass.pipeline->getFramebuffers()[m_swapchain->getCurrentFrameIndex()], 1280, 720,
+		m_settings.parallelRecording && !gpuDriven);
+	glm::mat4 viewProjection = m_sceneData.proj * m_sceneData.view;
+	float lodScale = CullView::getLodScale(m_sceneData.proj, 720.0f);
+	glm::vec3 position = glm::vec3(m_sceneData.camPos);
+	if (gpuDriven) {
+		drawIndirect(m_indirectData.depthPipeline, *m_indirectData.depthDescriptorSet, IndirectData::cameraView, false, 1280, 720, m_depthPrePass.cullingStats);
+		drawInstanced(*m_commandBuffer, m_instancedData.depthPipeline, m_instancedData.depthDescriptorSet, viewProjection, position, true, lodScale, m_settings.lodPixelError, false, 1280, 720, m_depthPrePass.cullingStats);
+		m_commandBuffer->endRenderPass();
+		return;
+	}
+	m_depthPrePass.cullingStats = CullingStats{};
+	cullScene(Frustum::fromMatrix(viewProjection), m_depthPrePass.cullingStats);
+	gatherPassMeshes(viewProjection, position, true, lodScale, nullptr);
+
+	VkDescriptorSet sceneDescriptorSet = m_depthPrePass.descriptorSet->getHandle(m_swapchain->getCurrentFrameIndex());
+	VkPipelineLayout layout = m_depthPrePass.descriptorSet->getShader()->getPipelineLayout();
+	uint32_t chunkCount = getChunkCount(m_passMeshes.size());
+	beginChunks(chunkCount);
+	recordChunks(chunkCount, [&](CommandBuffer& commands, uint32_t chunk) {
+		RecordChunk& state = m_recordChunks[chunk];
+		commands.bindPipeline(m_depthPrePass.pipeline);
+		commands.updateViewport(1280, 720);
+		m_scene.geometry->bind(commands, *m_depthPrePass.pipeline);
+		commands.bindDescriptorSets(VK_PIPELINE_BIND_POINT_GRAPHICS, layout, 0, 1, &sceneDescriptorSet);
+		state.stats.descriptorSetBinds++;
+		drawPassMeshes(commands, state, getChunkBegin(m_passMeshes.size(), chunk, chunkCount), getChunkBegin(m_passMeshes.size(), chunk + 1, chunkCount), m_settings.lodPixelError);
+		// the instanced draws go after every other, in the last chunk
+		if (chunk + 1 == chunkCount)
+			drawInstanced(commands, m_instancedData.depthPipeline, m_instancedData.depthDescriptorSet, viewProjection, position, true, lodScale, m_settings.lodPixelError, false, 1280, 720, state.stats);
+	});
+	addChunkStats(chunkCount, m_depthPrePass.cullingStats);
+	m_commandBuffer->endRenderPass();
+}
+
+void SceneRenderer::hiZPass(uint32_t i) {
+	uint32_t frameIndex = m_swapchain->getCurrentFrameIndex();
+	auto& level = m_hiZData.levels[i];
+	m_commandBuffer->beginRenderpass(m_hiZData.pipeline->getRenderPass(), m_hiZData.framebuffers[frameIndex][i], level->getWidth(), level->getHeight());
+	m_commandBuffer->bindPipeline(m_hiZData.pipeline);
+	m_commandBuffer->updateViewport(level->getWidth(), level->getHeight());
+
+	VkDescriptorSet hiZDescriptorSet = m_hiZData.descriptorSets[i]->getHandle(frameIndex);
+	m_commandBuffer->bindDescriptorSets(VK_PIPELINE_BIND_POINT_GRAPHICS, m_hiZData.descriptorSets[i]->getShader()->getPipelineLayout(), 0, 1, &hiZDescriptorSet);
+
+	m_commandBuffer->draw(3, 1, 0, 0);
+	m_commandBuffer->endRenderPass();
+}
+
+void SceneRenderer::hiZReadback() {
+	uint32_t frameIndex = m_swapchain->getCurrentFrameIndex();
+	auto& level = m_hiZData.levels[hiZLevelCount - 1];
+	VkBufferImageCopy region{};
+	region.imageSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1 };
+	region.imageExtent = { level->getWidth(), level->getHeight(), 1 };
+	vkCmdCopyImageToBuffer(m_commandBuffer->getHandle(), level->getImage(), VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, m_hiZData.readback[frameIndex]->getHandle(), 1, &region);
+
+	// the render graph orders the next frame's hi-z after the copy, only the host read needs to wait
+	VkMemoryBarrier hostBarrier{};
+	hostBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+	hostBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+	hostBarrier.dstAccessMask = VK_ACCESS_HOST_READ_BIT;
+	vkCmdPipelineBarrier(m_commandBuffer->getHandle(), VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_HOST_BIT, 0, 1, &hostBarrier, 0, nullptr, 0, nullptr);
+
+	m_hiZData.viewProjection[frameIndex] = m_sceneData.proj * m_sceneData.view;
+	m_hiZData.pending[frameIndex] = true;
+	m_hiZData.boundsVersion[frameIndex] = m_boundsVersion;
+}
+
+void SceneRenderer::readHiZ() {
+	uint32_t frameIndex = m_swapchain->getCurrentFrameIndex();
+	if (!m_hiZData.pending[frameIndex]) {
+		m_depthPyramid.invalidate();
+		return;
+	}
+
+	const auto& level = m_hiZData.levels[hiZLevelCount - 1];
+	m_depthPyramid.build(static_cast<const float*>(m_hiZData.readback[frameIndex]->getMapped()), level->getWidth(), level->getHeight(), m_hiZData.viewProjection[frameIndex]);
+	m_hiZData.pending[frameIndex] = false;
+	m_hiZData.pyramidBoundsVersion = m_hiZData.boundsVersion[frameIndex];
+}
+
+void SceneRenderer::cullOccluded(const DepthPyramid& pyramid, CullingStats& stats) {
+	const glm::mat4& toClip = pyramid.getViewProjection();
+	for (size_t i = 0; i < m_visibleMeshes.size(); i++) {
+		if (m_visibleMeshes[i] && !pyramid.isVisible(m_meshBounds.getBox(i), toClip)) {
+			m_visibleMeshes[i] = 0;
+			stats.visibleMeshes--;
+			stats.occludedMeshes++;
+		}
+	}
+}
+
+void SceneRenderer::cullSoftwareOcclusion(SoftwareOcclusion& occlusion, const glm::mat4& viewProjection, const glm::vec3& position, bool perspective, CullingStats& stats) {
+	auto start = std::chrono::high_resolution_clock::now();
+
+	m_occluderCandidates.clear();
+	for (size_t i = 0; i < m_visibleMeshes.size(); i++) {
+		if (!m_visibleMeshes[i] || m_boundsMeshes[i]->m_occluderIndices.empty())
+			continue;
+		float radius = m_meshBounds.radius[i];
+		float score = radius;
+		if (perspective) {
+			glm::vec3 center(m_meshBounds.sphereX[i], m_meshBounds.sphereY[i], m_meshBounds.sphereZ[i]);
+			score = radius / std::max(glm::length(center - position), radius);
+		}
+		m_occluderCandidates.push_back({ score, static_cast<uint32_t>(i) });
+	}
+	std::sort(m_occluderCandidates.begin(), m_occluderCandidates.end(), [](const auto& a, const auto& b) { return a.first > b.first; });
+
+	occlusion.rasterizer.begin(viewProjection);
+	for (const auto& candidate : m_occluderCandidates) {
+		if (stats.occluderCount == m_settings.maxOccluders)
+			break;
+		const Mesh& mesh = *m_boundsMeshes[candidate.second];
+		uint32_t triangleCount = static_cast<uint32_t>(mesh.m_occluderIndices.size() / 3);
+		if (stats.occluderTriangles + triangleCount > m_settings.occluderTriangleBudget)
+			continue;
+		occlusion.rasterizer.drawTriangles(mesh.m_occluderPositions.data(), static_cast<uint32_t>(mesh.m_occluderPositions.size()),
+			mesh.m_occluderIndices.data(), static_cast<uint32_t>(mesh.m_occluderIndices.size()), m_scene.models[m_boundsModels[candidate.second]]->m_modelMatrix);
+		stats.occluderCount++;
+		stats.occluderTriangles += triangleCount;
+	}
+	occlusion.rasterizer.buildPyramid(occlusion.pyramid);
+	cullOccluded(occlusion.pyramid, stats);
+
+	occlusion.milliseconds = std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+}
+
+void SceneRenderer::ssaoPass() {
+	m_commandBuffer->beginRenderpass(m_ssaoPass.pipeline->getRenderPass(), m_ssaoPass.pipeline->getFramebuffers()[m_swapchain->getCurrentFrameIndex()], 1280, 720);
+	m_commandBuffer->bindPipeline(m_ssaoPass.pipeline);
+
+	VkDescriptorSet ssaoDescriptorSet = m_ssaoPass.descriptorSet->getHandle(m_swapchain->getCurrentFrameIndex());
+	m_commandBuffer->bindDescriptorSets(VK_PIPELINE_BIND_POINT_GRAPHICS, m_ssaoPass.descriptorSet->getShader()->getPipelineLayout(), 0, 1, &ssaoDescriptorSet); // todo: abstract these
+
+	m_commandBuffer->draw(3, 1, 0, 0);
+
+	m_commandBuffer->endRenderPass();
+}
+
+void SceneRenderer::shadowPass() {
+	bool gpuDriven = m_settings.gpuDriven;
+	m_commandBuffer->beginRenderpass(m_shadowData.pipeline->getRenderPass(), m_shadowData.pipeline->getFramebuffers()[m_swapchain->getCurrentFrameIndex()], m_shadowData.resolution, m_shadowData.resolution,
+		m_settings.parallelRecording && !gpuDriven);
+	float lodScale = CullView::getLodScale(m_shadowData.lightProjection, static_cast<float>(m_shadowData.resolution));
+	float maxPixelError = m_settings.lodPixelError * m_settings.shadowLodBias;
+	uint32_t resolution = m_shadowData.resolution;
+	if (gpuDriven) {
+		drawIndirect(m_indirectData.shadowPipeline, *m_indirectData.shadowDescriptorSet, IndirectData::shadowView, false, resolution, resolution, m_shadowData.cullingStats);
+		drawInstanced(*m_commandBuffer, m_instancedData.shadowPipeline, m_instancedData.shadowDescriptorSet, m_shadowData.lightSpace, m_shadowData.lightPos, false, lodScale, maxPixelError, false, resolution, resolution, m_shadowData.cullingStats);
+		m_commandBuffer->endRenderPass();
+		return;
+	}
+	m_shadowData.cullingStats = CullingStats{};
+	cullScene(Frustum::fromMatrix(m_shadowData.lightSpace), m_shadowData.cullingStats);
+	if (m_settings.softwareOcclusion)
+		cullSoftwareOcclusion(m_shadowData.occlusion, m_shadowData.lightSpace, m_shadowData.lightPos, false, m_shadowData.cullingStats);
+	// orthographic, no backface cone test
+	gatherPassMeshes(m_shadowData.lightSpace, m_shadowData.lightPos, false, lodScale, nullptr);
+
+	VkDescriptorSet sceneDescriptorSet = m_shadowData.descriptorSet->getHandle(m_swapchain->getCurrentFrameIndex());
+	VkPipelineLayout layout = m_shadowData.descriptorSet->getShader()->getPipelineLayout();
+	uint32_t chunkCount = getChunkCount(m_passMeshes.size());
+	beginChunks(chunkCount);
+	recordChunks(chunkCount, [&](CommandBuffer& commands, uint32_t chunk) {
+		RecordChunk& state = m_recordChunks[chunk];
+		commands.bindPipeline(m_shadowData.pipeline);
+		commands.updateViewport(resolution, resolution);
+		m_scene.geometry->bind(commands, *m_shadowData.pipeline);
+		commands.bindDescriptorSets(VK_PIPELINE_BIND_POINT_GRAPHICS, layout, 0, 1, &sceneDescriptorSet);
+		state.stats.descriptorSetBinds++;
+		drawPassMeshes(commands, state, getChunkBegin(m_passMeshes.size(), chunk, chunkCount), getChunkBegin(m_passMeshes.size(), chunk + 1, chunkCount), maxPixelError);
+		if (chunk + 1 == chunkCount)
+			drawInstanced(commands, m_instancedData.shadowPipeline, m_instancedData.shadowDescriptorSet, m_shadowData.lightSpace, m_shadowData.lightPos, false, lodScale, maxPixelError, false, resolution, resolution, state.stats);
+	});
+	addChunkStats(chunkCount, m_shadowData.cullingStats);
+	m_commandBuffer->endRenderPass();
+}
+
+void SceneRenderer::forwardPass() {
+	bool gpuDriven = m_settings.gpuDriven;
+	m_commandBuffer->beginRenderpass(m_forwardData.pipeline->getRenderPass(), m_forwardData.pipeline->getFramebuffers()[m_swapchain->getCurrentFrameIndex()], 1280, 720,
+		m_settings.parallelRecording && !gpuDriven);
+	glm::mat4 viewProjection = m_sceneData.proj * m_sceneData.view;
+	float lodScale = CullView::getLodScale(m_sceneData.proj, 720.0f);
+	glm::vec3 position = glm::vec3(m_sceneData.camPos);
+	if (gpuDriven) {
+		drawIndirect(m_indirectData.forwardPipeline, *m_indirectData.forwardDescriptorSet, IndirectData::cameraView, true, 1280, 720, m_forwardData.cullingStats);
+		drawInstanced(*m_commandBuffer, m_instancedData.forwardPipeline, m_instancedData.forwardDescriptorSet, viewProjection, position, true, lodScale, m_settings.lodPixelError, true, 1280, 720, m_forwardData.cullingStats);
+		m_commandBuffer->endRenderPass();
+		return;
+	}
+	m_forwardData.cullingStats = CullingStats{};
+
+	// the pyramid is MAX_FRAMES_IN_FLIGHT frames old, whatever the camera or a moving mesh revealed since would stay culled.
+	// it is only trusted while the view and every bounds are the ones it was rendered with, software occlusion covers motion
+	bool occlusion = m_settings.occlusionCulling && m_depthPyramid.isValid() && m_depthPyramid.getViewProjection() == viewProjection &&
+		m_hiZData.pyramidBoundsVersion == m_boundsVersion;
+	m_forwardData.hiZOcclusion = occlusion;
+
+	cullScene(Frustum::fromMatrix(viewProjection), m_forwardData.cullingStats);
+	if (m_settings.softwareOcclusion)
+		cullSoftwareOcclusion(m_forwardData.occlusion, viewProjection, position, true, m_forwardData.cullingStats);
+	if (occlusion)
+		cullOccluded(m_depthPyramid, m_forwardData.cullingStats);
+	gatherPassMeshes(viewProjection, position, true, lodScale, occlusion ? &m_depthPyramid : nullptr);
+
+	uint32_t frameIndex = m_swapchain->getCurrentFrameIndex();
+	auto beginChunk = [&](CommandBuffer& commands) {
+		commands.bindPipeline(m_forwardData.pipeline);
+		commands.updateViewport(1280, 720);
+		m_scene.geometry->bind(commands, *m_forwardData.pipeline);
+	};
+	auto endChunk = [&](CommandBuffer& commands, uint32_t chunk, uint32_t chunkCount) {
+		if (chunk + 1 == chunkCount)
+			drawInstanced(commands, m_instancedData.forwardPipeline, m_instancedData.forwardDescriptorSet, viewProjection, position, true, lodScale, m_settings.lodPixelError, true, 1280, 720, m_recordChunks[chunk].stats);
+	};
+
+	uint32_t chunkCount = getChunkCount(m_passMeshes.size());
+	beginChunks(chunkCount);
+	if (!m_settings.drawSorting) {
+		recordChunks(chunkCount, [&](CommandBuffer& commands, uint32_t chunk) {
+			RecordChunk& state = m_recordChunks[chunk];
+			beginChunk(commands);
+			size_t end = getChunkBegin(m_passMeshes.size(), chunk + 1, chunkCount);
+			for (size_t i = getChunkBegin(m_passMeshes.size(), chunk, chunkCount); i < end; i++) {
+				const Mesh& mesh = *m_boundsMeshes[m_passMeshes[i]];
+				uint32_t model = m_boundsModels[m_passMeshes[i]];
+				if (!cullMesh(mesh, m_modelViews[model], m_settings.lodPixelError, state.visibleRanges, state.stats))
+					continue;
+
+				MeshConstants constants = mesh.getConstants(m_scene.models[model]->m_modelMatrix);
+				commands.pushConstants(*m_forwardData.shader, &constants);
+
+				VkDescriptorSet descriptorSets[] = {
+					m_forwardData.descriptorSet->getHandle(frameIndex),
+					mesh.m_material->m_descriptorSet->getHandle(frameIndex)
+				};
+				commands.bindDescriptorSets(VK_PIPELINE_BIND_POINT_GRAPHICS, mesh.m_material->m_shader->getPipelineLayout(), 0, 2, descriptorSets);
+				state.stats.descriptorSetBinds += 2;
+				drawRanges(commands, mesh, state.visibleRanges.data(), state.visibleRanges.size(), state.stats);
+			}
+			endChunk(commands, chunk, chunkCount);
+		});
+		addChunkStats(chunkCount, m_forwardData.cullingStats);
+		m_commandBuffer->endRenderPass();
+		return;
+	}
+
+	// sorted : the chunks cull and queue their meshes in parallel, the merged queue is sorted then recorded in slices
+	ThreadPool::get().parallelFor(chunkCount, [&](uint32_t chunk) {
+		RecordChunk& state = m_recordChunks[chunk];
+		size_t end = getChunkBegin(m_passMeshes.size(), chunk + 1, chunkCount);
+		for (size_t i = getChunkBegin(m_passMeshes.size(), chunk, chunkCount); i < end; i++) {
+			uint32_t bounds = m_passMeshes[i];
+			const Mesh& mesh = *m_boundsMeshes[bounds];
+			uint32_t model = m_boundsModels[bounds];
+			if (!cullMesh(mesh, m_modelViews[model], m_settings.lodPixelError, state.visibleRanges, state.stats))
+				continue;
+			glm::vec3 center(m_meshBounds.sphereX[bounds], m_meshBounds.sphereY[bounds], m_meshBounds.sphereZ[bounds]);
+			queueForward(state, mesh, m_scene.models[model]->m_modelMatrix, glm::length(center - position) / m_forwardData.farPlane);
+		}
+	});
+	addChunkStats(chunkCount, m_forwardData.cullingStats);
+	sortForwardQueue(chunkCount);
+
+	uint32_t drawChunkCount = getChunkCount(m_renderQueue.size());
+	beginChunks(drawChunkCount);
+	recordChunks(drawChunkCount, [&](CommandBuffer& commands, uint32_t chunk) {
+		beginChunk(commands);
+		drawForwardQueue(commands, getChunkBegin(m_renderQueue.size(), chunk, drawChunkCount), getChunkBegin(m_renderQueue.size(), chunk + 1, drawChunkCount), m_recordChunks[chunk].stats);
+		endChunk(commands, chunk, drawChunkCount);
+	});
+	addChunkStats(drawChunkCount, m_forwardData.cullingStats);
+	m_commandBuffer->endRenderPass();
+}
+
+void SceneRenderer::skyBoxPass() {
+	m_commandBuffer->beginRenderpass(m_skyBoxData.pipeline->getRenderPass(), m_skyBoxData.pipeline->getFramebuffers()[m_swapchain->getCurrentFrameIndex()], 1280, 720);
+	m_commandBuffer->bindPipeline(m_skyBoxData.pipeline);
+	m_commandBuffer->updateViewport(1280, 720);
+	VkDescriptorSet skyBoxDescriptorSet = m_skyBoxData.descriptorSet->getHandle(m_swapchain->getCurrentFrameIndex());
+	m_commandBuffer->bindDescriptorSets(VK_PIPELINE_BIND_POINT_GRAPHICS, m_skyBoxData.descriptorSet->getShader()->getPipelineLayout(), 0, 1, &skyBoxDescriptorSet); // todo: abstract these
+
+	m_commandBuffer->draw(36, 1, 0, 0);
+
+	m_commandBuffer->endRenderPass();
+}
+
+void SceneRenderer::bloomDownsample(int i) {
+	auto& mip = m_bloomData.mipChain[i][m_swapchain->getCurrentFrameIndex()];
+	m_commandBuffer->beginRenderpass(m_bloomData.pipeline->getRenderPass(), m_bloomData.framebuffers[m_swapchain->getCurrentFrameIndex()][i], mip->getWidth(), mip->getHeight());
+	m_commandBuffer->bindPipeline(m_bloomData.pipeline);
+	m_commandBuffer->updateViewport(mip->getWidth(), mip->getHeight());
+
+	VkDescriptorSet bloomDescriptorSet = m_bloomData.descriptorSets[i]->getHandle(m_swapchain->getCurrentFrameIndex());
+	m_commandBuffer->bindDescriptorSets(VK_PIPELINE_BIND_POINT_GRAPHICS, m_bloomData.descriptorSets[i]->getShader()->getPipelineLayout(), 0, 1, &bloomDescriptorSet);
+	if (i == 0)
+		m_bloomData.pushConstant.mode = 0;
+	else
+		m_bloomData.pushConstant.mode = 1;
+	m_bloomData.pushConstant.mipLevel = i - 1;
+	m_bloomData.pushConstant.resolution = glm::vec2(mip->getWidth(), mip->getHeight());
+	m_commandBuffer->pushConstants(*m_bloomData.descriptorSets[0]->getShader(), &m_bloomData.pushConstant);
+
+	m_commandBuffer->draw(3, 1, 0, 0);
+
+	m_commandBuffer->endRenderPass();
+}
+
+void SceneRenderer::bloomUpsample(int i) {
+	auto& mip = m_bloomData.mipChain[i - 2][m_swapchain->getCurrentFrameIndex()];
+	m_commandBuffer->beginRenderpass(m_bloomData.pipeline->getRenderPass(), m_bloomData.framebuffers[m_swapchain->getCurrentFrameIndex()][i - 2], mip->getWidth(), mip->getHeight());
+	m_commandBuffer->bindPipeline(m_bloomData.pipeline);
+	m_commandBuffer->updateViewport(mip->getWidth(), mip->getHeight());
+
+	VkDescriptorSet bloomDescriptorSet = m_bloomData.descriptorSets[i]->getHandle(m_swapchain->getCurrentFrameIndex());
+	m_commandBuffer->bindDescriptorSets(VK_PIPELINE_BIND_POINT_GRAPHICS, m_bloomData.descriptorSets[i]->getShader()->getPipelineLayout(), 0, 1, &bloomDescriptorSet);
+	m_bloomData.pushConstant.mode = 2;
+	m_commandBuffer->pushConstants(*m_bloomData.descriptorSets[0]->getShader(), &m_bloomData.pushConstant);
+
+	m_commandBuffer->draw(3, 1, 0, 0);
+
+	m_commandBuffer->endRenderPass();
+}
+
+void SceneRenderer::toneMapping() {
+	m_commandBuffer->beginRenderpass(m_toneMappingData.pipeline->getRenderPass(), m_toneMappingData.pipeline->getFramebuffers()[m_swapchain->getCurrentFrameIndex()], 1280, 720);
+	m_commandBuffer->bindPipeline(m_toneMappingData.pipeline);
+	m_commandBuffer->updateViewport(1280, 720);
+	VkDescriptorSet toneMappingDescriptorSet = m_toneMappingData.descriptorSet->getHandle(m_swapchain->getCurrentFrameIndex());
+	m_commandBuffer->bindDescriptorSets(VK_PIPELINE_BIND_POINT_GRAPHICS, m_toneMappingData.descriptorSet->getShader()->getPipelineLayout(), 0, 1, &toneMappingDescriptorSet); // todo: abstract these
+
+	m_commandBuffer->draw(3, 1, 0, 0);
+	m_commandBuffer->endRenderPass();
+}
+
+void SceneRenderer::finalPass() {
+	m_commandBuffer->beginRenderpass(m_postProcessData.pipeline->getRenderPass(), m_postProcessData.pipeline->getFramebuffers()[m_swapchain->getCurrentImageIndex()], 1280, 720);
+	m_commandBuffer->bindPipeline(m_postProcessData.pipeline);
+	m_commandBuffer->updateViewport(1280, 720);
+
+	VkDescriptorSet postProcessDescriptorSet = m_postProcessData.descriptorSet->getHandle(m_swapchain->getCurrentFrameIndex());
+	m_commandBuffer->bindDescriptorSets(VK_PIPELINE_BIND_POINT_GRAPHICS, m_postProcessData.descriptorSet->getShader()->getPipelineLayout(), 0, 1, &postProcessDescriptorSet); // todo: abstract these
+
+	m_commandBuffer->draw(3, 1, 0, 0);
+
+	//ImGui::Render();
+	//ImGui_ImplVulkan_RenderDrawData(ImGui::GetDrawData(), m_commandBuffer->getHandle());
+
+	m_commandBuffer->endRenderPass();
+}
+
+uint32_t SceneRenderer::getRenderGraphKey() const {
+	return (m_settings.enableSSAO ? GRAPH_SSAO : 0) | (m_settings.enableBloom ? GRAPH_BLOOM : 0) | (m_settings.enableShadow ? GRAPH_SHADOW : 0)
+		| (m_settings.enableSkyBox ? GRAPH_SKY_BOX : 0) | (m_settings.occlusionCulling ? GRAPH_OCCLUSION : 0);
+}
+
+void SceneRenderer::buildRenderGraph() {
+	// the descriptor sets of the frames in flight are rewritten
+	if (m_renderGraphKey != ~0u)
+		vkDeviceWaitIdle(Device::getHandle());
+	m_renderGraphKey = getRenderGraphKey();
+
+	std::shared_ptr<Texture> shadowMap = m_whiteTexture;
+	if (m_settings.enableShadow)
+		shadowMap = m_shadowData.texture;
+	FrameResource<Texture> ssao = m_whiteTexture;
+	if (m_settings.enableSSAO)
+		ssao = m_ssaoPass.texture;
+	for (const std::shared_ptr<DescriptorSet>& descriptorSet : { m_forwardData.descriptorSet, m_indirectData.forwardDescriptorSet, m_instancedData.forwardDescriptorSet }) {
+		if (!descriptorSet)
+			continue;
+		descriptorSet->setTexture(shadowMap, 1);
+		descriptorSet->setTexture(ssao, 2);
+	}
+	FrameResource<Texture> bloom = m_blackTexture;
+	if (m_settings.enableBloom)
+		bloom = m_bloomData.mipChain[0];
+	m_toneMappingData.descriptorSet->setTexture(bloom, 1);
+
+	declareRenderGraph(m_renderGraphKey);
+	m_renderGraph.compile();
+}
+
+void SceneRenderer::declareRenderGraph(uint32_t features) {
+	auto hiZLevel = [](uint32_t i) { return "hi-z " + std::to_string(i); };
+	auto bloomMip = [](int i) { return "bloom " + std::to_string(i); };
+
+	RenderGraph& graph = m_renderGraph;
+	graph.clear();
+	graph.setImage("depth", m_depthPrePass.texture);
+	for (uint32_t i = 0; i < hiZLevelCount; i++)
+		graph.setImage(hiZLevel(i), m_hiZData.levels[i]);
+	graph.setImage("ssao", m_ssaoPass.texture);
+	graph.setImage("shadow map", m_shadowData.texture);
+	graph.setImage("forward color", m_forwardData.colorTexture);
+	graph.setImage("forward depth", m_forwardData.depthTexture);
+	graph.setImage("scene", m_forwardData.resolveTexture);
+	for (int i = 0; i < mipChainLength; i++)
+		graph.setImage(bloomMip(i), m_bloomData.mipChain[i]);
+	graph.setImage("tone mapped", m_toneMappingData.texture);
+	graph.setImage("swapchain", m_swapchain->m_swapchainTextures[m_swapchain->getCurrentImageIndex()]);
+
+	graph.addPass("depth pre-pass", { { "depth", ImageAccess::ATTACHMENT } }, [this] { depthPrePass(); });
+	if (features & GRAPH_OCCLUSION) {
+		for (uint32_t i = 0; i < hiZLevelCount; i++) {
+			graph.addPass(hiZLevel(i), { { i == 0 ? "depth" : hiZLevel(i - 1), ImageAccess::SAMPLED }, { hiZLevel(i), ImageAccess::ATTACHMENT } },
+				[this, i] { hiZPass(i); });
+		}
+		graph.addPass("hi-z readback", { { hiZLevel(hiZLevelCount - 1), ImageAccess::TRANSFER_SRC } }, [this] { hiZReadback(); }, true);
+	}
+	if (features & GRAPH_SSAO)
+		graph.addPass("ssao", { { "depth", ImageAccess::SAMPLED }, { "ssao", ImageAccess::ATTACHMENT } }, [this] { ssaoPass(); });
+	if (features & GRAPH_SHADOW)
+		graph.addPass("shadow", { { "shadow map", ImageAccess::ATTACHMENT } }, [this] { shadowPass(); });
+
+	std::vector<RenderGraph::Access> forwardAccesses = {
+		{ "forward color", ImageAccess::ATTACHMENT },
+		{ "forward depth", ImageAccess::ATTACHMENT },
+		{ "scene", ImageAccess::ATTACHMENT } };
+	if (features & GRAPH_SHADOW)
+		forwardAccesses.push_back({ "shadow map", ImageAccess::SAMPLED });
+	if (features & GRAPH_SSAO)
+		forwardAccesses.push_back({ "ssao", ImageAccess::SAMPLED });
+	graph.addPass("forward", forwardAccesses, [this] {
+		forwardPass();
+		m_geometryRecordTime = std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - m_recordStart).count();
+	});
+
+	if (features & GRAPH_SKY_BOX) {
+		graph.addPass("sky box", { { "forward color", ImageAccess::ATTACHMENT_LOAD }, { "forward depth", ImageAccess::ATTACHMENT_LOAD }, { "scene", ImageAccess::ATTACHMENT_LOAD } },
+			[this] { skyBoxPass(); });
+	}
+	if (features & GRAPH_BLOOM) {
+		for (int i = 0; i < mipChainLength; i++) {
+			graph.addPass("bloom down " + std::to_string(i), { { i == 0 ? "scene" : bloomMip(i - 1), ImageAccess::SAMPLED }, { bloomMip(i), ImageAccess::ATTACHMENT } },
+				[this, i] { bloomDownsample(i); });
+		}
+		for (int i = mipChainLength; i > 1; i--) {
+			graph.addPass("bloom up " + std::to_string(i - 2), { { bloomMip(i - 1), ImageAccess::SAMPLED }, { bloomMip(i - 2), ImageAccess::ATTACHMENT } },
+				[this, i] { bloomUpsample(i); });
+		}
+	}
+
+	std::vector<RenderGraph::Access> toneMappingAccesses = { { "scene", ImageAccess::SAMPLED }, { "tone mapped", ImageAccess::ATTACHMENT } };
+	if (features & GRAPH_BLOOM)
+		toneMappingAccesses.push_back({ bloomMip(0), ImageAccess::SAMPLED });
+	graph.addPass("tone mapping", toneMappingAccesses, [this] { toneMapping(); });
+	graph.addPass("final", { { "tone mapped", ImageAccess::SAMPLED }, { "swapchain", ImageAccess::ATTACHMENT } }, [this] { finalPass(); });
+
+	graph.addOutput("swapchain");
+}
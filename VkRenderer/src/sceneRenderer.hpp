@@ -0,0 +1,339 @@
+#pragma once
+#include "src/vulkan/vkHeader.hpp"
+#include "src/vulkan/frameResource.hpp"
+#include "src/culling.hpp"
+#include "src/bvh.hpp"
+#include "src/depthPyramid.hpp"
+#include "src/occlusionRasterizer.hpp"
+#include "src/renderQueue.hpp"
+#include "src/renderGraph.hpp"
+
+class CubeMap;
+class UniformBuffer;
+class IndirectScene;
+class InstanceBuffer;
+class InstancedModel;
+class ParallelRecorder;
+
+// what the scene renderer draws, loaded by the app into a single geometry buffer
+struct Scene {
+	std::shared_ptr<GeometryBuffer> geometry;
+	std::vector<std::shared_ptr<Model>> models;
+	std::vector<std::shared_ptr<InstancedModel>> instancedModels;	// drawn by the INSTANCED_DRAW pipelines
+};
+
+// the passes of a frame, the render graph ordering them and the culling feeding them.
+// the render targets are 1280x720, the swapchain's images are drawn to by the final pass
+class SceneRenderer {
+public:
+	struct Settings {
+		bool enableSSAO = true;
+		bool enableBloom = true;
+		bool enableShadow = true;
+		bool enableSkyBox = true;
+		bool bvhCulling = true;			// hierarchical mesh culling, the flat batch test otherwise
+		bool clusterCulling = true;
+		bool occlusionCulling = true;	// forward pass against the hi-z of the depth pre-pass, read back a few frames late
+		bool softwareOcclusion = true;	// forward and shadow passes against occluders rasterized on the cpu, no latency
+		uint32_t maxOccluders = 32;
+		uint32_t occluderTriangleBudget = 32768;
+		bool drawSorting = true;		// forward draws ordered by material and depth, materials bound once per batch
+		bool parallelRecording = true;	// cpu culled passes recorded on the thread pool into secondary command buffers
+		bool gpuDriven = false;			// compute culled instances drawn with an indirect call per batch, needs multiDrawIndirect
+		bool lodSelection = true;
+		float lodPixelError = 1.0f;	// largest on screen error of the selected lod
+		float shadowLodBias = 4.0f;	// shadow map texels tolerate more, multiplies lodPixelError
+		// read once, when the render targets are created
+		bool renderTargetAliasing = true;	// transient targets alive at different times share memory
+		bool perFrameRenderTargets = true;	// a copy of the offscreen targets per frame in flight, shared ones serialize the frames
+	};
+
+	// the models of the scene must be loaded, the shaders are picked for the vertex format of its geometry
+	SceneRenderer(Scene& scene, const std::shared_ptr<Swapchain>& swapchain, const Settings& settings);
+	~SceneRenderer();
+
+	void setCamera(const glm::vec3& position, const glm::vec3& front, const glm::vec3& up);
+	// nearest mesh box along the view direction, reported on the console
+	void pick(const glm::vec3& origin, const glm::vec3& direction);
+
+	// writes the scene data of the current frame and follows the models that moved
+	void update();
+	// the frame's fence must have been waited
+	void beginFrame();
+	// records the frame, the swapchain image must have been acquired
+	void render(const std::shared_ptr<CommandBuffer>& commandBuffer);
+	// the settings and stats, inside an imgui window
+	void gui();
+	// the counters of the last recorded frame, on the console
+	void printStats() const;
+
+	Settings& getSettings() { return m_settings; }
+
+private:
+	// cpu occlusion of a pass, rebuilt every frame
+	struct SoftwareOcclusion {
+		OcclusionRasterizer rasterizer;
+		DepthPyramid pyramid;
+		float milliseconds = 0.f;
+	};
+
+	// forward draws of the frame, m_renderQueue items index m_queuedDraws
+	struct QueuedDraw {
+		const Mesh* mesh;
+		const glm::mat4* model;
+		uint32_t firstRange;	// in m_queuedRanges
+		uint32_t rangeCount;
+	};
+
+	// what a task of a pass culls and queues, merged on the calling thread once they are done
+	struct RecordChunk {
+		std::vector<IndexRange> visibleRanges;
+		std::vector<QueuedDraw> queuedDraws;
+		std::vector<IndexRange> queuedRanges;
+		std::vector<RenderQueue::Item> queuedItems;		// draw indexes queuedDraws
+		CullingStats stats;
+	};
+
+	// the optional passes of the render graph
+	enum GraphFeature : uint32_t {
+		GRAPH_SSAO = 1 << 0,
+		GRAPH_BLOOM = 1 << 1,
+		GRAPH_SHADOW = 1 << 2,
+		GRAPH_SKY_BOX = 1 << 3,
+		GRAPH_OCCLUSION = 1 << 4,
+		GRAPH_ALL = (1 << 5) - 1,
+	};
+
+	// every image of the render graph. the transient ones get their memory from the graph and a copy per frame in flight,
+	// frame n + 1 renders its first passes while frame n is still post processing in the same images otherwise, aliases
+	// included. the shadow map and hi-z are single copies : the next frame writes them after this frame's forward pass
+	// and hi-z readback, the middle of the frame, and the hi-z readback already has a buffer per frame
+	void createRenderTargets();
+
+	// world bounds of every drawn mesh, in the order the passes walk them. models whose matrix changed are
+	// refitted in the bvh, a different set of meshes or a degraded tree rebuilds it
+	void updateBounds();
+	void rebuildBvh();
+	// fills m_visibleMeshes for a pass, from the bvh or by testing every mesh
+	void cullScene(const Frustum& frustum, CullingStats& stats);
+	// picks the mesh's lod for the view and fills ranges with its meshlets that pass the view's culling,
+	// false when none does
+	bool cullMesh(const Mesh& mesh, const CullView& view, float maxPixelError, std::vector<IndexRange>& ranges, CullingStats& stats);
+	// the m_meshBounds indices left in m_visibleMeshes, and every model's view for the culling of its meshes
+	void gatherPassMeshes(const glm::mat4& viewProjection, const glm::vec3& position, bool perspective, float lodScale, const DepthPyramid* occlusion);
+	// clears the meshes of m_visibleMeshes hidden behind the pyramid
+	void cullOccluded(const DepthPyramid& pyramid, CullingStats& stats);
+	// rasterizes the largest meshes of m_visibleMeshes on the cpu and culls the ones they hide.
+	// occluders are ranked by their angular size from position, or by radius for orthographic views
+	void cullSoftwareOcclusion(SoftwareOcclusion& occlusion, const glm::mat4& viewProjection, const glm::vec3& position, bool perspective, CullingStats& stats);
+
+	// contiguous slices of a pass's items handled by one task each, a few per thread so they balance.
+	// a single one when parallel recording is off
+	uint32_t getChunkCount(size_t itemCount) const;
+	static size_t getChunkBegin(size_t itemCount, uint32_t chunk, uint32_t chunkCount);
+	// clears the state of the chunks about to run
+	void beginChunks(uint32_t chunkCount);
+	void addChunkStats(uint32_t chunkCount, CullingStats& stats);
+	// calls record(commandBuffer, chunk) for every chunk, on the thread pool into secondary command buffers executed in order,
+	// or inline in order when parallel recording is off. the render pass must have been begun accordingly
+	void recordChunks(uint32_t chunkCount, const std::function<void(CommandBuffer&, uint32_t)>& record);
+
+	// culls the camera and light views of the indirect scene, outside of the render passes
+	void cullIndirect();
+	// draws a view culled by cullIndirect() in the render pass already begun, visibility stays on the gpu
+	// so the stats only count instances and indirect calls
+	void drawIndirect(const std::shared_ptr<Pipeline>& pipeline, const DescriptorSet& descriptorSet, uint32_t view, bool materials, uint32_t width, uint32_t height, CullingStats& stats);
+	// culls the instanced models for a view and draws them after the pass's other draws.
+	// the view is in world space, maxPixelError applies when lod selection is on
+	void drawInstanced(CommandBuffer& commands, const std::shared_ptr<Pipeline>& pipeline, const std::shared_ptr<DescriptorSet>& descriptorSet, const glm::mat4& viewProjection,
+		const glm::vec3& position, bool perspective, float lodScale, float maxPixelError, bool materials, uint32_t width, uint32_t height, CullingStats& stats);
+	void drawRanges(CommandBuffer& commands, const Mesh& mesh, const IndexRange* ranges, size_t rangeCount, CullingStats& stats);
+	// culls and draws a chunk of m_passMeshes with a pass that only needs the scene set
+	void drawPassMeshes(CommandBuffer& commands, RecordChunk& chunk, size_t begin, size_t end, float maxPixelError);
+	// keeps the visible ranges of a mesh culled for the forward pass, drawn once the queue is sorted
+	void queueForward(RecordChunk& chunk, const Mesh& mesh, const glm::mat4& model, float depth);
+	// moves the draws queued by every chunk to the render queue, in chunk order, and sorts it by material then depth
+	void sortForwardQueue(uint32_t chunkCount);
+	// records a slice of the sorted forward queue, binding a material only when it changes
+	void drawForwardQueue(CommandBuffer& commands, size_t begin, size_t end, CullingStats& stats);
+
+	void depthPrePass();
+	// halves the pre-pass depth, or the previous level, keeping the farthest depth
+	void hiZPass(uint32_t i);
+	// copies the coarsest hi-z level, in the transfer layout, to this frame's readback buffer.
+	// the cpu reads it once the frame's fence is signaled, the next time this frame slot comes around
+	void hiZReadback();
+	// rebuilds the depth pyramid from the hi-z this frame slot read back, the frame's fence must have been waited
+	void readHiZ();
+	void ssaoPass();
+	void shadowPass();
+	void forwardPass();
+	void skyBoxPass();
+	// renders mip i from the resolved scene or the mip above
+	void bloomDownsample(int i);
+	// renders mip i - 2 from mip i - 1, from the smallest mip up to the first
+	void bloomUpsample(int i);
+	void toneMapping();
+	void finalPass();
+
+	// the optional passes of the render graph enabled by the settings
+	uint32_t getRenderGraphKey() const;
+	// builds the graph of the enabled settings, the graph culls what nothing presented depends on. the inputs of
+	// disabled passes are bound to neutral textures rather than what they last produced, their memory may be an alias's
+	void buildRenderGraph();
+	// the passes of the given GraphFeature flags and what they read and write
+	void declareRenderGraph(uint32_t features);
+
+	Scene& m_scene;
+	std::shared_ptr<Swapchain> m_swapchain;
+	std::shared_ptr<CommandBuffer> m_commandBuffer;	// of the frame being recorded
+	std::vector<UniformBuffer> m_sceneUBO;
+	BoundsBatch m_meshBounds;
+	std::vector<glm::mat4> m_boundsMatrices;	// model matrices m_meshBounds was built with
+	std::vector<const Mesh*> m_boundsMeshes;	// mesh of every m_meshBounds entry
+	std::vector<uint32_t> m_boundsModels;		// its m_scene.models index
+	uint32_t m_boundsVersion = 0;				// bumped whenever m_meshBounds changes
+	Bvh m_bvh;									// items are m_meshBounds indices
+	std::vector<uint32_t> m_visibleItems;
+	std::vector<uint8_t> m_visibleMeshes;
+	std::vector<uint32_t> m_passMeshes;		// m_meshBounds indices left by the pass's mesh culling
+	std::vector<CullView> m_modelViews;		// the pass's view of every m_scene.models entry
+	std::vector<std::pair<float, uint32_t>> m_occluderCandidates;	// score, m_meshBounds index
+	RenderQueue m_renderQueue;
+	std::vector<QueuedDraw> m_queuedDraws;
+	std::vector<IndexRange> m_queuedRanges;
+	std::vector<RecordChunk> m_recordChunks;
+	std::shared_ptr<ParallelRecorder> m_recorder;
+	std::shared_ptr<Texture2D> m_whiteTexture;
+	std::shared_ptr<Texture2D> m_blackTexture;
+	RenderGraph m_renderGraph;	// declared before the render targets, it frees their memory once they are destroyed
+	uint32_t m_renderGraphKey = ~0u;	// getRenderGraphKey() it was built for, ~0u before the first build
+
+	float m_geometryRecordTime = 0.0f;	// milliseconds
+	std::chrono::high_resolution_clock::time_point m_recordStart;
+
+	Settings m_settings;
+
+	struct SceneDataUBO {
+		struct Light {
+			glm::vec4 color;
+			glm::vec4 position;
+		};
+		Light lights[16];
+		glm::mat4 lightSpace;
+		glm::mat4 view;
+		glm::mat4 proj;
+		glm::vec4 camPos;
+		int lightCount = 2;
+		glm::vec3 padding;
+	} m_sceneData;
+
+	struct DepthPrePass {
+		FrameResource<Texture2D> texture;
+		std::shared_ptr<Pipeline> pipeline;
+		std::shared_ptr<DescriptorSet> descriptorSet;
+		CullingStats cullingStats;
+	}  m_depthPrePass;
+
+	struct SSAOPass {
+		FrameResource<Texture2D> texture;
+		std::shared_ptr<Pipeline> pipeline;
+		std::shared_ptr<DescriptorSet> descriptorSet;
+	} m_ssaoPass;
+
+	struct ForwardData {
+		std::shared_ptr<Shader> shader;
+		std::shared_ptr<Pipeline> pipeline;
+		FrameResource<Texture2D> colorTexture;
+		FrameResource<Texture2D> resolveTexture;
+		FrameResource<Texture2D> depthTexture;
+		std::shared_ptr<DescriptorSet> descriptorSet;
+		CullingStats cullingStats;
+		SoftwareOcclusion occlusion;
+		float farPlane = 100.0f;
+		float sortMilliseconds = 0.f;
+		bool hiZOcclusion = false;	// the depth pyramid was recent enough to cull this frame
+	} m_forwardData;
+
+	struct PostProcessData {
+		std::shared_ptr<Pipeline> pipeline;
+		std::shared_ptr<DescriptorSet> descriptorSet;
+	} m_postProcessData;
+
+	struct SkyBoxData {
+		std::shared_ptr<CubeMap> cubeMap;
+		std::shared_ptr<Pipeline> pipeline;
+		std::shared_ptr<DescriptorSet> descriptorSet;
+	}  m_skyBoxData;
+
+	struct ShadowData {
+		std::shared_ptr<Texture2D> texture;
+		std::shared_ptr<Pipeline> pipeline;
+		std::shared_ptr<DescriptorSet> descriptorSet;
+		uint32_t resolution = 4096;
+		glm::vec3 lightPos = glm::vec3(50, 50.0f, .0f);
+		glm::mat4 lightSpace;
+		glm::mat4 lightProjection;
+		glm::mat4 lightView;
+		CullingStats cullingStats;
+		SoftwareOcclusion occlusion{ OcclusionRasterizer(256, 256) };
+	} m_shadowData;
+
+	static const uint32_t mipChainLength = 5;
+	struct BloomData {
+		struct PushConstant {
+			int mode;
+			int mipLevel;
+			glm::vec2 resolution;
+		};
+		PushConstant pushConstant;
+		std::shared_ptr<Pipeline> pipeline;
+		std::shared_ptr<Framebuffer> framebuffers[MAX_FRAMES_IN_FLIGHT][mipChainLength];
+		FrameResource<Texture2D> mipChain[mipChainLength];
+		std::shared_ptr<DescriptorSet> descriptorSets[mipChainLength+1];
+	} m_bloomData;
+
+	static const uint32_t hiZLevelCount = 3;	// 640x360 down to the 160x90 level read back
+	struct HiZData {
+		std::shared_ptr<Pipeline> pipeline;
+		std::shared_ptr<Framebuffer> framebuffers[MAX_FRAMES_IN_FLIGHT][hiZLevelCount];
+		std::shared_ptr<Texture2D> levels[hiZLevelCount];
+		std::shared_ptr<DescriptorSet> descriptorSets[hiZLevelCount];
+		std::shared_ptr<Buffer> readback[MAX_FRAMES_IN_FLIGHT];	// coarsest level, host visible
+		glm::mat4 viewProjection[MAX_FRAMES_IN_FLIGHT];			// the view each readback was rendered from
+		bool pending[MAX_FRAMES_IN_FLIGHT] = {};				// a readback was recorded and not read yet
+		uint32_t boundsVersion[MAX_FRAMES_IN_FLIGHT] = {};		// m_boundsVersion each readback was rendered with
+		uint32_t pyramidBoundsVersion = 0;						// the one m_depthPyramid was built from
+	} m_hiZData;
+	DepthPyramid m_depthPyramid;
+
+	struct IndirectData {
+		static constexpr uint32_t cameraView = 0;	// depth pre-pass and forward
+		static constexpr uint32_t shadowView = 1;
+		static constexpr uint32_t viewCount = 2;
+		std::shared_ptr<IndirectScene> scene;	// null without multiDrawIndirect
+		std::shared_ptr<Pipeline> depthPipeline;
+		std::shared_ptr<Pipeline> shadowPipeline;
+		std::shared_ptr<Pipeline> forwardPipeline;
+		std::shared_ptr<DescriptorSet> depthDescriptorSet;
+		std::shared_ptr<DescriptorSet> shadowDescriptorSet;
+		std::shared_ptr<DescriptorSet> forwardDescriptorSet;
+	} m_indirectData;
+
+	struct InstancedData {
+		static constexpr uint32_t capacity = 1 << 16;	// transforms per frame, every pass included
+		std::shared_ptr<InstanceBuffer> buffer;	// null without instanced models
+		std::shared_ptr<Pipeline> depthPipeline;
+		std::shared_ptr<Pipeline> shadowPipeline;
+		std::shared_ptr<Pipeline> forwardPipeline;
+		std::shared_ptr<DescriptorSet> depthDescriptorSet;
+		std::shared_ptr<DescriptorSet> shadowDescriptorSet;
+		std::shared_ptr<DescriptorSet> forwardDescriptorSet;
+	} m_instancedData;
+
+	struct ToneMappingData {
+		FrameResource<Texture2D> texture;
+		std::shared_ptr<Pipeline> pipeline;
+		std::shared_ptr<DescriptorSet> descriptorSet;
+	} m_toneMappingData;
+};
@@ -0,0 +1,238 @@
+#include "src/threadPool.hpp"
+
+struct ThreadPool::Job {
+	std::function<void()> func;
+	JobCounter* counter;
+	const JobCounter* dependency;
+};
+
+// chase-lev deque of a fixed capacity, lê et al. "correct and efficient work-stealing for weak memory models".
+// the owner pushes and pops at the bottom, thieves take from the top
+class ThreadPool::JobDeque {
+public:
+	// owner only, false when full
+	bool push(Job* job) {
+		int64_t bottom = m_bottom.load(std::memory_order_relaxed);
+		int64_t top = m_top.load(std::memory_order_acquire);
+		if (bottom - top >= capacity)
+			return false;
+		m_jobs[bottom & (capacity - 1)].store(job, std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_release);
+		m_bottom.store(bottom + 1, std::memory_order_relaxed);
+		return true;
+	}
+
+	// owner only, the newest job
+	Job* pop() {
+		int64_t bottom = m_bottom.load(std::memory_order_relaxed) - 1;
+		m_bottom.store(bottom, std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		int64_t top = m_top.load(std::memory_order_relaxed);
+		if (top > bottom) {
+			m_bottom.store(bottom + 1, std::memory_order_relaxed);
+			return nullptr;
+		}
+
+		Job* job = m_jobs[bottom & (capacity - 1)].load(std::memory_order_relaxed);
+		if (top == bottom) {
+			// the last one, the thieves may be taking it too
+			if (!m_top.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+				job = nullptr;
+			m_bottom.store(bottom + 1, std::memory_order_relaxed);
+		}
+		return job;
+	}
+
+	// any thread, the oldest job. nullptr when empty or taken by another thread first
+	Job* steal() {
+		int64_t top = m_top.load(std::memory_order_acquire);
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		int64_t bottom = m_bottom.load(std::memory_order_acquire);
+		if (top >= bottom)
+			return nullptr;
+
+		Job* job = m_jobs[top & (capacity - 1)].load(std::memory_order_relaxed);
+		if (!m_top.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+			return nullptr;
+		return job;
+	}
+
+private:
+	static const int64_t capacity = 4096;
+
+	alignas(64) std::atomic<int64_t> m_top{ 0 };
+	alignas(64) std::atomic<int64_t> m_bottom{ 0 };
+	std::atomic<Job*> m_jobs[capacity];
+};
+
+// the pool whose deque m_deques[threadIndex] the thread owns
+static thread_local ThreadPool* threadPool = nullptr;
+static thread_local uint32_t threadIndex = 0;
+
+ThreadPool::ThreadPool(uint32_t threadCount) {
+	for (uint32_t i = 0; i < std::max(threadCount, 1u); i++)
+		m_deques.push_back(std::make_unique<JobDeque>());
+	if (threadPool == nullptr)
+		threadPool = this;
+
+	// the thread waiting works too
+	for (uint32_t i = 1; i < threadCount; i++)
+		m_threads.emplace_back(&ThreadPool::workerLoop, this, i);
+}
+
+ThreadPool::~ThreadPool() {
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_stop = true;
+	}
+	m_condition.notify_all();
+	for (auto& thread : m_threads)
+		thread.join();
+
+	if (threadPool == this)
+		threadPool = nullptr;
+	DEBUG_ASSERT(m_deferred.empty(), "%zu jobs never started, their dependency isn't done", m_deferred.size());
+}
+
+ThreadPool& ThreadPool::get() {
+	static ThreadPool pool(std::max(1u, std::thread::hardware_concurrency()));
+	return pool;
+}
+
+uint32_t ThreadPool::getThreadIndex() {
+	return threadIndex;
+}
+
+void ThreadPool::submit(std::function<void()> job, JobCounter* counter, const JobCounter* dependency) {
+	if (counter)
+		counter->m_count++;
+	Job* newJob = new Job{ std::move(job), counter, dependency };
+
+	if (dependency && !dependency->isDone()) {
+		{
+			std::lock_guard<std::mutex> lock(m_deferredMutex);
+			m_deferred.push_back(newJob);
+			m_deferredCount++;
+		}
+		// the dependency may have been done before the job was deferred
+		releaseDeferred();
+		return;
+	}
+	push(newJob);
+}
+
+void ThreadPool::wait(const JobCounter& counter) {
+	while (!counter.isDone()) {
+		if (Job* job = findJob())
+			runJob(job);
+		else
+			std::this_thread::yield();
+	}
+}
+
+void ThreadPool::parallelFor(uint32_t count, const std::function<void(uint32_t)>& func) {
+	if (count == 0)
+		return;
+
+	// the indices are handed out one at a time to whoever runs the jobs, they balance uneven calls
+	std::atomic<uint32_t> next{ 0 };
+	auto run = [&]() {
+		for (uint32_t i = next++; i < count; i = next++)
+			func(i);
+	};
+
+	JobCounter counter;
+	uint32_t helpers = std::min(static_cast<uint32_t>(m_threads.size()), count - 1);
+	for (uint32_t i = 0; i < helpers; i++)
+		submit(run, &counter);
+
+	run();
+	wait(counter);
+}
+
+void ThreadPool::workerLoop(uint32_t index) {
+	threadPool = this;
+	threadIndex = index;
+	while (true) {
+		if (Job* job = findJob()) {
+			runJob(job);
+			continue;
+		}
+
+		std::unique_lock<std::mutex> lock(m_mutex);
+		m_sleeping++;
+		m_condition.wait(lock, [this] { return m_stop || m_pending > 0; });
+		m_sleeping--;
+		if (m_stop && m_pending == 0)
+			return;
+	}
+}
+
+void ThreadPool::push(Job* job) {
+	// counted first, a thief may take it as soon as it is pushed
+	m_pending++;
+	if (threadPool != this || !m_deques[threadIndex]->push(job)) {
+		std::lock_guard<std::mutex> lock(m_injectedMutex);
+		m_injected.push_back(job);
+	}
+
+	// a worker about to sleep holds m_mutex until it waits, and sees m_pending once it has it
+	if (m_sleeping > 0) {
+		{ std::lock_guard<std::mutex> lock(m_mutex); }
+		m_condition.notify_one();
+	}
+}
+
+ThreadPool::Job* ThreadPool::findJob() {
+	if (m_pending == 0)
+		return nullptr;
+
+	Job* job = nullptr;
+	uint32_t deque = threadPool == this ? threadIndex : 0;
+	if (threadPool == this)
+		job = m_deques[deque]->pop();
+
+	if (job == nullptr) {
+		std::lock_guard<std::mutex> lock(m_injectedMutex);
+		if (!m_injected.empty()) {
+			job = m_injected.front();
+			m_injected.pop_front();
+		}
+	}
+
+	// from the next thread's on, so the thieves spread
+	uint32_t dequeCount = static_cast<uint32_t>(m_deques.size());
+	for (uint32_t i = 1; job == nullptr && i <= dequeCount; i++)
+		job = m_deques[(deque + i) % dequeCount]->steal();
+
+	if (job)
+		m_pending--;
+	return job;
+}
+
+void ThreadPool::runJob(Job* job) {
+	job->func();
+	if (job->counter && --job->counter->m_count == 0 && m_deferredCount > 0)
+		releaseDeferred();
+	delete job;
+}
+
+void ThreadPool::releaseDeferred() {
+	std::vector<Job*> ready;
+	{
+		std::lock_guard<std::mutex> lock(m_deferredMutex);
+		for (size_t i = 0; i < m_deferred.size();) {
+			if (m_deferred[i]->dependency->isDone()) {
+				ready.push_back(m_deferred[i]);
+				m_deferred[i] = m_deferred.back();
+				m_deferred.pop_back();
+			}
+			else {
+				i++;
+			}
+		}
+		m_deferredCount = static_cast<uint32_t>(m_deferred.size());
+	}
+	for (Job* job : ready)
+		push(job);
+}
@@ -0,0 +1,68 @@
+#pragma once
+#include "src/vulkan/vkHeader.hpp"
+#include <thread>
+#include <condition_variable>
+#include <functional>
+#include <atomic>
+
+// unfinished jobs of a group, jobs submitted with it add one until they are done
+class JobCounter {
+public:
+	bool isDone() const { return m_count.load() == 0; }
+
+private:
+	friend class ThreadPool;
+	std::atomic<uint32_t> m_count{ 0 };
+};
+
+// work stealing job system : every worker, and the thread that created the pool, pushes and pops its own jobs at one end
+// of a deque while idle threads steal the oldest ones at the other end. jobs submitted by other threads go through a shared queue.
+// waiting threads run jobs until what they wait on is done, so jobs may submit and wait on other jobs
+class ThreadPool {
+public:
+	ThreadPool(uint32_t threadCount);
+	~ThreadPool();
+
+	ThreadPool(const ThreadPool&) = delete;
+	ThreadPool& operator=(const ThreadPool&) = delete;
+
+	static ThreadPool& get();
+
+	// runs job on any thread. counter : counts the job until it is done. dependency : the job starts once it is done,
+	// submit the jobs it counts first, it may be done in between otherwise
+	void submit(std::function<void()> job, JobCounter* counter = nullptr, const JobCounter* dependency = nullptr);
+	// runs jobs until counter is done, from any thread
+	void wait(const JobCounter& counter);
+	// calls func(i) for every i in [0, count) and returns once all calls are done, the calling thread helps
+	void parallelFor(uint32_t count, const std::function<void(uint32_t)>& func);
+
+	uint32_t getThreadCount() const { return static_cast<uint32_t>(m_threads.size()) + 1; }
+	// 1 to getThreadCount() - 1 on the workers, 0 on any other thread. indexes per thread data used inside parallelFor
+	// when it is called from outside the workers
+	static uint32_t getThreadIndex();
+
+private:
+	struct Job;
+	class JobDeque;
+
+	void workerLoop(uint32_t index);
+	void push(Job* job);
+	// the calling thread's newest job, then a shared one, then one stolen from another thread, nullptr when none is found
+	Job* findJob();
+	void runJob(Job* job);
+	// pushes the deferred jobs whose dependency is done
+	void releaseDeferred();
+
+	std::vector<std::thread> m_threads;
+	std::vector<std::unique_ptr<JobDeque>> m_deques;	// 0 : the creating thread's, then one per worker
+	std::deque<Job*> m_injected;						// submitted from threads without a deque
+	std::mutex m_injectedMutex;
+	std::vector<Job*> m_deferred;						// waiting on their dependency
+	std::mutex m_deferredMutex;
+	std::atomic<uint32_t> m_deferredCount{ 0 };
+	std::atomic<uint32_t> m_pending{ 0 };				// jobs pushed and not taken yet
+	std::atomic<uint32_t> m_sleeping{ 0 };
+	std::mutex m_mutex;
+	std::condition_variable m_condition;
+	bool m_stop = false;
+};
@@ -0,0 +1,169 @@
+#include "src/vertexPacking.hpp"
+
+namespace VertexPacking {
+
+	static glm::vec2 signNotZero(const glm::vec2& v) {
+		return glm::vec2(v.x >= 0.f ? 1.f : -1.f, v.y >= 0.f ? 1.f : -1.f);
+	}
+
+	glm::vec2 octEncode(const glm::vec3& n) {
+		glm::vec3 p = n / (std::abs(n.x) + std::abs(n.y) + std::abs(n.z));
+		glm::vec2 e(p.x, p.y);
+		// the lower hemisphere is folded over the diagonals
+		if (p.z < 0.f)
+			e = (glm::vec2(1.f) - glm::abs(glm::vec2(e.y, e.x))) * signNotZero(e);
+		return e;
+	}
+
+	glm::vec3 octDecode(const glm::vec2& e) {
+		glm::vec3 n(e.x, e.y, 1.f - std::abs(e.x) - std::abs(e.y));
+		float t = std::max(-n.z, 0.f);
+		n.x += n.x >= 0.f ? -t : t;
+		n.y += n.y >= 0.f ? -t : t;
+		return glm::normalize(n);
+	}
+
+	static glm::vec3 getNormal(const Vertex& vertex) {
+		float length = glm::length(vertex.normal);
+		return length > 0.f ? vertex.normal / length : glm::vec3(0.f, 0.f, 1.f);
+	}
+
+	// gram-schmidt against the normal, any perpendicular direction when the tangent is missing
+	static glm::vec3 getTangent(const Vertex& vertex, const glm::vec3& normal) {
+		glm::vec3 tangent = vertex.tangent - normal * glm::dot(normal, vertex.tangent);
+		float length = glm::length(tangent);
+		if (length > 1e-6f)
+			return tangent / length;
+
+		glm::vec3 axis = std::abs(normal.x) < 0.9f ? glm::vec3(1.f, 0.f, 0.f) : glm::vec3(0.f, 1.f, 0.f);
+		return glm::normalize(glm::cross(axis, normal));
+	}
+
+	static float angleDegrees(const glm::vec3& a, const glm::vec3& b) {
+		return glm::degrees(std::acos(glm::clamp(glm::dot(a, b), -1.f, 1.f)));
+	}
+
+	Bounds computeBounds(const Vertex* vertices, size_t vertexCount) {
+		Bounds bounds;
+		if (vertexCount == 0)
+			return bounds;
+
+		glm::vec3 min = vertices[0].pos;
+		glm::vec3 max = vertices[0].pos;
+		for (size_t i = 1; i < vertexCount; i++) {
+			min = glm::min(min, vertices[i].pos);
+			max = glm::max(max, vertices[i].pos);
+		}
+
+		bounds.offset = min;
+		bounds.scale = max - min;
+		// flat axes still need a valid scale to divide by
+		for (int axis = 0; axis < 3; axis++) {
+			if (bounds.scale[axis] <= 0.f)
+				bounds.scale[axis] = 1.f;
+		}
+		return bounds;
+	}
+
+	void pack(const Vertex* vertices, size_t vertexCount, const Bounds& bounds, PackedVertex* output) {
+		glm::vec3 inverseScale = 1.f / bounds.scale;
+
+		for (size_t i = 0; i < vertexCount; i++) {
+			const Vertex& vertex = vertices[i];
+			PackedVertex& packed = output[i];
+
+			glm::vec3 position = glm::clamp((vertex.pos - bounds.offset) * inverseScale, glm::vec3(0.f), glm::vec3(1.f));
+			glm::vec3 normal = getNormal(vertex);
+			glm::vec3 tangent = getTangent(vertex, normal);
+			bool positiveBitangent = glm::dot(glm::cross(normal, tangent), vertex.bitangent) >= 0.f;
+
+			packed.position[0] = glm::packUnorm1x16(position.x);
+			packed.position[1] = glm::packUnorm1x16(position.y);
+			packed.position[2] = glm::packUnorm1x16(position.z);
+			packed.position[3] = positiveBitangent ? UINT16_MAX : 0;
+
+			glm::vec2 octNormal = octEncode(normal);
+			packed.normal[0] = static_cast<int16_t>(glm::packSnorm1x16(octNormal.x));
+			packed.normal[1] = static_cast<int16_t>(glm::packSnorm1x16(octNormal.y));
+
+			packed.texCoord[0] = glm::packHalf1x16(vertex.texCoord.x);
+			packed.texCoord[1] = glm::packHalf1x16(vertex.texCoord.y);
+
+			glm::vec2 octTangent = octEncode(tangent);
+			packed.tangent[0] = static_cast<int16_t>(glm::packSnorm1x16(octTangent.x));
+			packed.tangent[1] = static_cast<int16_t>(glm::packSnorm1x16(octTangent.y));
+		}
+	}
+
+	// same decode as the PACKED_VERTEX path of vertexInput.glsl
+	Vertex unpack(const PackedVertex& packed, const Bounds& bounds) {
+		Vertex vertex{};
+
+		glm::vec3 position(
+			glm::unpackUnorm1x16(packed.position[0]),
+			glm::unpackUnorm1x16(packed.position[1]),
+			glm::unpackUnorm1x16(packed.position[2]));
+		vertex.pos = bounds.offset + bounds.scale * position;
+
+		vertex.normal = octDecode(glm::vec2(
+			glm::unpackSnorm1x16(static_cast<uint16_t>(packed.normal[0])),
+			glm::unpackSnorm1x16(static_cast<uint16_t>(packed.normal[1]))));
+
+		vertex.texCoord = glm::vec2(glm::unpackHalf1x16(packed.texCoord[0]), glm::unpackHalf1x16(packed.texCoord[1]));
+
+		vertex.tangent = octDecode(glm::vec2(
+			glm::unpackSnorm1x16(static_cast<uint16_t>(packed.tangent[0])),
+			glm::unpackSnorm1x16(static_cast<uint16_t>(packed.tangent[1]))));
+
+		float sign = packed.position[3] > UINT16_MAX / 2 ? 1.f : -1.f;
+		vertex.bitangent = glm::cross(vertex.normal, vertex.tangent) * sign;
+		return vertex;
+	}
+
+	void measure(const Vertex* vertices, const PackedVertex* packed, size_t vertexCount, const Bounds& bounds, QualityStats& stats) {
+		for (size_t i = 0; i < vertexCount; i++) {
+			const Vertex& source = vertices[i];
+			Vertex decoded = unpack(packed[i], bounds);
+
+			float positionError = glm::length(decoded.pos - source.pos);
+			stats.maxPositionError = std::max(stats.maxPositionError, positionError);
+			stats.positionErrorSum += positionError;
+
+			glm::vec3 normal = getNormal(source);
+			float normalError = angleDegrees(normal, decoded.normal);
+			stats.maxNormalError = std::max(stats.maxNormalError, normalError);
+			stats.normalErrorSum += normalError;
+
+			stats.maxTangentError = std::max(stats.maxTangentError, angleDegrees(getTangent(source, normal), decoded.tangent));
+
+			glm::vec2 texCoordDelta = glm::abs(decoded.texCoord - source.texCoord);
+			float texCoordError = std::max(texCoordDelta.x, texCoordDelta.y);
+			stats.maxTexCoordError = std::max(stats.maxTexCoordError, texCoordError);
+			stats.texCoordErrorSum += texCoordError;
+		}
+		stats.vertexCount += vertexCount;
+	}
+
+	void QualityStats::add(const QualityStats& other) {
+		vertexCount += other.vertexCount;
+		maxPositionError = std::max(maxPositionError, other.maxPositionError);
+		positionErrorSum += other.positionErrorSum;
+		maxNormalError = std::max(maxNormalError, other.maxNormalError);
+		normalErrorSum += other.normalErrorSum;
+		maxTangentError = std::max(maxTangentError, other.maxTangentError);
+		maxTexCoordError = std::max(maxTexCoordError, other.maxTexCoordError);
+		texCoordErrorSum += other.texCoordErrorSum;
+	}
+
+	void QualityStats::print(const char* name) const {
+		if (vertexCount == 0)
+			return;
+
+		double count = static_cast<double>(vertexCount);
+		printf("%s: packed %llu vertices, %.1f -> %.1f MB\n", name, static_cast<unsigned long long>(vertexCount),
+			count * sizeof(Vertex) / (1024.0 * 1024.0), count * sizeof(PackedVertex) / (1024.0 * 1024.0));
+		printf("  position error max %.6f avg %.6f, normal error max %.4f avg %.4f deg, tangent error max %.4f deg, uv error max %.6f avg %.6f\n",
+			maxPositionError, positionErrorSum / count, maxNormalError, normalErrorSum / count,
+			maxTangentError, maxTexCoordError, texCoordErrorSum / count);
+	}
+}
@@ -0,0 +1,46 @@
+#pragma once
+#include "src/vulkan/vkHeader.hpp"
+#include "src/model.hpp"
+
+// 20 byte vertex, the attribute order matches the PACKED_VERTEX inputs of vertexInput.glsl
+struct PackedVertex {
+	uint16_t position[4];	// unorm16 inside the mesh bounds, w : bitangent sign (0 -> -1, 1 -> +1)
+	int16_t normal[2];		// octahedral snorm16
+	uint16_t texCoord[2];	// half float
+	int16_t tangent[2];		// octahedral snorm16, orthogonalized against the normal
+};
+static_assert(sizeof(PackedVertex) == 20, "PackedVertex must stay tightly packed");
+
+namespace VertexPacking {
+
+	// dequantization : position = offset + scale * unorm
+	struct Bounds {
+		glm::vec3 offset = glm::vec3(0.0f);
+		glm::vec3 scale = glm::vec3(1.0f);
+	};
+
+	// decode error of the packed vertices against the fp32 source
+	struct QualityStats {
+		uint64_t vertexCount = 0;
+		float maxPositionError = 0.f;	// in model units
+		double positionErrorSum = 0.0;
+		float maxNormalError = 0.f;		// in degrees
+		double normalErrorSum = 0.0;
+		float maxTangentError = 0.f;	// in degrees, against the orthogonalized source tangent
+		float maxTexCoordError = 0.f;
+		double texCoordErrorSum = 0.0;
+
+		void add(const QualityStats& other);
+		void print(const char* name) const;
+	};
+
+	Bounds computeBounds(const Vertex* vertices, size_t vertexCount);
+
+	void pack(const Vertex* vertices, size_t vertexCount, const Bounds& bounds, PackedVertex* output);
+	Vertex unpack(const PackedVertex& vertex, const Bounds& bounds);
+
+	void measure(const Vertex* vertices, const PackedVertex* packed, size_t vertexCount, const Bounds& bounds, QualityStats& stats);
+
+	glm::vec2 octEncode(const glm::vec3& n);
+	glm::vec3 octDecode(const glm::vec2& e);
+}
@@ -0,0 +1,103 @@
+#include "src/vertexWelder.hpp"
+
+// key words of a vertex, -0 folded into +0 so bitwise equality matches float equality
+static void getKey(const Vertex& vertex, uint32_t key[8]) {
+	const float values[8] = {
+		vertex.pos.x, vertex.pos.y, vertex.pos.z,
+		vertex.normal.x, vertex.normal.y, vertex.normal.z,
+		vertex.texCoord.x, vertex.texCoord.y
+	};
+	for (int i = 0; i < 8; i++) {
+		float value = values[i] == 0.f ? 0.f : values[i];
+		memcpy(&key[i], &value, sizeof(float));
+	}
+}
+
+static bool keyEquals(const Vertex& a, const Vertex& b) {
+	uint32_t keyA[8], keyB[8];
+	getKey(a, keyA);
+	getKey(b, keyB);
+	return memcmp(keyA, keyB, sizeof(keyA)) == 0;
+}
+
+static uint64_t rotateLeft(uint64_t value, int shift) {
+	return (value << shift) | (value >> (64 - shift));
+}
+
+uint64_t VertexWelder::hash(const Vertex& vertex) {
+	uint32_t key[8];
+	getKey(vertex, key);
+
+	// xxhash64 style rounds on pairs of words, then a murmur3 finalizer
+	uint64_t h = 0x27d4eb2f165667c5ull;
+	for (int i = 0; i < 8; i += 2) {
+		uint64_t word = uint64_t(key[i]) | (uint64_t(key[i + 1]) << 32);
+		h ^= rotateLeft(word * 0xc2b2ae3d27d4eb4full, 31) * 0x9e3779b185ebca87ull;
+		h = rotateLeft(h, 27) * 0x9e3779b185ebca87ull + 0x85ebca77c2b2ae63ull;
+	}
+	h ^= h >> 33;
+	h *= 0xff51afd7ed558ccdull;
+	h ^= h >> 33;
+	h *= 0xc4ceb9fe1a85ec53ull;
+	h ^= h >> 33;
+	return h;
+}
+
+VertexWelder::VertexWelder(std::vector<Vertex>& vertices, size_t expectedVertexCount)
+	: m_vertices(vertices) {
+	m_vertices.reserve(m_vertices.size() + expectedVertexCount);
+
+	// stays at most half full until the estimate is exceeded
+	size_t capacity = 16;
+	while (capacity < expectedVertexCount * 2)
+		capacity *= 2;
+	rehash(capacity);
+}
+
+void VertexWelder::rehash(size_t capacity) {
+	std::vector<Slot> slots(capacity, Slot{ 0, EMPTY_SLOT });
+	size_t mask = capacity - 1;
+
+	for (const Slot& slot : m_slots) {
+		if (slot.index == EMPTY_SLOT)
+			continue;
+		size_t position = hash(m_vertices[slot.index]) & mask;
+		while (slots[position].index != EMPTY_SLOT)
+			position = (position + 1) & mask;
+		slots[position] = slot;
+	}
+
+	m_slots = std::move(slots);
+	m_mask = mask;
+}
+
+uint32_t VertexWelder::weld(const Vertex& vertex) {
+	if ((m_count + 1) * 10 > m_slots.size() * 7)
+		rehash(m_slots.size() * 2);
+
+	uint64_t h = hash(vertex);
+	uint32_t fingerprint = static_cast<uint32_t>(h >> 32);
+	size_t position = h & m_mask;
+	m_lookupCount++;
+
+	while (true) {
+		Slot& slot = m_slots[position];
+		if (slot.index == EMPTY_SLOT) {
+			slot.hash = fingerprint;
+			slot.index = static_cast<uint32_t>(m_vertices.size());
+			m_vertices.push_back(vertex);
+			m_count++;
+			return slot.index;
+		}
+
+		if (slot.hash == fingerprint && keyEquals(m_vertices[slot.index], vertex)) {
+			Vertex& welded = m_vertices[slot.index];
+			welded.tangent += vertex.tangent;
+			welded.bitangent += vertex.bitangent;
+			return slot.index;
+		}
+
+		position = (position + 1) & m_mask;
+		m_probeCount++;
+	}
+}
@@ -0,0 +1,35 @@
+#pragma once
+#include "src/vulkan/vkHeader.hpp"
+#include "src/model.hpp"
+
+// merges vertices with identical position, normal and uv through a flat open addressing table.
+// tangent and bitangent are not part of the key, they are summed over every welded corner
+class VertexWelder {
+public:
+	VertexWelder(std::vector<Vertex>& vertices, size_t expectedVertexCount);
+
+	// index of the matching vertex, appended to the output if it is new
+	uint32_t weld(const Vertex& vertex);
+
+	uint64_t getLookupCount() const { return m_lookupCount; }
+	uint64_t getProbeCount() const { return m_probeCount; }
+
+	static uint64_t hash(const Vertex& vertex);
+
+private:
+	struct Slot {
+		uint32_t hash;
+		uint32_t index;	// EMPTY_SLOT when unused
+	};
+	static constexpr uint32_t EMPTY_SLOT = UINT32_MAX;
+
+	void rehash(size_t capacity);
+
+	std::vector<Vertex>& m_vertices;
+	std::vector<Slot> m_slots;
+	size_t m_mask = 0;
+	size_t m_count = 0;
+
+	uint64_t m_lookupCount = 0;
+	uint64_t m_probeCount = 0;
+};
@@ -1,16 +1,17 @@
 #include "src/vulkan/buffer.hpp"
-#include "src/vulkan/commandBuffer.hpp"
+#include "src/vulkan/context.hpp"
 #include "src/vulkan/device.hpp"
+#include "src/vulkan/uploadQueue.hpp"
 
 Buffer::Buffer() {
 }
 
 Buffer::~Buffer() {
 	vkDestroyBuffer(Device::getHandle(), m_handle, nullptr);
-	vkFreeMemory(Device::getHandle(), m_memory, nullptr);
+	Device::get()->getAllocator().free(m_allocation);
 }
 
-void Buffer::createBuffer(uint32_t size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties, VkBuffer& buffer, VkDeviceMemory& bufferMemory)
+void Buffer::createBuffer(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties)
 {
 	VkBufferCreateInfo bufferInfo{};
 	bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
@@ -18,107 +19,59 @@ void Buffer::createBuffer(uint32_t size, VkBufferUsageFlags usage, VkMemoryPrope
 	bufferInfo.usage = usage;
 	bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
 
-	VK_CHECK(vkCreateBuffer(Device::getHandle(), &bufferInfo, nullptr, &buffer));
+	VK_CHECK(vkCreateBuffer(Device::getHandle(), &bufferInfo, nullptr, &m_handle));
 
 	VkMemoryRequirements memRequirements;
-	vkGetBufferMemoryRequirements(Device::getHandle(), buffer, &memRequirements);
+	vkGetBufferMemoryRequirements(Device::getHandle(), m_handle, &memRequirements);
 
-	VkMemoryAllocateInfo allocInfo{};
-	allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-	allocInfo.allocationSize = memRequirements.size;
-	allocInfo.memoryTypeIndex = Context::get()->getDevice()->getPhysicalDevice().findMemoryType(memRequirements.memoryTypeBits, properties);
+	AllocationInfo allocInfo{};
+	allocInfo.properties = properties;
+	allocInfo.linear = true;
+	m_allocation = Device::get()->getAllocator().allocate(memRequirements, allocInfo);
 
-	VK_CHECK(vkAllocateMemory(Device::getHandle(), &allocInfo, nullptr, &bufferMemory));
-
-	vkBindBufferMemory(Device::getHandle(), buffer, bufferMemory, 0);
-}
-
-void Buffer::createBuffer(uint32_t size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties)
-{
-	createBuffer(size, usage, properties, m_handle, m_memory);
+	VK_CHECK(vkBindBufferMemory(Device::getHandle(), m_handle, m_allocation.memory, m_allocation.offset));
 }
 
 void Buffer::copyBuffer(VkBuffer srcBuffer, VkBuffer dstBuffer, VkDeviceSize size) {
-	CommandPool commandPool;
-	CommandBuffer commandBuffer(commandPool.getHandle());
-	commandBuffer.beginRecording();
-
 	VkBufferCopy copyRegion{};
 	copyRegion.size = size;
-	vkCmdCopyBuffer(commandBuffer.getHandle(), srcBuffer, dstBuffer, 1, &copyRegion);
-
-	commandBuffer.endRecording();
-
-	commandBuffer.submit(false);
-
-	vkQueueWaitIdle(Device::get()->getGraphicsQueue()); // temp
+	copyBuffer(srcBuffer, dstBuffer, { copyRegion });
 }
 
+void Buffer::copyBuffer(VkBuffer srcBuffer, VkBuffer dstBuffer, const std::vector<VkBufferCopy>& regions) {
+	if (regions.empty())
+		return;
 
+	// callers may free the source right after, so this one waits
+	auto uploadQueue = Context::get()->getUploadQueue();
+	uploadQueue->copyBuffer(srcBuffer, dstBuffer, regions);
+	uploadQueue->wait(uploadQueue->flush());
+}
 
 // vertex buffer
 VertexBuffer::VertexBuffer(uint32_t size, const void* vData) {
 	VkDeviceSize bufferSize = size;
 
-	VkBuffer stagingBuffer;
-	VkDeviceMemory stagingBufferMemory;
-	createBuffer(
-		bufferSize,
-		VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-		VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-		stagingBuffer,
-		stagingBufferMemory
-	);
-
-	// todo
-	void* data;
-	vkMapMemory(Device::getHandle(), stagingBufferMemory, 0, bufferSize, 0, &data);
-	memcpy(data, vData, (size_t)bufferSize);
-	vkUnmapMemory(Device::getHandle(), stagingBufferMemory);
-
 	createBuffer(
 		bufferSize,
 		VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
-		VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
-		m_handle,
-		m_memory
+		VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT
 	);
 
-	copyBuffer(stagingBuffer, m_handle, bufferSize);
-	vkDestroyBuffer(Device::getHandle(), stagingBuffer, nullptr);
-	vkFreeMemory(Device::getHandle(), stagingBufferMemory, nullptr);
+	Context::get()->getUploadQueue()->copyToBuffer(m_handle, 0, vData, bufferSize);
 }
 
 // index buffer
 IndexBuffer::IndexBuffer(uint32_t size, const void* vData) {
 	VkDeviceSize bufferSize = size;
 
-	VkBuffer stagingBuffer;
-	VkDeviceMemory stagingBufferMemory;
-	createBuffer(
-		bufferSize,
-		VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-		VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-		stagingBuffer,
-		stagingBufferMemory
-	);
-
-	void* data;
-	vkMapMemory(Device::getHandle(), stagingBufferMemory, 0, bufferSize, 0, &data);
-	memcpy(data, vData, (size_t)bufferSize);
-	vkUnmapMemory(Device::getHandle(), stagingBufferMemory);
-
 	createBuffer(
 		bufferSize,
 		VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT,
-		VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
-		m_handle,
-		m_memory
+		VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT
 	);
 
-	copyBuffer(stagingBuffer, m_handle, bufferSize);
-	vkDestroyBuffer(Device::getHandle(), stagingBuffer, nullptr);
-	vkFreeMemory(Device::getHandle(), stagingBufferMemory, nullptr);
+	Context::get()->getUploadQueue()->copyToBuffer(m_handle, 0, vData, bufferSize);
 }
 
 // uniform buffer
@@ -126,9 +79,9 @@ UniformBuffer::UniformBuffer( uint32_t size)
 	: m_size(size) {
 	VkDeviceSize bufferSize = size;
 
-	createBuffer(bufferSize, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, m_handle, m_memory);
+	createBuffer(bufferSize, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
 
-	vkMapMemory(Device::getHandle(), m_memory, 0, bufferSize, 0, &m_mapped);
+	m_mapped = m_allocation.mapped;
 }
 
 void UniformBuffer::setData(void* data, uint32_t size)
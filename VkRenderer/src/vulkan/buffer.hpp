@@ -1,20 +1,22 @@
 #pragma once
 #include "src/vulkan/vkHeader.hpp"
+#include "src/vulkan/memoryAllocator.hpp"
 
 class Buffer {
 public:
 	Buffer();
 	~Buffer();
 
-	void createBuffer(uint32_t size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties, VkBuffer& buffer, VkDeviceMemory& bufferMemory);
-	void createBuffer(uint32_t size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties);
+	void createBuffer(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties);
 	void copyBuffer(VkBuffer srcBuffer, VkBuffer dstBuffer, VkDeviceSize size);
+	void copyBuffer(VkBuffer srcBuffer, VkBuffer dstBuffer, const std::vector<VkBufferCopy>& regions);
 
 	VkBuffer getHandle() { return m_handle; }
-	VkDeviceMemory getMemory() { return m_memory; }
+	const Allocation& getAllocation() const { return m_allocation; }
+	void* getMapped() const { return m_allocation.mapped; }
 protected:
 	VkBuffer m_handle = VK_NULL_HANDLE;
-	VkDeviceMemory m_memory = VK_NULL_HANDLE;
+	Allocation m_allocation;
 };
 
 class VertexBuffer : public Buffer {
@@ -4,6 +4,7 @@
 #include "src/vulkan/framebuffer.hpp"
 #include "src/vulkan/pipeline.hpp"
 #include "src/vulkan/renderPass.hpp"
+#include "src/vulkan/shader.hpp"
 
 CommandPool::CommandPool() {
 	auto& pDevice = Device::get()->getPhysicalDevice();
@@ -20,16 +21,22 @@ CommandPool::~CommandPool() {
 	vkDestroyCommandPool(Device::getHandle(), m_handle, nullptr);
 }
 
-CommandBuffer::CommandBuffer(VkCommandPool commandPool)
+void CommandPool::reset() {
+	VK_CHECK(vkResetCommandPool(Device::getHandle(), m_handle, 0));
+}
+
+CommandBuffer::CommandBuffer(VkCommandPool commandPool, VkCommandBufferLevel level)
 	: m_commandPool(commandPool) {
 	VkCommandBufferAllocateInfo allocInfo{};
 	allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
-	allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+	allocInfo.level = level;
 	allocInfo.commandPool = m_commandPool;
 	allocInfo.commandBufferCount = 1;
 
 	VK_CHECK(vkAllocateCommandBuffers(Device::getHandle(), &allocInfo, &m_handle));
 
+	if (level == VK_COMMAND_BUFFER_LEVEL_SECONDARY)
+		return;
 	m_imageAvailableSemaphores = std::make_unique<Semaphore>();
 	m_renderFinishedSemaphores = std::make_unique<Semaphore>();
 	m_fence = std::make_unique<Fence>();
@@ -45,11 +52,38 @@ void CommandBuffer::beginRecording() {
 	beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
 
 	VK_CHECK(vkBeginCommandBuffer(m_handle, &beginInfo));
+
+	// a new recording starts without any state
+	forgetState();
+	m_stats = Stats{};
 }
 
-void CommandBuffer::beginRenderpass(std::shared_ptr<RenderPass> renderPass, std::shared_ptr<Framebuffer> framebuffer, uint32_t width, uint32_t height)
+void CommandBuffer::beginRecording(const CommandBuffer& primary) {
+	m_renderPass = primary.m_renderPass;
+	m_framebuffer = primary.m_framebuffer;
+
+	VkCommandBufferInheritanceInfo inheritanceInfo{};
+	inheritanceInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO;
+	inheritanceInfo.renderPass = m_renderPass->getHandle();
+	inheritanceInfo.subpass = 0;
+	inheritanceInfo.framebuffer = m_framebuffer->getHandle();
+
+	VkCommandBufferBeginInfo beginInfo{};
+	beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+	beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT | VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT;
+	beginInfo.pInheritanceInfo = &inheritanceInfo;
+
+	VK_CHECK(vkBeginCommandBuffer(m_handle, &beginInfo));
+
+	// nothing is inherited from the primary, not even the viewport
+	forgetState();
+	m_stats = Stats{};
+}
+
+void CommandBuffer::beginRenderpass(std::shared_ptr<RenderPass> renderPass, std::shared_ptr<Framebuffer> framebuffer, uint32_t width, uint32_t height, bool secondaryContents)
 {
 	m_renderPass = renderPass;
+	m_framebuffer = framebuffer;
 	
 	auto& clearValues = renderPass->getClearValues();
 
@@ -62,7 +96,7 @@ void CommandBuffer::beginRenderpass(std::shared_ptr<RenderPass> renderPass, std:
 	renderPassInfo.clearValueCount = static_cast<uint32_t>(clearValues.size());
 	renderPassInfo.pClearValues = clearValues.data();
 
-	vkCmdBeginRenderPass(m_handle, &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
+	vkCmdBeginRenderPass(m_handle, &renderPassInfo, secondaryContents ? VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS : VK_SUBPASS_CONTENTS_INLINE);
 
 }
 
@@ -76,6 +110,22 @@ void CommandBuffer::endRenderPass()
 	vkCmdEndRenderPass(m_handle);
 }
 
+void CommandBuffer::executeCommands(CommandBuffer* const* commandBuffers, uint32_t count)
+{
+	if (count == 0)
+		return;
+	std::vector<VkCommandBuffer> handles(count);
+	for (uint32_t i = 0; i < count; i++) {
+		handles[i] = commandBuffers[i]->getHandle();
+		for (size_t j = 0; j < static_cast<size_t>(Command::COUNT); j++) {
+			m_stats.issued[j] += commandBuffers[i]->m_stats.issued[j];
+			m_stats.filtered[j] += commandBuffers[i]->m_stats.filtered[j];
+		}
+	}
+	vkCmdExecuteCommands(m_handle, count, handles.data());
+	forgetState();
+}
+
 void CommandBuffer::reset()
 {
 	vkResetCommandBuffer(m_handle, 0);
@@ -109,12 +159,101 @@ void CommandBuffer::submit(bool semaphores)
 
 void CommandBuffer::bindPipeline(std::shared_ptr<Pipeline> pipeline)
 {
-
+	bool bound = m_graphics.pipeline == pipeline->getHandle();
+	count(Command::PIPELINE, bound);
+	if (bound)
+		return;
 	vkCmdBindPipeline(m_handle, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline->getHandle());
+	m_graphics.pipeline = pipeline->getHandle();
+}
+
+void CommandBuffer::bindComputePipeline(const ComputePipeline& pipeline)
+{
+	bool bound = m_compute.pipeline == pipeline.getHandle();
+	count(Command::PIPELINE, bound);
+	if (bound)
+		return;
+	vkCmdBindPipeline(m_handle, VK_PIPELINE_BIND_POINT_COMPUTE, pipeline.getHandle());
+	m_compute.pipeline = pipeline.getHandle();
+}
+
+void CommandBuffer::bindDescriptorSets(VkPipelineBindPoint bindPoint, VkPipelineLayout layout, uint32_t firstSet, uint32_t setCount, const VkDescriptorSet* sets)
+{
+	DEBUG_ASSERT(firstSet + setCount <= maxDescriptorSets, "descriptor sets %u to %u aren't tracked", firstSet, firstSet + setCount);
+	BindPoint& state = bindPoint == VK_PIPELINE_BIND_POINT_COMPUTE ? m_compute : m_graphics;
+
+	// whether sets stay bound across layouts depends on their compatibility, assume they don't
+	if (state.layout != layout)
+		state = BindPoint{ state.pipeline, layout };
+
+	// the smallest run of sets that differs from the bound ones
+	uint32_t first = 0;
+	while (first < setCount && state.sets[firstSet + first] == sets[first])
+		first++;
+	uint32_t end = setCount;
+	while (end > first && state.sets[firstSet + end - 1] == sets[end - 1])
+		end--;
+
+	count(Command::DESCRIPTOR_SETS, first == end);
+	if (first == end)
+		return;
+	vkCmdBindDescriptorSets(m_handle, bindPoint, layout, firstSet + first, end - first, sets + first, 0, nullptr);
+	for (uint32_t i = first; i < end; i++)
+		state.sets[firstSet + i] = sets[i];
+}
+
+void CommandBuffer::bindVertexBuffer(VkBuffer buffer)
+{
+	bool bound = m_vertexBuffer == buffer;
+	count(Command::VERTEX_BUFFER, bound);
+	if (bound)
+		return;
+	VkDeviceSize offset = 0;
+	vkCmdBindVertexBuffers(m_handle, 0, 1, &buffer, &offset);
+	m_vertexBuffer = buffer;
+}
+
+void CommandBuffer::bindIndexBuffer(VkBuffer buffer, VkIndexType indexType)
+{
+	bool bound = m_indexBuffer == buffer && m_indexType == indexType;
+	count(Command::INDEX_BUFFER, bound);
+	if (bound)
+		return;
+	vkCmdBindIndexBuffer(m_handle, buffer, 0, indexType);
+	m_indexBuffer = buffer;
+	m_indexType = indexType;
+}
+
+void CommandBuffer::pushConstants(const Shader& shader, const void* data)
+{
+	uint32_t size = 0;
+	for (const auto& range : shader.getPushConstantRanges())
+		size = std::max(size, range.offset + range.size);
+	DEBUG_ASSERT(size <= maxPushConstantSize, "%u bytes of push constants aren't tracked", size);
+
+	bool pushed = m_pushLayout == shader.getPipelineLayout() && m_pushSize == size && memcmp(m_pushData, data, size) == 0;
+	count(Command::PUSH_CONSTANTS, pushed);
+	if (pushed)
+		return;
+
+	for (const auto& range : shader.getPushConstantRanges()) {
+		const void* ptr = static_cast<const uint8_t*>(data) + range.offset;
+		vkCmdPushConstants(m_handle, shader.getPipelineLayout(), range.stageFlags, range.offset, range.size, ptr);
+	}
+	m_pushLayout = shader.getPipelineLayout();
+	m_pushSize = size;
+	memcpy(m_pushData, data, size);
 }
 
 void CommandBuffer::updateViewport(uint32_t width, uint32_t height)
 {
+	bool set = m_viewportWidth == width && m_viewportHeight == height;
+	count(Command::VIEWPORT, set);
+	if (set)
+		return;
+	m_viewportWidth = width;
+	m_viewportHeight = height;
+
 	VkViewport viewport{};
 	viewport.x = 0.0f;
 	viewport.y = 0.0f;
@@ -131,3 +270,74 @@ void CommandBuffer::updateViewport(uint32_t width, uint32_t height)
 	vkCmdSetViewport(m_handle, 0, 1, &viewport);
 	vkCmdSetScissor(m_handle, 0, 1, &scissor);
 }
+
+void CommandBuffer::draw(uint32_t vertexCount, uint32_t instanceCount, uint32_t firstVertex, uint32_t firstInstance)
+{
+	count(Command::DRAW, false);
+	vkCmdDraw(m_handle, vertexCount, instanceCount, firstVertex, firstInstance);
+}
+
+void CommandBuffer::drawIndexed(uint32_t indexCount, uint32_t instanceCount, uint32_t firstIndex, int32_t vertexOffset, uint32_t firstInstance)
+{
+	count(Command::DRAW, false);
+	vkCmdDrawIndexed(m_handle, indexCount, instanceCount, firstIndex, vertexOffset, firstInstance);
+}
+
+void CommandBuffer::drawIndexedIndirect(VkBuffer buffer, VkDeviceSize offset, uint32_t drawCount, uint32_t stride)
+{
+	count(Command::DRAW, false);
+	vkCmdDrawIndexedIndirect(m_handle, buffer, offset, drawCount, stride);
+}
+
+void CommandBuffer::drawIndexedIndirectCount(VkBuffer buffer, VkDeviceSize offset, VkBuffer countBuffer, VkDeviceSize countOffset, uint32_t maxDrawCount, uint32_t stride)
+{
+	count(Command::DRAW, false);
+	vkCmdDrawIndexedIndirectCountKHR(m_handle, buffer, offset, countBuffer, countOffset, maxDrawCount, stride);
+}
+
+void CommandBuffer::dispatch(uint32_t groupCountX, uint32_t groupCountY, uint32_t groupCountZ)
+{
+	count(Command::DRAW, false);
+	vkCmdDispatch(m_handle, groupCountX, groupCountY, groupCountZ);
+}
+
+const char* CommandBuffer::getCommandName(Command command)
+{
+	switch (command) {
+	case Command::PIPELINE: return "pipeline";
+	case Command::DESCRIPTOR_SETS: return "descriptor sets";
+	case Command::VERTEX_BUFFER: return "vertex buffer";
+	case Command::INDEX_BUFFER: return "index buffer";
+	case Command::PUSH_CONSTANTS: return "push constants";
+	case Command::VIEWPORT: return "viewport";
+	case Command::DRAW: return "draw";
+	default: return "unknown";
+	}
+}
+
+void CommandBuffer::forgetState()
+{
+	m_graphics = BindPoint{};
+	m_compute = BindPoint{};
+	m_vertexBuffer = VK_NULL_HANDLE;
+	m_indexBuffer = VK_NULL_HANDLE;
+	m_indexType = VK_INDEX_TYPE_MAX_ENUM;
+	m_pushLayout = VK_NULL_HANDLE;
+	m_pushSize = 0;
+	m_viewportWidth = 0;
+	m_viewportHeight = 0;
+}
+
+void CommandBuffer::count(Command command, bool filtered)
+{
+	if (filtered)
+		m_stats.filtered[static_cast<size_t>(command)]++;
+	else
+		m_stats.issued[static_cast<size_t>(command)]++;
+}
+
+void CommandBuffer::printStats() const {
+	printf("  commands:\n");
+	for (uint32_t i = 0; i < static_cast<uint32_t>(Command::COUNT); i++)
+		printf("    %s: %u recorded, %u redundant filtered\n", getCommandName(static_cast<Command>(i)), m_stats.issued[i], m_stats.filtered[i]);
+}
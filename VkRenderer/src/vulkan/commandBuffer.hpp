@@ -6,6 +6,9 @@ public:
 	CommandPool();
 	~CommandPool();
 
+	// returns every command buffer allocated from the pool to the initial state, none may be pending
+	void reset();
+
 	VkCommandPool getHandle() { return m_handle; }
 
 private:
@@ -14,17 +17,59 @@ private:
 
 class CommandBuffer {
 public:
-	CommandBuffer(VkCommandPool m_commandPool);
+	// secondary command buffers have no semaphores nor fence, they are executed by a primary
+	CommandBuffer(VkCommandPool m_commandPool, VkCommandBufferLevel level = VK_COMMAND_BUFFER_LEVEL_PRIMARY);
 	~CommandBuffer();
 
 	void beginRecording();
-	void beginRenderpass(std::shared_ptr<RenderPass> renderPass, std::shared_ptr<Framebuffer> framebuffer, uint32_t width, uint32_t height);
+	// secondary only : records commands continuing the render pass the primary is in
+	void beginRecording(const CommandBuffer& primary);
+	// secondaryContents : the pass is recorded by executeCommands() only, no draw may be recorded inline
+	void beginRenderpass(std::shared_ptr<RenderPass> renderPass, std::shared_ptr<Framebuffer> framebuffer, uint32_t width, uint32_t height, bool secondaryContents = false);
 	void endRecording();
 	void endRenderPass();
+	// runs recorded secondary command buffers in order, their stats are added to this one's.
+	// the bound state is unknown afterwards and the next state commands are never filtered
+	void executeCommands(CommandBuffer* const* commandBuffers, uint32_t count);
 
+	// state commands : calls matching what is already bound since beginRecording() are skipped and counted as filtered.
+	// commands recorded on getHandle() directly bypass the cache and must not change the state it tracks
 	void bindPipeline(std::shared_ptr<Pipeline> pipeline);
+	void bindComputePipeline(const ComputePipeline& pipeline);
+	// only the sets that differ are bound, every cached set is forgotten when the layout changes
+	void bindDescriptorSets(VkPipelineBindPoint bindPoint, VkPipelineLayout layout, uint32_t firstSet, uint32_t setCount, const VkDescriptorSet* sets);
+	void bindVertexBuffer(VkBuffer buffer);
+	void bindIndexBuffer(VkBuffer buffer, VkIndexType indexType);
+	// every push constant range of the shader, skipped when the same bytes were pushed with its layout
+	void pushConstants(const Shader& shader, const void* data);
 	void updateViewport(uint32_t width, uint32_t height);
 
+	void draw(uint32_t vertexCount, uint32_t instanceCount, uint32_t firstVertex, uint32_t firstInstance);
+	void drawIndexed(uint32_t indexCount, uint32_t instanceCount, uint32_t firstIndex, int32_t vertexOffset, uint32_t firstInstance);
+	void drawIndexedIndirect(VkBuffer buffer, VkDeviceSize offset, uint32_t drawCount, uint32_t stride);
+	void drawIndexedIndirectCount(VkBuffer buffer, VkDeviceSize offset, VkBuffer countBuffer, VkDeviceSize countOffset, uint32_t maxDrawCount, uint32_t stride);
+	void dispatch(uint32_t groupCountX, uint32_t groupCountY, uint32_t groupCountZ);
+
+	enum class Command {
+		PIPELINE,
+		DESCRIPTOR_SETS,
+		VERTEX_BUFFER,
+		INDEX_BUFFER,
+		PUSH_CONSTANTS,
+		VIEWPORT,
+		DRAW,	// draws and dispatches, never filtered
+		COUNT
+	};
+	// since the last beginRecording()
+	struct Stats {
+		uint32_t issued[static_cast<size_t>(Command::COUNT)] = {};
+		uint32_t filtered[static_cast<size_t>(Command::COUNT)] = {};
+	};
+	const Stats& getStats() const { return m_stats; }
+	// the commands of the last recording, secondary ones included once executed
+	void printStats() const;
+	static const char* getCommandName(Command command);
+
 	void reset();
 	void submit(bool semaphores = true);
 
@@ -32,11 +77,38 @@ public:
 
 	VkCommandBuffer getHandle() { return m_handle; }
 
+private:
+	static constexpr uint32_t maxDescriptorSets = 4;
+	static constexpr uint32_t maxPushConstantSize = 128;
+
+	// state bound on the command buffer, VK_NULL_HANDLE for unknown
+	struct BindPoint {
+		VkPipeline pipeline = VK_NULL_HANDLE;
+		VkPipelineLayout layout = VK_NULL_HANDLE;
+		VkDescriptorSet sets[maxDescriptorSets] = {};
+	};
+
+	void count(Command command, bool filtered);
+	void forgetState();
+
+	BindPoint m_graphics;
+	BindPoint m_compute;
+	VkBuffer m_vertexBuffer = VK_NULL_HANDLE;
+	VkBuffer m_indexBuffer = VK_NULL_HANDLE;
+	VkIndexType m_indexType = VK_INDEX_TYPE_MAX_ENUM;
+	VkPipelineLayout m_pushLayout = VK_NULL_HANDLE;
+	uint32_t m_pushSize = 0;
+	uint8_t m_pushData[maxPushConstantSize];
+	uint32_t m_viewportWidth = 0;
+	uint32_t m_viewportHeight = 0;
+	Stats m_stats;
+
 public:
 	VkCommandBuffer m_handle;
 	VkCommandPool m_commandPool;
 
 	std::shared_ptr<RenderPass> m_renderPass;
+	std::shared_ptr<Framebuffer> m_framebuffer;
 	std::shared_ptr<Semaphore> m_imageAvailableSemaphores;
 	std::shared_ptr<Semaphore> m_renderFinishedSemaphores;
 	std::shared_ptr<Fence> m_fence;
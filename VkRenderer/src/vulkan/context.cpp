@@ -1,5 +1,7 @@
 #include "src/vulkan/context.hpp"
 #include "src/vulkan/device.hpp"
+#include "src/vulkan/uploadQueue.hpp"
+#include <atomic>
 
 #define VOLK_IMPLEMENTATION
 #include "volk.h"
@@ -30,6 +32,7 @@ Context::Context() {
 }
 
 Context::~Context() {
+	m_uploadQueue.reset();
 	vkDestroyPipelineCache(Device::getHandle(), m_pipelineCache, nullptr);
 	m_device.reset();
 	if (enableValidationLayers) {
@@ -46,6 +49,7 @@ void Context::create()
 		s_context = new Context();
 		s_context->m_device = std::make_shared<Device>();
 		s_context->createPipelineCache();
+		s_context->m_uploadQueue = std::make_shared<UploadQueue>();
 	}
 }
 
@@ -99,6 +103,8 @@ std::vector<const char*> Context::getRequiredExtensions() {
 	return extensions;
 }
 
+static std::atomic<uint32_t> validationMessageCount{ 0 };
+
 static VKAPI_ATTR VkBool32 VKAPI_CALL debugCallback(
 	VkDebugUtilsMessageSeverityFlagBitsEXT messageSeverity,
 	VkDebugUtilsMessageTypeFlagsEXT messageType,
@@ -106,10 +112,16 @@ static VKAPI_ATTR VkBool32 VKAPI_CALL debugCallback(
 	void* pUserData) {
 
 	std::cerr << "---------------------\nvalidation layer msg: " << pCallbackData->pMessage << std::endl;
+	if (messageType & VK_DEBUG_UTILS_MESSAGE_TYPE_VALIDATION_BIT_EXT)
+		validationMessageCount++;
 
 	return VK_FALSE;
 }
 
+uint32_t Context::getValidationMessageCount() {
+	return validationMessageCount;
+}
+
 void Context::populateDebugMessengerCreateInfo(VkDebugUtilsMessengerCreateInfoEXT& createInfo) {
 	createInfo = {};
 	createInfo.sType = VK_STRUCTURE_TYPE_DEBUG_UTILS_MESSENGER_CREATE_INFO_EXT;
@@ -14,6 +14,9 @@ public:
 	VkInstance getInstance() const { return m_instance; }
 	std::shared_ptr<Device> getDevice() const { return m_device; }
 	VkPipelineCache getPipelineCache() const { return m_pipelineCache; }
+	std::shared_ptr<UploadQueue> getUploadQueue() const { return m_uploadQueue; }
+	// validation layer errors and warnings reported so far, performance warnings aside
+	static uint32_t getValidationMessageCount();
 
 private:
 	Context();
@@ -35,6 +38,7 @@ private:
 	VkPipelineCache m_pipelineCache = VK_NULL_HANDLE;
 
 	std::shared_ptr<Device> m_device;
+	std::shared_ptr<UploadQueue> m_uploadQueue;
 	static Context* s_context;
 	
 
@@ -103,22 +103,50 @@ void DescriptorSet::setUniform(std::vector<UniformBuffer>& uniformBuffers, uint3
 	vkUpdateDescriptorSets(Device::getHandle(), 1, &descriptorWrite, 0, nullptr);
 }
 
-void DescriptorSet::setTexture(std::shared_ptr<Texture> texture, uint32_t binding)
+void DescriptorSet::setTexture(const FrameResource<Texture>& textures, uint32_t binding)
 {
 	for (int i = 0; i < m_descriptorSets.size(); i++) {
-		VkDescriptorImageInfo info{};
-		info.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-		info.imageView = texture->getImageView();
-		info.sampler = texture->getSampler();
-		
-
-		VkWriteDescriptorSet descriptorWrite{};
-		descriptorWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-		descriptorWrite.dstSet = m_descriptorSets[i];
-		descriptorWrite.dstBinding = binding;
-		descriptorWrite.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-		descriptorWrite.descriptorCount = 1;
-		descriptorWrite.pImageInfo = &info;
-		vkUpdateDescriptorSets(Device::getHandle(), 1, &descriptorWrite, 0, nullptr);
+		setTexture(textures[i], binding, i);
 	}
-}
\ No newline at end of file
+}
+
+void DescriptorSet::setTexture(std::shared_ptr<Texture> texture, uint32_t binding, uint32_t frameIndex)
+{
+	VkDescriptorImageInfo info{};
+	info.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+	info.imageView = texture->getImageView();
+	info.sampler = texture->getSampler();
+
+	VkWriteDescriptorSet descriptorWrite{};
+	descriptorWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+	descriptorWrite.dstSet = m_descriptorSets[frameIndex];
+	descriptorWrite.dstBinding = binding;
+	descriptorWrite.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+	descriptorWrite.descriptorCount = 1;
+	descriptorWrite.pImageInfo = &info;
+	vkUpdateDescriptorSets(Device::getHandle(), 1, &descriptorWrite, 0, nullptr);
+}
+
+void DescriptorSet::setStorageBuffer(Buffer& buffer, uint32_t binding)
+{
+	for (int i = 0; i < m_descriptorSets.size(); i++) {
+		setStorageBuffer(buffer, binding, i);
+	}
+}
+
+void DescriptorSet::setStorageBuffer(Buffer& buffer, uint32_t binding, uint32_t frameIndex)
+{
+	VkDescriptorBufferInfo info{};
+	info.buffer = buffer.getHandle();
+	info.offset = 0;
+	info.range = VK_WHOLE_SIZE;
+
+	VkWriteDescriptorSet descriptorWrite{};
+	descriptorWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+	descriptorWrite.dstSet = m_descriptorSets[frameIndex];
+	descriptorWrite.dstBinding = binding;
+	descriptorWrite.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+	descriptorWrite.descriptorCount = 1;
+	descriptorWrite.pBufferInfo = &info;
+	vkUpdateDescriptorSets(Device::getHandle(), 1, &descriptorWrite, 0, nullptr);
+}
@@ -1,6 +1,7 @@
 #pragma once
 #include "src/vulkan/vkHeader.hpp"
 #include "src/vulkan/buffer.hpp"
+#include "src/vulkan/frameResource.hpp"
 
 class DescriptorSet {
 public:
@@ -13,8 +14,11 @@ public:
 
 	void setUniform(std::vector<UniformBuffer>& uniformBuffers, uint32_t binding);
 	void setUniform(std::vector<UniformBuffer>& uniformBuffers, uint32_t binding, uint32_t frameIndex);
-	void setTexture(std::shared_ptr<Texture> texture, uint32_t binding);
-	//void setTexture(std::shared_ptr<Texture2D> texture, uint32_t binding, uint32_t frameIndex);
+	// each frame's set gets the frame's copy
+	void setTexture(const FrameResource<Texture>& textures, uint32_t binding);
+	void setTexture(std::shared_ptr<Texture> texture, uint32_t binding, uint32_t frameIndex);
+	void setStorageBuffer(Buffer& buffer, uint32_t binding);
+	void setStorageBuffer(Buffer& buffer, uint32_t binding, uint32_t frameIndex);
 
 private:
 	void createDescriptorPool();
@@ -1,5 +1,6 @@
 #include "src/vulkan/device.hpp"
 #include "src/vulkan/context.hpp"
+#include "src/vulkan/memoryAllocator.hpp"
 
 PhysicalDevice::PhysicalDevice() {
 	pickPhysicalDevice();
@@ -123,10 +124,12 @@ VkFormat PhysicalDevice::findSupportedFormat(const std::vector<VkFormat>& candid
 
 Device::Device() {
 	createDevice();
+	m_allocator = std::make_unique<MemoryAllocator>(m_handle, m_physicalDevice.getHandle());
 }
 
 Device::~Device()
 {
+	m_allocator.reset();
 	vkDestroyDevice(m_handle, nullptr);
 }
 
@@ -146,16 +149,40 @@ void Device::createDevice() {
 		queueCreateInfos.push_back(queueCreateInfo);
 	}
 
+	VkPhysicalDeviceFeatures supportedFeatures;
+	vkGetPhysicalDeviceFeatures(m_physicalDevice.getHandle(), &supportedFeatures);
+
 	VkPhysicalDeviceFeatures deviceFeatures{};
 	deviceFeatures.samplerAnisotropy = VK_TRUE;
+	m_multiDrawIndirect = supportedFeatures.multiDrawIndirect && supportedFeatures.drawIndirectFirstInstance;
+	deviceFeatures.multiDrawIndirect = m_multiDrawIndirect;
+	deviceFeatures.drawIndirectFirstInstance = m_multiDrawIndirect;
+
+	uint32_t extensionCount;
+	vkEnumerateDeviceExtensionProperties(m_physicalDevice.getHandle(), nullptr, &extensionCount, nullptr);
+	std::vector<VkExtensionProperties> availableExtensions(extensionCount);
+	vkEnumerateDeviceExtensionProperties(m_physicalDevice.getHandle(), nullptr, &extensionCount, availableExtensions.data());
+
+	std::vector<const char*> extensions = m_physicalDevice.m_deviceExtensions;
+	for (const char* optional : m_physicalDevice.m_optionalExtensions) {
+		for (const auto& extension : availableExtensions) {
+			if (strcmp(extension.extensionName, optional) == 0) {
+				extensions.push_back(optional);
+				break;
+			}
+		}
+	}
+	m_drawIndirectCount = std::find_if(extensions.begin(), extensions.end(), [](const char* name) {
+		return strcmp(name, VK_KHR_DRAW_INDIRECT_COUNT_EXTENSION_NAME) == 0;
+	}) != extensions.end();
 
 	VkDeviceCreateInfo createInfo{};
 	createInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
 	createInfo.queueCreateInfoCount = static_cast<uint32_t>(queueCreateInfos.size());
 	createInfo.pQueueCreateInfos = queueCreateInfos.data();
 	createInfo.pEnabledFeatures = &deviceFeatures;
-	createInfo.enabledExtensionCount = static_cast<uint32_t>(m_physicalDevice.m_deviceExtensions.size());
-	createInfo.ppEnabledExtensionNames = m_physicalDevice.m_deviceExtensions.data();
+	createInfo.enabledExtensionCount = static_cast<uint32_t>(extensions.size());
+	createInfo.ppEnabledExtensionNames = extensions.data();
 
 	VK_CHECK(vkCreateDevice(m_physicalDevice.getHandle(), &createInfo, nullptr, &m_handle));
 
@@ -40,6 +40,10 @@ private:
 	const std::vector<const char*> m_deviceExtensions = {
 		VK_KHR_SWAPCHAIN_EXTENSION_NAME
 	};
+	// enabled when present
+	const std::vector<const char*> m_optionalExtensions = {
+		VK_KHR_DRAW_INDIRECT_COUNT_EXTENSION_NAME
+	};
 
 	friend class Device;
 };
@@ -56,6 +60,11 @@ public:
 	VkQueue getGraphicsQueue() { return m_presentQueue; }
 	VkQueue getPresentQueue() { return m_graphicsQueue; }
 	PhysicalDevice& getPhysicalDevice() { return m_physicalDevice; }
+	MemoryAllocator& getAllocator() { return *m_allocator; }
+	// several draws per indirect call, each with its own first instance
+	bool supportsMultiDrawIndirect() const { return m_multiDrawIndirect; }
+	// vkCmdDrawIndexedIndirectCountKHR, the draw count read from a buffer
+	bool supportsDrawIndirectCount() const { return m_drawIndirectCount; }
 
 private:
 	void createDevice();
@@ -64,6 +73,9 @@ private:
 	VkQueue m_graphicsQueue;
 	VkQueue m_presentQueue;
 	VkPipelineCache m_pipelineCache = VK_NULL_HANDLE;
+	bool m_multiDrawIndirect = false;
+	bool m_drawIndirectCount = false;
 
 	PhysicalDevice m_physicalDevice;
+	std::unique_ptr<MemoryAllocator> m_allocator;
 };
\ No newline at end of file
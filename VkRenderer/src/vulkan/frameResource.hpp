@@ -0,0 +1,43 @@
+#pragma once
+#include "src/vulkan/vkHeader.hpp"
+
+// a resource per frame in flight, indexed by Swapchain::getCurrentFrameIndex() like the command buffers and descriptor
+// sets. a shared one is the same copy in every slot, for the resources a single copy is safe for : a frame only
+// touches it once the previous frame is done with it, without waiting on much of that frame
+template<typename T>
+class FrameResource {
+public:
+	FrameResource() = default;
+
+	// a single copy every frame uses
+	template<typename U>
+	FrameResource(std::shared_ptr<U> shared) {
+		for (auto& copy : m_copies)
+			copy = shared;
+	}
+
+	template<typename U>
+	FrameResource(const FrameResource<U>& other) {
+		for (uint32_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++)
+			m_copies[i] = other[i];
+	}
+
+	// a copy made by make() per frame in flight, or a single one when perFrame is false
+	template<typename Make>
+	static FrameResource create(bool perFrame, Make make) {
+		FrameResource resource;
+		for (uint32_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
+			if (perFrame || i == 0)
+				resource.m_copies[i] = make();
+			else
+				resource.m_copies[i] = resource.m_copies[0];
+		}
+		return resource;
+	}
+
+	const std::shared_ptr<T>& operator[](uint32_t frameIndex) const { return m_copies[frameIndex]; }
+	bool isShared() const { return m_copies[0] == m_copies[MAX_FRAMES_IN_FLIGHT - 1]; }
+
+private:
+	std::shared_ptr<T> m_copies[MAX_FRAMES_IN_FLIGHT];
+};
@@ -0,0 +1,285 @@
+#include "src/vulkan/geometryBuffer.hpp"
+#include "src/vulkan/buffer.hpp"
+#include "src/vulkan/context.hpp"
+#include "src/vulkan/device.hpp"
+#include "src/vulkan/uploadQueue.hpp"
+#include "src/vulkan/pipeline.hpp"
+#include "src/vulkan/shader.hpp"
+#include "src/vulkan/commandBuffer.hpp"
+
+GeometryRange::~GeometryRange() {
+	m_owner->release(this);
+}
+
+GeometryBuffer::GeometryBuffer(uint32_t vertexStride, uint32_t positionStride, uint32_t vertexCapacity, uint32_t indexCapacity)
+	: m_vertexStride(vertexStride), m_positionStride(positionStride) {
+	DEBUG_ASSERT(positionStride <= vertexStride, "position stride %u is larger than the vertex stride %u", positionStride, vertexStride);
+	m_vertexRanges = std::make_unique<RangeAllocator>(0);
+	m_indexRanges = std::make_unique<RangeAllocator>(0);
+	resize(vertexCapacity, VkDeviceSize(indexCapacity) * sizeof(uint32_t));
+}
+
+GeometryBuffer::~GeometryBuffer() {
+	if (!m_ranges.empty())
+		DEBUG_WARNING("geometry buffer destroyed with %zu live ranges", m_ranges.size());
+}
+
+VkBuffer GeometryBuffer::getVertexBuffer() const {
+	return m_vertexBuffer->getHandle();
+}
+
+VkBuffer GeometryBuffer::getPositionBuffer() const {
+	return m_positionBuffer ? m_positionBuffer->getHandle() : VK_NULL_HANDLE;
+}
+
+VkBuffer GeometryBuffer::getIndexBuffer() const {
+	return m_indexBuffer->getHandle();
+}
+
+void GeometryBuffer::upload(Buffer& dst, VkDeviceSize dstOffset, const void* data, VkDeviceSize size) {
+	Context::get()->getUploadQueue()->copyToBuffer(dst.getHandle(), dstOffset, data, size);
+}
+
+void GeometryBuffer::uploadPositions(VkDeviceSize firstVertex, const void* vertices, uint32_t vertexCount) {
+	if (m_positionStride == 0 || vertexCount == 0)
+		return;
+
+	// gathered straight into staging memory
+	VkDeviceSize size = VkDeviceSize(vertexCount) * m_positionStride;
+	UploadQueue& uploadQueue = *Context::get()->getUploadQueue();
+	StagingRegion staging = uploadQueue.stage(size);
+
+	const uint8_t* src = static_cast<const uint8_t*>(vertices);
+	uint8_t* dst = static_cast<uint8_t*>(staging.mapped);
+	for (uint32_t i = 0; i < vertexCount; i++)
+		memcpy(dst + size_t(i) * m_positionStride, src + size_t(i) * m_vertexStride, m_positionStride);
+
+	uploadQueue.copyToBuffer(m_positionBuffer->getHandle(), firstVertex * m_positionStride, staging, size);
+}
+
+void GeometryBuffer::uploadIndices(const GeometryRange& range, const uint32_t* indices) {
+	if (range.m_indexType == VK_INDEX_TYPE_UINT32) {
+		upload(*m_indexBuffer, range.m_indexRange.offset, indices, VkDeviceSize(range.m_indexCount) * sizeof(uint32_t));
+		return;
+	}
+	if (range.m_indexCount == 0)
+		return;
+
+	// narrowed while writing the staging memory
+	VkDeviceSize size = VkDeviceSize(range.m_indexCount) * sizeof(uint16_t);
+	UploadQueue& uploadQueue = *Context::get()->getUploadQueue();
+	StagingRegion staging = uploadQueue.stage(size);
+
+	uint16_t* dst = static_cast<uint16_t*>(staging.mapped);
+	for (uint32_t i = 0; i < range.m_indexCount; i++)
+		dst[i] = static_cast<uint16_t>(indices[i]);
+
+	uploadQueue.copyToBuffer(m_indexBuffer->getHandle(), range.m_indexRange.offset, staging, size);
+}
+
+std::unique_ptr<Buffer> GeometryBuffer::createVertexBuffer(uint32_t vertexCapacity, uint32_t stride) {
+	auto buffer = std::make_unique<Buffer>();
+	buffer->createBuffer(VkDeviceSize(vertexCapacity) * stride,
+		VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+		VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+	return buffer;
+}
+
+std::shared_ptr<GeometryRange> GeometryBuffer::allocate(const void* vertices, uint32_t vertexCount, const uint32_t* indices, uint32_t indexCount) {
+	auto range = std::make_shared<GeometryRange>(this);
+	range->m_vertexCount = vertexCount;
+	range->m_indexCount = indexCount;
+	range->m_indexType = vertexCount <= 65536 ? VK_INDEX_TYPE_UINT16 : VK_INDEX_TYPE_UINT32;
+
+	uint32_t indexSize = range->getIndexSize();
+	VkDeviceSize indexBytes = VkDeviceSize(indexCount) * indexSize;
+
+	auto tryAllocate = [&]() {
+		if (!m_vertexRanges->allocate(vertexCount, 1, range->m_vertexRange))
+			return false;
+		if (!m_indexRanges->allocate(indexBytes, indexSize, range->m_indexRange)) {
+			m_vertexRanges->free(range->m_vertexRange.node);
+			return false;
+		}
+		return true;
+	};
+
+	if (!tryAllocate()) {
+		VkDeviceSize vertexFree = m_vertexRanges->getSize() - m_vertexRanges->getUsed();
+		VkDeviceSize indexFree = m_indexRanges->getSize() - m_indexRanges->getUsed();
+
+		// enough room overall : the arena is only fragmented
+		if (vertexFree >= vertexCount && indexFree >= indexBytes) {
+			compact();
+		}
+
+		if (!tryAllocate()) {
+			uint32_t vertexCapacity = static_cast<uint32_t>(std::max(m_vertexRanges->getSize() * 2, m_vertexRanges->getUsed() + vertexCount));
+			VkDeviceSize indexCapacity = std::max(m_indexRanges->getSize() * 2, m_indexRanges->getUsed() + indexBytes);
+			resize(vertexCapacity, indexCapacity);
+
+			bool success = tryAllocate();
+			DEBUG_ASSERT(success, "failed to allocate %u vertices / %u indices in the geometry buffer", vertexCount, indexCount);
+		}
+	}
+
+	upload(*m_vertexBuffer, range->m_vertexRange.offset * m_vertexStride, vertices, VkDeviceSize(vertexCount) * m_vertexStride);
+	uploadPositions(range->m_vertexRange.offset, vertices, vertexCount);
+	uploadIndices(*range, indices);
+
+	range->m_slot = static_cast<uint32_t>(m_ranges.size());
+	m_ranges.push_back(range.get());
+
+	return range;
+}
+
+void GeometryBuffer::release(GeometryRange* range) {
+	GeometryRange* last = m_ranges.back();
+	m_ranges[range->m_slot] = last;
+	last->m_slot = range->m_slot;
+	m_ranges.pop_back();
+
+	m_pendingFrees.push_back({ range->m_vertexRange.node, range->m_indexRange.node, MAX_FRAMES_IN_FLIGHT });
+}
+
+void GeometryBuffer::nextFrame() {
+	for (size_t i = 0; i < m_pendingFrees.size();) {
+		PendingFree& pending = m_pendingFrees[i];
+		if (--pending.framesLeft == 0) {
+			m_vertexRanges->free(pending.vertexNode);
+			m_indexRanges->free(pending.indexNode);
+			pending = m_pendingFrees.back();
+			m_pendingFrees.pop_back();
+		} else {
+			i++;
+		}
+	}
+}
+
+void GeometryBuffer::resize(uint32_t vertexCapacity, VkDeviceSize indexCapacity) {
+	auto vertexBuffer = createVertexBuffer(vertexCapacity, m_vertexStride);
+	std::unique_ptr<Buffer> positionBuffer = m_positionStride > 0 ? createVertexBuffer(vertexCapacity, m_positionStride) : nullptr;
+
+	auto indexBuffer = std::make_unique<Buffer>();
+	indexBuffer->createBuffer(indexCapacity,
+		VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+		VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+
+	if (m_vertexBuffer) {
+		// offsets are kept, so the old contents are copied as is
+		vertexBuffer->copyBuffer(m_vertexBuffer->getHandle(), vertexBuffer->getHandle(), m_vertexRanges->getSize() * m_vertexStride);
+		if (positionBuffer)
+			positionBuffer->copyBuffer(m_positionBuffer->getHandle(), positionBuffer->getHandle(), m_vertexRanges->getSize() * m_positionStride);
+		indexBuffer->copyBuffer(m_indexBuffer->getHandle(), indexBuffer->getHandle(), m_indexRanges->getSize());
+		vkDeviceWaitIdle(Device::getHandle());
+	}
+
+	m_vertexRanges->grow(vertexCapacity);
+	m_indexRanges->grow(indexCapacity);
+
+	m_vertexBuffer = std::move(vertexBuffer);
+	m_positionBuffer = std::move(positionBuffer);
+	m_indexBuffer = std::move(indexBuffer);
+}
+
+void GeometryBuffer::compact() {
+	vkDeviceWaitIdle(Device::getHandle());
+	m_pendingFrees.clear();
+
+	std::vector<GeometryRange*> ranges = m_ranges;
+	std::sort(ranges.begin(), ranges.end(), [](const GeometryRange* a, const GeometryRange* b) {
+		return a->m_vertexRange.offset < b->m_vertexRange.offset;
+	});
+
+	auto vertexRanges = std::make_unique<RangeAllocator>(m_vertexRanges->getSize());
+	auto indexRanges = std::make_unique<RangeAllocator>(m_indexRanges->getSize());
+
+	uint32_t vertexCapacity = static_cast<uint32_t>(m_vertexRanges->getSize());
+	auto vertexBuffer = createVertexBuffer(vertexCapacity, m_vertexStride);
+	std::unique_ptr<Buffer> positionBuffer = m_positionStride > 0 ? createVertexBuffer(vertexCapacity, m_positionStride) : nullptr;
+
+	auto indexBuffer = std::make_unique<Buffer>();
+	indexBuffer->createBuffer(m_indexRanges->getSize(),
+		VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+		VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+
+	std::vector<VkBufferCopy> vertexCopies;
+	std::vector<VkBufferCopy> positionCopies;
+	std::vector<VkBufferCopy> indexCopies;
+	vertexCopies.reserve(ranges.size());
+	positionCopies.reserve(ranges.size());
+	indexCopies.reserve(ranges.size());
+
+	for (GeometryRange* range : ranges) {
+		RangeAllocator::Range vertexRange, indexRange;
+		// a fresh allocator hands out ranges back to back
+		vertexRanges->allocate(range->m_vertexCount, 1, vertexRange);
+		VkDeviceSize indexBytes = VkDeviceSize(range->m_indexCount) * range->getIndexSize();
+		indexRanges->allocate(indexBytes, range->getIndexSize(), indexRange);
+
+		if (range->m_vertexCount > 0) {
+			vertexCopies.push_back({ range->m_vertexRange.offset * m_vertexStride, vertexRange.offset * m_vertexStride, VkDeviceSize(range->m_vertexCount) * m_vertexStride });
+			positionCopies.push_back({ range->m_vertexRange.offset * m_positionStride, vertexRange.offset * m_positionStride, VkDeviceSize(range->m_vertexCount) * m_positionStride });
+		}
+		if (range->m_indexCount > 0)
+			indexCopies.push_back({ range->m_indexRange.offset, indexRange.offset, indexBytes });
+
+		range->m_vertexRange = vertexRange;
+		range->m_indexRange = indexRange;
+	}
+
+	vertexBuffer->copyBuffer(m_vertexBuffer->getHandle(), vertexBuffer->getHandle(), vertexCopies);
+	if (positionBuffer)
+		positionBuffer->copyBuffer(m_positionBuffer->getHandle(), positionBuffer->getHandle(), positionCopies);
+	indexBuffer->copyBuffer(m_indexBuffer->getHandle(), indexBuffer->getHandle(), indexCopies);
+
+	m_vertexRanges = std::move(vertexRanges);
+	m_indexRanges = std::move(indexRanges);
+	m_vertexBuffer = std::move(vertexBuffer);
+	m_positionBuffer = std::move(positionBuffer);
+	m_indexBuffer = std::move(indexBuffer);
+	m_generation++;
+}
+
+void GeometryBuffer::bind(CommandBuffer& commandBuffer, const Pipeline& pipeline) {
+	const Shader& shader = *pipeline.getShader();
+	bool positionOnly = m_positionBuffer && shader.readsPositionOnly();
+	uint32_t stride = positionOnly ? m_positionStride : m_vertexStride;
+	DEBUG_ASSERT(shader.getVertexInputStride() == stride, "shader vertex input stride %u doesn't match the geometry stride %u", shader.getVertexInputStride(), stride);
+
+	commandBuffer.bindVertexBuffer(positionOnly ? m_positionBuffer->getHandle() : m_vertexBuffer->getHandle());
+}
+
+void GeometryBuffer::draw(CommandBuffer& commandBuffer, const GeometryRange& range, uint32_t instanceCount) {
+	draw(commandBuffer, range, 0, range.m_indexCount, instanceCount);
+}
+
+void GeometryBuffer::draw(CommandBuffer& commandBuffer, const GeometryRange& range, uint32_t firstIndex, uint32_t indexCount, uint32_t instanceCount) {
+	bindIndexBuffer(commandBuffer, range.m_indexType);
+	commandBuffer.drawIndexed(indexCount, instanceCount, range.getFirstIndex() + firstIndex, range.getVertexOffset(), 0);
+}
+
+void GeometryBuffer::bindIndexBuffer(CommandBuffer& commandBuffer, VkIndexType indexType) {
+	commandBuffer.bindIndexBuffer(m_indexBuffer->getHandle(), indexType);
+}
+
+GeometryBuffer::Stats GeometryBuffer::getStats() const {
+	Stats stats{};
+	stats.rangeCount = static_cast<uint32_t>(m_ranges.size());
+	stats.vertexCapacity = static_cast<uint32_t>(m_vertexRanges->getSize());
+	stats.vertexCount = static_cast<uint32_t>(m_vertexRanges->getUsed());
+	stats.indexCapacity = m_indexRanges->getSize();
+	stats.indexBytes = m_indexRanges->getUsed();
+	for (const GeometryRange* range : m_ranges) {
+		if (range->m_indexType == VK_INDEX_TYPE_UINT16)
+			stats.shortIndexRangeCount++;
+	}
+	return stats;
+}
+
+void GeometryBuffer::printStats() const {
+	Stats stats = getStats();
+	printf("geometry: %u ranges (%u with 16 bit indices), %u / %u vertices, %.1f / %.1f MB of indices\n",
+		stats.rangeCount, stats.shortIndexRangeCount, stats.vertexCount, stats.vertexCapacity,
+		stats.indexBytes / (1024.0 * 1024.0), stats.indexCapacity / (1024.0 * 1024.0));
+}
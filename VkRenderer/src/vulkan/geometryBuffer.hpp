@@ -0,0 +1,107 @@
+#pragma once
+#include "src/vulkan/vkHeader.hpp"
+#include "src/vulkan/rangeAllocator.hpp"
+
+class GeometryBuffer;
+
+// a mesh's slice of the shared vertex / index buffers, freed on destruction
+class GeometryRange {
+public:
+	GeometryRange(GeometryBuffer* owner) : m_owner(owner) {}
+	~GeometryRange();
+
+	GeometryRange(const GeometryRange&) = delete;
+	GeometryRange& operator=(const GeometryRange&) = delete;
+
+	int32_t getVertexOffset() const { return static_cast<int32_t>(m_vertexRange.offset); }
+	uint32_t getVertexCount() const { return m_vertexCount; }
+	uint32_t getFirstIndex() const { return static_cast<uint32_t>(m_indexRange.offset / getIndexSize()); }
+	uint32_t getIndexCount() const { return m_indexCount; }
+	// 16 bit whenever every index fits
+	VkIndexType getIndexType() const { return m_indexType; }
+	uint32_t getIndexSize() const { return m_indexType == VK_INDEX_TYPE_UINT16 ? 2 : 4; }
+
+private:
+	friend class GeometryBuffer;
+
+	GeometryBuffer* m_owner;
+	RangeAllocator::Range m_vertexRange;	// in vertices
+	RangeAllocator::Range m_indexRange;		// in bytes
+	uint32_t m_vertexCount = 0;
+	uint32_t m_indexCount = 0;
+	VkIndexType m_indexType = VK_INDEX_TYPE_UINT32;
+	uint32_t m_slot = 0;
+};
+
+// device local vertex and index buffers shared by every mesh so passes bind geometry once.
+// next to the interleaved vertices, a position stream holds the first positionStride bytes of every vertex
+// at the same vertex offsets, for the passes that read nothing else
+class GeometryBuffer {
+public:
+	// positionStride : 0 for no position stream
+	GeometryBuffer(uint32_t vertexStride, uint32_t positionStride, uint32_t vertexCapacity, uint32_t indexCapacity);
+	~GeometryBuffer();
+
+	// indices are stored as 16 bit when vertexCount allows it
+	std::shared_ptr<GeometryRange> allocate(const void* vertices, uint32_t vertexCount, const uint32_t* indices, uint32_t indexCount);
+	void compact();
+	void nextFrame();
+
+	// binds the position stream when the pipeline's shader only reads location 0, the interleaved vertices otherwise
+	void bind(CommandBuffer& commandBuffer, const Pipeline& pipeline);
+	// indexed draw of a range, the command buffer skips the index buffer bind while the index type doesn't change
+	void draw(CommandBuffer& commandBuffer, const GeometryRange& range, uint32_t instanceCount = 1);
+	// part of a range, firstIndex is relative to the range
+	void draw(CommandBuffer& commandBuffer, const GeometryRange& range, uint32_t firstIndex, uint32_t indexCount, uint32_t instanceCount = 1);
+	// for draws recorded outside of draw(), every range of the index type can then be drawn
+	void bindIndexBuffer(CommandBuffer& commandBuffer, VkIndexType indexType);
+
+	uint32_t getVertexStride() const { return m_vertexStride; }
+	// changes whenever compact() moved ranges, their offsets read before are stale
+	uint32_t getGeneration() const { return m_generation; }
+	uint32_t getPositionStride() const { return m_positionStride; }
+	VkBuffer getVertexBuffer() const;
+	VkBuffer getPositionBuffer() const;
+	VkBuffer getIndexBuffer() const;
+
+	struct Stats {
+		uint32_t rangeCount;
+		uint32_t vertexCapacity;
+		uint32_t vertexCount;
+		VkDeviceSize indexCapacity;	// bytes
+		VkDeviceSize indexBytes;
+		uint32_t shortIndexRangeCount;	// ranges with 16 bit indices
+	};
+	Stats getStats() const;
+	void printStats() const;
+
+private:
+	friend class GeometryRange;
+
+	void release(GeometryRange* range);
+	void resize(uint32_t vertexCapacity, VkDeviceSize indexCapacity);
+	void upload(Buffer& dst, VkDeviceSize dstOffset, const void* data, VkDeviceSize size);
+	void uploadPositions(VkDeviceSize firstVertex, const void* vertices, uint32_t vertexCount);
+	void uploadIndices(const GeometryRange& range, const uint32_t* indices);
+	std::unique_ptr<Buffer> createVertexBuffer(uint32_t vertexCapacity, uint32_t stride);
+
+	uint32_t m_vertexStride;
+	uint32_t m_positionStride;
+
+	std::unique_ptr<Buffer> m_vertexBuffer;
+	std::unique_ptr<Buffer> m_positionBuffer;
+	std::unique_ptr<Buffer> m_indexBuffer;
+	std::unique_ptr<RangeAllocator> m_vertexRanges;
+	std::unique_ptr<RangeAllocator> m_indexRanges;
+
+	std::vector<GeometryRange*> m_ranges;
+	uint32_t m_generation = 0;
+
+	// ranges stay reserved until the frames that may still read them are done
+	struct PendingFree {
+		uint32_t vertexNode;
+		uint32_t indexNode;
+		uint32_t framesLeft;
+	};
+	std::vector<PendingFree> m_pendingFrees;
+};
@@ -0,0 +1,208 @@
+#include "src/vulkan/memoryAllocator.hpp"
+
+static constexpr VkDeviceSize DEVICE_BLOCK_SIZE = 64ull * 1024 * 1024;
+static constexpr VkDeviceSize HOST_BLOCK_SIZE = 32ull * 1024 * 1024;
+static constexpr VkDeviceSize DEDICATED_RENDER_TARGET_SIZE = 4ull * 1024 * 1024;
+
+MemoryAllocator::MemoryAllocator(VkDevice device, VkPhysicalDevice physicalDevice)
+	: m_device(device) {
+	vkGetPhysicalDeviceMemoryProperties(physicalDevice, &m_memoryProperties);
+
+	VkPhysicalDeviceProperties properties;
+	vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+	m_maxAllocationCount = properties.limits.maxMemoryAllocationCount;
+
+	m_pools.resize(m_memoryProperties.memoryTypeCount * 2);
+	for (uint32_t i = 0; i < m_memoryProperties.memoryTypeCount; i++) {
+		const VkMemoryType& type = m_memoryProperties.memoryTypes[i];
+		VkDeviceSize heapSize = m_memoryProperties.memoryHeaps[type.heapIndex].size;
+
+		VkDeviceSize blockSize = (type.propertyFlags & VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT) ? DEVICE_BLOCK_SIZE : HOST_BLOCK_SIZE;
+		// small heaps (e.g. the 256MB BAR heap) shouldn't be eaten by a few blocks
+		blockSize = std::min(blockSize, heapSize / 8);
+
+		for (uint32_t j = 0; j < 2; j++) {
+			m_pools[i * 2 + j].memoryType = i;
+			m_pools[i * 2 + j].blockSize = blockSize;
+		}
+	}
+}
+
+MemoryAllocator::~MemoryAllocator() {
+	for (auto& pool : m_pools) {
+		for (auto& block : pool.blocks) {
+			if (block.memory == VK_NULL_HANDLE)
+				continue;
+			if (!block.ranges->isEmpty())
+				DEBUG_WARNING("%u allocations leaked in memory type %u", block.ranges->getAllocationCount(), pool.memoryType);
+			vkFreeMemory(m_device, block.memory, nullptr);
+		}
+	}
+	if (m_dedicatedCount > 0)
+		DEBUG_WARNING("%u dedicated allocations leaked", m_dedicatedCount);
+}
+
+uint32_t MemoryAllocator::findMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties) const {
+	for (uint32_t i = 0; i < m_memoryProperties.memoryTypeCount; i++) {
+		if ((typeFilter & (1 << i)) && (m_memoryProperties.memoryTypes[i].propertyFlags & properties) == properties) {
+			return i;
+		}
+	}
+
+	DEBUG_ERROR("failed to find suitable memory type");
+}
+
+VkDeviceMemory MemoryAllocator::allocateMemory(uint32_t memoryType, VkDeviceSize size, void** mapped) {
+	if (m_allocationCount >= m_maxAllocationCount)
+		DEBUG_ERROR("maxMemoryAllocationCount (%u) reached", m_maxAllocationCount);
+
+	VkMemoryAllocateInfo allocInfo{};
+	allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+	allocInfo.allocationSize = size;
+	allocInfo.memoryTypeIndex = memoryType;
+
+	VkDeviceMemory memory;
+	VK_CHECK(vkAllocateMemory(m_device, &allocInfo, nullptr, &memory));
+	m_allocationCount++;
+
+	*mapped = nullptr;
+	if (m_memoryProperties.memoryTypes[memoryType].propertyFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) {
+		// host visible memory stays persistently mapped
+		VK_CHECK(vkMapMemory(m_device, memory, 0, VK_WHOLE_SIZE, 0, mapped));
+	}
+
+	return memory;
+}
+
+Allocation MemoryAllocator::allocateDedicated(uint32_t memoryType, VkDeviceSize size) {
+	Allocation allocation{};
+	allocation.memory = allocateMemory(memoryType, size, &allocation.mapped);
+	allocation.size = size;
+	allocation.pool = UINT32_MAX;
+
+	m_dedicatedCount++;
+	m_dedicatedBytes += size;
+	return allocation;
+}
+
+Allocation MemoryAllocator::allocate(const VkMemoryRequirements& requirements, const AllocationInfo& info) {
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	uint32_t memoryType = findMemoryType(requirements.memoryTypeBits, info.properties);
+	uint32_t poolIndex = memoryType * 2 + (info.linear ? 0 : 1);
+	Pool& pool = m_pools[poolIndex];
+
+	if (requirements.size > pool.blockSize / 2 || (info.renderTarget && requirements.size >= DEDICATED_RENDER_TARGET_SIZE)) {
+		return allocateDedicated(memoryType, requirements.size);
+	}
+
+	Allocation allocation{};
+	allocation.pool = poolIndex;
+
+	RangeAllocator::Range range;
+	for (uint32_t i = 0; i < pool.blocks.size(); i++) {
+		Block& block = pool.blocks[i];
+		if (block.memory == VK_NULL_HANDLE)
+			continue;
+		if (block.ranges->allocate(requirements.size, requirements.alignment, range)) {
+			allocation.block = i;
+			break;
+		}
+	}
+
+	if (range.node == RangeAllocator::INVALID_NODE) {
+		// reuse a released block slot if there is one
+		uint32_t blockIndex = 0;
+		while (blockIndex < pool.blocks.size() && pool.blocks[blockIndex].memory != VK_NULL_HANDLE)
+			blockIndex++;
+		if (blockIndex == pool.blocks.size())
+			pool.blocks.emplace_back();
+
+		Block& block = pool.blocks[blockIndex];
+		block.memory = allocateMemory(memoryType, pool.blockSize, &block.mapped);
+		block.ranges = std::make_unique<RangeAllocator>(pool.blockSize);
+
+		bool success = block.ranges->allocate(requirements.size, requirements.alignment, range);
+		DEBUG_ASSERT(success, "failed to allocate %llu bytes from a new memory block", (unsigned long long)requirements.size);
+		allocation.block = blockIndex;
+	}
+
+	Block& block = pool.blocks[allocation.block];
+	allocation.memory = block.memory;
+	allocation.offset = range.offset;
+	allocation.size = range.size;
+	allocation.node = range.node;
+	if (block.mapped)
+		allocation.mapped = static_cast<uint8_t*>(block.mapped) + range.offset;
+
+	return allocation;
+}
+
+void MemoryAllocator::free(Allocation& allocation) {
+	if (allocation.memory == VK_NULL_HANDLE)
+		return;
+
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	if (allocation.pool == UINT32_MAX) {
+		vkFreeMemory(m_device, allocation.memory, nullptr);
+		m_allocationCount--;
+		m_dedicatedCount--;
+		m_dedicatedBytes -= allocation.size;
+	} else {
+		Pool& pool = m_pools[allocation.pool];
+		Block& block = pool.blocks[allocation.block];
+		block.ranges->free(allocation.node);
+
+		// keep one empty block around per pool to avoid allocation churn
+		if (block.ranges->isEmpty()) {
+			uint32_t liveBlocks = 0;
+			for (auto& b : pool.blocks)
+				liveBlocks += b.memory != VK_NULL_HANDLE;
+
+			if (liveBlocks > 1) {
+				vkFreeMemory(m_device, block.memory, nullptr);
+				m_allocationCount--;
+				block.memory = VK_NULL_HANDLE;
+				block.mapped = nullptr;
+				block.ranges.reset();
+			}
+		}
+	}
+
+	allocation = Allocation{};
+}
+
+MemoryAllocator::Stats MemoryAllocator::getStats() {
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	Stats stats{};
+	VkDeviceSize freeBytes = 0;
+	for (auto& pool : m_pools) {
+		for (auto& block : pool.blocks) {
+			if (block.memory == VK_NULL_HANDLE)
+				continue;
+			stats.blockCount++;
+			stats.blockBytes += block.ranges->getSize();
+			stats.usedBytes += block.ranges->getUsed();
+			stats.allocationCount += block.ranges->getAllocationCount();
+			stats.freeRegionCount += block.ranges->getFreeRegionCount();
+			stats.largestFreeRegion = std::max(stats.largestFreeRegion, block.ranges->getLargestFreeRegion());
+			freeBytes += block.ranges->getSize() - block.ranges->getUsed();
+		}
+	}
+	stats.dedicatedCount = m_dedicatedCount;
+	stats.dedicatedBytes = m_dedicatedBytes;
+	stats.fragmentation = freeBytes > 0 ? 1.f - static_cast<float>(stats.largestFreeRegion) / static_cast<float>(freeBytes) : 0.f;
+
+	return stats;
+}
+
+void MemoryAllocator::printStats() {
+	Stats stats = getStats();
+	printf("memory: %u blocks (%.1f MB, %.1f MB used, %u allocations, %u free regions, %.1f%% fragmentation), %u dedicated (%.1f MB), %u / %u vkAllocateMemory\n",
+		stats.blockCount, stats.blockBytes / (1024.f * 1024.f), stats.usedBytes / (1024.f * 1024.f),
+		stats.allocationCount, stats.freeRegionCount, stats.fragmentation * 100.f,
+		stats.dedicatedCount, stats.dedicatedBytes / (1024.f * 1024.f),
+		m_allocationCount, m_maxAllocationCount);
+}
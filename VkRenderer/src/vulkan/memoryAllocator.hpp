@@ -0,0 +1,73 @@
+#pragma once
+#include "src/vulkan/vkHeader.hpp"
+#include "src/vulkan/rangeAllocator.hpp"
+
+struct Allocation {
+	VkDeviceMemory memory = VK_NULL_HANDLE;
+	VkDeviceSize offset = 0;
+	VkDeviceSize size = 0;
+	void* mapped = nullptr;
+
+	uint32_t pool = UINT32_MAX;	// UINT32_MAX : dedicated allocation
+	uint32_t block = 0;
+	uint32_t node = RangeAllocator::INVALID_NODE;
+};
+
+struct AllocationInfo {
+	VkMemoryPropertyFlags properties = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
+	bool linear = true;			// buffers and linear images, kept apart from optimal images (bufferImageGranularity)
+	bool renderTarget = false;	// big attachments get their own VkDeviceMemory
+};
+
+// sub-allocates resources from large VkDeviceMemory blocks, one pool per memory type
+class MemoryAllocator {
+public:
+	struct Stats {
+		uint32_t blockCount = 0;
+		uint32_t allocationCount = 0;
+		uint32_t dedicatedCount = 0;
+		uint32_t freeRegionCount = 0;
+		VkDeviceSize blockBytes = 0;
+		VkDeviceSize usedBytes = 0;
+		VkDeviceSize dedicatedBytes = 0;
+		VkDeviceSize largestFreeRegion = 0;
+		float fragmentation = 0.f;	// 1 - largest free region / total free
+	};
+
+	MemoryAllocator(VkDevice device, VkPhysicalDevice physicalDevice);
+	~MemoryAllocator();
+
+	Allocation allocate(const VkMemoryRequirements& requirements, const AllocationInfo& info);
+	void free(Allocation& allocation);
+
+	Stats getStats();
+	void printStats();
+
+private:
+	struct Block {
+		VkDeviceMemory memory = VK_NULL_HANDLE;
+		void* mapped = nullptr;
+		std::unique_ptr<RangeAllocator> ranges;
+	};
+
+	struct Pool {
+		uint32_t memoryType = 0;
+		VkDeviceSize blockSize = 0;
+		std::vector<Block> blocks;
+	};
+
+	uint32_t findMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties) const;
+	VkDeviceMemory allocateMemory(uint32_t memoryType, VkDeviceSize size, void** mapped);
+	Allocation allocateDedicated(uint32_t memoryType, VkDeviceSize size);
+
+	VkDevice m_device;
+	VkPhysicalDeviceMemoryProperties m_memoryProperties;
+	uint32_t m_allocationCount = 0;
+	uint32_t m_maxAllocationCount = 0;
+
+	std::vector<Pool> m_pools;	// indexed by memoryType * 2 + (linear ? 0 : 1)
+	uint32_t m_dedicatedCount = 0;
+	VkDeviceSize m_dedicatedBytes = 0;
+
+	std::mutex m_mutex;
+};
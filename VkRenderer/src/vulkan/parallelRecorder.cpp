@@ -0,0 +1,49 @@
+#include "src/vulkan/parallelRecorder.hpp"
+#include "src/vulkan/commandBuffer.hpp"
+#include "src/threadPool.hpp"
+
+ParallelRecorder::ParallelRecorder() {
+	uint32_t threadCount = ThreadPool::get().getThreadCount();
+	for (auto& threads : m_threads) {
+		threads.resize(threadCount);
+		for (Thread& thread : threads)
+			thread.commandPool = std::make_unique<CommandPool>();
+	}
+}
+
+ParallelRecorder::~ParallelRecorder() {
+	// command buffers are freed before their pools
+	for (auto& threads : m_threads) {
+		for (Thread& thread : threads)
+			thread.commandBuffers.clear();
+	}
+}
+
+void ParallelRecorder::beginFrame(uint32_t frameIndex) {
+	m_frameIndex = frameIndex;
+	for (Thread& thread : m_threads[frameIndex]) {
+		if (thread.used == 0)
+			continue;
+		thread.commandPool->reset();
+		thread.used = 0;
+	}
+}
+
+void ParallelRecorder::record(CommandBuffer& primary, uint32_t chunkCount, const std::function<void(CommandBuffer&, uint32_t)>& record) {
+	m_chunks.assign(chunkCount, nullptr);
+	std::vector<Thread>& threads = m_threads[m_frameIndex];
+
+	ThreadPool::get().parallelFor(chunkCount, [&](uint32_t chunk) {
+		Thread& thread = threads[ThreadPool::getThreadIndex()];
+		if (thread.used == thread.commandBuffers.size())
+			thread.commandBuffers.push_back(std::make_unique<CommandBuffer>(thread.commandPool->getHandle(), VK_COMMAND_BUFFER_LEVEL_SECONDARY));
+		CommandBuffer& commandBuffer = *thread.commandBuffers[thread.used++];
+
+		commandBuffer.beginRecording(primary);
+		record(commandBuffer, chunk);
+		commandBuffer.endRecording();
+		m_chunks[chunk] = &commandBuffer;
+	});
+
+	primary.executeCommands(m_chunks.data(), chunkCount);
+}
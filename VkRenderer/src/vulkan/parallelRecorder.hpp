@@ -0,0 +1,31 @@
+#pragma once
+#include "src/vulkan/vkHeader.hpp"
+#include <functional>
+
+// records the draws of a render pass on the thread pool. a command pool can only be used by one thread at a time,
+// so every thread has its own per frame in flight, and allocates secondary command buffers from it that are kept
+// across frames. the secondaries of a call are executed by the primary in chunk order
+class ParallelRecorder {
+public:
+	ParallelRecorder();
+	~ParallelRecorder();
+
+	// resets the frame's pools, the frame's fence must have been waited
+	void beginFrame(uint32_t frameIndex);
+	// calls record(commandBuffer, chunk) once per chunk on the thread pool, each into a secondary continuing the
+	// primary's render pass, begun with secondary contents. call from outside the thread pool's workers
+	void record(CommandBuffer& primary, uint32_t chunkCount, const std::function<void(CommandBuffer&, uint32_t)>& record);
+
+	uint32_t getThreadCount() const { return static_cast<uint32_t>(m_threads[0].size()); }
+
+private:
+	struct Thread {
+		std::unique_ptr<CommandPool> commandPool;
+		std::vector<std::unique_ptr<CommandBuffer>> commandBuffers;
+		uint32_t used = 0;	// command buffers handed out this frame
+	};
+
+	std::vector<Thread> m_threads[MAX_FRAMES_IN_FLIGHT];
+	uint32_t m_frameIndex = 0;
+	std::vector<CommandBuffer*> m_chunks;
+};
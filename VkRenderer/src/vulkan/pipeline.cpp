@@ -5,6 +5,7 @@
 #include "src/vulkan/renderPass.hpp"
 #include "src/vulkan/swapchain.hpp"
 #include "src/vulkan/texture.hpp"
+#include "src/vulkan/commandBuffer.hpp"
 
 Pipeline::Pipeline(const PipelineDesc& info)
 	: m_shader(info.shader) {
@@ -16,17 +17,23 @@ Pipeline::Pipeline(const PipelineDesc& info)
 	bool hasDepth = false;
 
 	if (info.createFramebuffers) {
-		for (int i = 0; i < 4; i++) {
+		// indexed by Swapchain::getCurrentImageIndex() when presenting, by getCurrentFrameIndex() otherwise
+		uint32_t framebufferCount = info.swapchain != nullptr ? info.swapchain->getSwapchainTexturesCount() : MAX_FRAMES_IN_FLIGHT;
+		for (uint32_t i = 0; i < framebufferCount; i++) {
 			std::vector<std::shared_ptr<Texture>> textures;
 
 			for (auto& attachmentInfo : info.attachmentInfos) {
-				if (attachmentInfo.texture->getType() == TextureType::SWAPCHAIN && info.swapchain != nullptr) {
+				if (attachmentInfo.texture[0]->getType() == TextureType::SWAPCHAIN && info.swapchain != nullptr) {
 					textures.emplace_back(info.swapchain->m_swapchainTextures[i]);
 				} 
+				else if (info.swapchain != nullptr) {
+					DEBUG_ASSERT(attachmentInfo.texture.isShared(), "the framebuffers of a swapchain follow its images, not the frames in flight");
+					textures.emplace_back(attachmentInfo.texture[0]);
+				}
 				else {
-					textures.emplace_back(attachmentInfo.texture);
+					textures.emplace_back(attachmentInfo.texture[i]);
 				}
-				if (attachmentInfo.texture->getType() == TextureType::DEPTH) {
+				if (attachmentInfo.texture[0]->getType() == TextureType::DEPTH) {
 					hasDepth = true;
 				}
 			}
@@ -173,4 +180,25 @@ Pipeline::Pipeline(const PipelineDesc& info)
 Pipeline::~Pipeline() {
 	vkDestroyPipeline(Device::getHandle(), m_handle, nullptr);
 	vkDestroyPipelineLayout(Device::getHandle(), m_pipelineLayout, nullptr);
-}
\ No newline at end of file
+}
+
+ComputePipeline::ComputePipeline(std::shared_ptr<Shader> shader)
+	: m_shader(shader) {
+	m_pipelineLayout = m_shader->getPipelineLayout();
+
+	VkComputePipelineCreateInfo pipelineInfo{};
+	pipelineInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+	pipelineInfo.stage = m_shader->m_shaderStages[0];
+	pipelineInfo.layout = m_pipelineLayout;
+	VK_CHECK(vkCreateComputePipelines(Device::getHandle(), Context::get()->getPipelineCache(), 1, &pipelineInfo, nullptr, &m_handle));
+}
+
+ComputePipeline::~ComputePipeline() {
+	vkDestroyPipeline(Device::getHandle(), m_handle, nullptr);
+	vkDestroyPipelineLayout(Device::getHandle(), m_pipelineLayout, nullptr);
+}
+
+void ComputePipeline::dispatch(CommandBuffer& commandBuffer, uint32_t invocationCount, uint32_t groupSize) const {
+	commandBuffer.bindComputePipeline(*this);
+	commandBuffer.dispatch((invocationCount + groupSize - 1) / groupSize, 1, 1);
+}
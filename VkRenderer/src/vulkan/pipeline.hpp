@@ -26,6 +26,7 @@ public:
 	
 	VkPipeline getHandle() const { return m_handle; }
 	std::shared_ptr<RenderPass> getRenderPass() const { return m_renderPass; }
+	std::shared_ptr<Shader> getShader() const { return m_shader; }
 	std::vector<std::shared_ptr<Framebuffer>>& getFramebuffers() { return m_framebuffers; }
 private:
 
@@ -35,4 +36,22 @@ private:
 	std::shared_ptr<Shader> m_shader;
 	std::shared_ptr<RenderPass> m_renderPass;
 	std::vector<std::shared_ptr<Framebuffer>> m_framebuffers;
+};
+
+class ComputePipeline {
+public:
+	ComputePipeline(std::shared_ptr<Shader> shader);
+	~ComputePipeline();
+
+	VkPipeline getHandle() const { return m_handle; }
+	std::shared_ptr<Shader> getShader() const { return m_shader; }
+
+	// group counts covering invocationCount threads of groupSize
+	void dispatch(CommandBuffer& commandBuffer, uint32_t invocationCount, uint32_t groupSize) const;
+
+private:
+	VkPipelineLayout m_pipelineLayout;
+	VkPipeline m_handle;
+
+	std::shared_ptr<Shader> m_shader;
 };
\ No newline at end of file
@@ -0,0 +1,244 @@
+#include "src/vulkan/rangeAllocator.hpp"
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+static uint32_t bitScanForward(uint64_t mask) {
+#if defined(_MSC_VER)
+	unsigned long index;
+	_BitScanForward64(&index, mask);
+	return index;
+#else
+	return static_cast<uint32_t>(__builtin_ctzll(mask));
+#endif
+}
+
+static uint32_t bitScanReverse(uint64_t mask) {
+#if defined(_MSC_VER)
+	unsigned long index;
+	_BitScanReverse64(&index, mask);
+	return index;
+#else
+	return 63 - static_cast<uint32_t>(__builtin_clzll(mask));
+#endif
+}
+
+RangeAllocator::RangeAllocator(VkDeviceSize size) {
+	for (auto& fl : m_heads)
+		for (auto& head : fl)
+			head = INVALID_NODE;
+
+	grow(size);
+}
+
+void RangeAllocator::mapping(VkDeviceSize size, uint32_t& fl, uint32_t& sl) const {
+	if (size < SL_COUNT) {
+		fl = 0;
+		sl = static_cast<uint32_t>(size);
+		return;
+	}
+	uint32_t msb = bitScanReverse(size);
+	fl = msb - SL_BITS + 1;
+	sl = static_cast<uint32_t>(size >> (msb - SL_BITS)) - SL_COUNT;
+}
+
+uint32_t RangeAllocator::findFreeNode(VkDeviceSize size) const {
+	// round up to the next bin so that every block of the found bin is large enough
+	if (size >= SL_COUNT)
+		size += (VkDeviceSize(1) << (bitScanReverse(size) - SL_BITS)) - 1;
+
+	uint32_t fl, sl;
+	mapping(size, fl, sl);
+	if (fl >= FL_COUNT)
+		return INVALID_NODE;
+
+	uint32_t slMap = m_slBitmap[fl] & (~0u << sl);
+	if (slMap == 0) {
+		uint64_t flMap = fl + 1 < 64 ? m_flBitmap & (~uint64_t(0) << (fl + 1)) : 0;
+		if (flMap == 0)
+			return INVALID_NODE;
+		fl = bitScanForward(flMap);
+		slMap = m_slBitmap[fl];
+	}
+	sl = bitScanForward(slMap);
+
+	return m_heads[fl][sl];
+}
+
+void RangeAllocator::insertFree(uint32_t node) {
+	uint32_t fl, sl;
+	mapping(m_nodes[node].size, fl, sl);
+
+	uint32_t head = m_heads[fl][sl];
+	m_nodes[node].free = true;
+	m_nodes[node].prevFree = INVALID_NODE;
+	m_nodes[node].nextFree = head;
+	if (head != INVALID_NODE)
+		m_nodes[head].prevFree = node;
+	m_heads[fl][sl] = node;
+
+	m_flBitmap |= uint64_t(1) << fl;
+	m_slBitmap[fl] |= 1u << sl;
+	m_freeRegionCount++;
+}
+
+void RangeAllocator::removeFree(uint32_t node) {
+	Node& n = m_nodes[node];
+	uint32_t fl, sl;
+	mapping(n.size, fl, sl);
+
+	if (n.prevFree != INVALID_NODE)
+		m_nodes[n.prevFree].nextFree = n.nextFree;
+	if (n.nextFree != INVALID_NODE)
+		m_nodes[n.nextFree].prevFree = n.prevFree;
+
+	if (m_heads[fl][sl] == node) {
+		m_heads[fl][sl] = n.nextFree;
+		if (n.nextFree == INVALID_NODE) {
+			m_slBitmap[fl] &= ~(1u << sl);
+			if (m_slBitmap[fl] == 0)
+				m_flBitmap &= ~(uint64_t(1) << fl);
+		}
+	}
+
+	n.free = false;
+	n.prevFree = INVALID_NODE;
+	n.nextFree = INVALID_NODE;
+	m_freeRegionCount--;
+}
+
+uint32_t RangeAllocator::createNode() {
+	if (!m_unusedNodes.empty()) {
+		uint32_t node = m_unusedNodes.back();
+		m_unusedNodes.pop_back();
+		m_nodes[node] = Node{};
+		return node;
+	}
+	m_nodes.emplace_back();
+	return static_cast<uint32_t>(m_nodes.size() - 1);
+}
+
+void RangeAllocator::releaseNode(uint32_t node) {
+	m_unusedNodes.push_back(node);
+}
+
+uint32_t RangeAllocator::splitFront(uint32_t node, VkDeviceSize size) {
+	uint32_t front = createNode();
+
+	Node& n = m_nodes[node];
+	Node& f = m_nodes[front];
+	f.offset = n.offset;
+	f.size = size;
+	f.prevPhys = n.prevPhys;
+	f.nextPhys = node;
+	if (n.prevPhys != INVALID_NODE)
+		m_nodes[n.prevPhys].nextPhys = front;
+
+	n.offset += size;
+	n.size -= size;
+	n.prevPhys = front;
+
+	return front;
+}
+
+bool RangeAllocator::allocate(VkDeviceSize size, VkDeviceSize alignment, Range& range) {
+	size = std::max<VkDeviceSize>(size, 1);
+	alignment = std::max<VkDeviceSize>(alignment, 1);
+
+	uint32_t node = findFreeNode(size + alignment - 1);
+	if (node == INVALID_NODE)
+		return false;
+
+	removeFree(node);
+
+	VkDeviceSize offset = m_nodes[node].offset;
+	VkDeviceSize padding = (offset + alignment - 1) / alignment * alignment - offset;
+	if (padding > 0) {
+		uint32_t front = splitFront(node, padding);
+		insertFree(front);
+	}
+
+	if (m_nodes[node].size > size) {
+		uint32_t allocated = splitFront(node, size);
+		insertFree(node);
+		node = allocated;
+	}
+
+	m_used += m_nodes[node].size;
+	m_allocationCount++;
+
+	range.offset = m_nodes[node].offset;
+	range.size = m_nodes[node].size;
+	range.node = node;
+	return true;
+}
+
+void RangeAllocator::free(uint32_t node) {
+	DEBUG_ASSERT(node < m_nodes.size() && !m_nodes[node].free, "invalid range allocator node %u", node);
+
+	m_used -= m_nodes[node].size;
+	m_allocationCount--;
+
+	uint32_t prev = m_nodes[node].prevPhys;
+	if (prev != INVALID_NODE && m_nodes[prev].free) {
+		removeFree(prev);
+		m_nodes[node].offset = m_nodes[prev].offset;
+		m_nodes[node].size += m_nodes[prev].size;
+		m_nodes[node].prevPhys = m_nodes[prev].prevPhys;
+		if (m_nodes[node].prevPhys != INVALID_NODE)
+			m_nodes[m_nodes[node].prevPhys].nextPhys = node;
+		releaseNode(prev);
+	}
+
+	uint32_t next = m_nodes[node].nextPhys;
+	if (next != INVALID_NODE && m_nodes[next].free) {
+		removeFree(next);
+		m_nodes[node].size += m_nodes[next].size;
+		m_nodes[node].nextPhys = m_nodes[next].nextPhys;
+		if (m_nodes[node].nextPhys != INVALID_NODE)
+			m_nodes[m_nodes[node].nextPhys].prevPhys = node;
+		if (m_tail == next)
+			m_tail = node;
+		releaseNode(next);
+	}
+
+	insertFree(node);
+}
+
+void RangeAllocator::grow(VkDeviceSize newSize) {
+	DEBUG_ASSERT(newSize >= m_size, "range allocator can only grow");
+	VkDeviceSize extra = newSize - m_size;
+	if (extra == 0)
+		return;
+
+	if (m_tail != INVALID_NODE && m_nodes[m_tail].free) {
+		removeFree(m_tail);
+		m_nodes[m_tail].size += extra;
+		insertFree(m_tail);
+	} else {
+		uint32_t node = createNode();
+		m_nodes[node].offset = m_size;
+		m_nodes[node].size = extra;
+		m_nodes[node].prevPhys = m_tail;
+		if (m_tail != INVALID_NODE)
+			m_nodes[m_tail].nextPhys = node;
+		m_tail = node;
+		insertFree(node);
+	}
+
+	m_size = newSize;
+}
+
+VkDeviceSize RangeAllocator::getLargestFreeRegion() const {
+	if (m_flBitmap == 0)
+		return 0;
+
+	uint32_t fl = bitScanReverse(m_flBitmap);
+	uint32_t sl = bitScanReverse(m_slBitmap[fl]);
+
+	VkDeviceSize largest = 0;
+	for (uint32_t node = m_heads[fl][sl]; node != INVALID_NODE; node = m_nodes[node].nextFree)
+		largest = std::max(largest, m_nodes[node].size);
+	return largest;
+}
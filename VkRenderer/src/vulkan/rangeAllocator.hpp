@@ -0,0 +1,65 @@
+#pragma once
+#include "src/vulkan/vkHeader.hpp"
+
+// TLSF-style offset allocator : hands out [offset, offset + size) ranges of an
+// abstract address space (a VkDeviceMemory block, a buffer...) in O(1)
+class RangeAllocator {
+public:
+	static constexpr uint32_t INVALID_NODE = UINT32_MAX;
+
+	struct Range {
+		VkDeviceSize offset = 0;
+		VkDeviceSize size = 0;
+		uint32_t node = INVALID_NODE;
+	};
+
+	RangeAllocator(VkDeviceSize size);
+
+	bool allocate(VkDeviceSize size, VkDeviceSize alignment, Range& range);
+	void free(uint32_t node);
+	void grow(VkDeviceSize newSize);
+
+	VkDeviceSize getSize() const { return m_size; }
+	VkDeviceSize getUsed() const { return m_used; }
+	VkDeviceSize getLargestFreeRegion() const;
+	uint32_t getFreeRegionCount() const { return m_freeRegionCount; }
+	uint32_t getAllocationCount() const { return m_allocationCount; }
+	bool isEmpty() const { return m_allocationCount == 0; }
+
+private:
+	static constexpr uint32_t SL_BITS = 4;
+	static constexpr uint32_t SL_COUNT = 1 << SL_BITS;
+	static constexpr uint32_t FL_COUNT = 64 - SL_BITS + 1;
+
+	struct Node {
+		VkDeviceSize offset = 0;
+		VkDeviceSize size = 0;
+		uint32_t prevPhys = INVALID_NODE;
+		uint32_t nextPhys = INVALID_NODE;
+		uint32_t prevFree = INVALID_NODE;
+		uint32_t nextFree = INVALID_NODE;
+		bool free = false;
+	};
+
+	void mapping(VkDeviceSize size, uint32_t& fl, uint32_t& sl) const;
+	uint32_t findFreeNode(VkDeviceSize size) const;
+	void insertFree(uint32_t node);
+	void removeFree(uint32_t node);
+	uint32_t splitFront(uint32_t node, VkDeviceSize size);
+	uint32_t createNode();
+	void releaseNode(uint32_t node);
+
+	std::vector<Node> m_nodes;
+	std::vector<uint32_t> m_unusedNodes;
+
+	uint64_t m_flBitmap = 0;
+	uint32_t m_slBitmap[FL_COUNT] = {};
+	uint32_t m_heads[FL_COUNT][SL_COUNT];
+
+	uint32_t m_tail = INVALID_NODE;	// last node in address order
+
+	VkDeviceSize m_size = 0;
+	VkDeviceSize m_used = 0;
+	uint32_t m_freeRegionCount = 0;
+	uint32_t m_allocationCount = 0;
+};
@@ -17,7 +17,7 @@ RenderPass::RenderPass(std::initializer_list<Attachment> attachmentInfos, bool c
 		ref.attachment = binding;
 		binding++;
 
-		std::shared_ptr<Texture> tex = attachmentInfo.texture;
+		std::shared_ptr<Texture> tex = attachmentInfo.texture[0];
 		VkAttachmentDescription desc{};
 		desc.format = tex->getFormat();
 		desc.samples = tex->getSampleCount();
@@ -26,18 +26,10 @@ RenderPass::RenderPass(std::initializer_list<Attachment> attachmentInfos, bool c
 		desc.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
 		desc.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
 
-		switch (tex->getType()) {
-		case TextureType::COLOR:
-			desc.finalLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL; // todo
-			break;
-		case TextureType::DEPTH:
-			desc.finalLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+		desc.finalLayout = getFinalLayout(tex->getType());
+		if (tex->getType() == TextureType::DEPTH) {
 			ref.layout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
 			depthAttachmentRef.push_back(ref);
-			break;
-		case TextureType::SWAPCHAIN:
-			desc.finalLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
-			break;
 		}
 
 		if (clear) {	// todo: clear per attachment
@@ -91,6 +83,18 @@ RenderPass::RenderPass(std::initializer_list<Attachment> attachmentInfos, bool c
 	VK_CHECK(vkCreateRenderPass(Device::getHandle(), &renderPassInfo, nullptr, &m_handle));
 }
 
+VkImageLayout RenderPass::getFinalLayout(TextureType type) {
+	switch (type) {
+	case TextureType::COLOR:
+	case TextureType::DEPTH:
+		return VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL; // todo
+	case TextureType::SWAPCHAIN:
+		return VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+	default:
+		return VK_IMAGE_LAYOUT_UNDEFINED;
+	}
+}
+
 RenderPass::~RenderPass() {
 	vkDestroyRenderPass(Device::getHandle(), m_handle, nullptr);
 }
\ No newline at end of file
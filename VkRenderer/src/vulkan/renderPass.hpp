@@ -1,8 +1,9 @@
 #pragma once
 #include "src/vulkan/vkHeader.hpp"
+#include "src/vulkan/frameResource.hpp"
 
 struct Attachment {
-	std::shared_ptr<Texture> texture;
+	FrameResource<Texture> texture;	// the render pass is made from the first copy, they share format and sample count
 	bool resolve = false;
 };
 
@@ -11,6 +12,9 @@ public:
 	RenderPass(std::initializer_list<Attachment> attachmentInfos, bool clear, glm::vec4 clearColor);
 	~RenderPass();
 
+	// layout every attachment of the type is left in, and loaded from when the pass doesn't clear
+	static VkImageLayout getFinalLayout(TextureType type);
+
 	VkRenderPass getHandle() const { return m_handle; }
 	std::vector<VkClearValue>& getClearValues() { return m_clearValues; }
 
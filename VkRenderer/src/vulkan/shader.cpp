@@ -16,9 +16,43 @@ static std::vector<char> readFile(const std::string& filename) {
 	return buffer;
 }
 
-VkFormat spirvTypeToVkFormat(const spirv_cross::SPIRType& type) {
+static bool endsWith(const std::string& name, const char* suffix) {
+	size_t length = strlen(suffix);
+	return name.size() >= length && name.compare(name.size() - length, length, suffix) == 0;
+}
+
+// 16 bit attributes still read as float vectors in glsl, the input name carries the storage format :
+// inNormal_snorm16, inPosition_unorm16, inTexCoord_half. there is no 3 component variant, pad to vec4
+static VkFormat packedFormat(const spirv_cross::SPIRType& type, const std::string& name) {
+	static const VkFormat snorm16[] = { VK_FORMAT_R16_SNORM, VK_FORMAT_R16G16_SNORM, VK_FORMAT_UNDEFINED, VK_FORMAT_R16G16B16A16_SNORM };
+	static const VkFormat unorm16[] = { VK_FORMAT_R16_UNORM, VK_FORMAT_R16G16_UNORM, VK_FORMAT_UNDEFINED, VK_FORMAT_R16G16B16A16_UNORM };
+	static const VkFormat half[] = { VK_FORMAT_R16_SFLOAT, VK_FORMAT_R16G16_SFLOAT, VK_FORMAT_UNDEFINED, VK_FORMAT_R16G16B16A16_SFLOAT };
+
+	if (type.basetype != spirv_cross::SPIRType::Float || type.columns != 1 || type.vecsize < 1 || type.vecsize > 4)
+		return VK_FORMAT_UNDEFINED;
+
+	const VkFormat* formats = nullptr;
+	if (endsWith(name, "_snorm16"))
+		formats = snorm16;
+	else if (endsWith(name, "_unorm16"))
+		formats = unorm16;
+	else if (endsWith(name, "_half"))
+		formats = half;
+	else
+		return VK_FORMAT_UNDEFINED;
+
+	VkFormat format = formats[type.vecsize - 1];
+	DEBUG_ASSERT(format != VK_FORMAT_UNDEFINED, "vertex attribute %s : 16 bit vec3 isn't supported, use a vec4", name.c_str());
+	return format;
+}
+
+VkFormat spirvTypeToVkFormat(const spirv_cross::SPIRType& type, const std::string& name) {
 	using namespace spirv_cross;
 
+	VkFormat packed = packedFormat(type, name);
+	if (packed != VK_FORMAT_UNDEFINED)
+		return packed;
+
 	if (type.basetype == SPIRType::Float) {
 		switch (type.columns) {
 		case 1:
@@ -65,6 +99,15 @@ uint32_t formatSize(VkFormat format) {
 	case VK_FORMAT_R32G32_UINT: return 8;
 	case VK_FORMAT_R32G32B32_UINT: return 12;
 	case VK_FORMAT_R32G32B32A32_UINT: return 16;
+	case VK_FORMAT_R16_SNORM: return 2;
+	case VK_FORMAT_R16G16_SNORM: return 4;
+	case VK_FORMAT_R16G16B16A16_SNORM: return 8;
+	case VK_FORMAT_R16_UNORM: return 2;
+	case VK_FORMAT_R16G16_UNORM: return 4;
+	case VK_FORMAT_R16G16B16A16_UNORM: return 8;
+	case VK_FORMAT_R16_SFLOAT: return 2;
+	case VK_FORMAT_R16G16_SFLOAT: return 4;
+	case VK_FORMAT_R16G16B16A16_SFLOAT: return 8;
 	default: DEBUG_ERROR("Unhandled VkFormat");
 	}
 }
@@ -100,6 +143,22 @@ Shader::Shader(const char* vertPath, const char* fragPath) {
 	createPipelineLayout();
 }
 
+Shader::Shader(const char* compPath) {
+	std::string compFullPath = std::string(ASSETS_PATH) + compPath;
+	auto compShaderCode = readFile(compFullPath.c_str());
+
+	VkPipelineShaderStageCreateInfo compShaderStageInfo{};
+	compShaderStageInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+	compShaderStageInfo.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+	compShaderStageInfo.module = createShaderModule(compShaderCode);
+	compShaderStageInfo.pName = "main";
+	m_shaderStages[0] = compShaderStageInfo;
+
+	loadData(compShaderCode, VK_SHADER_STAGE_COMPUTE_BIT);
+
+	createPipelineLayout();
+}
+
 Shader::~Shader()
 {
 	destroy();
@@ -152,7 +211,7 @@ void Shader::loadData(std::vector<char>& code, VkShaderStageFlags stage)
 			VkVertexInputAttributeDescription desc{};
 			desc.binding = comp.get_decoration(resource.id, spv::DecorationBinding);
 			desc.location = comp.get_decoration(resource.id, spv::DecorationLocation);
-			desc.format = spirvTypeToVkFormat(type);
+			desc.format = spirvTypeToVkFormat(type, comp.get_name(resource.id));
 			desc.offset = currOffset;
 			currOffset += formatSize(desc.format);
 			m_attributeDescriptions.emplace_back(desc);
@@ -190,6 +249,32 @@ void Shader::loadData(std::vector<char>& code, VkShaderStageFlags stage)
 		}
 	}
 
+	// storage buffer data, the size is the fixed part before a runtime array
+	for (auto& storage : resources.storage_buffers) {
+		uint32_t binding = comp.get_decoration(storage.id, spv::DecorationBinding);
+		uint32_t set = comp.get_decoration(storage.id, spv::DecorationDescriptorSet);
+
+		auto it = std::find_if(
+			m_descriptorInfos.begin(),
+			m_descriptorInfos.end(),
+			[&](const DescriptorInfo& info) {
+				return info.binding == binding && info.set == set;
+			}
+		);
+
+		if (it != m_descriptorInfos.end()) {
+			it->shaderStage |= stage;
+		} else {
+			m_descriptorInfos.push_back({
+			VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+			stage,
+			0,
+			binding,
+			set
+			});
+		}
+	}
+
 	// image sampler data
 	for (auto& image : resources.sampled_images) {
 
@@ -208,8 +293,9 @@ void Shader::loadData(std::vector<char>& code, VkShaderStageFlags stage)
 		auto ranges = comp.get_active_buffer_ranges(pushConst.id);
 		uint32_t size = 0;
 
+		// up to the end of the last member used, unused members in between still take space
 		for (auto& range : ranges) {
-			size += static_cast<uint32_t>(range.range);
+			size = std::max(size, static_cast<uint32_t>(range.offset + range.range));
 		}
 
 		m_pushConstantRanges.push_back({
@@ -12,6 +12,8 @@ struct DescriptorInfo {
 class Shader {
 public:
 	Shader(const char* vertPath, const char* fragPath);
+	// compute shader, its only stage is m_shaderStages[0]
+	explicit Shader(const char* compPath);
 	~Shader();
 
 	void destroy();
@@ -23,9 +25,12 @@ public:
 	std::vector<VkDescriptorSetLayout>& getDescriptorSetLayouts() { return m_descriptorSetLayouts; }
 	std::vector<DescriptorInfo>& getDescriptorInfos() { return m_descriptorInfos; }
 	uint32_t getVertexInputStride() const { return m_vertexInputStride; }
+	// depth only shaders, they can be fed the position stream of a geometry buffer
+	bool readsPositionOnly() const { return m_attributeDescriptions.size() == 1 && m_attributeDescriptions[0].location == 0; }
 	VkPipelineLayout getPipelineLayout() const { return m_pipelineLayout; }
+	const std::vector<VkPushConstantRange>& getPushConstantRanges() const { return m_pushConstantRanges; }
 	
-	VkPipelineShaderStageCreateInfo m_shaderStages[2];
+	VkPipelineShaderStageCreateInfo m_shaderStages[2] = {};
 
 private:
 	void loadData(std::vector<char>& code, VkShaderStageFlags stage);
@@ -36,6 +36,13 @@ void Fence::wait()
 	}
 }
 
+bool Fence::isComplete()
+{
+	if (!m_signaled)
+		m_signaled = vkGetFenceStatus(Device::getHandle(), m_handle) == VK_SUCCESS;
+	return m_signaled;
+}
+
 void Fence::reset()
 {
 	if (m_signaled)
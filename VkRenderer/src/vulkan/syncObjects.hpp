@@ -20,6 +20,7 @@ public:
 	VkFence getHandle() const { return m_handle; }
 
 	bool isSignaled() const { return m_signaled; }
+	bool isComplete();
 
 	void wait();
 	void reset();
@@ -1,7 +1,7 @@
 #include "src/vulkan/texture.hpp"
-#include "src/vulkan/buffer.hpp"
 #include "src/vulkan/device.hpp"
-#include "src/vulkan/commandBuffer.hpp"
+#include "src/vulkan/context.hpp"
+#include "src/vulkan/uploadQueue.hpp"
 #define STB_IMAGE_IMPLEMENTATION
 #include <stb_image.h>
 
@@ -10,11 +10,10 @@ Texture::~Texture() {
 	vkDestroyImageView(Device::getHandle(), m_imageView, nullptr);
 	if(m_type!=TextureType::SWAPCHAIN)
 		vkDestroyImage(Device::getHandle(), m_image, nullptr);
-	vkFreeMemory(Device::getHandle(), m_imageMemory, nullptr);
+	Device::get()->getAllocator().free(m_allocation);
 }
 
-void Texture::createImage(VkImageTiling tiling, VkImageUsageFlags usage, VkMemoryPropertyFlags properties) {
-	// todo; use vma
+void Texture::createImage(VkImageTiling tiling, VkImageUsageFlags usage, VkMemoryPropertyFlags properties, bool transient) {
 	VkImageCreateInfo imageInfo{};
 	imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
 	imageInfo.imageType = VK_IMAGE_TYPE_2D;
@@ -35,20 +34,28 @@ void Texture::createImage(VkImageTiling tiling, VkImageUsageFlags usage, VkMemor
 
 	VK_CHECK(vkCreateImage(Device::getHandle(), &imageInfo, nullptr, &m_image));
 
+	m_transient = transient;
+	if (transient)
+		return;
+
 	VkMemoryRequirements memRequirements;
 	vkGetImageMemoryRequirements(Device::getHandle(), m_image, &memRequirements);
 
-	VkMemoryAllocateInfo allocInfo{};
-	allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-	allocInfo.allocationSize = memRequirements.size;
-	allocInfo.memoryTypeIndex = Device::get()->getPhysicalDevice().findMemoryType(memRequirements.memoryTypeBits, properties);
-
-	VK_CHECK(vkAllocateMemory(Device::getHandle(), &allocInfo, nullptr, &m_imageMemory));
+	AllocationInfo allocInfo{};
+	allocInfo.properties = properties;
+	allocInfo.linear = tiling == VK_IMAGE_TILING_LINEAR;
+	allocInfo.renderTarget = usage & (VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT);
+	m_allocation = Device::get()->getAllocator().allocate(memRequirements, allocInfo);
 
-	vkBindImageMemory(Device::getHandle(), m_image, m_imageMemory, 0);
+	VK_CHECK(vkBindImageMemory(Device::getHandle(), m_image, m_allocation.memory, m_allocation.offset));
 }
 
 void Texture::createImageView(VkImageAspectFlags aspectFlags) {
+	if (m_transient && !m_bound) {
+		m_pendingViewAspect = aspectFlags;
+		return;
+	}
+
 	VkImageViewCreateInfo viewInfo{};
 	viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
 	viewInfo.image = m_image;
@@ -66,10 +73,25 @@ void Texture::createImageView(VkImageAspectFlags aspectFlags) {
 	VK_CHECK(vkCreateImageView(Device::getHandle(), &viewInfo, nullptr, &m_imageView));
 }
 
+VkMemoryRequirements Texture::getMemoryRequirements() const {
+	VkMemoryRequirements requirements;
+	vkGetImageMemoryRequirements(Device::getHandle(), m_image, &requirements);
+	return requirements;
+}
+
+void Texture::bindMemory(VkDeviceMemory memory, VkDeviceSize offset) {
+	DEBUG_ASSERT(m_transient && !m_bound, "only transient images are bound to memory they don't own, once");
+	VK_CHECK(vkBindImageMemory(Device::getHandle(), m_image, memory, offset));
+	m_bound = true;
+
+	if (m_pendingViewAspect != 0) {
+		createImageView(m_pendingViewAspect);
+		m_pendingViewAspect = 0;
+	}
+}
+
 void Texture::transitionImageLayout(VkImageLayout oldLayout, VkImageLayout newLayout) {
-	CommandPool commandPool;
-	CommandBuffer commandBuffer(commandPool.getHandle());
-	commandBuffer.beginRecording();
+	VkCommandBuffer commandBuffer = Context::get()->getUploadQueue()->getCommandBuffer();
 
 	VkPipelineStageFlags sourceStage;
 	VkPipelineStageFlags destinationStage;
@@ -125,7 +147,7 @@ void Texture::transitionImageLayout(VkImageLayout oldLayout, VkImageLayout newLa
 	}
 
 	vkCmdPipelineBarrier(
-		commandBuffer.getHandle(),
+		commandBuffer,
 		sourceStage, destinationStage,
 		0,
 		0, nullptr,
@@ -134,10 +156,6 @@ void Texture::transitionImageLayout(VkImageLayout oldLayout, VkImageLayout newLa
 	);
 
 	m_layout = newLayout;
-
-	commandBuffer.endRecording();
-	commandBuffer.submit(false);
-	vkQueueWaitIdle(Device::get()->getGraphicsQueue()); // temp
 }
 
 void Texture::createSampler(VkSamplerAddressMode addressMode) {
@@ -166,9 +184,7 @@ void Texture::createSampler(VkSamplerAddressMode addressMode) {
 }
 
 void Texture::clear(VkClearColorValue clearColor) {
-	CommandPool commandPool;
-	CommandBuffer commandBuffer(commandPool.getHandle());
-	commandBuffer.beginRecording();
+	VkCommandBuffer commandBuffer = Context::get()->getUploadQueue()->getCommandBuffer();
 
     // Define the subresource range to clear (entire image)
     VkImageSubresourceRange range{};
@@ -191,7 +207,7 @@ void Texture::clear(VkClearColorValue clearColor) {
     barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
 
     vkCmdPipelineBarrier(
-		commandBuffer.getHandle(),
+		commandBuffer,
         VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
         VK_PIPELINE_STAGE_TRANSFER_BIT,
         0,
@@ -202,7 +218,7 @@ void Texture::clear(VkClearColorValue clearColor) {
 
     // Clear the image
     vkCmdClearColorImage(
-		commandBuffer.getHandle(),
+		commandBuffer,
         m_image,
         VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
         &clearColor,
@@ -210,45 +226,7 @@ void Texture::clear(VkClearColorValue clearColor) {
         &range
     );
 
-	commandBuffer.endRecording();
-	commandBuffer.submit(false);
-	vkQueueWaitIdle(Device::get()->getGraphicsQueue()); // temp
-}
-
-void Texture::copyBufferToImage(VkBuffer buffer, uint32_t width, uint32_t height) {
-	CommandPool commandPool;
-	CommandBuffer commandBuffer(commandPool.getHandle());
-	commandBuffer.beginRecording();
-
-	VkBufferImageCopy region{};
-	region.bufferOffset = 0;
-	region.bufferRowLength = 0;
-	region.bufferImageHeight = 0;
-
-	region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-	region.imageSubresource.mipLevel = 0;
-	region.imageSubresource.baseArrayLayer = 0;
-	region.imageSubresource.layerCount = m_layerCount;
-
-	region.imageOffset = { 0, 0, 0 };
-	region.imageExtent = {
-		width,
-		height,
-		1
-	};
-
-	vkCmdCopyBufferToImage(
-		commandBuffer.getHandle(),
-		buffer,
-		m_image,
-		VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-		1,
-		&region
-	);
-
-	commandBuffer.endRecording();
-	commandBuffer.submit(false);
-	vkQueueWaitIdle(Device::get()->getGraphicsQueue()); // temp
+	m_layout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
 }
 
 Texture2D::Texture2D(TextureType type, VkImage image, VkImageView imageView, uint32_t width, uint32_t height, VkFormat format) {
@@ -275,17 +253,6 @@ Texture2D::Texture2D(std::filesystem::path path) {
 
 	DEBUG_ASSERT(pixels, "failed to load texture image \"%s\"", path.string().c_str());
 
-	Buffer stagingBuffer;
-	stagingBuffer.createBuffer(imageSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
-
-	void* data;
-	vkMapMemory(Device::getHandle(), stagingBuffer.getMemory(), 0, imageSize, 0, &data);
-	memcpy(data, pixels, static_cast<size_t>(imageSize));
-	vkUnmapMemory(Device::getHandle(), stagingBuffer.getMemory());
-
-	stbi_image_free(pixels);
-
-
 	createImage(
 		VK_IMAGE_TILING_OPTIMAL,
 		VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
@@ -294,7 +261,9 @@ Texture2D::Texture2D(std::filesystem::path path) {
 
 	// copy
 	transitionImageLayout(VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
-	copyBufferToImage(stagingBuffer.getHandle(), m_width, m_height);
+	Context::get()->getUploadQueue()->copyToImage(m_image, m_width, m_height, m_layerCount, pixels, imageSize);
+
+	stbi_image_free(pixels);
 
 	createImageView( VK_IMAGE_ASPECT_COLOR_BIT);
 
@@ -312,14 +281,6 @@ Texture2D::Texture2D(const void* pixels, uint32_t width, uint32_t height) {
 
 	VkDeviceSize imageSize = width * height * 4;
 
-	Buffer stagingBuffer;
-	stagingBuffer.createBuffer(imageSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
-
-	void* data;
-	vkMapMemory(Device::getHandle(), stagingBuffer.getMemory(), 0, imageSize, 0, &data);
-	memcpy(data, pixels, static_cast<size_t>(imageSize));
-	vkUnmapMemory(Device::getHandle(), stagingBuffer.getMemory());
-
 	createImage(
 		VK_IMAGE_TILING_OPTIMAL,
 		VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
@@ -328,7 +289,7 @@ Texture2D::Texture2D(const void* pixels, uint32_t width, uint32_t height) {
 
 	// copy
 	transitionImageLayout(VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
-	copyBufferToImage(stagingBuffer.getHandle(), m_width, m_height);
+	Context::get()->getUploadQueue()->copyToImage(m_image, m_width, m_height, m_layerCount, pixels, imageSize);
 
 	createImageView(VK_IMAGE_ASPECT_COLOR_BIT);
 
@@ -346,9 +307,7 @@ Texture2D::Texture2D(TextureType type, uint32_t width, uint32_t height, VkFormat
 }
 
 void Texture2D::generateMipmaps() {
-	CommandPool commandPool;
-	CommandBuffer commandBuffer(commandPool.getHandle());
-	commandBuffer.beginRecording();
+	VkCommandBuffer commandBuffer = Context::get()->getUploadQueue()->getCommandBuffer();
 
 	int32_t mipWidth = m_width;
 	int32_t mipHeight = m_height;
@@ -370,7 +329,7 @@ void Texture2D::generateMipmaps() {
 		barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
 		barrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
 
-		vkCmdPipelineBarrier(commandBuffer.getHandle(),
+		vkCmdPipelineBarrier(commandBuffer,
 			VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0,
 			0, nullptr,
 			0, nullptr,
@@ -390,7 +349,7 @@ void Texture2D::generateMipmaps() {
 		blit.dstSubresource.baseArrayLayer = 0;
 		blit.dstSubresource.layerCount = 1;
 
-		vkCmdBlitImage(commandBuffer.getHandle(),
+		vkCmdBlitImage(commandBuffer,
 			m_image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
 			m_image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
 			1, &blit,
@@ -401,7 +360,7 @@ void Texture2D::generateMipmaps() {
 		barrier.srcAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
 		barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
 
-		vkCmdPipelineBarrier(commandBuffer.getHandle(),
+		vkCmdPipelineBarrier(commandBuffer,
 			VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0,
 			0, nullptr,
 			0, nullptr,
@@ -417,15 +376,13 @@ void Texture2D::generateMipmaps() {
 	barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
 	barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
 
-	vkCmdPipelineBarrier(commandBuffer.getHandle(),
+	vkCmdPipelineBarrier(commandBuffer,
 		VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0,
 		0, nullptr,
 		0, nullptr,
 		1, &barrier);
 
-	commandBuffer.endRecording();
-	commandBuffer.submit(false);
-	vkQueueWaitIdle(Device::get()->getGraphicsQueue()); // temp
+	m_layout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
 }
 
 CubeMap::CubeMap(const char** paths) {
@@ -452,22 +409,21 @@ CubeMap::CubeMap(const char** paths) {
 	VkDeviceSize layerSize = m_width * m_height * 4;
 	VkDeviceSize imageSize = layerSize * m_layerCount;
 
-	Buffer stagingBuffer;
-	stagingBuffer.createBuffer(imageSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+	createImage(VK_IMAGE_TILING_OPTIMAL, VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+
+	transitionImageLayout(VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
+
+	auto uploadQueue = Context::get()->getUploadQueue();
+	StagingRegion staging = uploadQueue->stage(imageSize);
 
-	void* data;
-	vkMapMemory(Device::getHandle(), stagingBuffer.getMemory(), 0, imageSize, 0, &data);
+	uint8_t* data = static_cast<uint8_t*>(staging.mapped);
 	for (int i = 0; i < 6; i++)
-		memcpy(static_cast<uint8_t*>(data) + (layerSize * i), textureData[i], static_cast<size_t>(layerSize));
-	vkUnmapMemory(Device::getHandle(), stagingBuffer.getMemory());
+		memcpy(data + (layerSize * i), textureData[i], static_cast<size_t>(layerSize));
 
 	for (int i = 0; i < 6; i++)
 		stbi_image_free(textureData[i]);
 
-	createImage(VK_IMAGE_TILING_OPTIMAL, VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
-
-	transitionImageLayout(VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
-	copyBufferToImage(stagingBuffer.getHandle(), m_width, m_height);
+	uploadQueue->copyToImage(m_image, m_width, m_height, m_layerCount, staging);
 	transitionImageLayout(VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
 
 	createImageView(VK_IMAGE_ASPECT_COLOR_BIT);
@@ -475,10 +431,10 @@ CubeMap::CubeMap(const char** paths) {
 	createSampler();
 }
 
-DepthTexture::DepthTexture(uint32_t width, uint32_t height, VkSampleCountFlagBits sampleCount)
+DepthTexture::DepthTexture(uint32_t width, uint32_t height, VkSampleCountFlagBits sampleCount, bool transient)
 	: Texture2D(TextureType::DEPTH, width, height, Device::get()->getPhysicalDevice().findDepthFormat(), sampleCount) {
 	createImage(VK_IMAGE_TILING_OPTIMAL,
 		VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
-		VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+		VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, transient);
 	createImageView(VK_IMAGE_ASPECT_DEPTH_BIT);
 }
\ No newline at end of file
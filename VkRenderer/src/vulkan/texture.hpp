@@ -1,5 +1,6 @@
 #pragma once
 #include "src/vulkan/vkHeader.hpp"
+#include "src/vulkan/memoryAllocator.hpp"
 
 class Texture {
 public:
@@ -8,26 +9,33 @@ public:
 
 	uint32_t getWidth() const { return m_width; }
 	uint32_t getHeight() const { return m_height; }
+	VkImage getImage() const { return m_image; }
 	VkImageView getImageView() const { return m_imageView; }
 	VkSampler getSampler() const { return m_sampler; }
 	VkSampleCountFlagBits getSampleCount() const { return m_sampleCount; }
 	VkFormat getFormat() const { return m_format; }
 	VkImageLayout getLayout() const { return m_layout; }
 	TextureType getType() const { return m_type; }
+	bool isTransient() const { return m_transient; }
 
-	void createImage(VkImageTiling tiling, VkImageUsageFlags usage, VkMemoryPropertyFlags properties);
+	// transient : the image gets no memory of its own, bindMemory() places it in memory shared with other images
+	void createImage(VkImageTiling tiling, VkImageUsageFlags usage, VkMemoryPropertyFlags properties, bool transient = false);
+	// created once the memory of a transient image is bound
 	void createImageView(VkImageAspectFlags aspectFlags);
+	VkMemoryRequirements getMemoryRequirements() const;
+	void bindMemory(VkDeviceMemory memory, VkDeviceSize offset);
 	void transitionImageLayout(VkImageLayout oldLayout, VkImageLayout newLayout);
 	void createSampler(VkSamplerAddressMode addressMode = VK_SAMPLER_ADDRESS_MODE_REPEAT);
 	void clear(VkClearColorValue clearColor);
 protected:
-	void copyBufferToImage(VkBuffer buffer, uint32_t width, uint32_t height);
-
 	uint32_t m_width = 0;
 	uint32_t m_height = 0;
 	VkImage m_image = VK_NULL_HANDLE;
 	VkImageView m_imageView = VK_NULL_HANDLE;
-	VkDeviceMemory m_imageMemory = VK_NULL_HANDLE;
+	Allocation m_allocation;
+	bool m_transient = false;
+	bool m_bound = false;
+	VkImageAspectFlags m_pendingViewAspect = 0;	// the view of a transient image waiting for its memory
 	VkSampler m_sampler = VK_NULL_HANDLE;
 
 	uint32_t m_mipLevels = 1;
@@ -50,7 +58,7 @@ public:
 
 class DepthTexture : public Texture2D {
 public:
-	DepthTexture(uint32_t width, uint32_t height, VkSampleCountFlagBits sampleCount = VK_SAMPLE_COUNT_1_BIT);
+	DepthTexture(uint32_t width, uint32_t height, VkSampleCountFlagBits sampleCount = VK_SAMPLE_COUNT_1_BIT, bool transient = false);
 };
 
 class CubeMap : public Texture {
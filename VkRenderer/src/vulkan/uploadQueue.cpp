@@ -0,0 +1,230 @@
+#include "src/vulkan/uploadQueue.hpp"
+#include "src/vulkan/buffer.hpp"
+#include "src/vulkan/commandBuffer.hpp"
+#include "src/vulkan/syncObjects.hpp"
+#include "src/vulkan/device.hpp"
+
+static constexpr uint32_t BATCH_COUNT = 4;
+
+UploadQueue::UploadQueue(VkDeviceSize stagingSize)
+	: m_stagingSize(stagingSize) {
+	m_commandPool = std::make_unique<CommandPool>();
+
+	m_batches.resize(BATCH_COUNT);
+	for (auto& batch : m_batches)
+		batch.commandBuffer = std::make_unique<CommandBuffer>(m_commandPool->getHandle());
+
+	m_staging = std::make_unique<Buffer>();
+	m_staging->createBuffer(m_stagingSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+}
+
+UploadQueue::~UploadQueue() {
+	waitIdle();
+}
+
+void UploadQueue::beginBatch() {
+	if (m_recording)
+		return;
+
+	// every batch is in flight : wait for the oldest one, which is the next in line
+	Batch& batch = m_batches[m_current];
+	while (batch.inFlight)
+		retireOldest();
+
+	batch.commandBuffer->reset();
+	batch.commandBuffer->beginRecording();
+	batch.ticket = m_nextTicket;
+	m_batchStart = m_writePos;
+	m_recording = true;
+}
+
+void UploadQueue::retireOldest() {
+	DEBUG_ASSERT(!m_inFlight.empty(), "no upload batch in flight");
+
+	Batch& batch = m_batches[m_inFlight.front()];
+	batch.commandBuffer->getFence()->wait();
+
+	m_readPos = batch.stagingEnd;
+	m_completedTicket = batch.ticket;
+	batch.overflowBuffers.clear();
+	batch.inFlight = false;
+	m_inFlight.pop_front();
+}
+
+void UploadQueue::poll() {
+	while (!m_inFlight.empty() && m_batches[m_inFlight.front()].commandBuffer->getFence()->isComplete())
+		retireOldest();
+}
+
+StagingRegion UploadQueue::stage(VkDeviceSize size, VkDeviceSize alignment) {
+	StagingRegion region{};
+
+	if (size > m_stagingSize / 2) {
+		// too big for the ring, lives as long as the batch
+		beginBatch();
+		auto buffer = std::make_unique<Buffer>();
+		buffer->createBuffer(size, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+		region.buffer = buffer->getHandle();
+		region.mapped = buffer->getMapped();
+		m_batches[m_current].overflowBuffers.push_back(std::move(buffer));
+		return region;
+	}
+
+	// let the gpu start on what was recorded so far
+	if (m_recording && m_writePos - m_batchStart > m_stagingSize / 4)
+		flush();
+
+	VkDeviceSize offset = m_writePos % m_stagingSize;
+	VkDeviceSize aligned = (offset + alignment - 1) / alignment * alignment;
+	if (aligned + size > m_stagingSize)
+		aligned = m_stagingSize;	// skip the end of the ring and wrap to 0
+
+	uint64_t start = m_writePos + (aligned - offset);
+	uint64_t end = start + size;
+
+	poll();
+	while (end - m_readPos > m_stagingSize) {
+		m_stats.stallCount++;
+		// only the batch being recorded holds the ring
+		if (m_inFlight.empty())
+			flush();
+		retireOldest();
+	}
+
+	beginBatch();
+	m_writePos = end;
+
+	region.buffer = m_staging->getHandle();
+	region.offset = start % m_stagingSize;
+	region.mapped = static_cast<uint8_t*>(m_staging->getMapped()) + region.offset;
+	return region;
+}
+
+VkCommandBuffer UploadQueue::getCommandBuffer() {
+	beginBatch();
+	return m_batches[m_current].commandBuffer->getHandle();
+}
+
+void UploadQueue::copyToBuffer(VkBuffer dst, VkDeviceSize dstOffset, const void* data, VkDeviceSize size) {
+	if (size == 0)
+		return;
+
+	StagingRegion staging = stage(size);
+	memcpy(staging.mapped, data, static_cast<size_t>(size));
+	copyToBuffer(dst, dstOffset, staging, size);
+}
+
+void UploadQueue::copyToBuffer(VkBuffer dst, VkDeviceSize dstOffset, const StagingRegion& staging, VkDeviceSize size) {
+	if (size == 0)
+		return;
+
+	VkBufferCopy region{};
+	region.srcOffset = staging.offset;
+	region.dstOffset = dstOffset;
+	region.size = size;
+	vkCmdCopyBuffer(getCommandBuffer(), staging.buffer, dst, 1, &region);
+
+	m_stats.uploadCount++;
+	m_stats.uploadedBytes += size;
+}
+
+void UploadQueue::copyBuffer(VkBuffer src, VkBuffer dst, const std::vector<VkBufferCopy>& regions) {
+	if (regions.empty())
+		return;
+
+	VkCommandBuffer commandBuffer = getCommandBuffer();
+
+	// the source may have been written earlier in this batch
+	VkMemoryBarrier barrier{};
+	barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+	barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+	barrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT | VK_ACCESS_TRANSFER_WRITE_BIT;
+	vkCmdPipelineBarrier(commandBuffer,
+		VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0,
+		1, &barrier,
+		0, nullptr,
+		0, nullptr);
+
+	vkCmdCopyBuffer(commandBuffer, src, dst, static_cast<uint32_t>(regions.size()), regions.data());
+}
+
+void UploadQueue::copyToImage(VkImage image, uint32_t width, uint32_t height, uint32_t layerCount, const StagingRegion& staging) {
+	VkBufferImageCopy region{};
+	region.bufferOffset = staging.offset;
+	region.bufferRowLength = 0;
+	region.bufferImageHeight = 0;
+
+	region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+	region.imageSubresource.mipLevel = 0;
+	region.imageSubresource.baseArrayLayer = 0;
+	region.imageSubresource.layerCount = layerCount;
+
+	region.imageOffset = { 0, 0, 0 };
+	region.imageExtent = { width, height, 1 };
+
+	vkCmdCopyBufferToImage(getCommandBuffer(), staging.buffer, image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region);
+
+	m_stats.uploadCount++;
+}
+
+void UploadQueue::copyToImage(VkImage image, uint32_t width, uint32_t height, uint32_t layerCount, const void* data, VkDeviceSize size) {
+	StagingRegion staging = stage(size);
+	memcpy(staging.mapped, data, static_cast<size_t>(size));
+	copyToImage(image, width, height, layerCount, staging);
+
+	m_stats.uploadedBytes += size;
+}
+
+uint64_t UploadQueue::flush() {
+	if (!m_recording)
+		return m_nextTicket - 1;
+
+	Batch& batch = m_batches[m_current];
+
+	// make the uploads visible to everything submitted after this batch
+	VkMemoryBarrier barrier{};
+	barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+	barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+	barrier.dstAccessMask = VK_ACCESS_MEMORY_READ_BIT | VK_ACCESS_MEMORY_WRITE_BIT;
+	vkCmdPipelineBarrier(batch.commandBuffer->getHandle(),
+		VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, 0,
+		1, &barrier,
+		0, nullptr,
+		0, nullptr);
+
+	batch.commandBuffer->endRecording();
+	batch.commandBuffer->submit(false);
+
+	batch.stagingEnd = m_writePos;
+	batch.inFlight = true;
+	m_inFlight.push_back(m_current);
+
+	m_current = (m_current + 1) % BATCH_COUNT;
+	m_recording = false;
+	m_stats.submittedBatches++;
+
+	return m_nextTicket++;
+}
+
+bool UploadQueue::isComplete(uint64_t ticket) {
+	poll();
+	return ticket <= m_completedTicket;
+}
+
+void UploadQueue::wait(uint64_t ticket) {
+	if (m_recording && ticket >= m_nextTicket)
+		flush();
+
+	while (m_completedTicket < ticket && !m_inFlight.empty())
+		retireOldest();
+}
+
+void UploadQueue::waitIdle() {
+	wait(flush());
+}
+
+void UploadQueue::printStats() const {
+	printf("uploads: %llu copies (%.1f MB) in %llu batches, %llu staging stalls\n",
+		(unsigned long long)m_stats.uploadCount, m_stats.uploadedBytes / (1024.f * 1024.f),
+		(unsigned long long)m_stats.submittedBatches, (unsigned long long)m_stats.stallCount);
+}
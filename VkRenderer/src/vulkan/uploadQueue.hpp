@@ -0,0 +1,81 @@
+#pragma once
+#include "src/vulkan/vkHeader.hpp"
+
+// staging space for one upload, either in the ring or in a dedicated buffer for oversized data
+struct StagingRegion {
+	VkBuffer buffer = VK_NULL_HANDLE;
+	VkDeviceSize offset = 0;
+	void* mapped = nullptr;
+};
+
+// records every resource upload into a few batched command buffers fed by a persistent staging ring.
+// a batch is submitted on flush() (or when it gets too big) and identified by a ticket that can be polled or waited on
+class UploadQueue {
+public:
+	struct Stats {
+		uint64_t submittedBatches = 0;
+		uint64_t uploadCount = 0;
+		VkDeviceSize uploadedBytes = 0;
+		uint64_t stallCount = 0;	// times the ring was full and the cpu had to wait for the gpu
+	};
+
+	UploadQueue(VkDeviceSize stagingSize = 64ull * 1024 * 1024);
+	~UploadQueue();
+
+	UploadQueue(const UploadQueue&) = delete;
+	UploadQueue& operator=(const UploadQueue&) = delete;
+
+	// returns mapped staging memory that stays valid until the current batch completes
+	StagingRegion stage(VkDeviceSize size, VkDeviceSize alignment = 16);
+
+	void copyToBuffer(VkBuffer dst, VkDeviceSize dstOffset, const void* data, VkDeviceSize size);
+	// size bytes already written to a region returned by stage()
+	void copyToBuffer(VkBuffer dst, VkDeviceSize dstOffset, const StagingRegion& staging, VkDeviceSize size);
+	void copyBuffer(VkBuffer src, VkBuffer dst, const std::vector<VkBufferCopy>& regions);
+	// copies tightly packed layers into mip 0, the image must be in TRANSFER_DST_OPTIMAL
+	void copyToImage(VkImage image, uint32_t width, uint32_t height, uint32_t layerCount, const StagingRegion& staging);
+	void copyToImage(VkImage image, uint32_t width, uint32_t height, uint32_t layerCount, const void* data, VkDeviceSize size);
+
+	// command buffer of the batch being recorded, for barriers, blits and clears
+	VkCommandBuffer getCommandBuffer();
+
+	uint64_t flush();
+	bool isComplete(uint64_t ticket);
+	void wait(uint64_t ticket);
+	void waitIdle();
+
+	uint64_t getRecordingTicket() const { return m_nextTicket; }
+	const Stats& getStats() const { return m_stats; }
+	void printStats() const;
+
+private:
+	struct Batch {
+		std::unique_ptr<CommandBuffer> commandBuffer;
+		uint64_t ticket = 0;
+		uint64_t stagingEnd = 0;
+		std::vector<std::unique_ptr<Buffer>> overflowBuffers;
+		bool inFlight = false;
+	};
+
+	void beginBatch();
+	void retireOldest();
+	void poll();
+
+	std::unique_ptr<CommandPool> m_commandPool;
+	std::vector<Batch> m_batches;
+	std::deque<uint32_t> m_inFlight;	// batch indices in submission order
+	uint32_t m_current = 0;
+	bool m_recording = false;
+
+	uint64_t m_nextTicket = 1;
+	uint64_t m_completedTicket = 0;
+
+	std::unique_ptr<Buffer> m_staging;
+	VkDeviceSize m_stagingSize;
+	// monotonic positions, the ring offset is position % size
+	uint64_t m_writePos = 0;
+	uint64_t m_readPos = 0;
+	uint64_t m_batchStart = 0;
+
+	Stats m_stats;
+};
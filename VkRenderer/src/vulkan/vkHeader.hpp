@@ -73,10 +73,16 @@ class Semaphore;
 class Framebuffer;
 class RenderPass;
 class Pipeline;
+class ComputePipeline;
 class Swapchain;
+class Buffer;
 class VertexBuffer;
 class IndexBuffer;
+class GeometryBuffer;
+class GeometryRange;
 class Material;
+class MemoryAllocator;
+class UploadQueue;
 
 enum class TextureType {
 	NONE,
@@ -0,0 +1,475 @@
+#include "tests/test.hpp"
+#include "src/bvh.hpp"
+#include "src/occlusionRasterizer.hpp"
+#include "src/depthPyramid.hpp"
+#include <random>
+
+// small objects scattered over a city sized area, like instanced props
+static std::vector<Aabb> getCityBoxes(uint32_t count, std::mt19937& random) {
+	std::uniform_real_distribution<float> position(-500.0f, 500.0f);
+	std::uniform_real_distribution<float> height(0.0f, 50.0f);
+	std::uniform_real_distribution<float> size(0.2f, 4.0f);
+	std::vector<Aabb> boxes(count);
+	for (Aabb& box : boxes) {
+		glm::vec3 center(position(random), height(random), position(random));
+		glm::vec3 extent(size(random), size(random), size(random));
+		box = { center - extent, center + extent };
+	}
+	return boxes;
+}
+
+static Frustum getCityFrustum() {
+	glm::mat4 projection = glm::perspective(glm::radians(90.0f), 16.0f / 9.0f, 0.1f, 300.0f);
+	glm::mat4 view = glm::lookAt(glm::vec3(0.0f, 20.0f, 0.0f), glm::vec3(100.0f, 10.0f, 50.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+	return Frustum::fromMatrix(projection * view);
+}
+
+// the items a linear pass over the boxes would keep
+static std::vector<uint32_t> getVisibleItems(const Frustum& frustum, const std::vector<Aabb>& boxes) {
+	std::vector<uint32_t> items;
+	for (uint32_t i = 0; i < boxes.size(); i++) {
+		if (frustum.classify(boxes[i]) != Frustum::Overlap::OUTSIDE)
+			items.push_back(i);
+	}
+	return items;
+}
+
+static std::vector<uint32_t> sorted(std::vector<uint32_t> items) {
+	std::sort(items.begin(), items.end());
+	return items;
+}
+
+// slab test of one box, infinity when it is missed
+static float getRayDistance(const Aabb& box, const glm::vec3& origin, const glm::vec3& direction) {
+	float enter = 0.0f, exit = std::numeric_limits<float>::infinity();
+	for (int axis = 0; axis < 3; axis++) {
+		float t0 = (box.min[axis] - origin[axis]) / direction[axis];
+		float t1 = (box.max[axis] - origin[axis]) / direction[axis];
+		enter = std::max(enter, std::min(t0, t1));
+		exit = std::min(exit, std::max(t0, t1));
+	}
+	return enter <= exit ? enter : std::numeric_limits<float>::infinity();
+}
+
+TEST(bvhFrustumQueryMatchesLinear) {
+	std::mt19937 random(1);
+	std::vector<Aabb> boxes = getCityBoxes(10000, random);
+	Frustum frustum = getCityFrustum();
+
+	Bvh bvh;
+	bvh.build(boxes.data(), static_cast<uint32_t>(boxes.size()));
+	CHECK(bvh.getItemCount() == boxes.size());
+
+	std::vector<uint32_t> items;
+	bvh.queryFrustum(frustum, items);
+	std::vector<uint32_t> expected = getVisibleItems(frustum, boxes);
+	CHECK(!expected.empty());
+	CHECK(sorted(items) == expected);
+
+	// refitted after moving every third box
+	std::uniform_real_distribution<float> offset(-20.0f, 20.0f);
+	for (uint32_t i = 0; i < boxes.size(); i += 3) {
+		glm::vec3 move(offset(random), 0.0f, offset(random));
+		boxes[i] = { boxes[i].min + move, boxes[i].max + move };
+		bvh.update(i, boxes[i]);
+	}
+	items.clear();
+	bvh.queryFrustum(frustum, items);
+	CHECK(sorted(items) == getVisibleItems(frustum, boxes));
+}
+
+TEST(bvhOverlapQueryMatchesLinear) {
+	std::mt19937 random(2);
+	std::vector<Aabb> boxes = getCityBoxes(10000, random);
+	Bvh bvh;
+	bvh.build(boxes.data(), static_cast<uint32_t>(boxes.size()));
+
+	std::uniform_real_distribution<float> position(-500.0f, 500.0f);
+	bool same = true;
+	for (uint32_t query = 0; query < 100; query++) {
+		glm::vec3 center(position(random), 25.0f, position(random));
+		Aabb box = { center - glm::vec3(30.0f), center + glm::vec3(30.0f) };
+
+		std::vector<uint32_t> items, expected;
+		bvh.queryOverlap(box, items);
+		for (uint32_t i = 0; i < boxes.size(); i++) {
+			if (boxes[i].overlaps(box))
+				expected.push_back(i);
+		}
+		same &= sorted(items) == expected;
+	}
+	CHECK(same);
+}
+
+TEST(bvhRaycastFindsTheNearestBox) {
+	std::mt19937 random(3);
+	std::vector<Aabb> boxes = getCityBoxes(5000, random);
+	Bvh bvh;
+	bvh.build(boxes.data(), static_cast<uint32_t>(boxes.size()));
+
+	std::uniform_real_distribution<float> position(-500.0f, 500.0f);
+	std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+	const float maxDistance = 200.0f;
+	uint32_t hits = 0, wrong = 0;
+	for (uint32_t ray = 0; ray < 1000; ray++) {
+		glm::vec3 origin(position(random), 25.0f, position(random));
+		glm::vec3 direction = glm::normalize(glm::vec3(unit(random), unit(random) * 0.2f, unit(random)));
+
+		float nearest = maxDistance;
+		bool expectHit = false;
+		for (const Aabb& box : boxes) {
+			float distance = getRayDistance(box, origin, direction);
+			if (distance <= nearest) {
+				nearest = distance;
+				expectHit = true;
+			}
+		}
+
+		float distance = 0.0f;
+		uint32_t item = bvh.raycast(origin, direction, maxDistance, &distance);
+		if (item == Bvh::INVALID_ITEM) {
+			wrong += expectHit;
+			continue;
+		}
+		hits++;
+		wrong += !expectHit || std::abs(distance - nearest) > 1e-3f || std::abs(getRayDistance(boxes[item], origin, direction) - nearest) > 1e-3f;
+	}
+	CHECK(hits > 0);
+	CHECK(wrong == 0);
+}
+
+// build, refit and queries against a linear pass
+BENCHMARK(bvhQueries) {
+	using Clock = std::chrono::high_resolution_clock;
+	auto milliseconds = [](Clock::time_point start) {
+		return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+	};
+
+	std::mt19937 random(1);
+	std::uniform_real_distribution<float> position(-500.0f, 500.0f);
+	std::uniform_real_distribution<float> height(0.0f, 50.0f);
+	const uint32_t itemCount = 50000;
+	std::vector<Aabb> boxes = getCityBoxes(itemCount, random);
+
+	Bvh bvh;
+	auto start = Clock::now();
+	bvh.build(boxes.data(), itemCount);
+	double buildTime = milliseconds(start);
+	printf("  %u items, %u nodes, built in %.2f ms, sah cost %.2f\n", itemCount, bvh.getNodeCount(), buildTime, bvh.getSahCost());
+
+	Frustum frustum = getCityFrustum();
+	const uint32_t repeats = 100;
+	std::vector<uint32_t> items;
+	uint32_t nodesVisited = 0;
+	start = Clock::now();
+	for (uint32_t r = 0; r < repeats; r++) {
+		items.clear();
+		bvh.queryFrustum(frustum, items, &nodesVisited);
+	}
+	double bvhTime = milliseconds(start) / repeats;
+	size_t bvhVisible = items.size();
+
+	size_t linearVisible = 0;
+	start = Clock::now();
+	for (uint32_t r = 0; r < repeats; r++) {
+		linearVisible = 0;
+		for (const Aabb& box : boxes)
+			linearVisible += frustum.classify(box) != Frustum::Overlap::OUTSIDE;
+	}
+	double linearTime = milliseconds(start) / repeats;
+	printf("  frustum: %zu visible, %.3f ms (%u nodes), linear %.3f ms (%zu visible)\n",
+		bvhVisible, bvhTime, nodesVisited / repeats, linearTime, linearVisible);
+
+	const uint32_t rayCount = 100000;
+	std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+	uint32_t hits = 0;
+	start = Clock::now();
+	for (uint32_t i = 0; i < rayCount; i++) {
+		glm::vec3 origin(position(random), height(random), position(random));
+		glm::vec3 direction = glm::normalize(glm::vec3(unit(random), unit(random) * 0.2f, unit(random)));
+		hits += bvh.raycast(origin, direction, 200.0f) != Bvh::INVALID_ITEM;
+	}
+	printf("  rays: %u in %.2f ms, %u hits\n", rayCount, milliseconds(start), hits);
+
+	const uint32_t overlapCount = 10000;
+	size_t overlapping = 0;
+	start = Clock::now();
+	for (uint32_t i = 0; i < overlapCount; i++) {
+		glm::vec3 center(position(random), height(random), position(random));
+		items.clear();
+		bvh.queryOverlap({ center - glm::vec3(10.0f), center + glm::vec3(10.0f) }, items);
+		overlapping += items.size();
+	}
+	printf("  overlap: %u queries in %.2f ms, %.1f items each\n", overlapCount, milliseconds(start), overlapping / double(overlapCount));
+
+	// a tenth of the scene moves a little every frame
+	std::uniform_real_distribution<float> offset(-2.0f, 2.0f);
+	const uint32_t frames = 10;
+	start = Clock::now();
+	for (uint32_t frame = 0; frame < frames; frame++) {
+		for (uint32_t i = frame % 10; i < itemCount; i += 10) {
+			glm::vec3 move(offset(random), 0.0f, offset(random));
+			boxes[i] = { boxes[i].min + move, boxes[i].max + move };
+			bvh.update(i, boxes[i]);
+		}
+	}
+	printf("  refit: %u items per frame in %.3f ms, sah cost %.2f, needs rebuild %s\n",
+		itemCount / 10, milliseconds(start) / frames, bvh.getSahCost(), bvh.needsRebuild() ? "yes" : "no");
+
+	start = Clock::now();
+	bvh.build(boxes.data(), itemCount);
+	printf("  rebuild: %.2f ms, sah cost %.2f\n", milliseconds(start), bvh.getSahCost());
+}
+
+// boxes and spheres of unrelated sizes around the city frustum, plenty of them crossing its planes
+static BoundsBatch getRandomBounds(size_t count, std::mt19937& random) {
+	std::uniform_real_distribution<float> position(-350.0f, 350.0f);
+	std::uniform_real_distribution<float> size(0.0f, 30.0f);
+	std::uniform_real_distribution<float> offset(-5.0f, 5.0f);
+	BoundsBatch bounds;
+	for (size_t i = 0; i < count; i++) {
+		glm::vec3 center(position(random), position(random) * 0.2f, position(random));
+		bounds.centerX.push_back(center.x);
+		bounds.centerY.push_back(center.y);
+		bounds.centerZ.push_back(center.z);
+		bounds.extentX.push_back(size(random));
+		bounds.extentY.push_back(size(random));
+		bounds.extentZ.push_back(size(random));
+		bounds.sphereX.push_back(center.x + offset(random));
+		bounds.sphereY.push_back(center.y + offset(random));
+		bounds.sphereZ.push_back(center.z + offset(random));
+		bounds.radius.push_back(size(random));
+	}
+	return bounds;
+}
+
+TEST(cullBoundsMatchesScalar) {
+	std::mt19937 random(1);
+	Frustum frustum = getCityFrustum();
+	bool same = true, counted = true;
+	uint32_t visibleCount = 0, culledCount = 0;
+	// the tails left after the groups of 4 as well
+	for (size_t count : { 0, 1, 2, 3, 4, 5, 6, 7, 13, 4097 }) {
+		for (uint32_t repeat = 0; repeat < 16; repeat++) {
+			BoundsBatch bounds = getRandomBounds(count, random);
+			std::vector<uint8_t> visible;
+			CullingStats stats;
+			cullBounds(frustum, bounds, visible, stats);
+
+			uint32_t expected = 0;
+			same &= visible.size() == count;
+			for (size_t i = 0; i < count && i < visible.size(); i++) {
+				bool scalar = isBoundsVisible(frustum, bounds, i);
+				same &= visible[i] == (scalar ? 1 : 0);
+				expected += scalar ? 1 : 0;
+			}
+			counted &= stats.meshCount == count && stats.visibleMeshes == expected;
+			visibleCount += expected;
+			culledCount += static_cast<uint32_t>(count) - expected;
+		}
+	}
+	CHECK(same);
+	CHECK(counted);
+	// both outcomes are exercised
+	CHECK(visibleCount > 1000 && culledCount > 1000);
+}
+
+// the 12 triangles of a box
+static void addBox(const glm::vec3& center, const glm::vec3& extent, std::vector<glm::vec3>& positions, std::vector<uint32_t>& indices) {
+	const uint32_t boxIndices[36] = {
+		0, 1, 3, 0, 3, 2, 4, 6, 7, 4, 7, 5, 0, 4, 5, 0, 5, 1,
+		2, 3, 7, 2, 7, 6, 0, 2, 6, 0, 6, 4, 1, 5, 7, 1, 7, 3 };
+	uint32_t first = static_cast<uint32_t>(positions.size());
+	for (int corner = 0; corner < 8; corner++)
+		positions.push_back(center + extent * glm::vec3((corner & 1) ? 1.f : -1.f, (corner & 2) ? 1.f : -1.f, (corner & 4) ? 1.f : -1.f));
+	for (uint32_t index : boxIndices)
+		indices.push_back(first + index);
+}
+
+// looking down -z
+static glm::mat4 getViewProjection(const glm::vec3& eye) {
+	glm::mat4 projection = glm::perspective(glm::radians(90.0f), 16.0f / 9.0f, 0.1f, 300.0f);
+	glm::mat4 view = glm::lookAt(eye, eye + glm::vec3(0.0f, 0.0f, -1.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+	return projection * view;
+}
+
+static Aabb getBox(const glm::vec3& center, const glm::vec3& extent) {
+	return { center - extent, center + extent };
+}
+
+// a 30 x 20 wall 20 units in front of the camera, covering the middle of the view
+static void drawWall(OcclusionRasterizer& rasterizer, DepthPyramid& pyramid, const glm::mat4& viewProjection) {
+	std::vector<glm::vec3> positions;
+	std::vector<uint32_t> indices;
+	addBox(glm::vec3(0.0f, 0.0f, -20.0f), glm::vec3(15.0f, 10.0f, 0.5f), positions, indices);
+	rasterizer.begin(viewProjection);
+	rasterizer.drawTriangles(positions.data(), static_cast<uint32_t>(positions.size()), indices.data(), static_cast<uint32_t>(indices.size()), glm::mat4(1.0f));
+	rasterizer.buildPyramid(pyramid);
+}
+
+TEST(occluderDepthCoversTheWall) {
+	glm::mat4 viewProjection = getViewProjection(glm::vec3(0.0f));
+	OcclusionRasterizer rasterizer;
+	DepthPyramid pyramid;
+	drawWall(rasterizer, pyramid, viewProjection);
+	CHECK(rasterizer.getTriangleCount() > 0);
+
+	// the wall's front face, pushed to the back of the pixel at most as far as its back face
+	glm::vec4 front = viewProjection * glm::vec4(0.0f, 0.0f, -19.5f, 1.0f);
+	glm::vec4 back = viewProjection * glm::vec4(0.0f, 0.0f, -20.5f, 1.0f);
+	uint32_t width = rasterizer.getWidth(), height = rasterizer.getHeight();
+	float center = rasterizer.getDepth()[(height / 2) * width + width / 2];
+	CHECK(center >= front.z / front.w - 1e-4f);
+	CHECK(center <= back.z / back.w);
+
+	// nothing beside it
+	CHECK(rasterizer.getDepth()[0] == 1.0f);
+	CHECK(rasterizer.getDepth()[width * height - 1] == 1.0f);
+	CHECK(pyramid.isValid());
+	CHECK(pyramid.getLevelCount() > 1);
+}
+
+TEST(occlusionOfHiddenAndPartlyVisibleBoxes) {
+	glm::mat4 viewProjection = getViewProjection(glm::vec3(0.0f));
+	OcclusionRasterizer rasterizer;
+	DepthPyramid pyramid;
+	drawWall(rasterizer, pyramid, viewProjection);
+
+	// behind the wall
+	CHECK(!pyramid.isVisible(getBox(glm::vec3(0.0f, 0.0f, -40.0f), glm::vec3(1.0f)), viewProjection));
+	CHECK(!pyramid.isVisible(glm::vec3(5.0f, 3.0f, -60.0f), 2.0f, viewProjection));
+	// in front of it
+	CHECK(pyramid.isVisible(getBox(glm::vec3(0.0f, 0.0f, -10.0f), glm::vec3(1.0f)), viewProjection));
+	// behind it, past its edge on one side
+	CHECK(pyramid.isVisible(getBox(glm::vec3(31.0f, 0.0f, -40.0f), glm::vec3(2.0f, 1.0f, 1.0f)), viewProjection));
+	// beside it
+	CHECK(pyramid.isVisible(getBox(glm::vec3(-55.0f, 0.0f, -40.0f), glm::vec3(1.0f)), viewProjection));
+	// crossing the edge of the view
+	CHECK(pyramid.isVisible(getBox(glm::vec3(0.0f, 0.0f, -40.0f), glm::vec3(100.0f, 1.0f, 1.0f)), viewProjection));
+}
+
+TEST(occlusionNearThePlane) {
+	glm::mat4 viewProjection = getViewProjection(glm::vec3(0.0f));
+	OcclusionRasterizer rasterizer;
+	DepthPyramid pyramid;
+	drawWall(rasterizer, pyramid, viewProjection);
+
+	// boxes crossing the near plane or behind the camera project to nothing usable, they are kept
+	CHECK(pyramid.isVisible(getBox(glm::vec3(0.0f), glm::vec3(0.5f)), viewProjection));
+	CHECK(pyramid.isVisible(getBox(glm::vec3(0.0f, 0.0f, 5.0f), glm::vec3(1.0f)), viewProjection));
+
+	// an occluder crossing the near plane is clipped, what is in front of the camera still occludes
+	std::vector<glm::vec3> positions;
+	std::vector<uint32_t> indices;
+	addBox(glm::vec3(0.0f, 0.0f, -5.0f), glm::vec3(20.0f, 20.0f, 10.0f), positions, indices);
+	rasterizer.begin(viewProjection);
+	rasterizer.drawTriangles(positions.data(), static_cast<uint32_t>(positions.size()), indices.data(), static_cast<uint32_t>(indices.size()), glm::mat4(1.0f));
+	rasterizer.buildPyramid(pyramid);
+	CHECK(rasterizer.getTriangleCount() > 0);
+
+	bool finite = true;
+	uint32_t covered = 0;
+	for (uint32_t i = 0; i < rasterizer.getWidth() * rasterizer.getHeight(); i++) {
+		float depth = rasterizer.getDepth()[i];
+		finite &= depth >= 0.0f && depth <= 1.0f;
+		covered += depth < 1.0f;
+	}
+	CHECK(finite);
+	CHECK(covered == rasterizer.getWidth() * rasterizer.getHeight());
+	CHECK(!pyramid.isVisible(getBox(glm::vec3(0.0f, 0.0f, -40.0f), glm::vec3(1.0f)), viewProjection));
+}
+
+TEST(occluderScalarMatchesSse) {
+	glm::mat4 viewProjection = getViewProjection(glm::vec3(0.0f));
+	// a width that is not a multiple of 4 before rounding
+	OcclusionRasterizer vector(250, 141), scalar(250, 141);
+	scalar.setScalar(true);
+
+	// triangles of every size and orientation, some of them crossing the near plane or behind the camera
+	std::mt19937 random(1);
+	std::uniform_real_distribution<float> position(-30.0f, 30.0f);
+	std::uniform_real_distribution<float> depth(-80.0f, 2.0f);
+	std::uniform_real_distribution<float> size(0.05f, 20.0f);
+	bool same = true;
+	for (uint32_t batch = 0; batch < 8; batch++) {
+		std::vector<glm::vec3> positions;
+		std::vector<uint32_t> indices;
+		for (uint32_t i = 0; i < 256; i++) {
+			glm::vec3 center(position(random), position(random), depth(random));
+			float extent = size(random);
+			for (uint32_t k = 0; k < 3; k++) {
+				indices.push_back(static_cast<uint32_t>(positions.size()));
+				positions.push_back(center + glm::vec3(position(random), position(random), position(random)) * (extent / 30.0f));
+			}
+		}
+
+		for (OcclusionRasterizer* rasterizer : { &vector, &scalar }) {
+			rasterizer->begin(viewProjection);
+			rasterizer->drawTriangles(positions.data(), static_cast<uint32_t>(positions.size()), indices.data(), static_cast<uint32_t>(indices.size()), glm::mat4(1.0f));
+		}
+		size_t pixelCount = vector.getWidth() * vector.getHeight();
+		same &= vector.getTriangleCount() == scalar.getTriangleCount() && vector.getTriangleCount() > 0;
+		same &= std::memcmp(vector.getDepth(), scalar.getDepth(), pixelCount * sizeof(float)) == 0;
+	}
+	CHECK(same);
+}
+
+// occluder rasterization and the pyramid test, walls in front of a crowd of small boxes
+BENCHMARK(occlusionCulling) {
+	using Clock = std::chrono::high_resolution_clock;
+	auto milliseconds = [](Clock::time_point start) {
+		return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+	};
+
+	// wide walls between the camera and a crowd of small boxes
+	std::mt19937 random(1);
+	std::uniform_real_distribution<float> lateral(-40.0f, 40.0f);
+	std::uniform_real_distribution<float> wallDistance(10.0f, 40.0f);
+	std::uniform_real_distribution<float> boxDistance(5.0f, 150.0f);
+	std::uniform_real_distribution<float> size(0.2f, 2.0f);
+
+	const uint32_t occluderCount = 32, boxCount = 50000;
+	std::vector<glm::vec3> positions;
+	std::vector<uint32_t> indices;
+	for (uint32_t i = 0; i < occluderCount; i++) {
+		glm::vec3 center(lateral(random), 0.0f, -wallDistance(random));
+		addBox(center, glm::vec3(8.0f, 6.0f, 0.5f), positions, indices);
+	}
+
+	std::vector<Aabb> boxes(boxCount);
+	for (Aabb& box : boxes) {
+		glm::vec3 center(lateral(random), lateral(random) * 0.2f, -boxDistance(random));
+		glm::vec3 extent(size(random), size(random), size(random));
+		box = { center - extent, center + extent };
+	}
+
+	glm::mat4 viewProjection = getViewProjection(glm::vec3(0.0f, 2.0f, 0.0f));
+
+	OcclusionRasterizer rasterizer;
+	DepthPyramid pyramid;
+	const uint32_t repeats = 100;
+	auto start = Clock::now();
+	for (uint32_t r = 0; r < repeats; r++) {
+		rasterizer.begin(viewProjection);
+		rasterizer.drawTriangles(positions.data(), static_cast<uint32_t>(positions.size()), indices.data(), static_cast<uint32_t>(indices.size()), glm::mat4(1.0f));
+	}
+	double rasterTime = milliseconds(start) / repeats;
+
+	start = Clock::now();
+	for (uint32_t r = 0; r < repeats; r++)
+		rasterizer.buildPyramid(pyramid);
+	double pyramidTime = milliseconds(start) / repeats;
+
+	uint32_t occluded = 0;
+	start = Clock::now();
+	for (uint32_t r = 0; r < repeats; r++) {
+		occluded = 0;
+		for (const Aabb& box : boxes)
+			occluded += !pyramid.isVisible(box, viewProjection);
+	}
+	double testTime = milliseconds(start) / repeats;
+
+	printf("  %s: %u occluders, %u triangles drawn at %ux%u in %.3f ms, pyramid %.3f ms\n", OcclusionRasterizer::getInstructionSet(),
+		occluderCount, rasterizer.getTriangleCount(), rasterizer.getWidth(), rasterizer.getHeight(), rasterTime, pyramidTime);
+	printf("  %u / %u boxes occluded, tested in %.3f ms\n", occluded, boxCount, testTime);
+}
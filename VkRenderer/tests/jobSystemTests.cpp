@@ -0,0 +1,102 @@
+#include "tests/test.hpp"
+#include "src/threadPool.hpp"
+
+// cpu bound work of a few microseconds
+static float work(uint32_t seed) {
+	float value = static_cast<float>(seed);
+	for (uint32_t i = 0; i < 2000; i++)
+		value = std::sqrt(value * 1.0001f + static_cast<float>(i));
+	return value;
+}
+
+static uint32_t getHardwareThreads() {
+	return std::max(1u, std::thread::hardware_concurrency());
+}
+
+// a few threads even on small machines, so the stealing and waking paths run
+static uint32_t getTestThreads() {
+	return std::max(4u, getHardwareThreads());
+}
+
+TEST(parallelForCallsEveryIndexOnce) {
+	ThreadPool pool(getTestThreads());
+	const uint32_t count = 100000;
+	std::vector<std::atomic<uint32_t>> calls(count);
+	pool.parallelFor(count, [&](uint32_t i) { calls[i]++; });
+	uint32_t wrong = 0;
+	for (auto& call : calls)
+		wrong += call != 1;
+	CHECK(wrong == 0);
+}
+
+TEST(parallelForOnASingleThread) {
+	ThreadPool pool(1);
+	uint32_t sum = 0;
+	pool.parallelFor(1000, [&](uint32_t i) { sum += i; });
+	CHECK(sum == 999 * 1000 / 2);
+	CHECK(pool.getThreadCount() == 1);
+}
+
+TEST(nestedParallelFor) {
+	ThreadPool pool(getTestThreads());
+	std::atomic<uint32_t> calls{ 0 };
+	pool.parallelFor(64, [&](uint32_t) {
+		pool.parallelFor(64, [&](uint32_t) { calls++; });
+	});
+	CHECK(calls == 64 * 64);
+}
+
+TEST(dependentJobsStartAfterTheirDependency) {
+	ThreadPool pool(getTestThreads());
+	JobCounter first, second;
+	std::atomic<uint32_t> firstDone{ 0 };
+	std::atomic<uint32_t> startedEarly{ 0 };
+	for (uint32_t i = 0; i < 256; i++)
+		pool.submit([&, i]() { work(i); firstDone++; }, &first);
+	for (uint32_t i = 0; i < 256; i++)
+		pool.submit([&]() { startedEarly += firstDone != 256; }, &second, &first);
+	pool.wait(second);
+	CHECK(first.isDone());
+	CHECK(startedEarly == 0);
+}
+
+TEST(jobsSubmittedOutsideThePool) {
+	ThreadPool pool(getTestThreads());
+	JobCounter counter;
+	std::atomic<uint32_t> calls{ 0 };
+	std::thread thread([&]() {
+		for (uint32_t i = 0; i < 1000; i++)
+			pool.submit([&]() { calls++; }, &counter);
+		pool.wait(counter);
+	});
+	thread.join();
+	CHECK(calls == 1000);
+}
+
+TEST(threadIndicesAreInRange) {
+	ThreadPool pool(getTestThreads());
+	std::atomic<uint32_t> outOfRange{ 0 };
+	pool.parallelFor(10000, [&](uint32_t) { outOfRange += ThreadPool::getThreadIndex() >= pool.getThreadCount(); });
+	CHECK(outOfRange == 0);
+}
+
+// the same uneven work on more and more threads
+BENCHMARK(parallelForScaling) {
+	uint32_t hardwareThreads = getHardwareThreads();
+	const uint32_t itemCount = 1 << 14;
+	float singleMilliseconds = 0.0f;
+	for (uint32_t threadCount = 1; ; threadCount = std::min(threadCount * 2, hardwareThreads)) {
+		ThreadPool pool(threadCount);
+		std::vector<float> results(itemCount);
+		auto start = std::chrono::high_resolution_clock::now();
+		pool.parallelFor(itemCount, [&](uint32_t i) {
+			results[i] = work(i % 7 == 0 ? i * 4 : i);
+		});
+		float milliseconds = std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+		if (threadCount == 1)
+			singleMilliseconds = milliseconds;
+		printf("  %2u threads %8.2f ms, %.2fx\n", threadCount, milliseconds, singleMilliseconds / milliseconds);
+		if (threadCount == hardwareThreads)
+			break;
+	}
+}
@@ -0,0 +1,401 @@
+#include "tests/test.hpp"
+#include "src/vertexWelder.hpp"
+#include "src/meshOptimizer.hpp"
+#include "src/culling.hpp"
+#include <random>
+#include <tuple>
+#include <unordered_map>
+
+namespace std {
+	template<> struct hash<Vertex> {
+		size_t operator()(Vertex const& vertex) const {
+			return ((hash<glm::vec3>()(vertex.pos) ^
+				(hash<glm::vec3>()(vertex.normal) << 1)) >> 1) ^
+				(hash<glm::vec2>()(vertex.texCoord) << 1);
+		}
+	};
+}
+
+// the corners of a size x size grid of quads, two triangles each, as an obj loader reads them before welding
+static std::vector<Vertex> getGridCorners(uint32_t size) {
+	auto getVertex = [size](uint32_t x, uint32_t y) {
+		Vertex vertex{};
+		vertex.pos = glm::vec3(static_cast<float>(x), 0.0f, static_cast<float>(y));
+		vertex.normal = glm::vec3(0.0f, 1.0f, 0.0f);
+		vertex.texCoord = glm::vec2(static_cast<float>(x) / size, static_cast<float>(y) / size);
+		return vertex;
+	};
+
+	std::vector<Vertex> corners;
+	corners.reserve(size * size * 6);
+	for (uint32_t y = 0; y < size; y++) {
+		for (uint32_t x = 0; x < size; x++) {
+			const Vertex quad[4] = { getVertex(x, y), getVertex(x + 1, y), getVertex(x + 1, y + 1), getVertex(x, y + 1) };
+			for (uint32_t corner : { 0, 1, 2, 0, 2, 3 })
+				corners.push_back(quad[corner]);
+		}
+	}
+	return corners;
+}
+
+TEST(welderMergesSharedCorners) {
+	const uint32_t size = 64;
+	std::vector<Vertex> corners = getGridCorners(size);
+
+	std::vector<Vertex> vertices;
+	VertexWelder welder(vertices, corners.size() / 3);
+	bool same = true;
+	for (const Vertex& corner : corners)
+		same &= vertices[welder.weld(corner)] == corner;
+
+	CHECK(same);
+	CHECK(vertices.size() == (size + 1) * (size + 1));
+	CHECK(welder.getLookupCount() == corners.size());
+}
+
+TEST(welderFoldsNegativeZero) {
+	Vertex positive{};
+	positive.normal = glm::vec3(0.0f, 1.0f, 0.0f);
+	Vertex negative = positive;
+	negative.pos = glm::vec3(-0.0f, 0.0f, -0.0f);
+
+	std::vector<Vertex> vertices;
+	VertexWelder welder(vertices, 2);
+	CHECK(welder.weld(positive) == welder.weld(negative));
+	CHECK(vertices.size() == 1);
+}
+
+// the welder against the previous std::unordered_map deduplication, on the shuffled triangles of a large grid
+BENCHMARK(vertexWelding) {
+	using Clock = std::chrono::high_resolution_clock;
+	auto milliseconds = [](Clock::time_point start) {
+		return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+	};
+
+	std::vector<Vertex> corners = getGridCorners(512);
+	std::vector<uint32_t> triangles(corners.size() / 3);
+	for (uint32_t i = 0; i < triangles.size(); i++)
+		triangles[i] = i;
+	std::shuffle(triangles.begin(), triangles.end(), std::mt19937(1));
+	std::vector<Vertex> shuffled;
+	shuffled.reserve(corners.size());
+	for (uint32_t triangle : triangles)
+		shuffled.insert(shuffled.end(), corners.begin() + triangle * 3, corners.begin() + triangle * 3 + 3);
+
+	std::vector<uint32_t> indices;
+	indices.reserve(shuffled.size());
+
+	auto start = Clock::now();
+	std::vector<Vertex> mapVertices;
+	std::unordered_map<Vertex, uint32_t> uniqueVertices{};
+	for (const Vertex& vertex : shuffled) {
+		if (uniqueVertices.count(vertex) == 0) {
+			uniqueVertices[vertex] = static_cast<uint32_t>(mapVertices.size());
+			mapVertices.push_back(vertex);
+		}
+		indices.push_back(uniqueVertices[vertex]);
+	}
+	double mapTime = milliseconds(start);
+
+	indices.clear();
+	start = Clock::now();
+	std::vector<Vertex> welderVertices;
+	VertexWelder welder(welderVertices, shuffled.size() / 3);
+	for (const Vertex& vertex : shuffled)
+		indices.push_back(welder.weld(vertex));
+	double welderTime = milliseconds(start);
+
+	printf("  %zu corners: unordered_map %.2f ms (%zu vertices), welder %.2f ms (%zu vertices, %.3f extra probes per lookup)\n",
+		shuffled.size(), mapTime, mapVertices.size(), welderTime, welderVertices.size(),
+		static_cast<double>(welder.getProbeCount()) / welder.getLookupCount());
+}
+
+// a uv sphere of radius 1, its triangles in a random order
+static void getShuffledSphere(uint32_t rings, uint32_t segments, std::vector<Vertex>& vertices, std::vector<uint32_t>& indices) {
+	const float pi = 3.14159265f;
+	for (uint32_t ring = 0; ring <= rings; ring++) {
+		float theta = pi * ring / rings;
+		for (uint32_t segment = 0; segment <= segments; segment++) {
+			float phi = 2.0f * pi * segment / segments;
+			Vertex vertex{};
+			vertex.pos = glm::vec3(std::sin(theta) * std::cos(phi), std::cos(theta), std::sin(theta) * std::sin(phi));
+			vertex.normal = vertex.pos;
+			vertex.texCoord = glm::vec2(static_cast<float>(segment) / segments, static_cast<float>(ring) / rings);
+			vertices.push_back(vertex);
+		}
+	}
+
+	std::vector<glm::uvec4> triangles;
+	for (uint32_t ring = 0; ring < rings; ring++) {
+		for (uint32_t segment = 0; segment < segments; segment++) {
+			uint32_t a = ring * (segments + 1) + segment;
+			uint32_t b = a + segments + 1;
+			triangles.push_back({ a, b, a + 1, 0 });
+			triangles.push_back({ a + 1, b, b + 1, 0 });
+		}
+	}
+	std::shuffle(triangles.begin(), triangles.end(), std::mt19937(1));
+	for (const glm::uvec4& triangle : triangles)
+		indices.insert(indices.end(), { triangle.x, triangle.y, triangle.z });
+}
+
+// every triangle once, starting from any of its corners
+static std::vector<glm::uvec4> getSortedTriangles(const std::vector<uint32_t>& indices) {
+	std::vector<glm::uvec4> triangles;
+	for (size_t i = 0; i + 2 < indices.size(); i += 3) {
+		uint32_t a = indices[i], b = indices[i + 1], c = indices[i + 2];
+		uint32_t first = std::min(a, std::min(b, c));
+		glm::uvec4 triangle = first == a ? glm::uvec4{ a, b, c, 0 } : first == b ? glm::uvec4{ b, c, a, 0 } : glm::uvec4{ c, a, b, 0 };
+		triangles.push_back(triangle);
+	}
+	std::sort(triangles.begin(), triangles.end(), [](const glm::uvec4& a, const glm::uvec4& b) {
+		return std::tie(a.x, a.y, a.z) < std::tie(b.x, b.y, b.z);
+	});
+	return triangles;
+}
+
+static bool sameTriangles(const std::vector<uint32_t>& a, const std::vector<uint32_t>& b) {
+	std::vector<glm::uvec4> trianglesA = getSortedTriangles(a), trianglesB = getSortedTriangles(b);
+	return std::equal(trianglesA.begin(), trianglesA.end(), trianglesB.begin(), trianglesB.end(), [](const glm::uvec4& a, const glm::uvec4& b) {
+		return a.x == b.x && a.y == b.y && a.z == b.z;
+	});
+}
+
+TEST(vertexCacheOrderLowersAcmr) {
+	std::vector<Vertex> vertices;
+	std::vector<uint32_t> indices;
+	getShuffledSphere(64, 128, vertices, indices);
+	std::vector<uint32_t> source = indices;
+
+	auto shuffled = MeshOptimizer::analyzeVertexCache(indices.data(), indices.size(), vertices.size());
+	MeshOptimizer::optimizeVertexCache(indices.data(), indices.size(), vertices.size());
+	auto cacheOrder = MeshOptimizer::analyzeVertexCache(indices.data(), indices.size(), vertices.size());
+	CHECK(sameTriangles(source, indices));
+	CHECK(cacheOrder.acmr < shuffled.acmr * 0.5f);
+	CHECK(cacheOrder.acmr < 0.8f);
+
+	// the overdraw order only moves whole clusters, it costs the few vertices still cached across a cut
+	MeshOptimizer::optimizeOverdraw(indices.data(), indices.size(), vertices.data(), vertices.size());
+	auto overdrawOrder = MeshOptimizer::analyzeVertexCache(indices.data(), indices.size(), vertices.size());
+	CHECK(sameTriangles(source, indices));
+	CHECK(overdrawOrder.acmr < cacheOrder.acmr * 1.05f);
+}
+
+TEST(vertexFetchOrderKeepsTriangles) {
+	std::vector<Vertex> vertices;
+	std::vector<uint32_t> indices;
+	getShuffledSphere(16, 32, vertices, indices);
+	std::vector<Vertex> sourceVertices = vertices;
+	std::vector<uint32_t> sourceIndices = indices;
+
+	uint32_t vertexCount = MeshOptimizer::optimizeVertexFetch(vertices.data(), indices.data(), indices.size(), vertices.size());
+	CHECK(vertexCount <= sourceVertices.size());
+
+	bool same = true, ordered = true;
+	uint32_t next = 0;
+	for (size_t i = 0; i < indices.size(); i++) {
+		same &= indices[i] < vertexCount && vertices[indices[i]] == sourceVertices[sourceIndices[i]];
+		ordered &= indices[i] <= next;
+		next = std::max(next, indices[i] + 1);
+	}
+	CHECK(same);
+	CHECK(ordered);
+}
+
+// acmr and timings of each reordering step on shuffled spheres
+BENCHMARK(meshReordering) {
+	using Clock = std::chrono::high_resolution_clock;
+	auto milliseconds = [](Clock::time_point start) {
+		return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+	};
+
+	for (uint32_t rings : { 32, 128, 512 }) {
+		std::vector<Vertex> vertices;
+		std::vector<uint32_t> indices;
+		getShuffledSphere(rings, rings * 2, vertices, indices);
+
+		auto shuffled = MeshOptimizer::analyzeVertexCache(indices.data(), indices.size(), vertices.size());
+		auto start = Clock::now();
+		MeshOptimizer::optimizeVertexCache(indices.data(), indices.size(), vertices.size());
+		double cacheTime = milliseconds(start);
+		auto cacheOrder = MeshOptimizer::analyzeVertexCache(indices.data(), indices.size(), vertices.size());
+
+		start = Clock::now();
+		MeshOptimizer::optimizeOverdraw(indices.data(), indices.size(), vertices.data(), vertices.size());
+		double overdrawTime = milliseconds(start);
+		auto overdrawOrder = MeshOptimizer::analyzeVertexCache(indices.data(), indices.size(), vertices.size());
+
+		printf("  %zu triangles: acmr shuffled %.3f, vertex cache %.3f in %.2f ms, overdraw %.3f in %.2f ms\n", indices.size() / 3,
+			shuffled.acmr, cacheOrder.acmr, cacheTime, overdrawOrder.acmr, overdrawTime);
+	}
+}
+
+TEST(meshletsCoverIndicesOnce) {
+	std::vector<Vertex> vertices;
+	std::vector<uint32_t> indices;
+	getShuffledSphere(64, 128, vertices, indices);
+	MeshOptimizer::optimizeVertexCache(indices.data(), indices.size(), vertices.size());
+
+	std::vector<Meshlet> meshlets;
+	MeshOptimizer::buildMeshlets(indices.data(), indices.size(), vertices.data(), vertices.size(), meshlets);
+	CHECK(!meshlets.empty());
+
+	// meshlets follow each other in the index list, without gaps nor overlaps
+	bool limits = true, contiguous = true, bounded = true;
+	uint32_t next = 0;
+	for (const Meshlet& meshlet : meshlets) {
+		contiguous &= meshlet.firstIndex == next && meshlet.indexCount > 0 && meshlet.indexCount % 3 == 0;
+		next = meshlet.firstIndex + meshlet.indexCount;
+
+		std::vector<uint32_t> unique(indices.begin() + meshlet.firstIndex, indices.begin() + next);
+		std::sort(unique.begin(), unique.end());
+		unique.erase(std::unique(unique.begin(), unique.end()), unique.end());
+		limits &= unique.size() <= MeshOptimizer::MESHLET_MAX_VERTICES && meshlet.indexCount / 3 <= MeshOptimizer::MESHLET_MAX_TRIANGLES;
+		for (uint32_t vertex : unique)
+			bounded &= glm::length(vertices[vertex].pos - meshlet.center) <= meshlet.radius * 1.0001f;
+	}
+	CHECK(limits);
+	CHECK(contiguous);
+	CHECK(next == indices.size());
+	CHECK(bounded);
+}
+
+TEST(meshletConeKeepsFrontFaces) {
+	std::vector<Vertex> vertices;
+	std::vector<uint32_t> indices;
+	getShuffledSphere(32, 64, vertices, indices);
+	MeshOptimizer::optimizeVertexCache(indices.data(), indices.size(), vertices.size());
+	std::vector<Meshlet> meshlets;
+	MeshOptimizer::buildMeshlets(indices.data(), indices.size(), vertices.data(), vertices.size(), meshlets);
+
+	std::mt19937 random(1);
+	std::normal_distribution<float> direction;
+	uint32_t backfaceCulled = 0;
+	bool frontKept = true, rangesMatch = true, rangesDisjoint = true;
+	for (uint32_t view = 0; view < 64; view++) {
+		// a wide view from outside the sphere, the whole of it inside the frustum so only the cone test culls
+		glm::vec3 eye = glm::normalize(glm::vec3(direction(random), direction(random), direction(random))) * 3.0f;
+		glm::mat4 projection = glm::perspective(glm::radians(120.0f), 1.0f, 0.1f, 100.0f);
+		glm::mat4 viewMatrix = glm::lookAt(eye, glm::vec3(0.0f), std::abs(eye.y) < 2.9f ? glm::vec3(0.0f, 1.0f, 0.0f) : glm::vec3(1.0f, 0.0f, 0.0f));
+		CullView cullView = CullView::create(projection * viewMatrix, eye, glm::mat4(1.0f), true, 1.0f);
+
+		std::vector<IndexRange> ranges;
+		CullingStats stats;
+		cullMeshlets(meshlets.data(), meshlets.size(), cullView, ranges, stats);
+		CHECK(stats.frustumCulled == 0);
+		backfaceCulled += stats.backfaceCulled;
+
+		std::vector<uint8_t> covered(indices.size(), 0);
+		for (const IndexRange& range : ranges) {
+			for (uint32_t i = range.firstIndex; i < range.firstIndex + range.indexCount; i++) {
+				rangesDisjoint &= covered[i] == 0;
+				covered[i] = 1;
+			}
+		}
+
+		// a meshlet is either wholly in the ranges or not at all, the visible ones add up to the ranges
+		uint32_t visibleIndices = 0, rangeIndices = 0, visibleMeshlets = 0;
+		for (const IndexRange& range : ranges)
+			rangeIndices += range.indexCount;
+		for (const Meshlet& meshlet : meshlets) {
+			uint32_t coveredIndices = 0;
+			bool frontFacing = false;
+			for (uint32_t i = meshlet.firstIndex; i < meshlet.firstIndex + meshlet.indexCount; i += 3) {
+				coveredIndices += covered[i] + covered[i + 1] + covered[i + 2];
+				const glm::vec3& p0 = vertices[indices[i]].pos;
+				glm::vec3 normal = glm::cross(vertices[indices[i + 1]].pos - p0, vertices[indices[i + 2]].pos - p0);
+				frontFacing |= glm::dot(normal, p0 - eye) < 0.0f;
+			}
+			rangesMatch &= coveredIndices == 0 || coveredIndices == meshlet.indexCount;
+			if (coveredIndices == meshlet.indexCount) {
+				visibleIndices += meshlet.indexCount;
+				visibleMeshlets++;
+			}
+			frontKept &= !frontFacing || coveredIndices == meshlet.indexCount;
+		}
+		rangesMatch &= visibleIndices == rangeIndices && visibleMeshlets == stats.visibleMeshlets;
+		rangesMatch &= stats.visibleMeshlets + stats.backfaceCulled == meshlets.size();
+	}
+	CHECK(frontKept);
+	CHECK(rangesMatch);
+	CHECK(rangesDisjoint);
+	// the test means nothing if the cones never cull
+	CHECK(backfaceCulled > 0);
+}
+
+// every level in range of the index list, made of whole triangles pointing at existing vertices, none of them degenerate
+static bool validLevels(const std::vector<uint32_t>& indices, size_t vertexCount, const std::vector<MeshLod>& lods) {
+	bool valid = true;
+	for (const MeshLod& lod : lods) {
+		valid &= lod.indexCount % 3 == 0 && lod.firstIndex + lod.indexCount <= indices.size();
+		for (uint32_t i = lod.firstIndex; valid && i < lod.firstIndex + lod.indexCount; i += 3) {
+			uint32_t a = indices[i], b = indices[i + 1], c = indices[i + 2];
+			valid &= a < vertexCount && b < vertexCount && c < vertexCount && a != b && b != c && a != c;
+		}
+	}
+	return valid;
+}
+
+TEST(lodErrorGrowsWithinBudget) {
+	std::vector<Vertex> vertices;
+	std::vector<uint32_t> indices;
+	getShuffledSphere(64, 128, vertices, indices);
+	MeshOptimizer::optimizeVertexCache(indices.data(), indices.size(), vertices.size());
+	size_t sourceIndexCount = indices.size();
+
+	std::vector<MeshLod> lods;
+	MeshOptimizer::buildLods(indices, vertices.data(), vertices.size(), lods);
+	CHECK(lods.size() > 2);
+	CHECK(lods[0].firstIndex == 0 && lods[0].indexCount == sourceIndexCount && lods[0].error == 0.0f);
+	CHECK(validLevels(indices, vertices.size(), lods));
+
+	// the sphere's bounding box diagonal
+	float maxError = MeshOptimizer::LOD_MAX_ERROR * glm::length(glm::vec3(2.0f));
+	bool fewer = true, growing = true, bounded = true;
+	for (size_t i = 1; i < lods.size(); i++) {
+		fewer &= lods[i].indexCount < lods[i - 1].indexCount;
+		growing &= lods[i].error >= lods[i - 1].error;
+		bounded &= lods[i].error <= maxError;
+	}
+	CHECK(fewer);
+	CHECK(growing);
+	CHECK(bounded);
+
+	// a single simplification with no triangle target stops at its error budget
+	std::vector<uint32_t> destination(sourceIndexCount);
+	float error = 0.0f;
+	size_t indexCount = MeshOptimizer::simplify(destination.data(), indices.data(), sourceIndexCount, vertices.data(), vertices.size(), 0, 0.01f, &error);
+	CHECK(indexCount > 0 && indexCount < sourceIndexCount);
+	CHECK(error <= 0.01f);
+}
+
+TEST(lodKeepsLockedBorders) {
+	// a welded bumpy grid, its outer edges are open
+	const uint32_t size = 32;
+	std::vector<Vertex> corners = getGridCorners(size);
+	std::vector<Vertex> vertices;
+	std::vector<uint32_t> indices;
+	VertexWelder welder(vertices, corners.size() / 3);
+	for (const Vertex& corner : corners)
+		indices.push_back(welder.weld(corner));
+	for (Vertex& vertex : vertices)
+		vertex.pos.y = 0.2f * std::sin(vertex.pos.x * 0.4f) * std::cos(vertex.pos.z * 0.3f);
+
+	std::vector<MeshLod> lods;
+	MeshOptimizer::buildLods(indices, vertices.data(), vertices.size(), lods);
+	CHECK(lods.size() > 1);
+	CHECK(validLevels(indices, vertices.size(), lods));
+
+	bool bordersKept = true;
+	for (const MeshLod& lod : lods) {
+		std::vector<bool> used(vertices.size(), false);
+		for (uint32_t i = lod.firstIndex; i < lod.firstIndex + lod.indexCount; i++)
+			used[indices[i]] = true;
+		for (uint32_t v = 0; v < vertices.size(); v++) {
+			const glm::vec3& pos = vertices[v].pos;
+			bool border = pos.x == 0.0f || pos.x == size || pos.z == 0.0f || pos.z == size;
+			bordersKept &= !border || used[v];
+		}
+	}
+	CHECK(bordersKept);
+}
@@ -0,0 +1,125 @@
+#include "tests/test.hpp"
+#include "src/renderQueue.hpp"
+#include <random>
+
+static bool compareKeys(const RenderQueue::Item& a, const RenderQueue::Item& b) {
+	return a.key < b.key;
+}
+
+// a few hundred materials, two index types and random depths, like a large scene's forward pass
+static std::vector<RenderQueue::Item> getForwardPassItems(uint32_t count, uint32_t seed) {
+	std::mt19937 random(seed);
+	std::uniform_int_distribution<uint32_t> material(0, 299);
+	std::uniform_int_distribution<uint32_t> geometry(0, 1);
+	std::uniform_real_distribution<float> depth(0.0f, 1.0f);
+	std::vector<RenderQueue::Item> items(count);
+	for (uint32_t i = 0; i < count; i++)
+		items[i] = { RenderQueue::makeKey(0, material(random), geometry(random), depth(random)), i };
+	return items;
+}
+
+// the queue's order of items against std::stable_sort's, and std::sort's keys
+static bool sortsLikeStd(const std::vector<RenderQueue::Item>& items) {
+	RenderQueue queue;
+	for (const RenderQueue::Item& item : items)
+		queue.push(item.key, item.draw);
+	queue.sort();
+
+	std::vector<RenderQueue::Item> stable = items;
+	std::stable_sort(stable.begin(), stable.end(), compareKeys);
+	std::vector<RenderQueue::Item> unstable = items;
+	std::sort(unstable.begin(), unstable.end(), compareKeys);
+
+	if (queue.size() != items.size())
+		return false;
+	for (size_t i = 0; i < items.size(); i++) {
+		const RenderQueue::Item& item = queue.getItems()[i];
+		if (item.key != stable[i].key || item.draw != stable[i].draw || item.key != unstable[i].key)
+			return false;
+	}
+	return true;
+}
+
+TEST(renderQueueKeyFields) {
+	uint64_t key = RenderQueue::makeKey(7, 1234, 56, 0.5f);
+	CHECK(key >> 56 == 7);
+	CHECK(RenderQueue::getMaterial(key) == 1234);
+	CHECK(RenderQueue::getGeometry(key) == 56);
+	CHECK((key & 0xffffff) == static_cast<uint32_t>(0.5f * 0xffffff));
+
+	// out of range fields are masked, depths clamped
+	uint64_t wide = RenderQueue::makeKey(0x1ff, 0x1ffff, 0x1ffff, 2.0f);
+	CHECK(wide >> 56 == 0xff);
+	CHECK(RenderQueue::getMaterial(wide) == 0xffff);
+	CHECK(RenderQueue::getGeometry(wide) == 0xffff);
+	CHECK((wide & 0xffffff) == 0xffffff);
+	CHECK((RenderQueue::makeKey(0, 0, 0, -1.0f) & 0xffffff) == 0);
+}
+
+TEST(renderQueueKeyOrder) {
+	// pipeline first, then material, geometry and depth
+	CHECK(RenderQueue::makeKey(0, 0xffff, 0xffff, 1.0f) < RenderQueue::makeKey(1, 0, 0, 0.0f));
+	CHECK(RenderQueue::makeKey(0, 0, 0xffff, 1.0f) < RenderQueue::makeKey(0, 1, 0, 0.0f));
+	CHECK(RenderQueue::makeKey(0, 0, 0, 1.0f) < RenderQueue::makeKey(0, 0, 1, 0.0f));
+	CHECK(RenderQueue::makeKey(0, 0, 0, 0.25f) < RenderQueue::makeKey(0, 0, 0, 0.5f));
+}
+
+TEST(renderQueueSortsLikeStd) {
+	CHECK(sortsLikeStd(getForwardPassItems(10000, 1)));
+
+	// every byte of the key differs, no pass is skipped
+	std::mt19937_64 random(2);
+	std::vector<RenderQueue::Item> items(10000);
+	for (uint32_t i = 0; i < items.size(); i++)
+		items[i] = { random(), i };
+	CHECK(sortsLikeStd(items));
+
+	// many equal keys, the push order is kept among them
+	for (uint32_t i = 0; i < items.size(); i++)
+		items[i].key = (items[i].key % 8) << 40;
+	CHECK(sortsLikeStd(items));
+}
+
+TEST(renderQueueSortsSmallAndUniformQueues) {
+	CHECK(sortsLikeStd({}));
+	CHECK(sortsLikeStd({ { 5, 0 } }));
+	CHECK(sortsLikeStd({ { 5, 0 }, { 3, 1 } }));
+
+	// every pass is skipped, nothing moves
+	std::vector<RenderQueue::Item> items(100);
+	for (uint32_t i = 0; i < items.size(); i++)
+		items[i] = { RenderQueue::makeKey(1, 2, 3, 0.5f), i };
+	CHECK(sortsLikeStd(items));
+}
+
+// the radix sort against std::stable_sort on forward pass keys
+BENCHMARK(renderQueueSort) {
+	using Clock = std::chrono::high_resolution_clock;
+	auto milliseconds = [](Clock::time_point start) {
+		return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+	};
+
+	const uint32_t drawCount = 100000;
+	std::vector<RenderQueue::Item> items = getForwardPassItems(drawCount, 1);
+
+	RenderQueue queue;
+	const uint32_t repeats = 20;
+	double radixTime = 0.0;
+	for (uint32_t r = 0; r < repeats; r++) {
+		queue.clear();
+		for (const RenderQueue::Item& item : items)
+			queue.push(item.key, item.draw);
+		auto start = Clock::now();
+		queue.sort();
+		radixTime += milliseconds(start);
+	}
+
+	double stdTime = 0.0;
+	for (uint32_t r = 0; r < repeats; r++) {
+		std::vector<RenderQueue::Item> sorted = items;
+		auto start = Clock::now();
+		std::stable_sort(sorted.begin(), sorted.end(), compareKeys);
+		stdTime += milliseconds(start);
+	}
+	printf("  %u draws sorted in %.3f ms, std::stable_sort %.3f ms\n", drawCount, radixTime / repeats, stdTime / repeats);
+}
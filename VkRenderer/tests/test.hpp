@@ -0,0 +1,28 @@
+#pragma once
+#include "src/vulkan/vkHeader.hpp"
+#include <functional>
+
+// cpu only checks of the renderer, without a window nor a gpu. a test fails when one of its CHECKs does, the executable
+// then returns EXIT_FAILURE. benchmarks only run with --benchmark, they time and print rather than check
+namespace Test {
+	void add(const char* name, std::function<void()> func, bool benchmark);
+	void fail(const char* expression, const char* file, int line);
+
+	struct Registrar {
+		Registrar(const char* name, void (*func)(), bool benchmark) { add(name, func, benchmark); }
+	};
+}
+
+#define TEST(name) \
+	static void name(); \
+	static Test::Registrar name##Registrar(#name, name, false); \
+	static void name()
+
+#define BENCHMARK(name) \
+	static void name(); \
+	static Test::Registrar name##Registrar(#name, name, true); \
+	static void name()
+
+// any thread may check
+#define CHECK(x) \
+	do { if (!(x)) Test::fail(#x, __FILE__, __LINE__); } while (0)
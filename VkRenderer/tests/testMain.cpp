@@ -0,0 +1,60 @@
+#include "tests/test.hpp"
+#include <atomic>
+
+namespace Test {
+	struct Entry {
+		const char* name;
+		std::function<void()> func;
+		bool benchmark;
+	};
+
+	// filled by the static registrars before main
+	static std::vector<Entry>& getEntries() {
+		static std::vector<Entry> entries;
+		return entries;
+	}
+
+	static std::atomic<uint32_t> failures{ 0 };
+
+	void add(const char* name, std::function<void()> func, bool benchmark) {
+		getEntries().push_back({ name, std::move(func), benchmark });
+	}
+
+	void fail(const char* expression, const char* file, int line) {
+		printf("  CHECK failed: %s [%s:%d]\n", expression, file, line);
+		failures++;
+	}
+}
+
+// usage : <tests> [--benchmark] [name...], every test, or benchmark, when no name is given
+int main(int argc, char** argv) {
+	bool benchmark = false;
+	std::vector<std::string> names;
+	for (int i = 1; i < argc; i++) {
+		if (strcmp(argv[i], "--benchmark") == 0)
+			benchmark = true;
+		else
+			names.push_back(argv[i]);
+	}
+
+	uint32_t run = 0, failed = 0;
+	for (const Test::Entry& entry : Test::getEntries()) {
+		if (entry.benchmark != benchmark)
+			continue;
+		if (!names.empty() && std::find(names.begin(), names.end(), entry.name) == names.end())
+			continue;
+
+		printf("%s\n", entry.name);
+		uint32_t failuresBefore = Test::failures;
+		auto start = std::chrono::high_resolution_clock::now();
+		entry.func();
+		float milliseconds = std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+		bool passed = Test::failures == failuresBefore;
+		printf("  %s in %.1f ms\n", passed ? "ok" : "FAILED", milliseconds);
+		run++;
+		failed += !passed;
+	}
+
+	printf("%u / %u %s passed\n", run - failed, run, benchmark ? "benchmarks" : "tests");
+	return failed == 0 && run > 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}